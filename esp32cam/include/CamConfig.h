@@ -0,0 +1,59 @@
+/**
+ * @file CamConfig.h
+ * @author @sebastiano123-c
+ * @brief Configuration of the ESP32-CAM companion: change these values as you need.
+ *
+ * The ESP32-CAM is wired to the flight controller on its UART0 (the pins of the programmer): U0R (GPIO3) to the TX
+ * of the flight controller (PIN_TX1), U0T (GPIO1) to its RX (PIN_RX1), and the grounds together. Unplug the
+ * flight controller while uploading.
+ *
+ * @version 0.1
+ * @date 2022-06-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef CAM_CONFIG_H
+#define CAM_CONFIG_H
+
+/**
+ * ----------------------------------------------------------------------------------------------------------------------------
+ *  WIFI:
+ *
+ *      The ESP32-CAM makes its access point: connect to it and open http://192.168.4.1.
+ */
+#define CAM_SSID                    "DroneInoTelemetry"
+#define CAM_PASSWORD                "DroneIno"                // at least 8 characters
+
+
+/**
+ * ----------------------------------------------------------------------------------------------------------------------------
+ *  LINK:
+ *
+ *      WIFI_BAUD_RATE must be the same of the flight controller (see ../src/Config.h).
+ *      The UART driver moves the bytes from the FIFO to its ring buffer in the interrupt; the relay task reads them
+ *      every time the ring has CAM_UART_WAKE bytes, or the line has been quiet for a while.
+ */
+#define WIFI_BAUD_RATE              115200                    // (9600, 57600, 115200)
+#define CAM_UART                    UART_NUM_0
+#define CAM_PIN_RX                  3
+#define CAM_PIN_TX                  1
+#define CAM_UART_RING_SIZE          2048                      // (bytes) of the driver
+#define CAM_UART_WAKE               64                        // (bytes)
+#define CAM_REQUEST_PERIOD          1000                      // (ms) between two requests of the parameters
+#define TELEMETRY_PUSH_PERIOD       100                       // (ms) between two WebSocket messages
+
+
+/**
+ * ----------------------------------------------------------------------------------------------------------------------------
+ *  CAMERA:
+ *
+ *      OV2640 of the AI-Thinker ESP32-CAM, streamed as MJPEG on http://192.168.4.1:81/stream. A larger frame or a
+ *      lower quality number takes more WiFi, which is shared with the telemetry.
+ */
+#define CAM_FRAME_SIZE              FRAMESIZE_VGA             // (FRAMESIZE_QVGA, FRAMESIZE_VGA, FRAMESIZE_SVGA)
+#define CAM_JPEG_QUALITY            12                        // (10-63) lower is better
+#define CAM_FRAME_BUFFERS           2                         // in the PSRAM
+#define CAM_STREAM_PORT             81
+
+#endif /* CAM_CONFIG_H */
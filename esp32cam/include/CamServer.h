@@ -0,0 +1,142 @@
+/**
+ * @file CamServer.h
+ * @author @sebastiano123-c
+ * @brief The page of the telemetry on the ESP32-CAM, the same of the NATIVE telemetry (see
+ * ../../include/WiFiTelemetry.h):
+ *  @li "/" the page, gzip'd in the flash (../../web/index.html);
+ *  @li "/parameters" the parameters of the flight controller, as the relay knows them;
+ *  @li "/set" a batch of parameters, sent to the flight controller as a LINK_SET;
+ *  @li "/status" the answer of the flight controller to a LINK_SET;
+ *  @li "/ws" the telemetry frames, sent by the relay task (see main.cpp).
+ *
+ * The handlers run in the task of AsyncTCP, the relay in its own task: relayLock protects the relayState. A handler
+ * never waits for the flight controller, or the other requests and the WebSocket would wait with it.
+ *
+ * @version 0.1
+ * @date 2022-06-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <WiFi.h>
+#include <AsyncTCP.h>
+#include <ESPAsyncWebServer.h>
+#include <driver/uart.h>
+#include "wifi/web_ui.h"
+
+#ifndef CAM_SERVER_H
+#define CAM_SERVER_H
+
+#define SET_ANSWER_TIMEOUT          100                       // (ms) for the LINK_STATUS of the flight controller
+
+relayState relay;
+SemaphoreHandle_t relayLock;
+uint8_t setSequence = 0;
+uint32_t setSentTime = 0;                                     // (ms) of the last LINK_SET
+
+AsyncWebServer server(80);
+AsyncWebSocket ws("/ws");
+
+
+/**
+ * @brief Handler of /set: the values of the request go to the flight controller in one LINK_SET, applied at the
+ * start of the same loop, or none of them. The answer is 202 with the sequence of the LINK_SET, to be asked to
+ * /status; 400 and 503 if the set cannot be sent.
+ *
+ * @param request
+ */
+void setCamParameters(AsyncWebServerRequest *request) {
+
+  const char *names[LINK_MAX_SET_PAIRS], *values[LINK_MAX_SET_PAIRS];
+  int count = request->params();
+  if (count > LINK_MAX_SET_PAIRS) {
+    request->send(400, "text/plain", "too many parameters");
+    return;
+  }
+  for (int i = 0; i < count; i++) {
+    AsyncWebParameter *p = request->getParam(i);
+    names[i] = p->name().c_str();
+    values[i] = p->value().c_str();
+  }
+
+  uint8_t frame[LINK_MAX_FRAME];
+  xSemaphoreTake(relayLock, portMAX_DELAY);
+  bool complete = relayParametersComplete(relay);
+  uint8_t sequence = ++setSequence;
+  size_t size = complete ? relaySetFrame(relay, names, values, count, sequence, frame) : 0;
+  xSemaphoreGive(relayLock);
+
+  if (!complete) {
+    request->send(503, "text/plain", "parameters not received yet");
+    return;
+  }
+  if (size == 0) {
+    request->send(400, "text/plain", "refused");
+    return;
+  }
+  uart_write_bytes(CAM_UART, (const char *)frame, size);
+  setSentTime = millis();
+  request->send(202, "text/plain", String(sequence));
+}
+
+/**
+ * @brief Handler of /status?seq=: the answer of the flight controller to the LINK_SET of that sequence (200, 400 if
+ * a value is wrong, 503 if it is busy), 202 with the sequence while it is on its way (a few loops), 504 if it does
+ * not come in SET_ANSWER_TIMEOUT or a newer LINK_SET took its place.
+ *
+ * @param request
+ */
+void setCamStatus(AsyncWebServerRequest *request) {
+
+  if (!request->hasParam("seq")) {
+    request->send(400, "text/plain", "no sequence");
+    return;
+  }
+  uint8_t sequence = (uint8_t)request->getParam("seq")->value().toInt();
+
+  xSemaphoreTake(relayLock, portMAX_DELAY);
+  int16_t status = relay.sequence == sequence ? relay.status : -1;
+  xSemaphoreGive(relayLock);
+
+  if (status >= 0)
+    request->send(status == PARAMETERS_STAGED ? 200 : (status == PARAMETERS_BUSY ? 503 : 400), "text/plain",
+                  parameterStatusText[status <= PARAMETERS_TUNED ? status : PARAMETERS_REFUSED]);
+  else if (sequence == setSequence && millis() - setSentTime < SET_ANSWER_TIMEOUT)
+    request->send(202, "text/plain", String(sequence));
+  else
+    request->send(504, "text/plain", "no answer");
+}
+
+/**
+ * @brief Starts the access point and the server.
+ * @note Web app link: 192.168.4.1
+ *
+ */
+void setupCamServer() {
+
+  WiFi.softAP(CAM_SSID, CAM_PASSWORD);
+
+  server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
+    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", WEB_UI, WEB_UI_LENGTH);
+    response->addHeader("Content-Encoding", "gzip");
+    request->send(response);
+  });
+
+  server.on("/parameters", HTTP_GET, [](AsyncWebServerRequest *request) {
+    char json[LINK_MAX_PARAMETERS * 32];
+    xSemaphoreTake(relayLock, portMAX_DELAY);
+    relayParametersJSON(relay, json, sizeof(json));
+    xSemaphoreGive(relayLock);
+    request->send(200, "application/json", json);             // the response keeps its own copy, sent later
+  });
+
+  server.on("/set", HTTP_GET, setCamParameters);
+  server.on("/set", HTTP_POST, setCamParameters);
+  server.on("/status", HTTP_GET, setCamStatus);
+
+  server.addHandler(&ws);
+  server.onNotFound([](AsyncWebServerRequest *request) { request->send(404, "text/plain", "Not found"); });
+  server.begin();
+}
+
+#endif /* CAM_SERVER_H */
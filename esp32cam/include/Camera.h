@@ -0,0 +1,32 @@
+/**
+ * @file Camera.h
+ * @author @sebastiano123-c
+ * @brief The OV2640 of the ESP32-CAM, streamed as MJPEG (multipart/x-mixed-replace) on /stream.
+ *
+ * The stream has its own server (esp_http_server, on CAM_STREAM_PORT): every client keeps a task busy while it
+ * watches, so the page and the WebSocket of CamServer.h, on port 80, never wait for it. The functions are in
+ * Camera.cpp, out of the headers of the async server.
+ *
+ * @version 0.1
+ * @date 2022-06-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef CAMERA_H
+#define CAMERA_H
+
+/**
+ * @brief Starts the camera, with the pins of the AI-Thinker board.
+ *
+ * @return true if the camera answered
+ */
+bool setupCamera();
+
+/**
+ * @brief Starts the server of the stream, /stream on CAM_STREAM_PORT.
+ *
+ */
+void setupStream();
+
+#endif /* CAMERA_H */
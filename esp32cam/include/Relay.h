@@ -0,0 +1,243 @@
+/**
+ * @file Relay.h
+ * @author @sebastiano123-c
+ * @brief The ESP32-CAM side of the link with the flight controller (see ../include/TelemetryLink.h).
+ *
+ * The UART driver writes the bytes of the flight controller straight in relayState::received (relayReceiveBuffer()),
+ * and relayReceived() reads the frames there, in place:
+ *  @li the telemetry frames are put together in relayState::message, the WebSocket message of the page, taken by
+ *      relayTakeMessage() every TELEMETRY_PUSH_PERIOD: this is the only copy of the frames;
+ *  @li the parameters are kept, with their names, for /parameters and /set;
+ *  @li the LINK_STATUS of the last LINK_SET is kept for the page.
+ * The ESP32 UART has no DMA in the Arduino core: the driver moves the FIFO into its ring buffer in the interrupt,
+ * and the relay task reads it with a single uart_read_bytes() per wake up.
+ *
+ * Nothing here depends on the board, so the relay is compiled and tested on the computer too (see
+ * ../../test/simulator/camlink.cpp). One task only must call the functions on a relayState, or they must be
+ * called with a lock (see CamServer.h).
+ *
+ * @version 0.1
+ * @date 2022-06-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "TelemetryLink.h"
+
+#ifndef RELAY_H
+#define RELAY_H
+
+#define RELAY_RECEIVE_SIZE          1024                      // (bytes) from the flight controller, not yet read
+#define RELAY_BATCH_FRAMES          16                        // telemetry frames in a WebSocket message
+
+struct relayParameter {
+  char name[LINK_NAME_LENGTH];
+  float value;
+  bool known;                                                 // received at least once
+};
+
+struct relayState {
+  uint8_t received[RELAY_RECEIVE_SIZE];
+  size_t receivedLength;
+
+  uint8_t message[sizeof(telemetryBatch) + RELAY_BATCH_FRAMES * sizeof(telemetryFrame)];
+  uint16_t frames;                                            // in message
+  uint32_t telemetryFrames;                                   // received since the start
+  uint32_t dropped;                                           // lost because message was full
+  uint32_t errors;                                            // broken frames
+
+  relayParameter parameters[LINK_MAX_PARAMETERS];
+  uint8_t parameterCount;                                     // of the flight controller, 0 until the first one
+
+  uint8_t sequence;                                           // of the last LINK_SET
+  int16_t status;                                             // parameterStatus of the last LINK_SET, -1 none yet
+};
+
+
+/**
+ * @brief Empties the relay.
+ *
+ * @param relay
+ */
+inline void relayReset(relayState &relay){
+  memset(&relay, 0, sizeof(relay));
+  relay.status = -1;
+}
+
+/**
+ * @brief Where the UART can write the next bytes.
+ *
+ * @param relay
+ * @param room bytes that can be written
+ * @return uint8_t*
+ */
+inline uint8_t *relayReceiveBuffer(relayState &relay, size_t &room){
+  room = RELAY_RECEIVE_SIZE - relay.receivedLength;
+  return relay.received + relay.receivedLength;
+}
+
+/**
+ * @brief Reads the frames of the flight controller.
+ *
+ * @param relay
+ * @param count bytes just written in relayReceiveBuffer()
+ */
+inline void relayReceived(relayState &relay, size_t count){
+
+  relay.receivedLength += count;
+
+  size_t used = 0;
+  linkFrame frame;
+  for(;;){
+    used += linkScan(relay.received + used, relay.receivedLength - used, frame, relay.errors);
+    if(frame.payload == NULL) break;
+
+    if(frame.type == LINK_TELEMETRY && frame.length == sizeof(telemetryFrame)){
+      relay.telemetryFrames++;
+      if(relay.frames == RELAY_BATCH_FRAMES) relay.dropped++;
+      else memcpy(relay.message + sizeof(telemetryBatch) + relay.frames++ * sizeof(telemetryFrame),
+                  frame.payload, sizeof(telemetryFrame));
+    }
+    else if(frame.type == LINK_PARAMETER && frame.length == sizeof(linkParameter)){
+      linkParameter p;
+      memcpy(&p, frame.payload, sizeof(p));                   // the payload is not aligned
+      if(p.id < LINK_MAX_PARAMETERS && p.count <= LINK_MAX_PARAMETERS){
+        relayParameter &r = relay.parameters[p.id];
+        memcpy(r.name, p.name, LINK_NAME_LENGTH);
+        r.name[LINK_NAME_LENGTH - 1] = 0;
+        r.value = p.value;
+        r.known = true;
+        relay.parameterCount = p.count;
+      }
+    }
+    else if(frame.type == LINK_STATUS && frame.length == 2){
+      relay.sequence = frame.payload[0];
+      relay.status = frame.payload[1];
+    }
+    else relay.errors++;
+  }
+
+  if(used == 0 && relay.receivedLength == RELAY_RECEIVE_SIZE) used = 1;  // never stuck on a full buffer
+  relay.receivedLength -= used;
+  memmove(relay.received, relay.received + used, relay.receivedLength);
+}
+
+/**
+ * @brief Closes the WebSocket message with the frames received since the last one.
+ *
+ * @param relay
+ * @return size_t the bytes of relay.message to send, 0 if there are no frames
+ */
+inline size_t relayTakeMessage(relayState &relay){
+
+  if(relay.frames == 0) return 0;
+
+  telemetryBatch batch;
+  batch.frameSize = sizeof(telemetryFrame);
+  batch.frames = relay.frames;
+  batch.dropped = relay.dropped;
+  memcpy(relay.message, &batch, sizeof(batch));
+
+  size_t size = sizeof(telemetryBatch) + relay.frames * sizeof(telemetryFrame);
+  relay.frames = 0;
+  return size;
+}
+
+/**
+ * @brief Tells if all the parameters of the flight controller arrived.
+ *
+ * @param relay
+ * @return true
+ */
+inline bool relayParametersComplete(const relayState &relay){
+  if(relay.parameterCount == 0) return false;
+  for(int id = 0; id < relay.parameterCount; id++)
+    if(!relay.parameters[id].known) return false;
+  return true;
+}
+
+/**
+ * @brief Id of a parameter from its name, or from its number.
+ *
+ * @param relay
+ * @param name
+ * @return int -1 if unknown
+ */
+inline int relayFindParameter(const relayState &relay, const char *name){
+
+  for(int id = 0; id < relay.parameterCount; id++)
+    if(relay.parameters[id].known && strcmp(relay.parameters[id].name, name) == 0) return id;
+
+  char *end;
+  long id = strtol(name, &end, 10);
+  if(end != name && *end == 0 && id >= 0 && id < relay.parameterCount) return (int)id;
+  return -1;
+}
+
+/**
+ * @brief Writes the parameters as a JSON object, as /parameters of the flight controller does.
+ *
+ * @param relay
+ * @param json
+ * @param size
+ * @return size_t the length
+ */
+inline size_t relayParametersJSON(const relayState &relay, char *json, size_t size){
+  size_t length = snprintf(json, size, "{");
+  bool first = true;
+  for(int id = 0; id < relay.parameterCount && length < size; id++){
+    if(!relay.parameters[id].known) continue;
+    length += snprintf(json + length, size - length, "%s\"%s\":%.6g", first ? "" : ",", relay.parameters[id].name,
+                       relay.parameters[id].value);
+    first = false;
+  }
+  if(length < size) length += snprintf(json + length, size - length, "}");
+  return length < size ? length : size - 1;
+}
+
+/**
+ * @brief Writes the LINK_SET frame of a batch of parameters.
+ *
+ * @param relay
+ * @param names of the parameters, or their ids
+ * @param values as text
+ * @param count
+ * @param sequence of the frame, returned by the LINK_STATUS
+ * @param frame at least LINK_MAX_FRAME bytes
+ * @return size_t the bytes of the frame, 0 if a name or a value is wrong
+ */
+inline size_t relaySetFrame(const relayState &relay, const char *const *names, const char *const *values, int count,
+                            uint8_t sequence, uint8_t *frame){
+
+  if(count <= 0 || count > LINK_MAX_SET_PAIRS) return 0;
+
+  uint8_t payload[LINK_MAX_PAYLOAD];
+  payload[0] = sequence;
+  payload[1] = (uint8_t)count;
+
+  for(int i = 0; i < count; i++){
+    int id = relayFindParameter(relay, names[i]);
+    char *end;
+    float value = strtof(values[i], &end);
+    if(id < 0 || end == values[i] || *end != 0) return 0;
+
+    uint8_t *pair = payload + 2 + i * LINK_SET_PAIR_SIZE;
+    pair[0] = (uint8_t)id;
+    memcpy(pair + 1, &value, sizeof(value));
+  }
+  return linkEncode(frame, LINK_SET, payload, 2 + count * LINK_SET_PAIR_SIZE);
+}
+
+/**
+ * @brief Writes the LINK_REQUEST frame, that asks all the parameters.
+ *
+ * @param frame at least LINK_MAX_FRAME bytes
+ * @return size_t the bytes of the frame
+ */
+inline size_t relayRequestFrame(uint8_t *frame){
+  return linkEncode(frame, LINK_REQUEST, NULL, 0);
+}
+
+#endif /* RELAY_H */
@@ -0,0 +1,100 @@
+/**
+ * @file Camera.cpp
+ * @author @sebastiano123-c
+ * @brief The camera and its stream (see Camera.h). This is a translation unit of its own because esp_http_server.h
+ * and ESPAsyncWebServer.h both define HTTP_GET.
+ *
+ * @version 0.1
+ * @date 2022-06-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <Arduino.h>
+#include <esp_camera.h>
+#include <esp_http_server.h>
+#include "CamConfig.h"
+#include "Camera.h"
+
+#define STREAM_BOUNDARY             "droneinoframe"
+
+httpd_handle_t streamServer = NULL;
+
+/**
+ * @brief Starts the camera, with the pins of the AI-Thinker board.
+ *
+ * @return true if the camera answered
+ */
+bool setupCamera() {
+
+  camera_config_t config;
+  memset(&config, 0, sizeof(config));
+  config.ledc_channel = LEDC_CHANNEL_0;
+  config.ledc_timer = LEDC_TIMER_0;
+  config.pin_d0 = 5;
+  config.pin_d1 = 18;
+  config.pin_d2 = 19;
+  config.pin_d3 = 21;
+  config.pin_d4 = 36;
+  config.pin_d5 = 39;
+  config.pin_d6 = 34;
+  config.pin_d7 = 35;
+  config.pin_xclk = 0;
+  config.pin_pclk = 22;
+  config.pin_vsync = 25;
+  config.pin_href = 23;
+  config.pin_sscb_sda = 26;
+  config.pin_sscb_scl = 27;
+  config.pin_pwdn = 32;
+  config.pin_reset = -1;
+  config.xclk_freq_hz = 20000000;
+  config.pixel_format = PIXFORMAT_JPEG;
+  config.frame_size = CAM_FRAME_SIZE;
+  config.jpeg_quality = CAM_JPEG_QUALITY;
+  config.fb_count = CAM_FRAME_BUFFERS;
+
+  return esp_camera_init(&config) == ESP_OK;
+}
+
+/**
+ * @brief Handler of /stream: sends the frames of the camera, one after the other, until the client leaves.
+ *
+ * @param request
+ * @return esp_err_t
+ */
+esp_err_t streamHandler(httpd_req_t *request) {
+
+  char part[64];
+  esp_err_t result = httpd_resp_set_type(request, "multipart/x-mixed-replace;boundary=" STREAM_BOUNDARY);
+  httpd_resp_set_hdr(request, "Access-Control-Allow-Origin", "*");
+
+  while (result == ESP_OK) {
+    camera_fb_t *fb = esp_camera_fb_get();
+    if (fb == NULL)
+      return ESP_FAIL;
+
+    // the frame is sent from the buffer of the camera, then the buffer goes back to the driver
+    size_t length = snprintf(part, sizeof(part), "\r\n--" STREAM_BOUNDARY "\r\nContent-Type: image/jpeg\r\n"
+                             "Content-Length: %u\r\n\r\n", (unsigned)fb->len);
+    result = httpd_resp_send_chunk(request, part, length);
+    if (result == ESP_OK)
+      result = httpd_resp_send_chunk(request, (const char *)fb->buf, fb->len);
+    esp_camera_fb_return(fb);
+  }
+  return result;
+}
+
+/**
+ * @brief Starts the server of the stream.
+ *
+ */
+void setupStream() {
+
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.server_port = CAM_STREAM_PORT;
+  config.ctrl_port = CAM_STREAM_PORT + 32000;                 // not the one of the default server
+
+  httpd_uri_t stream = {"/stream", HTTP_GET, streamHandler, NULL};
+  if (httpd_start(&streamServer, &config) == ESP_OK)
+    httpd_register_uri_handler(streamServer, &stream);
+}
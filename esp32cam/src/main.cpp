@@ -0,0 +1,97 @@
+/**
+ * @file main.cpp
+ * @author @sebastiano123-c
+ * @brief ESP32-CAM companion of DroneIno: it streams the camera and relays the telemetry of the flight controller
+ * (WIFI_TELEMETRY ESP_CAM) on the same page of the NATIVE telemetry.
+ *
+ * Core 1 runs the relay task: it reads the UART of the flight controller straight into the relay (Relay.h), and
+ * every TELEMETRY_PUSH_PERIOD it sends the telemetry frames on the WebSocket. Core 0 runs the WiFi, the page and
+ * the camera stream. UART0 is the link, so nothing is printed on Serial.
+ *
+ * @version 0.1
+ * @date 2022-06-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <Arduino.h>
+#include "CamConfig.h"
+#include "Relay.h"
+#include "Camera.h"
+#include "CamServer.h"
+
+TaskHandle_t relayTaskHandle;
+
+
+/**
+ * @brief Starts the UART of the link, with the ring buffer of the driver filled in the interrupt.
+ *
+ */
+void setupLink() {
+  uart_config_t config;
+  memset(&config, 0, sizeof(config));
+  config.baud_rate = WIFI_BAUD_RATE;
+  config.data_bits = UART_DATA_8_BITS;
+  config.parity = UART_PARITY_DISABLE;
+  config.stop_bits = UART_STOP_BITS_1;
+  config.flow_ctrl = UART_HW_FLOWCTRL_DISABLE;
+
+  uart_param_config(CAM_UART, &config);
+  uart_set_pin(CAM_UART, CAM_PIN_TX, CAM_PIN_RX, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+  uart_driver_install(CAM_UART, CAM_UART_RING_SIZE, CAM_UART_RING_SIZE, 0, NULL, 0);
+}
+
+/**
+ * @brief Reads the flight controller, sends its telemetry on the WebSocket and asks the parameters until they all
+ * arrived.
+ *
+ * @param parameter
+ */
+void relayTask(void *parameter) {
+
+  uint32_t lastPush = millis(), lastRequest = 0;
+
+  for (;;) {
+    // the bytes go from the ring of the driver to the relay buffer, where the frames are read: a single copy
+    size_t room, buffered = 0;
+    uint8_t *buffer = relayReceiveBuffer(relay, room);
+    uart_get_buffered_data_len(CAM_UART, &buffered);
+    size_t wanted = buffered > CAM_UART_WAKE ? buffered : CAM_UART_WAKE;
+    int count = uart_read_bytes(CAM_UART, buffer, wanted < room ? wanted : room, 10 / portTICK_PERIOD_MS);
+
+    xSemaphoreTake(relayLock, portMAX_DELAY);
+    relayReceived(relay, count > 0 ? count : 0);
+    bool complete = relayParametersComplete(relay);
+
+    if (millis() - lastPush >= TELEMETRY_PUSH_PERIOD) {
+      lastPush = millis();
+      ws.cleanupClients();
+      size_t size = relayTakeMessage(relay);
+      if (size > 0 && ws.count() > 0 && ws.availableForWriteAll())
+        ws.binaryAll(relay.message, size);                    // a slow client loses the message, never the relay
+    }
+    xSemaphoreGive(relayLock);
+
+    if (!complete && millis() - lastRequest >= CAM_REQUEST_PERIOD) {
+      lastRequest = millis();
+      uint8_t frame[LINK_MAX_FRAME];
+      uart_write_bytes(CAM_UART, (const char *)frame, relayRequestFrame(frame));
+    }
+  }
+}
+
+void setup() {
+  relayReset(relay);
+  relayLock = xSemaphoreCreateMutex();
+
+  setupLink();
+  if (setupCamera())
+    setupStream();                                            // the page hides the camera without it
+  setupCamServer();
+
+  xTaskCreatePinnedToCore(relayTask, "relay", 4096, NULL, 2, &relayTaskHandle, 1);
+}
+
+void loop() {
+  vTaskDelete(NULL);                                          // everything runs in the tasks
+}
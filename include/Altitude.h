@@ -1,7 +1,7 @@
 /**
  * @file Altitude.h
  * @author @sebastiano123-c
- * @brief Pressure readings routines.
+ * @brief Pressure readings routines and altitude hold.
  *
  * Depending on the ALTITUDE_SENSOR macro value:
  *
@@ -9,6 +9,12 @@
  *  @li BME280*: not yet implemented;
  *  @li OFF: no altitude sensor, so there is no pressure data acquisition.
  *
+ * The barometer is read every other loop, to leave the bus to the compass in the other ones (see Compass.h). Its
+ * altitude, refined by the rangefinder close to the ground (see Proximity.h), corrects the estimator of
+ * AltitudeEstimator.h, which integrates the vertical acceleration of the MPU-6050 at every loop: estimatedAltitude
+ * and verticalSpeed are ready at 250Hz, without the lag of an average of the pressure readings.
+ * The altitude PID runs at every loop too: P and I on the altitude error (m), D on the vertical speed (m/s).
+ *
  * @note For now, the only sensor available is the BMP280, otherwise these routines return void.
  *
  * @version 0.1
@@ -18,10 +24,6 @@
  *
  */
 
-uint32_t sampleNumber = 5;
-uint8_t sampleCounter = 0;
-float samplePressure = 0.0f;
-
 #if ALTITUDE_SENSOR == BMP280
 
 /**
@@ -78,6 +80,8 @@ void readTrim()
     i++;
   }
 
+  traceInput(TRACE_BAROMETER_TRIMS, data, 32); // see FlightRecorder.h
+
   dig_T1 = (data[1] << 8) | data[0];
   dig_T2 = (data[3] << 8) | data[2];
   dig_T3 = (data[5] << 8) | data[4];
@@ -105,8 +109,8 @@ void readTrim()
 void checkAltitudeSensor()
 {
 
-  writeRegister(0xF4, 0x27);
-  writeRegister(0xF5, 0xA0);
+  writeRegister(0xF4, 0x27); // normal mode, pressure and temperature oversampling x1
+  writeRegister(0xF5, 0x08); // standby 0.5ms and IIR filter x4: a measure every ~6ms, the loop reads it every 8ms
 
   while (error != 0)
   {
@@ -181,7 +185,7 @@ unsigned long int calibration_P(signed long int adc_P)
 void readPressureData()
 {
 
-  uint32_t barometerData[8];
+  uint8_t barometerData[8];
 
   Wire.beginTransmission(ALTITUDE_SENSOR_ADDRESS);
   Wire.write(0xF7);
@@ -196,8 +200,10 @@ void readPressureData()
     i++;
   }
 
-  presRaw = (barometerData[0] << 12) | (barometerData[1] << 4) | (barometerData[2] >> 4);
-  tempRaw = (barometerData[3] << 12) | (barometerData[4] << 4) | (barometerData[5] >> 4);
+  traceInput(TRACE_BAROMETER, barometerData, 8); // see FlightRecorder.h
+
+  presRaw = ((uint32_t)barometerData[0] << 12) | ((uint32_t)barometerData[1] << 4) | (barometerData[2] >> 4);
+  tempRaw = ((uint32_t)barometerData[3] << 12) | ((uint32_t)barometerData[4] << 4) | (barometerData[5] >> 4);
 
   tempCal = calibration_T(tempRaw);
   pressCal = calibration_P(presRaw);
@@ -205,70 +211,9 @@ void readPressureData()
 
   pressure = (double)pressCal / 100.0;
 
-  altitudeMeasure = 44330 * (1 - pow(((float)pressure / PRESSURE_SEA_LEVEL), (1 / 5.255)));
-}
-
-/**
- * @brief Sample the pressure readings.
- *
- */
-void samplePressureReadings()
-{
-
-  samplePressure += pressure;        // increment the readings
-  sampleCounter = sampleCounter + 1; // increment counter
-
-  if (sampleCounter == sampleNumber)
-  {                                                  // after 10 samplings
-    pressureSampled = samplePressure / sampleNumber; // create the mean value
-    sampleCounter = 0;                               // reset
-    samplePressure = 0.0f;
-  }
+  altitudeMeasure = pressureAltitude(pressure, PRESSURE_SEA_LEVEL); // see AltitudeEstimator.h
 }
 
-/**
- * @brief Filter barometer readings for a smoother flight.
- *
- */
-void smoothPressureReadings()
-{
-  // To get a smoother pressure value we will use a 20 location rotating memory.
-  pressureTotalAverage -= pressureRotatingMem[pressureRotatingMemLocation]; // Subtract the current memory position to make room for the new value.
-  pressureRotatingMem[pressureRotatingMemLocation] = pressure;              // Calculate the new change between the actual pressure and the previous measurement.
-  pressureTotalAverage += pressureRotatingMem[pressureRotatingMemLocation]; // Add the new value to the long term avarage value.
-  pressureRotatingMemLocation++;                                            // Increase the rotating memory location.
-
-  if (pressureRotatingMemLocation == 20)
-    pressureRotatingMemLocation = 0;                       // Start at 0 when the memory location 20 is reached.
-  actualPressureFast = (float)pressureTotalAverage / 20.0; // Calculate the average pressure of the last 20 pressure readings.
-
-  // To get better results we will use a complementary fillter that can be adjusted by the fast average.
-  actualPressureSlow = actualPressureSlow * (float)0.985 + actualPressureFast * (float)0.015;
-  actualPressureDiff = actualPressureSlow - actualPressureFast; // Calculate the difference between the fast and the slow avarage value.
-
-  if (actualPressureDiff > 8)
-    actualPressureDiff = 8; // If the difference is larger then 8 limit the difference to 8.
-  if (actualPressureDiff < -8)
-    actualPressureDiff = -8; // If the difference is smaller then -8 limit the difference to -8.
-  // If the difference is larger then 1 or smaller then -1 the slow average is adjuste based on the error between the fast and slow average.
-  if (actualPressureDiff > 1 || actualPressureDiff < -1)
-    actualPressureSlow -= actualPressureDiff / 6.0;
-  actualPressure = actualPressureSlow; // The actualPressure is used in the program for altitude calculations.
-
-  // In the following part a rotating buffer is used to calculate the long term change between the various pressure measurements.
-  // This total value can be used to detect the direction (up/down) and speed of the quadcopter and functions as the D-controller of the total PID-controller.
-  if (manualAltitudeChange == 1)
-    pressureParachutePrevious = actualPressure * 10; // During manual altitude change the up/down detection is disabled.
-
-  parachuteThrottle -= parachuteBuffer[parachuteRotatingMemLocation];                              // Subtract the current memory position to make room for the new value.
-  parachuteBuffer[parachuteRotatingMemLocation] = actualPressure * 10 - pressureParachutePrevious; // Calculate the new change between the actual pressure and the previous measurement.
-  parachuteThrottle += parachuteBuffer[parachuteRotatingMemLocation];                              // Add the new value to the long term avarage value.
-  pressureParachutePrevious = actualPressure * 10;                                                 // Store the current measurement for the next loop.
-  parachuteRotatingMemLocation++;                                                                  // Increase the rotating memory location.
-
-  if (parachuteRotatingMemLocation == 30)
-    parachuteRotatingMemLocation = 0; // Start at 0 when the memory location 20 is reached.
-}
 #else
 
 void checkAltitudeSensor()
@@ -291,14 +236,6 @@ void calibration_P()
 {
   return;
 }
-void smoothPressureReadings()
-{
-  return;
-}
-void samplePressureReadings()
-{
-  return;
-}
 void readPressureData()
 {
   return;
@@ -307,58 +244,72 @@ void readPressureData()
 #endif
 
 /**
- * @brief  Transforms the barometer readings into the PID output pulses.
+ * @brief Moves the altitude and the vertical speed forward by one loop.
  *
- * When the throttle stick position is increased or decreased the altitude hold function is partially disabled.
- * The manualAltitudeChange variable will indicate if the altitude of the quadcopter is changed by the pilot.
+ * The vertical acceleration is the specific force of the accelerometer brought to the vertical with the roll and
+ * the pitch of calculateAnglePRY(): call it after that. A new barometer reading corrects the estimate.
  *
- * @param pressureForPID pressure value used for the PID calculations
+ * @param newReading true if the barometer has been read in this loop
  */
-void calculateAltitudeAdjustmentPID(float pressureForPID)
-{ //
+void calculateAltitudeEstimate(bool newReading)
+{
+
+  if (verticalEstimator.k1 == 0.0f)
+    resetAltitudeEstimator(verticalEstimator, ALTITUDE_ESTIMATOR_TIME); // the first time, see AltitudeEstimator.h
+
+  if (newReading) // close to the ground, refine the pressure with the rangefinder (see Proximity.h)
+    correctAltitudeEstimator(verticalEstimator, pressureAltitude(blendLowAltitude(pressure), PRESSURE_SEA_LEVEL));
+
+  float acceleration = verticalAcceleration((float)accAxis[1] / accSensibility, (float)accAxis[2] / accSensibility,
+                                            (float)accAxis[3] / accSensibility, angleRoll, anglePitch);
+  updateAltitudeEstimator(verticalEstimator, acceleration, 1.0f / gyroFrequency);
+
+  estimatedAltitude = verticalEstimator.altitude;
+  verticalSpeed = verticalEstimator.speed;
+}
+
+/**
+ * @brief  Transforms the estimated altitude and vertical speed into the PID output pulses.
+ *
+ * When the throttle stick position is increased or decreased the altitude hold function is partially disabled.
+ * The manualAltitudeChange variable will indicate if the altitude of the quadcopter is changed by the pilot: the
+ * set point follows the drone, and the stick adds manualThrottle to the output, which the D-controller turns
+ * into a climb rate.
+ */
+void calculateAltitudeAdjustmentPID()
+{
 
   manualAltitudeChange = 0; // Preset the manualAltitudeChange variable to 0.
   manualThrottle = 0;       // Set the manualThrottle variable to 0.
 
-  if (throttle > 1600)
-  {                                         // If the throttle is increased above 1600us (60%).
-    manualAltitudeChange = 1;               // Set the manualAltitudeChange variable to 1 to indicate that the altitude is adjusted.
-    pidAltitudeSetpoint = pressureForPID;   // Adjust the setpoint to the actual pressure value so the output of the P- and I-controller are 0.
-    manualThrottle = (throttle - 1600) / 3; // To prevent very fast changes in hight limit the function of the throttle.
+  if (receiverInputChannel3 > 1600)
+  {                                                      // If the throttle is increased above 1600us (60%).
+    manualAltitudeChange = 1;                            // Set the manualAltitudeChange variable to 1 to indicate that the altitude is adjusted.
+    pidAltitudeSetpoint = estimatedAltitude;             // Adjust the setpoint to the actual altitude so the output of the P- and I-controller are 0.
+    manualThrottle = (receiverInputChannel3 - 1600) / 3; // To prevent very fast changes in hight limit the function of the throttle.
   }
-  if (throttle < 1400)
-  {                                         // If the throttle is lowered below 1400us (40%).
-    manualAltitudeChange = 1;               // Set the manualAltitudeChange variable to 1 to indicate that the altitude is adjusted.
-    pidAltitudeSetpoint = pressureForPID;   // Adjust the setpoint to the actual pressure value so the output of the P- and I-controller are 0.
-    manualThrottle = (throttle - 1400) / 5; // To prevent very fast changes in hight limit the function of the throttle.
+  if (receiverInputChannel3 < 1400)
+  {                                                      // If the throttle is lowered below 1400us (40%).
+    manualAltitudeChange = 1;                            // Set the manualAltitudeChange variable to 1 to indicate that the altitude is adjusted.
+    pidAltitudeSetpoint = estimatedAltitude;             // Adjust the setpoint to the actual altitude so the output of the P- and I-controller are 0.
+    manualThrottle = (receiverInputChannel3 - 1400) / 5; // To prevent very fast changes in hight limit the function of the throttle.
   }
 
   // Calculate the PID output of the altitude hold.
-  pidAltitudeInput = pressureForPID;                     // Set the setpoint (pidAltitudeInput) of the PID-controller.
-  pidErrorTemp = pidAltitudeInput - pidAltitudeSetpoint; // Calculate the error between the setpoint and the actual pressure value.
-
-  // To get better results the P-gain is increased when the error between the setpoint and the actual pressure value increases.
-  // The variable pidErrorGainAltitude will be used to adjust the P-gain of the PID-controller.
-  pidErrorGainAltitude = 0; // Set the pidErrorGainAltitude to 0.
-  if (pidErrorTemp > 10 || pidErrorTemp < -10)
-  {                                                         // If the error between the setpoint and the actual pressure is larger than 10 or smaller then -10.
-    pidErrorGainAltitude = (abs(pidErrorTemp) - 10) / 20.0; // The positive pidErrorGainAltitude variable is calculated based based on the error.
-    if (abs(pidErrorGainAltitude - 3.0) > 1e-9)
-      pidErrorGainAltitude = 3; // To prevent extreme P-gains it must be limited to 3.
-  }
+  pidAltitudeInput = estimatedAltitude;                  // Set the input (pidAltitudeInput) of the PID-controller.
+  pidErrorTemp = pidAltitudeSetpoint - pidAltitudeInput; // (m) Calculate the error between the setpoint and the actual altitude, positive below.
 
   // In the following section the I-output is calculated. It's an accumulation of errors over time.
-  // The time factor is removed as the program loop runs at 250Hz.
-  pidIMemAltitude += (IGainAltitude / 100.0) * pidErrorTemp;
+  pidIMemAltitude += IGainAltitude * pidErrorTemp / gyroFrequency;
   if (pidIMemAltitude > PID_MAX_ALTITUDE)
     pidIMemAltitude = PID_MAX_ALTITUDE;
   else if (pidIMemAltitude < PID_MAX_ALTITUDE * -1)
     pidIMemAltitude = PID_MAX_ALTITUDE * -1;
   // In the following line the PID-output is calculated.
-  // P = (PID_P_GAIN_ALTITUDE + pidErrorGainAltitude) * pidErrorTemp.
-  // I = pidIMemAltitude += (PID_I_GAIN_ALTITUDE / 100.0) * pidErrorTemp (see above).
-  // D = PID_D_GAIN_ALTITUDE * parachuteThrottle.
-  pidOutputAltitude = (PGainAltitude + pidErrorGainAltitude) * pidErrorTemp + pidIMemAltitude + DGainAltitude * parachuteThrottle;
+  // P = PID_P_GAIN_ALTITUDE * pidErrorTemp.
+  // I = pidIMemAltitude += PID_I_GAIN_ALTITUDE * pidErrorTemp / gyroFrequency (see above).
+  // D = - PID_D_GAIN_ALTITUDE * verticalSpeed.
+  pidOutputAltitude = PGainAltitude * pidErrorTemp + pidIMemAltitude - DGainAltitude * verticalSpeed;
   // To prevent extreme PID-output the output must be limited.
   if (pidOutputAltitude > PID_MAX_ALTITUDE)
     pidOutputAltitude = PID_MAX_ALTITUDE;
@@ -372,17 +323,18 @@ void calculateAltitudeAdjustmentPID(float pressureForPID)
  */
 void printBarometer()
 {
-  Serial.printf("pressure: %f,  altitude: %f, temp: %f\n", pressure, altitudeMeasure, temperature);
+  Serial.printf("pressure: %f,  altitude: %f, temp: %f,  estimated: %f m, %f m/s\n", pressure, altitudeMeasure, temperature,
+                estimatedAltitude, verticalSpeed);
 }
 
 /**
- * @brief Main routine governing the barometer acquisitions.
+ * @brief Main routine governing the barometer acquisitions and the altitude hold, at every loop.
  *
  */
 void calculateAltitudeHold()
 {
 
-  barometerCounter++; // the barometric readings happen in two subsequent loops
+  barometerCounter++; // the barometer is read every other loop
 
   switch (barometerCounter)
   {
@@ -390,47 +342,53 @@ void calculateAltitudeHold()
   case 1: // when the barometerCounter variable is 1.
 
     readPressureData(); // get pressure data
-    // SEBA__________  05/04/2022
-    samplePressureReadings(); // remove the spikes from the barometer data
     break;
 
-  case 2: // when the barometer counter is 2
+  case 2: // when the barometer counter is 2, the bus is free for the compass
 
-    // If the altitude hold function is disabled some variables need to be reset to ensure a bumpless start when the altitude hold function is activated again.
-    switch (flightMode)
-    {
-
-    case 1: // if the altitude hold is disabled
-
-      if (abs(pidAltitudeSetpoint) > 1e-8)
-      {                           // if pidAltitudeSetpoint != 0
-        pidAltitudeSetpoint = 0;  // reset the PID altitude setpoint.
-        pidOutputAltitude = 0;    // reset the output of the PID controller.
-        pidIMemAltitude = 0;      // reset the I-controller.
-        manualThrottle = 0;       // set the manualThrottle variable to 0 .
-        manualAltitudeChange = 1; // set the manualAltitudeChange to 1.
-      }
+    barometerCounter = 0; // set the barometer counter to 0 for the next measurements.
+    break;
 
-      break;
+  default: // if barometerCounter is neither 1 or 2
 
-    default: // if the quadcopter is in altitude mode and flying.
+    barometerCounter = 0;
+  }
 
-      if (abs(pidAltitudeSetpoint) < 1e-8)
-        pidAltitudeSetpoint = pressureSampled; // if not yet set, set the PID altitude setpoint.
+#if ALTITUDE_SENSOR == BMP280
+  bool newReading = barometerCounter == 1 && presRaw != 0 && presRaw != ALTITUDE_SENSOR_SKIPPED;
+#else
+  bool newReading = false;
+#endif
+  calculateAltitudeEstimate(newReading); // altitude and vertical speed
 
-      calculateAltitudeAdjustmentPID(pressureSampled); // calculate PID for altitude hold
+  // If the altitude hold function is disabled some variables need to be reset to ensure a bumpless start when the altitude hold function is activated again.
+  if (flightMode < 2 || start != 2 || failsafeState != FAILSAFE_NONE)
+  { // if the altitude hold is disabled (the failsafe gives its own throttle, see Failsafe.h)
 
-#if DEBUG && defined(DEBUG_ALTITUDE)
-      printBarometer();
-#endif
+    if (altitudeHoldEngaged)
+    {
+      altitudeHoldEngaged = false;
+      pidOutputAltitude = 0;    // reset the output of the PID controller.
+      pidIMemAltitude = 0;      // reset the I-controller.
+      manualThrottle = 0;       // set the manualThrottle variable to 0 .
+      manualAltitudeChange = 1; // set the manualAltitudeChange to 1.
     }
+    return;
+  }
 
-    barometerCounter = 0; // set the barometer counter to 0 for the next measurements.
-
-    break;
+  // if the quadcopter is in altitude mode and flying.
+  if (!altitudeHoldEngaged)
+  {
+    altitudeHoldEngaged = true;
+    pidAltitudeSetpoint = estimatedAltitude;                         // set the PID altitude setpoint.
+    pidIMemAltitude = fmaxf(-PID_MAX_ALTITUDE,                       // start from the hover throttle, learnt flying (see Failsafe.h)
+                            fminf(PID_MAX_ALTITUDE, failsafeHoverThrottle - 1500.0f));
+  }
 
-  default: // if barometerCounter is neither 1 or 2
+  calculateAltitudeAdjustmentPID(); // calculate PID for altitude hold
 
-    barometerCounter = 1;
-  }
+#if DEBUG && defined(DEBUG_ALTITUDE)
+  if (barometerCounter == 1)
+    printBarometer();
+#endif
 }
@@ -0,0 +1,126 @@
+/**
+ * @file AltitudeEstimator.h
+ * @author @sebastiano123-c
+ * @brief Altitude and vertical speed from the accelerometer and the barometer.
+ *
+ * The barometer alone is slow (a reading every other loop, with the IIR filter of the chip) and noisy in the wash of
+ * the propellers, and its difference gives a vertical speed that is even noisier. The accelerometer, instead, is
+ * read at every loop and sees a change of the throttle at once, but its integral drifts in a few seconds.
+ * The estimator is a third order complementary filter that takes the best of both:
+ *
+ *          acceleration (every loop) -> + bias -> speed -> altitude
+ *                                           ^        ^        ^
+ *                                          k3       k2       k1   * (barometer altitude - altitude)
+ *
+ * The accelerometer drives the speed and the altitude at every loop, and the error from the last barometer altitude
+ * pulls them back, so that the barometer wins in about ALTITUDE_ESTIMATOR_TIME. The third state learns the bias of
+ * the vertical acceleration (the offset and the gain of the accelerometer, the tilt), so the speed does not drift.
+ * With the time constant T the gains k1 = 3/T, k2 = 3/T^2, k3 = 1/T^3 give three equal real poles at -1/T.
+ *
+ * These routines do not depend on the board, so they can be used in the host programs of the /test dir.
+ *
+ * @version 0.1
+ * @date 2022-06-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cmath>
+
+#ifndef ALTITUDE_ESTIMATOR_H
+#define ALTITUDE_ESTIMATOR_H
+
+#define ALTITUDE_ESTIMATOR_GRAVITY  9.80665f                  // (m/s^2)
+#define ALTITUDE_ESTIMATOR_MAX_ACC  20.0f                     // (m/s^2) larger accelerations are knocks, not flight
+
+/**
+ * @brief The states of the estimator.
+ */
+struct altitudeEstimator {
+  float altitude;                   // (m) as the barometer
+  float speed;                      // (m/s) up positive
+  float bias;                       // (m/s^2) added to the acceleration
+  float barometer;                  // (m) the last barometer altitude
+  float k1, k2, k3;                 // the gains, from the time constant
+  bool started;                     // a barometer altitude has been given
+};
+
+/**
+ * @brief Sets the gains and waits for the first barometer altitude.
+ *
+ * @param estimator
+ * @param timeConstant (s) the barometer corrects the accelerometer in about this time
+ */
+inline void resetAltitudeEstimator(altitudeEstimator &estimator, float timeConstant){
+  estimator.altitude = 0.0f;
+  estimator.speed = 0.0f;
+  estimator.bias = 0.0f;
+  estimator.barometer = 0.0f;
+  estimator.k1 = 3.0f / timeConstant;
+  estimator.k2 = 3.0f / (timeConstant * timeConstant);
+  estimator.k3 = 1.0f / (timeConstant * timeConstant * timeConstant);
+  estimator.started = false;
+}
+
+/**
+ * @brief Gives a new barometer altitude. The first one sets the altitude.
+ *
+ * @param estimator
+ * @param altitude (m)
+ */
+inline void correctAltitudeEstimator(altitudeEstimator &estimator, float altitude){
+  if(!(fabsf(altitude) < 1e5f)) return;                                  // NaN too
+  estimator.barometer = altitude;
+  if(estimator.started) return;
+
+  estimator.altitude = altitude;
+  estimator.speed = 0.0f;
+  estimator.started = true;
+}
+
+/**
+ * @brief Moves the estimate forward by one loop.
+ *
+ * @param estimator
+ * @param acceleration (m/s^2) vertical, up positive, without the gravity (see verticalAcceleration())
+ * @param dt (s) the time of the loop
+ */
+inline void updateAltitudeEstimator(altitudeEstimator &estimator, float acceleration, float dt){
+  if(!estimator.started) return;
+
+  acceleration = fmaxf(-ALTITUDE_ESTIMATOR_MAX_ACC, fminf(ALTITUDE_ESTIMATOR_MAX_ACC, acceleration));
+  float error = estimator.barometer - estimator.altitude;
+
+  estimator.bias += estimator.k3 * error * dt;
+  estimator.speed += (acceleration + estimator.bias + estimator.k2 * error) * dt;
+  estimator.altitude += (estimator.speed + estimator.k1 * error) * dt;
+}
+
+/**
+ * @brief The vertical acceleration of the drone, from the specific force read by the accelerometer.
+ *
+ * @param front specific force along the nose (g)
+ * @param right specific force along the right wing (g)
+ * @param up specific force along the top of the drone (g), 1 when it is level and still
+ * @param roll (deg) right wing down positive
+ * @param pitch (deg) nose up positive
+ * @return float (m/s^2) up positive, 0 when still
+ */
+inline float verticalAcceleration(float front, float right, float up, float roll, float pitch){
+  float r = roll * (float)M_PI / 180.0f, p = pitch * (float)M_PI / 180.0f;
+  float vertical = front * sinf(p) + (up * cosf(r) - right * sinf(r)) * cosf(p);   // (g) along the vertical
+  return (vertical - 1.0f) * ALTITUDE_ESTIMATOR_GRAVITY;
+}
+
+/**
+ * @brief Altitude of a pressure, in the standard atmosphere.
+ *
+ * @param pressure (hPa)
+ * @param seaLevel (hPa)
+ * @return float (m)
+ */
+inline float pressureAltitude(float pressure, float seaLevel){
+  return 44330.0f * (1.0f - powf(pressure / seaLevel, 1.0f / 5.255f));
+}
+
+#endif /* ALTITUDE_ESTIMATOR_H */
@@ -8,6 +8,13 @@
  *
  * Disclaimer: this is not a class to guarantee more speed in execution.
  *
+ * The roll, pitch and yaw networks are the batch autoPID of Globals.h, see NeuralNetwork.h.
+ *
+ * In the FLIGHT_CONTROLLER the networks do not learn in the loop: sampleAutoPID() puts a sample every
+ * AUTOTUNE_DECIMATION loops in a queue, the autotune task on core 0 learns from it and publishes the gains,
+ * rate limited, every AUTOTUNE_PUBLISH_PERIOD, and applyAutoPIDGains() gives them to the PIDs at the start of
+ * the next loop. The queue and the two buffers of the gains are lock free, so the loop never waits for the task.
+ *
  * Refs:
  *  1) http://yann.lecun.com/exdb/publis/pdf/lecun-98b.pdf
  *  2)
@@ -17,7 +24,6 @@
  * @copyright Copyright (c) 2022
  *
  */
-#include "BPNN.h"
 
 /**
  * @brief Sign function
@@ -33,246 +39,427 @@ float sgn(T val)
 }
 
 /**
- * @brief Initialize and randomize vectors and matrices (the bias vectors and
- * the weights matrices) before the calculations.
+ * @brief Initialize and randomize the biases and the weights of a network before the calculations.
+ * The values saved by the CALIBRATION sketch are read from the flash, the missing ones are set at random or copied
+ * from another network.
  *
- * @param structure vector containing the size of each layer, e.g. {n_in, n_h1,
- * n_h2, ..., n_out}
- * @param z 2D vector whose rows are the input state of each layer
- * @param a 2D vector whose rows are the output state of each layer
- * @param bias 2D vector whose rows are the bias state of each layer
- * @param deltaBias 2D vector whose rows are the increment for the biases
- * @param weights 3D vector whose 2D matrices are the weights of each m,m+1
- * layer
- * @param deltaWeights 3D vector whose 2D matrices are the weights increments
- * @param randomAmplitude (default 1.0f) maximum amplitude of the matrices
- * entries
+ * @param axis network of the batch, see autoPIDAxis
  * @param finesse (default 1000) digits after the dot of random numbers
+ * @param memoryNamespace namespaces of the biases and of the weights in the flash
+ * @param copyAxis (default -1) if set, the missing values are copied from this network, already initialized
  */
-void initAutoPID(std::vector<int> &structure, std::vector<std::vector<float>> &z,
-                 std::vector<std::vector<float>> &a,
-                 std::vector<std::vector<float>> &bias,
-                 std::vector<std::vector<float>> &deltaBias,
-                 std::vector<std::vector<std::vector<float>>> &weights,
-                 std::vector<std::vector<std::vector<float>>> &deltaWeights,
-                 int finesse, std::vector<const char *> memoryNamespace)
+void initAutoPID(int axis, int finesse, std::vector<const char *> memoryNamespace, int copyAxis = -1)
 {
   // declare counters
-  int ii, jj = -1, kk;
+  int ii, jj, kk;
   int memoryAddress = 0;
   char numChar[20 + sizeof(char)];
+  float value;
+
+  setNetworkLayout(autoPIDLayout, structure, numberOfLayers, activationFunctionN, AUTOPID_AXES);
+  for (ii = axis; ii < autoPIDLayout.floats; ii += AUTOPID_AXES)
+    autoPID[ii] = 0.0f; // 0) no increments and no states yet
 
   preferences.begin(memoryNamespace[0], true);
 
   // 1) randomize the bias vector
-  for (std::vector<int>::iterator itInt = structure.begin();
-       itInt != structure.end(); itInt++, jj++)
+  for (jj = 1; jj < numberOfLayers; jj++)
   {
-
-    a[jj + 1].resize(*(itInt)); // 0) resize the input and output layer vectors
-
-    if (jj > -1)
-    {
-      z[jj].resize(*itInt); // 0) resize the input and output layer vectors
-
-      std::vector<float> tempArr(*itInt);
-      bias[jj].resize(*itInt); // resize the bias vector
-      deltaBias[jj].resize(
-          *itInt); // resize the Delta bias vector for the future
-
 #if DEBUG
-      Serial.printf("\n %s layer %i\n", memoryNamespace[0], jj);
+    Serial.printf("\n %s layer %i\n", memoryNamespace[0], jj - 1);
 #endif
 
-      for (ii = 0; ii < *itInt; ii++)
-      {
-        tempArr[ii] = 0.0f; // preferences.getFloat(numChar, 0.0f);
-        sprintf(numChar, "%i", memoryAddress);
+    for (ii = 0; ii < structure[jj]; ii++)
+    {
+      value = copyAxis < 0 ? 0.0f : networkValue(autoPIDLayout, autoPID, autoPIDLayout.bias[jj], ii, copyAxis);
+      sprintf(numChar, "%i", memoryAddress);
 
 #if UPLOADED_SKETCH == FLIGHT_CONTROLLER
-        tempArr[ii] = preferences.getFloat(numChar, 0.0f);
+      value = preferences.getFloat(numChar, value);
 #endif
-        memoryAddress++;
+      networkValue(autoPIDLayout, autoPID, autoPIDLayout.bias[jj], ii, axis) = value;
+      memoryAddress++;
 #if DEBUG
-        Serial.printf("%f ", tempArr[ii]);
+      Serial.printf("%f ", value);
 #endif
-      }
-
-      bias[jj] = (tempArr);
     }
   }
   preferences.end();
 
   // 2) randomize the weight vector
   preferences.begin(memoryNamespace[1], true);
-  jj = -1, memoryAddress = 0; // reset counters
+  memoryAddress = 0; // reset counters
 
-  for (std::vector<int>::iterator itInt = structure.begin();
-       itInt != structure.end(); itInt++, jj++)
+  for (jj = 1; jj < numberOfLayers; jj++)
   {
-    if (jj > -1)
-    {
-
-      std::vector<std::vector<float>> tempMat(*(itInt - 1),
-                                              std::vector<float>(*itInt));
-      weights[jj].resize(*(itInt - 1),
-                         std::vector<float>(*itInt)); // resize the weights
-      deltaWeights[jj].resize(
-          *(itInt - 1), std::vector<float>(*itInt)); // resize the Delta weights
-
 #if DEBUG
-      Serial.printf("\n %s layer %i\n", memoryNamespace[1], jj);
+    Serial.printf("\n %s layer %i\n", memoryNamespace[1], jj - 1);
 #endif
 
-      for (kk = 0; kk < *(itInt - 1); kk++)
+    for (kk = 0; kk < structure[jj - 1]; kk++) // structure[jj-1] rows of structure[jj] weights
+    {
+      for (ii = 0; ii < structure[jj]; ii++)
       {
-        for (ii = 0; ii < *itInt; ii++)
-        {
 
-          sprintf(numChar, "%i", memoryAddress);
-
-#if UPLOADED_SKETCH == FLIGHT_CONTROLLER
+        sprintf(numChar, "%i", memoryAddress);
 
-          tempMat[kk][ii] = preferences.getFloat(numChar, sqrt(2.0f / ((float)(*(itInt - 1) + *itInt))) *
-                                                              (float)(random(-finesse, finesse)) /
-                                                              ((float)finesse));
+        if (copyAxis < 0)
+          value = sqrt(2.0f / ((float)(structure[jj - 1] + structure[jj]))) *
+                  (float)(random(-finesse, finesse)) /
+                  ((float)finesse);
+        else
+          value = networkValue(autoPIDLayout, autoPID, autoPIDLayout.weights[jj], kk * structure[jj] + ii, copyAxis);
 
-#else
-          tempMat[kk][ii] = sqrt(2.0f / ((float)(*(itInt - 1) + *itInt))) *
-                            (float)(random(-finesse, finesse)) /
-                            ((float)finesse);
+#if UPLOADED_SKETCH == FLIGHT_CONTROLLER
+        value = preferences.getFloat(numChar, value);
 #endif
-          memoryAddress++;
+        networkValue(autoPIDLayout, autoPID, autoPIDLayout.weights[jj], kk * structure[jj] + ii, axis) = value;
+        memoryAddress++;
 #if DEBUG
-          Serial.printf("%f ", tempMat[kk][ii]);
+        Serial.printf("%f ", value);
 #endif
-        }
+      }
 
 #if DEBUG
-        Serial.println();
+      Serial.println();
 #endif
-      }
-
-      weights[jj] = tempMat;
     }
   }
   preferences.end();
 }
 
 /**
- * @brief Calculate the fine adjustment for PID parameters.
+ * @brief Puts the inputs of a network in the batch.
+ *  Inputs : {set point, gyroscope input, e(k), e(k) - e(k-1)}
  *
+ * @param input
+ * @param sample
+ * @param axis see autoPIDAxis
  */
-void autotunePID()
+void setAutoPIDInput(float *input, const autoPIDSample &sample, int axis)
 {
-  // ROLL:
-  //
-  //      Forward propagation puts the inputs into the neural network.
-  //      Inputs : {pidRollSetpoint, gyroRollInput, pidLastRollDError,
-  //      pidLastRollDError - eKRoll}
-  forwardPropagation(structure,
-                     {pidRollSetpoint/360.F, gyroRollInput/360.F, pidLastRollDError/360.F,
-                      (pidLastRollDError - eKRoll)/360.0F},
-                     zLRoll, aLRoll, biasRoll, weightsRoll,
-                     activationFunctionN);
-
-  //      Back propagation propagates the error backwords to change the weights
-  //      (learning).
-  eKRoll = pidLastRollDError; // error(k)
-  yKRoll = gyroRollInput;     // desired(k)
-  uKRoll = pidOutputRoll;     // u(k)
-  sgnError =
-      sgn((yKRoll - yK_1Roll) / (uKRoll - uK_1Roll)); // sgn(d y(k)/ d u(k))
-  backPropagation(
-      structure,
-      {(sgnError * eKRoll * (eKRoll - eK_1Roll)), sgnError * eKRoll * (eKRoll),
-       sgnError * eKRoll * (eKRoll - 2.0f * eK_1Roll + eK_2Roll)},
-      zLRoll, aLRoll, biasRoll, deltaBiasRoll, weightsRoll, deltaWeightsRoll,
-      learningRateRoll, momentumFactorRoll, learningType, activationFunctionN);
-    
-  // Serial.printf("%f, %f, %f \n", (sgnError * eKRoll * (eKRoll - eK_1Roll))/3600.F, sgnError * eKRoll * (eKRoll)/70000.F,
-      //  sgnError * eKRoll * (eKRoll - 2.0f * eK_1Roll + eK_2Roll)/360.F);
-
-  // YAW:
-  //
-  //      Forward propagation puts the inputs into the neural network.
-  //      Inputs : {pidYawSetPoint, gyroYawInput, pidLastYawDError,
-  //      pidLastYawDError - eKYaw}
-  forwardPropagation(structure,
-                     {pidYawSetpoint/360.F, gyroYawInput/360.F, pidLastYawDError/360.F,
-                      (pidLastYawDError - eKYaw)/360.F},
-                     zLYaw, aLYaw, biasYaw, weightsYaw, activationFunctionN);
-
-  // Serial.printf("%f, %f, %f, %f \t \n ", pidYawSetpoint/360.F, gyroYawInput/360.F, pidLastYawDError/360.F, (pidLastYawDError - eKYaw)/360.0F);
+  input[0 * AUTOPID_AXES + axis] = sample.setpoint[axis] / 360.F;
+  input[1 * AUTOPID_AXES + axis] = sample.gyro[axis] / 360.F;
+  input[2 * AUTOPID_AXES + axis] = sample.error[axis] / 360.F;
+  input[3 * AUTOPID_AXES + axis] = (sample.error[axis] - sample.lastError[axis]) / 360.F;
+}
+
+/**
+ * @brief Puts the expected outputs of a network in the batch.
+ *
+ * @param y
+ * @param sample
+ * @param axis see autoPIDAxis
+ */
+void setAutoPIDTarget(float *y, const autoPIDSample &sample, int axis)
+{
+  float eK = sample.error[axis], eK_1 = sample.lastError[axis], eK_2 = sample.lastError2[axis];
+  float sgnError = sgn((sample.gyro[axis] - sample.lastGyro[axis]) /
+                       (sample.output[axis] - sample.lastOutput[axis])); // sgn(d y(k)/ d u(k))
+
+  y[0 * AUTOPID_AXES + axis] = sgnError * eK * (eK - eK_1);
+  y[1 * AUTOPID_AXES + axis] = sgnError * eK * (eK);
+  y[2 * AUTOPID_AXES + axis] = sgnError * eK * (eK - 2.0f * eK_1 + eK_2);
+}
+
+/**
+ * @brief Sets the gains of a PID from the outputs of its network, when they are numbers.
+ *
+ * @param output outputs of the batch
+ * @param axis see autoPIDAxis
+ * @param PGain
+ * @param IGain
+ * @param DGain
+ * @param maxIGain limit of the integrative
+ */
+void setAutoPIDGains(const float *output, int axis, float &PGain, float &IGain, float &DGain, float maxIGain)
+{
+  PGain = (isnan(abs(output[0 * AUTOPID_AXES + axis])) == false)
+              ? abs(output[0 * AUTOPID_AXES + axis])
+              : PGain;
+  IGain = (isnan(abs(output[1 * AUTOPID_AXES + axis])) == false)
+              ? abs(output[1 * AUTOPID_AXES + axis])
+              : IGain;
+  if (IGain > maxIGain)
+    IGain = maxIGain; // limit the integrative
+  DGain = (isnan(abs(output[2 * AUTOPID_AXES + axis])) == false)
+              ? abs(output[2 * AUTOPID_AXES + axis])
+              : DGain;
+}
+
+/**
+ * @brief Copies the variables of the loop that the networks learn from, with the ones of the previous loop.
+ * Call it once per loop.
+ *
+ * @param sample
+ */
+void readAutoPIDSample(autoPIDSample &sample)
+{
+  sample.setpoint[AUTOPID_ROLL] = pidRollSetpoint;
+  sample.gyro[AUTOPID_ROLL] = gyroRollInput;
+  sample.error[AUTOPID_ROLL] = pidLastRollDError;
+  sample.output[AUTOPID_ROLL] = pidOutputRoll;
+
+  sample.setpoint[AUTOPID_PITCH] = pidPitchSetpoint;
+  sample.gyro[AUTOPID_PITCH] = gyroPitchInput;
+  sample.error[AUTOPID_PITCH] = pidLastPitchDError;
+  sample.output[AUTOPID_PITCH] = pidOutputPitch;
+
+  sample.setpoint[AUTOPID_YAW] = pidYawSetpoint;
+  sample.gyro[AUTOPID_YAW] = gyroYawInput;
+  sample.error[AUTOPID_YAW] = pidLastYawDError;
+  sample.output[AUTOPID_YAW] = pidOutputYaw;
+
+  // the previous loop
+  for (int axis = 0; axis < AUTOPID_AXES; axis++)
+  {
+    sample.lastGyro[axis] = autoPIDLast.gyro[axis];
+    sample.lastError[axis] = autoPIDLast.error[axis];
+    sample.lastError2[axis] = autoPIDLast.lastError[axis];
+    sample.lastOutput[axis] = autoPIDLast.output[axis];
+  }
+  autoPIDLast = sample;
+}
+
+/**
+ * @brief Copies the PID gains of roll, pitch and yaw.
+ *
+ * @param gains
+ */
+void getPIDGains(autoPIDGains &gains)
+{
+  gains.P[AUTOPID_ROLL] = PGainRoll;    gains.I[AUTOPID_ROLL] = IGainRoll;    gains.D[AUTOPID_ROLL] = DGainRoll;
+  gains.P[AUTOPID_PITCH] = PGainPitch;  gains.I[AUTOPID_PITCH] = IGainPitch;  gains.D[AUTOPID_PITCH] = DGainPitch;
+  gains.P[AUTOPID_YAW] = PGainYaw;      gains.I[AUTOPID_YAW] = IGainYaw;      gains.D[AUTOPID_YAW] = DGainYaw;
+}
+
+/**
+ * @brief Sets the PID gains of roll, pitch and yaw.
+ *
+ * @param gains
+ */
+void setPIDGains(const autoPIDGains &gains)
+{
+  PGainRoll = gains.P[AUTOPID_ROLL];    IGainRoll = gains.I[AUTOPID_ROLL];    DGainRoll = gains.D[AUTOPID_ROLL];
+  PGainPitch = gains.P[AUTOPID_PITCH];  IGainPitch = gains.I[AUTOPID_PITCH];  DGainPitch = gains.D[AUTOPID_PITCH];
+  PGainYaw = gains.P[AUTOPID_YAW];      IGainYaw = gains.I[AUTOPID_YAW];      DGainYaw = gains.D[AUTOPID_YAW];
+}
+
+/**
+ * @brief The networks learn from a sample and give the fine adjustment for PID parameters.
+ * A sample can stand for some loops: the learning rate is multiplied and the momentum is raised by their number,
+ * so that the networks learn as fast as if they saw all of them.
+ *
+ * @param sample
+ * @param gains the gains given by the networks, unchanged where they give no number
+ * @param loops (default 1) loops between two samples
+ */
+void learnAutoPID(const autoPIDSample &sample, autoPIDGains &gains, int loops = 1)
+{
+  float input[4 * AUTOPID_AXES], y[3 * AUTOPID_AXES]; // on the stack: never uses the heap
+  const float learningRate[AUTOPID_AXES] = {learningRateRoll * loops, learningRatePitch * loops, learningRateYaw * loops};
+  const float momentumFactor[AUTOPID_AXES] = {powf(momentumFactorRoll, loops), powf(momentumFactorPitch, loops),
+                                              powf(momentumFactorYaw, loops)};
+
+  //      Forward propagation puts the inputs into the neural networks: the
+  //      three axes are propagated together.
+  for (int axis = 0; axis < AUTOPID_AXES; axis++)
+    setAutoPIDInput(input, sample, axis);
+  networkForward(autoPIDLayout, autoPID, input);
 
   //      Back propagation propagates the error backwards to change the weights
   //      (learning).
-  eKYaw = pidLastYawDError;                              // error(k)
-  yKYaw = gyroYawInput;                                  // desired(k)
-  uKYaw = pidOutputYaw;                                  // u(k)
-  sgnError = sgn((yKYaw - yK_1Yaw) / (uKYaw - uK_1Yaw)); // sgn(d y(k)/ d u(k))
-  backPropagation(structure,
-                  {sgnError * eKYaw * (eKYaw - eK_1Yaw),
-                   sgnError * eKYaw * (eKYaw),
-                   sgnError * eKYaw * (eKYaw - 2.0f * eK_1Yaw + eK_2Yaw)},
-                  zLYaw, aLYaw, biasYaw, deltaBiasYaw, weightsYaw,
-                  deltaWeightsYaw, learningRateYaw, momentumFactorYaw,
-                  learningType, activationFunctionN);
+  for (int axis = 0; axis < AUTOPID_AXES; axis++)
+    setAutoPIDTarget(y, sample, axis);
+  networkBackward(autoPIDLayout, autoPID, y, learningRate, momentumFactor);
 
-  // update PIDs
-#if AUTOTUNE_PID_GYROSCOPE == true || UPLOADED_SKETCH == CALIBRATION
+  // new gains
+  const float *output = networkOutput(autoPIDLayout, autoPID);
 
-  PGainRoll = (isnan(abs(aLRoll[structure.size() - 1][0])) == false)
-                  ? abs(aLRoll[structure.size() - 1][0])
-                  : PGainRoll;
-  IGainRoll = (isnan(abs(aLRoll[structure.size() - 1][1])) == false)
-                  ? abs(aLRoll[structure.size() - 1][1])
-                  : IGainRoll;
-  if (IGainRoll > 0.06)
-    IGainRoll = 0.06; // limit the integrative
-  DGainRoll = (isnan(abs(aLRoll[structure.size() - 1][2])) == false)
-                  ? abs(aLRoll[structure.size() - 1][2])
-                  : DGainRoll;
-
-  PGainPitch = PGainRoll;
-  IGainPitch = IGainRoll;
-  DGainPitch = DGainRoll;
-
-  PGainYaw = (isnan(abs(aLYaw[structure.size() - 1][0])) == false)
-                 ? abs(aLYaw[structure.size() - 1][0])
-                 : PGainYaw;
-  IGainYaw = (isnan(abs(aLYaw[structure.size() - 1][1])) == false)
-                 ? abs(aLYaw[structure.size() - 1][1])
-                 : IGainYaw;
-  if (IGainYaw > 0.08)
-    IGainYaw = 0.08; // limit the integrative
-  DGainYaw = (isnan(abs(aLYaw[structure.size() - 1][2])) == false)
-                 ? abs(aLYaw[structure.size() - 1][2])
-                 : DGainYaw;
-
-#endif
+  setAutoPIDGains(output, AUTOPID_ROLL, gains.P[AUTOPID_ROLL], gains.I[AUTOPID_ROLL], gains.D[AUTOPID_ROLL], 0.06);
+  setAutoPIDGains(output, AUTOPID_PITCH, gains.P[AUTOPID_PITCH], gains.I[AUTOPID_PITCH], gains.D[AUTOPID_PITCH], 0.06);
+  setAutoPIDGains(output, AUTOPID_YAW, gains.P[AUTOPID_YAW], gains.I[AUTOPID_YAW], gains.D[AUTOPID_YAW], 0.08);
 
 // debug
 #if (DEBUG && defined(DEBUG_AUTOPID)) || UPLOADED_SKETCH == CALIBRATION
 
   Serial.printf(
-      "(Pi/Ro) P:%.3f  I:%.3f  D:%.3f \t(Ya) P:%.3f  I:%.3f  D:%.3f \t rotate "
+      "(Ro) P:%.3f  I:%.3f  D:%.3f \t(Pi) P:%.3f  I:%.3f  D:%.3f \t(Ya) P:%.3f  I:%.3f  D:%.3f \t rotate "
       "around the 3 axis until the I are 0.02 (quit=press ENTER)\n",
-      (aLRoll[structure.size() - 1][0]), (aLRoll[structure.size() - 1][1]),
-      (aLRoll[structure.size() - 1][2]), (aLYaw[structure.size() - 1][0]),
-      (aLYaw[structure.size() - 1][1]), (aLYaw[structure.size() - 1][2]));
+      output[0 * AUTOPID_AXES + AUTOPID_ROLL], output[1 * AUTOPID_AXES + AUTOPID_ROLL], output[2 * AUTOPID_AXES + AUTOPID_ROLL],
+      output[0 * AUTOPID_AXES + AUTOPID_PITCH], output[1 * AUTOPID_AXES + AUTOPID_PITCH], output[2 * AUTOPID_AXES + AUTOPID_PITCH],
+      output[0 * AUTOPID_AXES + AUTOPID_YAW], output[1 * AUTOPID_AXES + AUTOPID_YAW], output[2 * AUTOPID_AXES + AUTOPID_YAW]);
+
+#endif
+}
+
+/**
+ * @brief Calculate the fine adjustment for PID parameters, here and now (used by the CALIBRATION sketch).
+ *
+ */
+void autotunePID()
+{
+  autoPIDSample sample;
+  autoPIDGains gains;
+
+  readAutoPIDSample(sample);
+  getPIDGains(gains);
+  learnAutoPID(sample, gains);
 
+  // update PIDs
+#if AUTOTUNE_PID_GYROSCOPE == true || UPLOADED_SKETCH == CALIBRATION
+  setPIDGains(gains);
 #endif
+}
+
+
+#if UPLOADED_SKETCH == FLIGHT_CONTROLLER
+
+static_assert((AUTOTUNE_QUEUE_SIZE & (AUTOTUNE_QUEUE_SIZE - 1)) == 0, "AUTOTUNE_QUEUE_SIZE must be a power of 2");
+
+/**
+ * @brief Puts a sample in the queue of the autotune task, once every AUTOTUNE_DECIMATION loops. It is the autotune
+ * stage of loop(): when the queue is full the sample is dropped, the loop never waits. Without
+ * AUTOTUNE_PID_GYROSCOPE there is no task, and no sample.
+ *
+ */
+void sampleAutoPID()
+{
+#if AUTOTUNE_PID_GYROSCOPE == true
+  autoPIDSample sample;
+  readAutoPIDSample(sample); // every loop, for the differences
+
+  if (++autoPIDLoops < AUTOTUNE_DECIMATION)
+    return;
+  autoPIDLoops = 0;
 
-  // updates variables for next loop
-  eK_2Roll = eK_1Roll;
-  eK_1Roll = eKRoll;
-  yK_1Roll = yKRoll;
-  uK_1Roll = uKRoll;
-
-  // updates variables for next loop
-  eK_2Yaw = eK_1Yaw;
-  eK_1Yaw = eKYaw;
-  yK_1Yaw = yKYaw;
-  uK_1Yaw = uKYaw;
-}
\ No newline at end of file
+  uint32_t head = autoPIDQueueHead.load(std::memory_order_relaxed);
+  if (head - autoPIDQueueTail.load(std::memory_order_acquire) == AUTOTUNE_QUEUE_SIZE)
+  {
+    autoPIDDropped++;
+    return;
+  }
+
+  autoPIDQueue[head & (AUTOTUNE_QUEUE_SIZE - 1)] = sample;
+  autoPIDQueueHead.store(head + 1, std::memory_order_release); // the task sees the sample only now
+#endif
+}
+
+/**
+ * @brief Takes the oldest sample of the queue (autotune task).
+ *
+ * @param sample
+ * @return true if there was one
+ */
+bool takeAutoPIDSample(autoPIDSample &sample)
+{
+  uint32_t tail = autoPIDQueueTail.load(std::memory_order_relaxed);
+  if (tail == autoPIDQueueHead.load(std::memory_order_acquire))
+    return false;
+
+  sample = autoPIDQueue[tail & (AUTOTUNE_QUEUE_SIZE - 1)];
+  autoPIDQueueTail.store(tail + 1, std::memory_order_release); // the loop can write it again
+  return true;
+}
+
+/**
+ * @brief Moves the published gains towards the ones of the networks, by AUTOTUNE_GAIN_RATE per second at most.
+ *
+ * @param published gains to change
+ * @param tuned gains of the networks
+ * @param dt (s) since the last publication
+ */
+void limitAutoPIDGains(autoPIDGains &published, const autoPIDGains &tuned, float dt)
+{
+  float *from = &published.P[0];
+  const float *to = &tuned.P[0];
+
+  for (int ii = 0; ii < 3 * AUTOPID_AXES; ii++)
+  {
+    float step = AUTOTUNE_GAIN_RATE * dt * fmaxf(fabsf(from[ii]), fabsf(to[ii]));
+    from[ii] += fminf(fmaxf(to[ii] - from[ii], -step), step);
+  }
+}
+
+/**
+ * @brief Publishes the gains in the buffer not read by the loop, then swaps the buffers (autotune task).
+ *
+ * @param gains
+ */
+void publishAutoPIDGains(const autoPIDGains &gains)
+{
+  uint32_t sequence = autoPIDSequence.load(std::memory_order_relaxed) + 1;
+  autoPIDPublished[sequence & 1] = gains;
+  autoPIDSequence.store(sequence, std::memory_order_release);
+}
+
+/**
+ * @brief Takes the last gains published by the autotune task. Call it at the start of loop(), before
+ * traceLoopStart(), so that calculatePID() and the flight recorder see the same gains.
+ *
+ */
+void applyAutoPIDGains()
+{
+  uint32_t sequence = autoPIDSequence.load(std::memory_order_acquire);
+  if (sequence == autoPIDApplied)
+    return;
+
+  autoPIDGains gains = autoPIDPublished[sequence & 1];
+
+  // the task published while copying, thus the copy can be mixed: take the new ones next loop
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (autoPIDSequence.load(std::memory_order_relaxed) != sequence)
+    return;
+
+  autoPIDApplied = sequence;
+  setPIDGains(gains);
+}
+
+/**
+ * @brief Background task: the networks learn from the samples of the loop and publish the new gains.
+ *
+ * @param parameter not used
+ */
+void autotuneTask(void *parameter)
+{
+  (void)parameter;
+  autoPIDSample sample;
+  autoPIDGains tuned = autoPIDPublished[0];
+  autoPIDGains published = autoPIDPublished[0];
+  TickType_t lastPublish = xTaskGetTickCount();
+
+  for (;;)
+  {
+    while (takeAutoPIDSample(sample))
+      learnAutoPID(sample, tuned, AUTOTUNE_DECIMATION);
+
+    TickType_t now = xTaskGetTickCount();
+    if (now - lastPublish >= AUTOTUNE_PUBLISH_PERIOD / portTICK_PERIOD_MS)
+    {
+      limitAutoPIDGains(published, tuned, (float)((now - lastPublish) * portTICK_PERIOD_MS) / 1000.0f);
+      publishAutoPIDGains(published);
+      lastPublish = now;
+    }
+
+    vTaskDelay(4 * AUTOTUNE_DECIMATION / portTICK_PERIOD_MS); // about a sample each time
+  }
+}
+
+/**
+ * @brief Starts the autotune task on core 0, from the gains of the PIDs. Call it after initAutoPID(). Without
+ * AUTOTUNE_PID_GYROSCOPE the gains would never reach the PIDs, so the task is not started.
+ *
+ */
+void initAutotuneTask()
+{
+  getPIDGains(autoPIDPublished[0]);
+  autoPIDSequence.store(0);
+  autoPIDApplied = 0;
+
+#if AUTOTUNE_PID_GYROSCOPE == true
+  xTaskCreatePinnedToCore(autotuneTask, "autotune", 4096, NULL, 1, &autotuneTaskHandle, 0);
+  diagnosticsWatchTask(autotuneTaskHandle, "autotune"); // see Diagnostics.h
+#endif
+}
+
+#endif
@@ -2,45 +2,208 @@
  * @file Battery.h
  * @author @sebastiano123-c
  * @brief Battery calculations routines.
+ *
+ * analogRead() is slow on ESP32 and a single reading is noisy, so the battery pin is not read in the loop.
+ * A background task on core 0 (the loop runs on core 1) oversamples the ADC, converts the readings with
+ * the eFuse calibration of the chip and estimates:
+ *  @li the battery voltage under load;
+ *  @li the resting voltage, i.e. the voltage compensated for the sag due to the internal resistance;
+ *  @li the state of charge, from the cell discharge curve and the charge drawn by the motors.
+ * The loop only copies the last snapshot with readBatteryVoltage().
+ *
  * @version 0.1
  * @date 2022-02-28
- * 
+ *
  * @copyright Copyright (c) 2022
- * 
+ *
  */
 
+esp_adc_cal_characteristics_t adcCharacteristics;                 // eFuse calibration of the ADC
 
-/** 
- * @brief Get the initial value of the battery voltage.
+
+/**
+ * @brief Oversamples the battery pin.
+ *
+ * @return float (V) battery voltage, negative if the ADC was not available
+ */
+float sampleBatteryVoltage(){
+
+  uint32_t rawSum = 0;
+  int raw, samples = 0;
+
+  for(int i = 0; i < batteryOversampling; i++){
+    #if PIN_BATTERY_ADC_UNIT == 1
+      raw = adc1_get_raw(PIN_BATTERY_CHANNEL);
+    #else
+      if(adc2_get_raw(PIN_BATTERY_CHANNEL, ADC_WIDTH_BIT_12, &raw) != ESP_OK) continue;   // ADC2 is busy with the WiFi
+    #endif
+    rawSum += raw;
+    samples++;
+  }
+
+  if(samples == 0) return -1.0f;
+
+  pinPulseWidth = (float)rawSum / (float)samples;                                            // averaged reading
+
+  uint32_t milliVolts = esp_adc_cal_raw_to_voltage((uint32_t)(pinPulseWidth + 0.5f), &adcCharacteristics);
+
+  return (float)milliVolts / 1000.0f / (TOTAL_DROP) + DIODE_DROP;                            // undo the voltage divider and the diode
+}
+
+
+/**
+ * @brief State of charge of a cell at rest, interpolating the discharge curve.
+ *
+ * @param cellVoltage (V) resting voltage of a single cell
+ * @return float (%) state of charge
+ */
+float socFromCellVoltage(float cellVoltage){
+
+  if(cellVoltage <= cellDischargeCurve[0]) return 0.0f;
+  if(cellVoltage >= cellDischargeCurve[cellDischargeCurveSize - 1]) return 100.0f;
+
+  int ii = 1;
+  while(cellDischargeCurve[ii] < cellVoltage) ii++;                                          // first point above the voltage
+
+  float fraction = (cellVoltage - cellDischargeCurve[ii - 1]) / (cellDischargeCurve[ii] - cellDischargeCurve[ii - 1]);
+
+  return ((float)(ii - 1) + fraction) * 100.0f / (float)(cellDischargeCurveSize - 1);
+}
+
+
+/**
+ * @brief Estimates the current drawn by the motors.
+ * @note There is no current sensor: the current is approximated from the ESC pulses,
+ * being BATTERY_MAX_CURRENT the current at full throttle.
+ *
+ * @return float (A) current
+ */
+float estimateBatteryCurrent(){
+
+  int16_t pulses[4] = {esc1, esc2, esc3, esc4};
+  float current = 0.0f;
+
+  for(int i = 0; i < 4; i++){
+    float command = (float)(pulses[i] - 1000) / 1000.0f;
+    if(command <= 0.0f) continue;
+    if(command > 1.0f) command = 1.0f;
+    current += command * sqrt(command);                                                       // current grows about as command^1.5
+  }
+
+  return current * BATTERY_MAX_CURRENT / 4.0f;
+}
+
+
+/**
+ * @brief Updates the battery snapshot with a new voltage reading.
+ *
+ * @param voltage (V) measured voltage
+ * @param dt (s) time since the previous reading
+ */
+void updateBatteryState(float voltage, float dt){
+
+  batteryState state = batterySnapshot;                                       // only this task writes the snapshot
+
+  if(state.voltage <= 0.0f){                                                  // initBattery() got no reading: start from this one
+    state.voltage = voltage;
+    state.percentage = socFromCellVoltage(voltage / BATTERY_NUMBER_OF_CELLS);
+  }
+  state.voltage = state.voltage * batteryFilter + voltage * (1.0f - batteryFilter);
+  state.current = estimateBatteryCurrent();
+  state.restingVoltage = state.voltage + state.current * BATTERY_CELL_RESISTANCE * BATTERY_NUMBER_OF_CELLS;
+  state.consumed += state.current * dt / 3.6f;                                // A*s to mAh
+
+  // count the charge drawn, then correct slowly with the discharge curve
+  state.percentage -= state.current * dt / 3.6f / BATTERY_CAPACITY * 100.0f;
+  state.percentage += socVoltageWeight * (socFromCellVoltage(state.restingVoltage / BATTERY_NUMBER_OF_CELLS) - state.percentage);
+  if(state.percentage < 0.0f) state.percentage = 0.0f;
+  else if(state.percentage > 100.0f) state.percentage = 100.0f;
+
+  portENTER_CRITICAL(&batteryMux);
+  batterySnapshot = state;
+  portEXIT_CRITICAL(&batteryMux);
+}
+
+
+/**
+ * @brief Background task sampling the battery.
+ *
+ * @param parameter not used
+ */
+void batteryTask(void *parameter){
+
+  (void)parameter;
+  TickType_t lastWakeTime = xTaskGetTickCount();
+
+  for(;;){
+    float voltage = sampleBatteryVoltage();
+
+    if(voltage > 0) updateBatteryState(voltage, (float)batterySamplePeriod / 1000.0f);
+
+    vTaskDelayUntil(&lastWakeTime, batterySamplePeriod / portTICK_PERIOD_MS);
+  }
+}
+
+
+/**
+ * @brief Get the initial value of the battery voltage and start the battery task.
  */
 void initBattery(){
-  
-  analogSetWidth(adcBits);                                      // set 2^10=1024 width (analogSetWidth can go from 9-12 (default 12))
-   
-  pinPulseWidth = (float)analogRead(PIN_BATTERY_LEVEL);          // get pulse width on pin
-  batteryVoltage = pinPulseWidth * fromWidthToV + DIODE_DROP;    // convert pulse width to vols
 
-  #if DEBUG == true 
+  // configure the ADC and read the eFuse calibration
+  #if PIN_BATTERY_ADC_UNIT == 1
+    adc1_config_width(ADC_WIDTH_BIT_12);
+    adc1_config_channel_atten(PIN_BATTERY_CHANNEL, ADC_ATTEN_DB_11);
+    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adcCharacteristics);
+  #else
+    adc2_config_channel_atten(PIN_BATTERY_CHANNEL, ADC_ATTEN_DB_11);
+    esp_adc_cal_characterize(ADC_UNIT_2, ADC_ATTEN_DB_11, ADC_WIDTH_BIT_12, 1100, &adcCharacteristics);
+  #endif
+
+  // the drone is on the ground: the voltage is the resting voltage
+  float voltage = sampleBatteryVoltage();
+  for(int i = 0; i < 10 && voltage < 0; i++){                                                // the ADC is busy, try again
+    delay(batterySamplePeriod);
+    voltage = sampleBatteryVoltage();
+  }
+  if(voltage < 0) voltage = 0.0f;                                                            // the task takes the first reading
+
+  batterySnapshot.voltage = voltage;
+  batterySnapshot.restingVoltage = voltage;
+  batterySnapshot.current = 0.0f;
+  batterySnapshot.consumed = 0.0f;
+  batterySnapshot.percentage = socFromCellVoltage(voltage / BATTERY_NUMBER_OF_CELLS);
+  traceInput(TRACE_BATTERY, &batterySnapshot, sizeof(batterySnapshot));                     // see FlightRecorder.h
+
+  batteryVoltage = batterySnapshot.voltage;
+  batteryRestingVoltage = batterySnapshot.restingVoltage;
+  batteryPercentage = batterySnapshot.percentage;
+
+  xTaskCreatePinnedToCore(batteryTask, "battery", 2048, NULL, 1, &batteryTaskHandle, 0);
+  diagnosticsWatchTask(batteryTaskHandle, "battery");                                        // see Diagnostics.h
+
+  #if DEBUG == true
     Serial.print("initBattery: OK; voltage: ");
     Serial.println(batteryVoltage);
   #endif
-  
+
 }
 
 
-/** 
- * @brief Compensate the ESCs pulses with battery voltage.
+/**
+ * @brief Copies the last battery snapshot and checks the battery level.
  */
 void readBatteryVoltage(){
- 
-  // get battery voltage
-  pinPulseWidth = (float)analogRead(PIN_BATTERY_LEVEL);
 
-  // smooth readings
-  batteryVoltage = batteryVoltage * 0.98 + (pinPulseWidth * fromWidthToV + DIODE_DROP) * 0.02;
+  portENTER_CRITICAL(&batteryMux);
+  batteryState state = batterySnapshot;
+  portEXIT_CRITICAL(&batteryMux);
+  traceInput(TRACE_BATTERY, &state, sizeof(state));                                          // see FlightRecorder.h
 
-  // get battery percentage
-  batteryPercentage = batteryVoltage / MAX_BATTERY_VOLTAGE * 100;
+  batteryVoltage = state.voltage;
+  batteryRestingVoltage = state.restingVoltage;
+  batteryCurrent = state.current;
+  batteryPercentage = state.percentage;
 
   //Turn on the led if battery voltage is too low.
   if(batteryVoltage <= WARNING_BATTERY_VOLTAGE){
@@ -58,8 +221,9 @@ void readBatteryVoltage(){
 
 /**
  * @brief Prints battery readings
- * 
+ *
  */
 void printBatteryVoltage(){
-  Serial.printf("pinPulseWidth: %f,  batteryVoltage: %f V, TOTAL_DROP: %f, batteryPercentage: %f\n", pinPulseWidth, batteryVoltage, TOTAL_DROP, batteryPercentage);
+  Serial.printf("pinPulseWidth: %f,  batteryVoltage: %f V, restingVoltage: %f V, current: %f A, consumed: %f mAh, batteryPercentage: %f\n",
+                pinPulseWidth, batteryVoltage, batteryRestingVoltage, batteryCurrent, batterySnapshot.consumed, batteryPercentage);
 }
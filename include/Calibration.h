@@ -26,7 +26,10 @@
  *  @li a: altitude sensor.
  *  @li e: print EEPROM.
  *  @li b: battery check.
+ *  @li d: rangefinder check.
  *  @li s: GPS check.
+ *  @li m: compass heading.
+ *  @li c: compass calibration.
  *  @li 1: check rotation / vibrations for motor 1 (right front CCW).
  *  @li 2: check rotation / vibrations for motor 2 (right rear CW).
  *  @li 3: check rotation / vibrations for motor 3 (left rear CCW).
@@ -68,7 +71,10 @@ long accAvVector,  accVectorNorm[20], vibrationTotalResult;
     Serial.println("   l: blink leds.");
     Serial.println("   a: print altitude readings.");
     Serial.println("   b: print battery readings.");
+    Serial.println("   d: print rangefinder readings.");
     Serial.println("   s: print GPS readings.");
+    Serial.println("   m: print compass heading.");
+    Serial.println("   c: calibrate compass.");
     Serial.println("   p: calibrate autoPID.");
     Serial.println("   1: check rotation / vibrations for motor 1 (right front CCW).");
     Serial.println("   2: check rotation / vibrations for motor 2 (right rear CW).");
@@ -124,10 +130,20 @@ long accAvVector,  accVectorNorm[20], vibrationTotalResult;
         checkAltitudeSensor();                                                          // few seconds for calibrating the barometer       
       }
       if(msg == 'b') Serial.println("Print battery readings.");
+      if(msg == 'd') Serial.println("Print rangefinder readings.");
       if(msg == 's') {
         setupGPS();
         Serial.println("Print GPS readings");
       }
+      if(msg == 'm'){
+        Serial.println("Print compass heading.");
+        setupCompass();                                                                 // see Compass.h
+        calibrateGyroscope();                                                           // the roll and pitch for the heading
+      }
+      if(msg == 'c'){
+        Serial.println("Calibrate compass.");
+        setupCompass();                                                                 // see Compass.h
+      }
       if(msg == '1') Serial.println("Test motor 1 (right front CCW.)\n Connect battery to motors BUT NOT TO THE BOARD !! ");
       if(msg == '2') Serial.println("Test motor 2 (right rear CW.)\n Connect battery to motors BUT NOT TO THE BOARD !! ");
       if(msg == '3') Serial.println("Test motor 3 (left rear CCW.)\n Connect battery to motors BUT NOT TO THE BOARD !! ");
@@ -303,6 +319,14 @@ long accAvVector,  accVectorNorm[20], vibrationTotalResult;
           ledcWrite(pwmChannel3, (uint32_t)((float)esc3/2000.*(float)MAX_DUTY_CYCLE));
           ledcWrite(pwmChannel4, (uint32_t)((float)esc4/2000.*(float)MAX_DUTY_CYCLE));
 
+        #elif defined(MOTOR_PULSE_BY_DSHOT)
+
+          writeDShot();
+
+        #elif defined(MOTOR_PULSE_BY_ONESHOT)
+
+          writeOneShot();
+
         #endif
 
 
@@ -342,44 +366,31 @@ long accAvVector,  accVectorNorm[20], vibrationTotalResult;
   }
 
 
-  void calibrateAutoPID(std::vector<int> structure){
-
-    Serial.println("Train the neural network to calibrate the PID parameters.");
-    delay(2000);
-
-    // initialize the auto pid objects
-      initAutoPID(structure, zLRoll, aLRoll, biasRoll, deltaBiasRoll, weightsRoll, deltaWeightsRoll, 200, {"roll-bias","roll-weights"});// pitch has the same values
-      initAutoPID(structure, zLYaw, aLYaw, biasYaw, deltaBiasYaw, weightsYaw, deltaWeightsYaw, 200, {"yaw-bias","yaw-weights"});
-
-
-    calibrateGyroscope();                                 // calibrate gyroscope
-    
-    
-    while (Serial.available() == 0){                      // if no char is sent to the serial, autotune PID
-      convertAllSignals();
-      calculateAnglePRY();
-      calculatePID();
-      autotunePID();
-    }
-
-    // save the weights on the EEPROM
-    Serial.printf("\n Saving weights on EEPROM...\n");
+  /**
+   * @brief Saves a network of the autoPID batch on the flash, then prints what was saved.
+   * 
+   * @param axis see autoPIDAxis
+   * @param name printed name
+   * @param memoryNamespace namespaces of the biases and of the weights
+   */
+  void saveAutoPID(int axis, const char *name, std::vector<const char*> memoryNamespace){
 
     int memoryAddress = 0;              // the starting index of memory
     int kk, ii, jj;
+    float value;
+    char numChar[20 + sizeof(char)];
 
-    preferences.begin("roll-bias", false);
+    preferences.begin(memoryNamespace[0], false);
     preferences.clear();// Remove all preferences under the opened namespace
 
-    char numChar[20 + sizeof(char)];
-
-    // roll biases
-    for(jj = 1; jj < structure.size(); jj++){
-      Serial.printf("Roll bias layer%i: \n", jj);
+    // biases
+    for(jj = 1; jj < numberOfLayers; jj++){
+      Serial.printf("%s bias layer%i: \n", name, jj);
         for (ii = 0; ii < structure[jj]; ii++) {
-            Serial.printf("%f ",biasRoll[jj-1][ii]);
+            value = networkValue(autoPIDLayout, autoPID, autoPIDLayout.bias[jj], ii, axis);
+            Serial.printf("%f ", value);
             sprintf(numChar, "%i", memoryAddress);
-            preferences.putFloat(numChar, biasRoll[jj-1][ii]);
+            preferences.putFloat(numChar, value);
             memoryAddress++;
         }
          Serial.printf("\n");
@@ -387,90 +398,34 @@ long accAvVector,  accVectorNorm[20], vibrationTotalResult;
 
     Serial.printf("\n\n");
     preferences.end();
-    preferences.begin("roll-weights", false);
+    preferences.begin(memoryNamespace[1], false);
     preferences.clear();// Remove all preferences under the opened namespace
     memoryAddress = 0;
 
-    // roll weights
-    for(jj = 1; jj < structure.size(); jj++){
-      Serial.printf("Roll weights layer%i: \n", jj);
+    // weights
+    for(jj = 1; jj < numberOfLayers; jj++){
+      Serial.printf("%s weights layer%i: \n", name, jj);
       for (kk = 0; kk < structure[jj-1]; kk++){
           for (ii = 0; ii < structure[jj]; ii++) {
-              Serial.printf("%f ",weightsRoll[jj-1][kk][ii]);
+              value = networkValue(autoPIDLayout, autoPID, autoPIDLayout.weights[jj], kk * structure[jj] + ii, axis);
+              Serial.printf("%f ", value);
               sprintf(numChar, "%i", memoryAddress);
-              preferences.putFloat(numChar, weightsRoll[jj-1][kk][ii]);
+              preferences.putFloat(numChar, value);
               memoryAddress++;
           }
           Serial.printf("\n");
         }
         Serial.printf("\n\n");
     }
-
-    preferences.end();
-    preferences.begin("yaw-bias", false);
-    preferences.clear();// Remove all preferences under the opened namespace
-    memoryAddress = 0;
-
-    // yaw biases
-    for(jj = 1; jj < structure.size(); jj++){
-      Serial.printf("Yaw bias layer%i: \n", jj);
-        for (ii = 0; ii < structure[jj]; ii++) {
-            Serial.printf("%f ",biasYaw[jj-1][ii]);
-            sprintf(numChar, "%i", memoryAddress);
-            preferences.putFloat(numChar, biasYaw[jj-1][ii]);
-            memoryAddress++;
-        }
-         Serial.printf("\n");
-      }
-
-    Serial.printf("\n\n");
     preferences.end();
-    preferences.begin("yaw-weights", false);
-    preferences.clear();// Remove all preferences under the opened namespace
-    memoryAddress = 0;
 
-    // yaw weights
-  for(jj = 1; jj < structure.size(); jj++){
-      Serial.printf("Yaw weights layer%i: \n", jj);
-     for (kk = 0; kk < structure[jj-1]; kk++){
-        for (ii = 0; ii < structure[jj]; ii++) {
-            Serial.printf("%f ",weightsYaw[jj-1][kk][ii]);
-            sprintf(numChar, "%i", memoryAddress);
-            preferences.putFloat(numChar, weightsYaw[jj-1][kk][ii]);
-            memoryAddress++;
-        }
-        Serial.printf("\n");
-      }
-      Serial.printf("\n\n");
-  }
-  preferences.end();
-  
-
-  // read preferences
-  preferences.begin("roll-weights", true);
-  memoryAddress=0;
-    
-  for(jj = 1; jj < structure.size(); jj++){
-  Serial.printf("Print roll weights layer%i: \n", jj);
-    for (kk = 0; kk < structure[jj-1]; kk++){
-      for (ii = 0; ii < structure[jj]; ii++) {
-        sprintf(numChar, "%i", memoryAddress);
-        float f = preferences.getFloat(numChar, 0.0f);
-        Serial.printf("%f ",f);
-        memoryAddress++;
-      }
-      Serial.printf("\n");
-    }
-    Serial.printf("\n\n");
-  }
-  preferences.end();
-
-  preferences.begin("yaw-weights", true);
-  memoryAddress=0;
-  
-  for(jj = 1; jj < structure.size(); jj++){
-    Serial.printf("Print Yaw weights layer%i: \n", jj);
-     for (kk = 0; kk < structure[jj-1]; kk++){
+    // read preferences
+    preferences.begin(memoryNamespace[1], true);
+    memoryAddress=0;
+      
+    for(jj = 1; jj < numberOfLayers; jj++){
+    Serial.printf("Print %s weights layer%i: \n", name, jj);
+      for (kk = 0; kk < structure[jj-1]; kk++){
         for (ii = 0; ii < structure[jj]; ii++) {
           sprintf(numChar, "%i", memoryAddress);
           float f = preferences.getFloat(numChar, 0.0f);
@@ -482,7 +437,36 @@ long accAvVector,  accVectorNorm[20], vibrationTotalResult;
       Serial.printf("\n\n");
     }
     preferences.end();
+  }
+
+
+  void calibrateAutoPID(){
+
+    Serial.println("Train the neural network to calibrate the PID parameters.");
+    delay(2000);
+
+    // initialize the auto pid objects
+      initAutoPID(AUTOPID_ROLL, 200, {"roll-bias","roll-weights"});
+      initAutoPID(AUTOPID_PITCH, 200, {"pitch-bias","pitch-weights"}, AUTOPID_ROLL);// pitch starts from roll
+      initAutoPID(AUTOPID_YAW, 200, {"yaw-bias","yaw-weights"});
+
+
+    calibrateGyroscope();                                 // calibrate gyroscope
+    
+    
+    while (Serial.available() == 0){                      // if no char is sent to the serial, autotune PID
+      convertAllSignals();
+      calculateAnglePRY();
+      calculatePID();
+      autotunePID();
+    }
+
+    // save the weights on the EEPROM
+    Serial.printf("\n Saving weights on EEPROM...\n");
 
+    saveAutoPID(AUTOPID_ROLL, "Roll", {"roll-bias","roll-weights"});
+    saveAutoPID(AUTOPID_PITCH, "Pitch", {"pitch-bias","pitch-weights"});
+    saveAutoPID(AUTOPID_YAW, "Yaw", {"yaw-bias","yaw-weights"});
 
     Serial.printf("\n NN saved on flash memory \n \n");
 
@@ -0,0 +1,287 @@
+/**
+ * @file Compass.h
+ * @author @sebastiano123-c
+ * @brief Magnetometer routines: HMC5883L and QMC5883L.
+ *
+ * The compass shares the I2C bus with the gyroscope and the barometer. Each I2C transfer of the ESP32 Wire waits
+ * for its end, so the readings are spread over the loops: the barometer is read every other loop (see Altitude.h)
+ * and the compass is read in one of the other loops, every COMPASS_LOOP_DIVIDER loops (62.5Hz), so that no loop
+ * reads more than the gyroscope and one more sensor.
+ *
+ * At every reading:
+ *  @li the axes of the chip are turned into the ones of the drone (x to the nose, y to the right, z down);
+ *  @li the hard and soft iron are removed with the calibration saved on the flash by the CALIBRATION sketch
+ *      (see CompassFit.h and calibrateCompass());
+ *  @li the field is brought back to the horizontal plane with the roll and the pitch of calculateAnglePRY(), and
+ *      the declination gives the true heading, actualCompassHeading;
+ *  @li the heading of the gyroscope, angleYaw, is moved towards it: angleYaw follows the compass in about
+ *      COMPASS_FUSION_TIME, and the gyroscope keeps it smooth in between.
+ * The GPS controller turns the north and east errors into roll and pitch with angleYaw (see GPS.h), so with a
+ * calibrated compass the motors can be started with the nose in any direction.
+ * Without a calibration on the flash the compass is not used, and angleYaw is 0 at the start of the motors.
+ *
+ * @version 0.1
+ * @date 2022-06-27
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#define COMPASS_MAGIC               0x53504d43                // "CMPS"
+#define COMPASS_VERSION             2
+#define COMPASS_NAMESPACE           "compass"
+#define COMPASS_KEY                 "blob"
+#define COMPASS_LOOP_DIVIDER        4                         // a reading every 4 loops at least (62.5Hz)
+#define COMPASS_FUSION_GAIN         (COMPASS_LOOP_DIVIDER * 0.004f / COMPASS_FUSION_TIME)   // of a reading
+
+struct compassBlob {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t chip;                                              // COMPASS of the calibration
+  compassCalibration calibration;
+};
+
+#if COMPASS != OFF
+
+/**
+ * @brief Waits for the compass and sets its registers.
+ */
+void setCompassRegisters(){
+
+  Wire.beginTransmission(COMPASS_ADDRESS);
+  error = Wire.endTransmission();
+  while(error != 0){                                          // stay here: the compass did not respond
+    ledcWrite(pwmLedChannel, abs(MAX_DUTY_CYCLE - (int)ledcRead(pwmLedChannel)));
+    Serial.print("COMPASS ERROR at address: ");
+    Serial.println(COMPASS_ADDRESS);
+    vTaskDelay(80/portTICK_PERIOD_MS);
+    Wire.beginTransmission(COMPASS_ADDRESS);
+    error = Wire.endTransmission();
+  }
+  ledcWrite(pwmLedChannel, 0);
+
+  #if COMPASS == HMC5883L
+    Wire.beginTransmission(COMPASS_ADDRESS);
+    Wire.write(COMPASS_CONFIG_A);                             // from the configuration register A
+    Wire.write(COMPASS_CONFIG_A_BITS);
+    Wire.write(COMPASS_CONFIG_B_BITS);
+    Wire.write(COMPASS_MODE_BITS);
+    Wire.endTransmission();
+  #elif COMPASS == QMC5883L
+    Wire.beginTransmission(COMPASS_ADDRESS);
+    Wire.write(COMPASS_SET_RESET);
+    Wire.write(COMPASS_SET_RESET_BITS);
+    Wire.endTransmission();
+
+    Wire.beginTransmission(COMPASS_ADDRESS);
+    Wire.write(COMPASS_CONTROL_1);
+    Wire.write(COMPASS_CONTROL_1_BITS);
+    Wire.endTransmission();
+  #endif
+
+  vTaskDelay(20/portTICK_PERIOD_MS);                          // the first measurement
+}
+
+/**
+ * @brief Reads the calibration saved on the flash. Call it in setup().
+ */
+void loadCompassCalibration(){
+
+  compassBlob blob;
+  preferences.begin(COMPASS_NAMESPACE, true);
+  size_t length = preferences.getBytes(COMPASS_KEY, &blob, sizeof(blob));
+  preferences.end();
+
+  memset(&compassCal, 0, sizeof(compassCal));
+  if(length == sizeof(blob) && blob.magic == COMPASS_MAGIC && blob.version == COMPASS_VERSION && blob.chip == COMPASS)
+    compassCal = blob.calibration;
+  traceInput(TRACE_COMPASS_CALIBRATION, &compassCal, sizeof(compassCal));   // see FlightRecorder.h
+
+  compassCalibrated = validCompassCalibration(compassCal);
+
+  #if DEBUG || UPLOADED_SKETCH == CALIBRATION
+    if(!compassCalibrated) Serial.println("COMPASS: not calibrated, the heading is the one of the gyroscope");
+  #endif
+}
+
+/**
+ * @brief Saves a calibration on the flash.
+ *
+ * @param calibration
+ * @return true if saved
+ */
+bool saveCompassCalibration(const compassCalibration &calibration){
+
+  compassBlob blob;
+  memset(&blob, 0, sizeof(blob));
+  blob.magic = COMPASS_MAGIC;
+  blob.version = COMPASS_VERSION;
+  blob.chip = COMPASS;
+  blob.calibration = calibration;
+
+  preferences.begin(COMPASS_NAMESPACE, false);
+  bool written = preferences.putBytes(COMPASS_KEY, &blob, sizeof(blob)) == sizeof(blob);
+  preferences.end();
+  return written;
+}
+
+/**
+ * @brief Sets the compass up and reads its calibration.
+ */
+void setupCompass(){
+  setCompassRegisters();
+  loadCompassCalibration();
+  compassLoopCounter = 0;
+}
+
+/**
+ * @brief Reads the field, in the axes of the drone.
+ *
+ * @param reading (LSB) x to the nose, y to the right, z down
+ * @return true if the reading is good
+ */
+bool readCompassField(float reading[3]){
+
+  uint8_t data[6];
+  memset(data, 0, sizeof(data));
+
+  Wire.beginTransmission(COMPASS_ADDRESS);
+  Wire.write(COMPASS_DATA);
+  Wire.endTransmission();
+  Wire.requestFrom(COMPASS_ADDRESS, 6);
+  for(int i = 0; i < 6 && Wire.available(); i++) data[i] = Wire.read();
+  traceInput(TRACE_COMPASS, data, 6);                         // see FlightRecorder.h
+
+  #if COMPASS == HMC5883L
+    int16_t x = data[0]<<8|data[1], z = data[2]<<8|data[3], y = data[4]<<8|data[5];       // X, Z, Y
+    if(x == COMPASS_OVERFLOW || y == COMPASS_OVERFLOW || z == COMPASS_OVERFLOW) return false;
+  #elif COMPASS == QMC5883L
+    int16_t x = data[1]<<8|data[0], y = data[3]<<8|data[2], z = data[5]<<8|data[4];       // X, Y, Z
+  #endif
+  if(x == 0 && y == 0 && z == 0) return false;                // nothing read
+
+  // the chip has its Z axis up, unless it is upside down
+  compassX = x;
+  compassY = COMPASS_UPSIDE_DOWN ? y : -y;
+  compassZ = COMPASS_UPSIDE_DOWN ? z : -z;
+
+  reading[0] = compassX;
+  reading[1] = compassY;
+  reading[2] = compassZ;
+  return true;
+}
+
+/**
+ * @brief The true heading of a reading, with the present roll and pitch.
+ *
+ * @param reading (LSB) as given by readCompassField()
+ */
+void calculateCompassHeading(const float reading[3]){
+
+  float field[3];
+  applyCompassCalibration(compassCal, reading, field);        // see CompassFit.h
+
+  actualCompassHeading = compassHeading(field, angleRoll, anglePitch) + COMPASS_DECLINATION;
+  if(actualCompassHeading < 0) actualCompassHeading += 360;
+  else if(actualCompassHeading >= 360) actualCompassHeading -= 360;
+}
+
+/**
+ * @brief Reads the compass when it is its turn on the bus, and corrects the heading of the gyroscope.
+ * Call it after calculateAnglePRY().
+ */
+void readCompass(){
+
+  if(compassLoopCounter < COMPASS_LOOP_DIVIDER) compassLoopCounter++;
+  if(compassLoopCounter < COMPASS_LOOP_DIVIDER) return;
+
+  #if UPLOADED_SKETCH == FLIGHT_CONTROLLER && ALTITUDE_SENSOR != OFF
+    if(barometerCounter != 1) return;                         // the barometer reads in this loop
+  #endif
+  compassLoopCounter = 0;
+
+  float reading[3];
+  if(!readCompassField(reading)) return;
+  calculateCompassHeading(reading);
+
+  if(!compassCalibrated) return;
+  angleYaw += headingDifference(actualCompassHeading, angleYaw) * COMPASS_FUSION_GAIN;
+  if(angleYaw < 0) angleYaw += 360;
+  else if(angleYaw >= 360) angleYaw -= 360;
+}
+
+/**
+ * @brief Prints the compass readings.
+ */
+void printCompass(){
+  Serial.printf("X: %i, Y: %i, Z: %i \t heading: %.1f deg%s\n", compassX, compassY, compassZ, actualCompassHeading,
+                compassCalibrated ? "" : " (not calibrated)");
+}
+
+#if UPLOADED_SKETCH == CALIBRATION
+
+  /**
+   * @brief Fits the calibration while the drone is turned on all its sides, then saves it on the flash.
+   * Stops when a char is sent on the serial.
+   */
+  void calibrateCompass(){
+
+    compassFit fit;
+    compassCalibration calibration;
+    float reading[3];
+    resetCompassFit(fit);
+
+    Serial.println("Turn the drone slowly on all its sides: nose up, nose down, on the left and on the right,");
+    Serial.println("upside down, and around the yaw in each position. Send any char to stop.");
+
+    while(Serial.available() == 0){
+      if(readCompassField(reading)){
+        addCompassFitSample(fit, reading);                    // see CompassFit.h
+        if(fit.samples % 50 == 0)
+          Serial.printf("%li readings, X: %.0f to %.0f, Y: %.0f to %.0f, Z: %.0f to %.0f\n", fit.samples,
+                        fit.minimum[0], fit.maximum[0], fit.minimum[1], fit.maximum[1], fit.minimum[2], fit.maximum[2]);
+      }
+      vTaskDelay(15/portTICK_PERIOD_MS);
+    }
+    while(Serial.available() > 0) Serial.read();
+
+    if(!solveCompassFit(fit, calibration)){
+      Serial.println("\nCompass NOT calibrated: turn the drone on all its sides, far from iron and magnets.\n");
+    }
+    else if(saveCompassCalibration(calibration)){
+      compassCal = calibration;
+      compassCalibrated = true;
+      Serial.printf("\nCompass calibrated: offsets %.1f %.1f %.1f\n"
+                    "soft iron %.3f %.3f %.3f / %.3f %.3f %.3f / %.3f %.3f %.3f\n\n",
+                    calibration.offset[0], calibration.offset[1], calibration.offset[2],
+                    calibration.softIron[0][0], calibration.softIron[0][1], calibration.softIron[0][2],
+                    calibration.softIron[1][0], calibration.softIron[1][1], calibration.softIron[1][2],
+                    calibration.softIron[2][0], calibration.softIron[2][1], calibration.softIron[2][2]);
+    }
+    else Serial.println("\nCompass calibration NOT saved on the flash.\n");
+
+    dialInstructions();
+    msg = 0;
+  }
+
+#endif
+
+#else
+
+void setupCompass(){
+  return;
+}
+void readCompass(){
+  return;
+}
+#if UPLOADED_SKETCH == CALIBRATION
+  void printCompass(){
+    Serial.println("No compass: set COMPASS in Config.h");
+  }
+  void calibrateCompass(){
+    Serial.println("No compass: set COMPASS in Config.h");
+    msg = 0;
+  }
+#endif
+
+#endif
@@ -0,0 +1,286 @@
+/**
+ * @file CompassFit.h
+ * @author @sebastiano123-c
+ * @brief Calibration of the compass and tilt compensated heading.
+ *
+ * The field read by a compass on the drone is not a sphere around zero when the drone turns:
+ *  @li the iron and the currents of the drone add a constant field (hard iron), that moves the center;
+ *  @li the iron close to the chip and the chip itself bend the field (soft iron): each axis has its own gain, and
+ *      the iron that is not along an axis of the drone mixes the axes too.
+ * So the readings lie on an ellipsoid, with its axes turned. The calibration fits the whole ellipsoid,
+ *
+ *          A x^2 + B y^2 + C z^2 + 2D xy + 2E xz + 2F yz + 2G x + 2H y + 2I z = 1,
+ *
+ * by least squares on the readings taken while the drone is turned on all its sides. The sums of the normal
+ * equations are accumulated one reading at a time, so that the fit needs no memory for the readings. The center of
+ * the ellipsoid is the hard iron offset; the axes and the radii of the ellipsoid (the eigenvectors and eigenvalues
+ * of its matrix, by Jacobi) give the soft iron matrix, that brings the ellipsoid back to a sphere. The fit is
+ * refused if the readings do not cover the ellipsoid (e.g. the drone was only turned around the yaw axis).
+ *
+ * The axes are the ones of the drone: x to the nose, y to the right, z down.
+ * These routines do not depend on the board, so they can be used in the host programs of the /test dir.
+ *
+ * @version 0.1
+ * @date 2022-06-27
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cmath>
+#include <stdint.h>
+#include <string.h>
+
+#ifndef COMPASS_FIT_H
+#define COMPASS_FIT_H
+
+#define COMPASS_FIT_MIN_SAMPLES     200                       // readings at least
+#define COMPASS_FIT_MIN_COVERAGE    1.4f                      // (radii) span of the readings along each axis at least
+#define COMPASS_FIT_MAX_ASPECT      1.5f                      // largest radius / smallest one at most
+
+#define COMPASS_FIT_TERMS           9
+
+/**
+ * @brief The calibration, as saved on the flash: field = softIron * (reading - offset).
+ */
+struct compassCalibration {
+  float offset[3];                  // (LSB) hard iron
+  float softIron[3][3];             // symmetric, the radius of the sphere is the mean one of the ellipsoid
+};
+
+/**
+ * @brief The sums of the fit.
+ */
+struct compassFit {
+  double normal[COMPASS_FIT_TERMS][COMPASS_FIT_TERMS];   // sum of the products of the terms x^2, y^2, z^2, 2xy,
+                                                         // 2xz, 2yz, 2x, 2y, 2z
+  double known[COMPASS_FIT_TERMS];                       // sum of the terms
+  float minimum[3], maximum[3];     // (LSB) of the readings
+  long samples;
+};
+
+/**
+ * @brief Starts a new fit.
+ *
+ * @param fit
+ */
+inline void resetCompassFit(compassFit &fit){
+  memset(&fit, 0, sizeof(fit));
+  for(int i = 0; i < 3; i++){
+    fit.minimum[i] = 1e9f;
+    fit.maximum[i] = -1e9f;
+  }
+}
+
+/**
+ * @brief Adds a reading to the fit.
+ *
+ * @param fit
+ * @param reading (LSB) x, y, z
+ */
+inline void addCompassFitSample(compassFit &fit, const float reading[3]){
+  double x = reading[0], y = reading[1], z = reading[2];
+  double terms[COMPASS_FIT_TERMS] = {x * x, y * y, z * z, 2.0 * x * y, 2.0 * x * z, 2.0 * y * z, 2.0 * x, 2.0 * y, 2.0 * z};
+
+  for(int i = 0; i < COMPASS_FIT_TERMS; i++){
+    for(int j = i; j < COMPASS_FIT_TERMS; j++) fit.normal[i][j] += terms[i] * terms[j];
+    fit.known[i] += terms[i];
+  }
+  for(int i = 0; i < 3; i++){
+    fit.minimum[i] = fminf(fit.minimum[i], reading[i]);
+    fit.maximum[i] = fmaxf(fit.maximum[i], reading[i]);
+  }
+  fit.samples++;
+}
+
+/**
+ * @brief Eigenvalues and eigenvectors of a symmetric 3x3 matrix, by the rotations of Jacobi.
+ *
+ * @param matrix symmetric
+ * @param values
+ * @param vectors the eigenvectors in the columns
+ */
+inline void symmetricEigen(const double matrix[3][3], double values[3], double vectors[3][3]){
+
+  double a[3][3];
+  memcpy(a, matrix, sizeof(a));
+  for(int i = 0; i < 3; i++)
+    for(int j = 0; j < 3; j++) vectors[i][j] = i == j ? 1.0 : 0.0;
+
+  for(int sweep = 0; sweep < 20; sweep++){
+    if(fabs(a[0][1]) + fabs(a[0][2]) + fabs(a[1][2]) == 0.0) break;
+    for(int p = 0; p < 2; p++)
+      for(int q = p + 1; q < 3; q++){
+        if(a[p][q] == 0.0) continue;
+        // the rotation in the plane p, q that cancels a[p][q]
+        double theta = (a[q][q] - a[p][p]) / (2.0 * a[p][q]);
+        double t = (theta >= 0.0 ? 1.0 : -1.0) / (fabs(theta) + sqrt(theta * theta + 1.0));
+        double c = 1.0 / sqrt(t * t + 1.0), s = t * c;
+        for(int k = 0; k < 3; k++){
+          double kp = a[k][p], kq = a[k][q];
+          a[k][p] = c * kp - s * kq;
+          a[k][q] = s * kp + c * kq;
+        }
+        for(int k = 0; k < 3; k++){
+          double pk = a[p][k], qk = a[q][k];
+          a[p][k] = c * pk - s * qk;
+          a[q][k] = s * pk + c * qk;
+        }
+        for(int k = 0; k < 3; k++){
+          double kp = vectors[k][p], kq = vectors[k][q];
+          vectors[k][p] = c * kp - s * kq;
+          vectors[k][q] = s * kp + c * kq;
+        }
+      }
+  }
+  for(int i = 0; i < 3; i++) values[i] = a[i][i];
+}
+
+/**
+ * @brief Solves the fit.
+ *
+ * @param fit
+ * @param calibration the result, unchanged if the fit fails
+ * @return true if the readings give a calibration
+ */
+inline bool solveCompassFit(const compassFit &fit, compassCalibration &calibration){
+
+  const int n = COMPASS_FIT_TERMS;
+  if(fit.samples < COMPASS_FIT_MIN_SAMPLES) return false;
+
+  // the normal equations, by Gauss elimination with partial pivoting
+  double m[n][n + 1], tiny = 1e-12 * fit.normal[0][0];
+  for(int i = 0; i < n; i++){
+    for(int j = 0; j < n; j++) m[i][j] = j >= i ? fit.normal[i][j] : fit.normal[j][i];
+    m[i][n] = fit.known[i];
+  }
+
+  for(int c = 0; c < n; c++){
+    int pivot = c;
+    for(int r = c + 1; r < n; r++) if(fabs(m[r][c]) > fabs(m[pivot][c])) pivot = r;
+    if(!(fabs(m[pivot][c]) > tiny)) return false;
+    for(int j = 0; j <= n; j++){ double t = m[c][j]; m[c][j] = m[pivot][j]; m[pivot][j] = t; }
+
+    for(int r = c + 1; r < n; r++){
+      double f = m[r][c] / m[c][c];
+      for(int j = c; j <= n; j++) m[r][j] -= f * m[c][j];
+    }
+  }
+
+  double p[n];
+  for(int r = n - 1; r >= 0; r--){
+    p[r] = m[r][n];
+    for(int j = r + 1; j < n; j++) p[r] -= m[r][j] * p[j];
+    p[r] /= m[r][r];
+  }
+
+  // x' Q x + 2 v' x = 1: with the eigenvalues of Q all positive it is (x - x0)' Q (x - x0) = G, x0 = -Q^-1 v
+  const double quadric[3][3] = {{p[0], p[3], p[4]}, {p[3], p[1], p[5]}, {p[4], p[5], p[2]}};
+  double eigen[3], axes[3][3];
+  symmetricEigen(quadric, eigen, axes);
+  if(!(eigen[0] > 0.0 && eigen[1] > 0.0 && eigen[2] > 0.0)) return false;    // not an ellipsoid (NaN too)
+
+  double inverse[3][3], center[3], g = 1.0;
+  for(int i = 0; i < 3; i++)
+    for(int j = 0; j < 3; j++){
+      inverse[i][j] = 0.0;
+      for(int k = 0; k < 3; k++) inverse[i][j] += axes[i][k] * axes[j][k] / eigen[k];
+    }
+  for(int i = 0; i < 3; i++){
+    center[i] = 0.0;
+    for(int j = 0; j < 3; j++) center[i] -= inverse[i][j] * p[6 + j];
+  }
+  for(int i = 0; i < 3; i++) g -= p[6 + i] * center[i];                     // 1 + x0' Q x0
+  if(!(g > 0.0)) return false;
+
+  double radius[3];
+  for(int i = 0; i < 3; i++) radius[i] = sqrt(g / eigen[i]);
+
+  double mean = cbrt(radius[0] * radius[1] * radius[2]), smallest = radius[0], largest = radius[0];
+  for(int i = 1; i < 3; i++){
+    smallest = fmin(smallest, radius[i]);
+    largest = fmax(largest, radius[i]);
+  }
+  if(largest > COMPASS_FIT_MAX_ASPECT * smallest) return false;
+
+  // the drone has been turned on all its sides: the readings span the ellipsoid along each axis of the drone
+  for(int i = 0; i < 3; i++)
+    if(fit.maximum[i] - fit.minimum[i] < COMPASS_FIT_MIN_COVERAGE * sqrt(g * inverse[i][i])) return false;
+
+  // along each axis of the ellipsoid, its radius to the mean one
+  for(int i = 0; i < 3; i++){
+    calibration.offset[i] = (float)center[i];
+    for(int j = 0; j < 3; j++){
+      double soft = 0.0;
+      for(int k = 0; k < 3; k++) soft += axes[i][k] * axes[j][k] * mean / radius[k];
+      calibration.softIron[i][j] = (float)soft;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief Checks a calibration, e.g. read from the flash.
+ *
+ * @param calibration
+ * @return true if it can be used
+ */
+inline bool validCompassCalibration(const compassCalibration &calibration){
+  // the eigenvalues are within the limits of the fit, so are the diagonal and half their spread off the diagonal
+  const float spread = 0.5f * (COMPASS_FIT_MAX_ASPECT - 1.0f / COMPASS_FIT_MAX_ASPECT);
+  for(int i = 0; i < 3; i++){
+    if(!(fabsf(calibration.offset[i]) < 32768.0f)) return false;                     // NaN too
+    for(int j = 0; j < 3; j++){
+      float soft = calibration.softIron[i][j];
+      if(i == j && !(soft > 1.0f / COMPASS_FIT_MAX_ASPECT && soft < COMPASS_FIT_MAX_ASPECT)) return false;
+      if(i != j && !(fabsf(soft) <= spread)) return false;
+    }
+  }
+  return true;
+}
+
+/**
+ * @brief The field without the hard and the soft iron.
+ *
+ * @param calibration
+ * @param reading (LSB) x, y, z
+ * @param field (LSB) x, y, z
+ */
+inline void applyCompassCalibration(const compassCalibration &calibration, const float reading[3], float field[3]){
+  float hard[3];
+  for(int i = 0; i < 3; i++) hard[i] = reading[i] - calibration.offset[i];
+  for(int i = 0; i < 3; i++)
+    field[i] = calibration.softIron[i][0] * hard[0] + calibration.softIron[i][1] * hard[1] +
+               calibration.softIron[i][2] * hard[2];
+}
+
+/**
+ * @brief Magnetic heading of the nose, with the field brought back to the horizontal plane.
+ *
+ * @param field x to the nose, y to the right, z down (any unit)
+ * @param roll (deg) right wing down positive
+ * @param pitch (deg) nose up positive
+ * @return float (deg) 0 north, 90 east, in [0, 360)
+ */
+inline float compassHeading(const float field[3], float roll, float pitch){
+  float r = roll * (float)M_PI / 180.0f, p = pitch * (float)M_PI / 180.0f;
+  float front = field[0] * cosf(p) + (field[1] * sinf(r) + field[2] * cosf(r)) * sinf(p);   // horizontal, to the nose
+  float right = field[1] * cosf(r) - field[2] * sinf(r);                                   // horizontal, to the right
+
+  float heading = atan2f(-right, front) * 180.0f / (float)M_PI;
+  return heading < 0.0f ? heading + 360.0f : heading;
+}
+
+/**
+ * @brief Difference between two headings.
+ *
+ * @param to (deg)
+ * @param from (deg)
+ * @return float (deg) in [-180, 180)
+ */
+inline float headingDifference(float to, float from){
+  float difference = fmodf(to - from + 540.0f, 360.0f);
+  if(difference < 0.0f) difference += 360.0f;
+  return difference - 180.0f;
+}
+
+#endif /* COMPASS_FIT_H */
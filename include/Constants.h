@@ -38,7 +38,20 @@
 #define BME280                      12
 #define HCSR04                      13
 #define BN_880                      14
+#define HMC5883L                    24
+#define QMC5883L                    25
 
 //      (WiFi)
 #define NATIVE                      15
 #define ESP_CAM                     16
+#define MAVLINK                     23
+
+//      (Motor protocols)
+#define ONESHOT125                  17
+#define MULTISHOT                   18
+
+//      (Frames)
+#define QUAD_X                      19
+#define QUAD_PLUS                   20
+#define HEX_X                       21
+#define OCTO_X                      22
@@ -0,0 +1,182 @@
+/**
+ * @file DShot.h
+ * @author @sebastiano123-c
+ * @brief DShot motor output using the ESP32 RMT peripheral.
+ *
+ * DShot is a digital protocol: the ESC receives the throttle as a 16 bits frame (see DShotFrame.h) instead of a
+ * pulse width, so there is no ESC calibration and the frame lasts few microseconds (27us at DShot600).
+ * Each motor has its own RMT TX channel (0-3): writeDShot() fills the RMT memory of the four channels, then
+ * starts them one after the other, so the four frames go out in parallel.
+ *
+ * With DSHOT_BIDIRECTIONAL the ESCs answer every frame with the motor eRPM on the same wire.
+ * The pins are open drain, and when a frame is sent an RX channel (4-7) listening on the same pin is started.
+ * At the next loop readDShotTelemetry() decodes the answers into motorERPM[].
+ *
+ * @version 0.1
+ * @date 2022-06-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#define DSHOT_RMT_CLOCK_DIVIDER     1                                           // 80MHz RMT ticks, 12.5ns each
+#define DSHOT_BIT_TICKS             (80000000 / (DSHOT_SPEED * 1000))           // ticks of a DShot bit
+#define DSHOT_T1H_TICKS             (DSHOT_BIT_TICKS * 3 / 4)                   // high time of a 1
+#define DSHOT_T0H_TICKS             (DSHOT_BIT_TICKS * 3 / 8)                   // high time of a 0
+#define DSHOT_TELEMETRY_BIT_TICKS   (DSHOT_BIT_TICKS * 4 / 5)                   // the ESC answers 5/4 faster
+
+const rmt_channel_t dshotTxChannel[4] = {RMT_CHANNEL_0, RMT_CHANNEL_1, RMT_CHANNEL_2, RMT_CHANNEL_3};
+const rmt_channel_t dshotRxChannel[4] = {RMT_CHANNEL_4, RMT_CHANNEL_5, RMT_CHANNEL_6, RMT_CHANNEL_7};
+const gpio_num_t dshotPin[4]          = {(gpio_num_t)PIN_ESC_1, (gpio_num_t)PIN_ESC_2, (gpio_num_t)PIN_ESC_3, (gpio_num_t)PIN_ESC_4};
+rmt_item32_t dshotItems[4][DSHOT_FRAME_BITS + 1];                               // one frame per motor plus the end marker
+
+
+#if DSHOT_BIDIRECTIONAL == true
+
+/**
+ * @brief Starts listening the ESC answer as soon as a frame is sent.
+ *
+ * @param channel RMT TX channel that finished
+ * @param arg not used
+ */
+void IRAM_ATTR dshotTxEnd(rmt_channel_t channel, void *arg){
+  rmt_rx_start(dshotRxChannel[channel], true);
+}
+
+#endif
+
+
+/**
+ * @brief Setup the RMT channels for the four motors.
+ *
+ */
+void setupDShot(){
+
+  for(int i = 0; i < 4; i++){
+
+    rmt_config_t txConfig = {};
+    txConfig.rmt_mode = RMT_MODE_TX;
+    txConfig.channel = dshotTxChannel[i];
+    txConfig.gpio_num = dshotPin[i];
+    txConfig.mem_block_num = 1;
+    txConfig.clk_div = DSHOT_RMT_CLOCK_DIVIDER;
+    txConfig.tx_config.loop_en = false;
+    txConfig.tx_config.carrier_en = false;
+    txConfig.tx_config.idle_output_en = true;
+    txConfig.tx_config.idle_level = DSHOT_BIDIRECTIONAL ? RMT_IDLE_LEVEL_HIGH : RMT_IDLE_LEVEL_LOW;
+
+    rmt_config(&txConfig);
+    rmt_driver_install(dshotTxChannel[i], 0, 0);
+
+    #if DSHOT_BIDIRECTIONAL == true
+
+      rmt_config_t rxConfig = {};
+      rxConfig.rmt_mode = RMT_MODE_RX;
+      rxConfig.channel = dshotRxChannel[i];
+      rxConfig.gpio_num = dshotPin[i];
+      rxConfig.mem_block_num = 1;
+      rxConfig.clk_div = DSHOT_RMT_CLOCK_DIVIDER;
+      rxConfig.rx_config.filter_en = true;
+      rxConfig.rx_config.filter_ticks_thresh = 20;                              // ignore glitches shorter than 250ns
+      rxConfig.rx_config.idle_threshold = DSHOT_TELEMETRY_BIT_TICKS * 6;      // the answer never stays still for 6 bits
+
+      rmt_config(&rxConfig);
+      rmt_driver_install(dshotRxChannel[i], 256, 0);
+
+      rmt_set_pin(dshotTxChannel[i], RMT_MODE_TX, dshotPin[i]);                // both channels on the same pin
+      gpio_set_direction(dshotPin[i], GPIO_MODE_INPUT_OUTPUT_OD);             // the ESC can pull the line down
+      gpio_pullup_en(dshotPin[i]);
+
+      rmt_register_tx_end_callback(dshotTxEnd, NULL);
+
+    #endif
+
+    motorERPM[i] = 0;
+  }
+}
+
+
+/**
+ * @brief Decodes the answers of the ESCs to the previous frames.
+ *
+ */
+void readDShotTelemetry(){
+
+  #if DSHOT_BIDIRECTIONAL == true
+
+    for(int i = 0; i < 4; i++){
+
+      RingbufHandle_t ringBuffer = NULL;
+      rmt_get_ringbuf_handle(dshotRxChannel[i], &ringBuffer);
+      rmt_rx_stop(dshotRxChannel[i]);
+
+      size_t size = 0;
+      rmt_item32_t *items = (rmt_item32_t *)xRingbufferReceive(ringBuffer, &size, 0);
+
+      while(items){                                                            // only the last answer is used
+
+        uint32_t raw = 0;
+        int bits = 0;
+
+        for(size_t j = 0; j < size / sizeof(rmt_item32_t); j++){
+          dshotAppendRun(raw, bits, items[j].level0, items[j].duration0, DSHOT_TELEMETRY_BIT_TICKS);
+          dshotAppendRun(raw, bits, items[j].level1, items[j].duration1, DSHOT_TELEMETRY_BIT_TICKS);
+        }
+
+        uint32_t eRPM = dshotTelemetryToERPM(dshotDecodeGCR(dshotPadTelemetry(raw, bits)));
+
+        if(eRPM != DSHOT_INVALID_TELEMETRY) motorERPM[i] = eRPM;
+        else dshotTelemetryErrors++;
+
+        vRingbufferReturnItem(ringBuffer, (void *)items);
+        items = (rmt_item32_t *)xRingbufferReceive(ringBuffer, &size, 0);
+      }
+    }
+
+  #endif
+}
+
+
+/**
+ * @brief Sends the ESC pulses to the four motors as DShot frames.
+ *
+ */
+void writeDShot(){
+
+  readDShotTelemetry();                                                         // the answers to the previous frames
+
+  uint16_t frame[4] = {
+    dshotFrame(pulseToDShot(esc1), false, DSHOT_BIDIRECTIONAL),
+    dshotFrame(pulseToDShot(esc2), false, DSHOT_BIDIRECTIONAL),
+    dshotFrame(pulseToDShot(esc3), false, DSHOT_BIDIRECTIONAL),
+    dshotFrame(pulseToDShot(esc4), false, DSHOT_BIDIRECTIONAL)
+  };
+
+  for(int i = 0; i < 4; i++){
+    for(int bit = 0; bit < DSHOT_FRAME_BITS; bit++){
+      uint32_t highTicks = (frame[i] & (0x8000 >> bit)) ? DSHOT_T1H_TICKS : DSHOT_T0H_TICKS;
+      dshotItems[i][bit].level0 = DSHOT_BIDIRECTIONAL ? 0 : 1;                  // bidirectional DShot is inverted
+      dshotItems[i][bit].duration0 = highTicks;
+      dshotItems[i][bit].level1 = DSHOT_BIDIRECTIONAL ? 1 : 0;
+      dshotItems[i][bit].duration1 = DSHOT_BIT_TICKS - highTicks;
+    }
+    dshotItems[i][DSHOT_FRAME_BITS].val = 0;                                   // end marker
+
+    rmt_fill_tx_items(dshotTxChannel[i], dshotItems[i], DSHOT_FRAME_BITS + 1, 0);
+  }
+
+  for(int i = 0; i < 4; i++) rmt_tx_start(dshotTxChannel[i], true);            // the four frames start together
+
+  #if DEBUG && defined(DEBUG_DSHOT)
+    printDShotTelemetry();
+  #endif
+}
+
+
+/**
+ * @brief Prints the motors eRPM.
+ *
+ */
+void printDShotTelemetry(){
+  Serial.printf("eRPM 1: %u, 2: %u, 3: %u, 4: %u, errors: %u\n", motorERPM[0], motorERPM[1], motorERPM[2], motorERPM[3], dshotTelemetryErrors);
+}
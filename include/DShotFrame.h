@@ -0,0 +1,142 @@
+/**
+ * @file DShotFrame.h
+ * @author @sebastiano123-c
+ * @brief DShot frame encoding and bidirectional telemetry decoding.
+ *
+ * A DShot frame is 16 bits long, sent MSB first:
+ *
+ *          vvvvvvvvvvv t cccc
+ *
+ *  @li v: 11 bits value, 0 = motor stop, 1-47 = ESC commands, 48-2047 = throttle;
+ *  @li t: telemetry request;
+ *  @li c: 4 bits CRC, the XOR of the three nibbles of (v << 1 | t). With bidirectional DShot it is inverted.
+ *
+ * With bidirectional DShot the line is inverted (idle high) and, after every frame, the ESC answers on the same
+ * wire with 21 bits at 5/4 of the DShot bit rate. Those bits are GCR encoded: once decoded they give 16 bits
+ *
+ *          eee mmmmmmmmm cccc
+ *
+ * i.e. the electrical period in us (m << e) and a 4 bits CRC.
+ *
+ * These routines do not depend on the board, so they can be used in the host programs of the /test dir.
+ *
+ * @version 0.1
+ * @date 2022-06-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdint.h>
+
+#ifndef DSHOT_FRAME_H
+#define DSHOT_FRAME_H
+
+#define DSHOT_MIN_THROTTLE          48                        // lower values are ESC commands
+#define DSHOT_MAX_THROTTLE          2047
+#define DSHOT_FRAME_BITS            16
+#define DSHOT_TELEMETRY_BITS        21
+#define DSHOT_INVALID_TELEMETRY     0xFFFFFFFF
+
+/**
+ * @brief Converts an ESC pulse in the standard 1000-2000us into a DShot value.
+ *
+ * @param pulse (us) ESC pulse
+ * @return uint16_t DShot value, 0 (motor stop) for pulses not above 1000us
+ */
+inline uint16_t pulseToDShot(int16_t pulse){
+  if(pulse <= 1000) return 0;
+  if(pulse >= 2000) return DSHOT_MAX_THROTTLE;
+  return DSHOT_MIN_THROTTLE + (uint16_t)(((uint32_t)(pulse - 1000) * (DSHOT_MAX_THROTTLE - DSHOT_MIN_THROTTLE)) / 1000);
+}
+
+/**
+ * @brief Builds the 16 bits DShot frame.
+ *
+ * @param value 0-2047 DShot value
+ * @param telemetry true to request the telemetry
+ * @param inverted true for bidirectional DShot
+ * @return uint16_t frame
+ */
+inline uint16_t dshotFrame(uint16_t value, bool telemetry, bool inverted){
+  uint16_t data = (uint16_t)((value & 0x07FF) << 1) | (telemetry ? 1 : 0);
+  uint16_t crc = (data ^ (data >> 4) ^ (data >> 8)) & 0x0F;
+  if(inverted) crc = (~crc) & 0x0F;
+  return (uint16_t)(data << 4) | crc;
+}
+
+/**
+ * @brief Appends a run of equal line levels to the raw telemetry bits.
+ *
+ * @param raw raw telemetry bits received so far
+ * @param bits number of raw bits received so far
+ * @param level line level of the run
+ * @param duration duration of the run in the same units of bitTime
+ * @param bitTime duration of a telemetry bit
+ */
+inline void dshotAppendRun(uint32_t &raw, int &bits, int level, uint32_t duration, uint32_t bitTime){
+  int length = (int)((duration + bitTime / 2) / bitTime);               // number of bits of the run
+  for(int i = 0; i < length && bits < DSHOT_TELEMETRY_BITS; i++, bits++)
+    raw = (raw << 1) | (level ? 1 : 0);
+}
+
+/**
+ * @brief Pads the raw telemetry with the idle level after the last edge.
+ *
+ * @param raw raw telemetry bits
+ * @param bits number of raw bits received
+ * @return uint32_t the 21 raw bits
+ */
+inline uint32_t dshotPadTelemetry(uint32_t raw, int bits){
+  while(bits < DSHOT_TELEMETRY_BITS){
+    raw = (raw << 1) | 1;                                                 // the line idles high
+    bits++;
+  }
+  return raw;
+}
+
+/**
+ * @brief Decodes the 21 raw telemetry bits into the 16 bits telemetry value.
+ *
+ * @param raw the 21 raw line bits, MSB first
+ * @return uint32_t 16 bits value, DSHOT_INVALID_TELEMETRY if it is corrupted
+ */
+inline uint32_t dshotDecodeGCR(uint32_t raw){
+  static const int8_t gcrToNibble[32] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1,  9, 10, 11, -1, 13, 14, 15,
+    -1, -1,  2,  3, -1,  5,  6,  7, -1,  0,  8,  1, -1,  4, 12, -1
+  };
+
+  uint32_t gcr = (raw ^ (raw >> 1)) & 0xFFFFF;                           // transitions encode the 20 GCR bits
+  uint32_t value = 0;
+
+  for(int i = 0; i < 4; i++){
+    int8_t nibble = gcrToNibble[(gcr >> (15 - 5 * i)) & 0x1F];
+    if(nibble < 0) return DSHOT_INVALID_TELEMETRY;
+    value = (value << 4) | (uint32_t)nibble;
+  }
+
+  uint32_t crc = (value ^ (value >> 4) ^ (value >> 8) ^ (value >> 12)) & 0x0F;
+  if(crc != 0x0F) return DSHOT_INVALID_TELEMETRY;
+
+  return value;
+}
+
+/**
+ * @brief Converts the telemetry value into the electrical RPM.
+ *
+ * @param value 16 bits telemetry value (see dshotDecodeGCR())
+ * @return uint32_t eRPM, 0 if the motor is still, DSHOT_INVALID_TELEMETRY if value is invalid
+ */
+inline uint32_t dshotTelemetryToERPM(uint32_t value){
+  if(value == DSHOT_INVALID_TELEMETRY) return DSHOT_INVALID_TELEMETRY;
+
+  value >>= 4;                                                           // remove the CRC
+  if(value == 0x0FFF) return 0;                                          // motor still
+
+  uint32_t period = (value & 0x01FF) << (value >> 9);                    // (us) electrical period
+  if(period == 0) return DSHOT_INVALID_TELEMETRY;
+
+  return 60000000UL / period;
+}
+
+#endif /* DSHOT_FRAME_H */
@@ -0,0 +1,329 @@
+/**
+ * @file Diagnostics.h
+ * @author @sebastiano123-c
+ * @brief Heap and stack usage of the flight controller.
+ *
+ * With DIAGNOSTICS true the global operator new and delete are replaced by counting ones: every block carries a
+ * small header with its size and the subsystem that took it, so the report tells, for each subsystem, the blocks
+ * taken and given back and the bytes still held. The subsystems are:
+ *  @li the stages of loop() (see FlightTrace.h), followed through the traceLoopStart() and traceStage() hooks;
+ *  @li "loop", what loop() does after the last stage (the busy wait);
+ *  @li "setup", everything before the first loop, including the global constructors;
+ *  @li "tasks", the other FreeRTOS tasks (battery task, WiFi and web server on core 0).
+ * The blocks taken by loop() between traceLoopStart() and the end of the autotune stage are taken inside the
+ * control tick: the report prints their number and the last stage that took one, and with DIAGNOSTICS_STRICT the
+ * sketch stops at the end of that stage.
+ *
+ * Every DIAGNOSTICS_PERIOD the report prints on the serial the free heap (its minimum and its largest block, which
+ * tells the fragmentation), the stack never used by the tasks registered with diagnosticsWatchTask() and a line per
+ * subsystem. The lines are printed one every DIAGNOSTICS_LINE_LOOPS loops, so that the UART FIFO never blocks the
+ * loop.
+ * String and the C code take their blocks with malloc(), calloc() and realloc(), not with operator new: the linker
+ * wraps them (-Wl,--wrap in platformio.ini), so they are counted as well, in the "malloc" column of the subsystem
+ * and inside the control tick. They carry no header, so free() is not wrapped and their bytes are not in "held".
+ *
+ * The host simulator compiles this file with -DSIMULATOR_DIAGNOSTICS (see Config.sim.h): the counters are the
+ * same, the heap is not simulated, and malloc() is replaced by the one of the HAL (see esp_heap_caps.h). Link it
+ * with -Wl,-z,now, or the first call of a task to the math library takes about 3KB of its stack on the computer
+ * (to resolve the symbol).
+ *
+ * @version 0.1
+ * @date 2022-06-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+// the C heap, as the linker wraps it (-Wl,--wrap=malloc,--wrap=calloc,--wrap=realloc in platformio.ini)
+extern "C" {
+  void *__real_malloc(size_t size);
+  void *__real_calloc(size_t count, size_t size);
+  void *__real_realloc(void *p, size_t size);
+  void *__wrap_malloc(size_t size);
+  void *__wrap_calloc(size_t count, size_t size);
+  void *__wrap_realloc(void *p, size_t size);
+}
+
+#if DIAGNOSTICS == true && UPLOADED_SKETCH == FLIGHT_CONTROLLER
+
+  #if FLIGHT_RECORDER == true
+    #error "DIAGNOSTICS: the serial is used by the FLIGHT_RECORDER, set one of them false"
+  #endif
+
+  #include <new>
+  #include <cstddef>
+  #include <esp_heap_caps.h>
+
+  #define DIAGNOSTICS_LOOP            TRACE_STAGES            // after the last stage
+  #define DIAGNOSTICS_SETUP           (TRACE_STAGES + 1)
+  #define DIAGNOSTICS_TASKS           (TRACE_STAGES + 2)
+  #define DIAGNOSTICS_SUBSYSTEMS      (TRACE_STAGES + 3)
+  #define DIAGNOSTICS_MAX_TASKS       6
+  #define DIAGNOSTICS_LINE_LOOPS      4                       // (loops) between two lines of the report
+
+  /**
+   * @brief Header of the blocks, aligned as malloc() aligns them.
+   */
+  struct alignas(std::max_align_t) diagnosticsBlock {
+    size_t size;
+    uint8_t subsystem;
+  };
+
+  struct diagnosticsCounters {
+    uint32_t taken;                                           // blocks
+    uint32_t given;                                           // blocks
+    uint32_t bytes;                                           // taken since the start
+    int32_t held;                                             // (bytes) taken and not given back
+    uint32_t mallocs;                                         // blocks of malloc(), calloc() and realloc()
+  };
+
+  diagnosticsCounters diagnosticsSubsystem[DIAGNOSTICS_SUBSYSTEMS];
+  portMUX_TYPE diagnosticsMux = portMUX_INITIALIZER_UNLOCKED;
+
+  volatile uint8_t diagnosticsCurrent = DIAGNOSTICS_SETUP;  // subsystem running in loop()
+  bool diagnosticsStarted = false;
+  TaskHandle_t diagnosticsLoopTask;
+
+  uint32_t diagnosticsTickAllocations = 0;                    // taken inside the control tick in this period
+  uint8_t diagnosticsTickStage = DIAGNOSTICS_LOOP;            // last stage that took one
+  bool diagnosticsTickFault = false;                          // a block was taken in the running stage
+
+  TaskHandle_t diagnosticsTaskHandle[DIAGNOSTICS_MAX_TASKS];
+  const char *diagnosticsTaskName[DIAGNOSTICS_MAX_TASKS];
+  int diagnosticsTasks = 0;
+
+  unsigned long diagnosticsLastReport = 0;
+  int diagnosticsLine = -1;                                   // line of the report to print, -1 when none
+  int diagnosticsLoops = 0;
+
+  const char *const diagnosticsNames[DIAGNOSTICS_SUBSYSTEMS] = {"gps", "gyroscope", "receiver", "proximity",
+                                                                "altitude", "pid", "battery", "esc", "telemetry",
+                                                                "autotune", "loop", "setup", "tasks"};
+
+
+  /**
+   * @brief The subsystem running in the calling task.
+   */
+  uint8_t diagnosticsRunning(){
+    if(!diagnosticsStarted) return DIAGNOSTICS_SETUP;
+    return xTaskGetCurrentTaskHandle() == diagnosticsLoopTask ? diagnosticsCurrent : DIAGNOSTICS_TASKS;
+  }
+
+  /**
+   * @brief Takes a block from the heap and counts it.
+   *
+   * @param size bytes asked
+   * @return void* the block, NULL if the heap is full
+   */
+  void *diagnosticsAllocate(size_t size){
+
+    diagnosticsBlock *block = (diagnosticsBlock *)__real_malloc(sizeof(diagnosticsBlock) + size);
+    if(block == NULL) return NULL;
+
+    uint8_t subsystem = diagnosticsRunning();
+
+    block->size = size;
+    block->subsystem = subsystem;
+
+    portENTER_CRITICAL(&diagnosticsMux);
+    diagnosticsSubsystem[subsystem].taken++;
+    diagnosticsSubsystem[subsystem].bytes += size;
+    diagnosticsSubsystem[subsystem].held += size;
+    if(subsystem < TRACE_STAGES){
+      diagnosticsTickAllocations++;
+      diagnosticsTickStage = subsystem;
+      diagnosticsTickFault = true;
+    }
+    portEXIT_CRITICAL(&diagnosticsMux);
+
+    return block + 1;
+  }
+
+  /**
+   * @brief Gives back a block taken by diagnosticsAllocate().
+   *
+   * @param p
+   */
+  void diagnosticsFree(void *p){
+
+    if(p == NULL) return;
+    diagnosticsBlock *block = (diagnosticsBlock *)p - 1;
+
+    portENTER_CRITICAL(&diagnosticsMux);
+    diagnosticsSubsystem[block->subsystem].given++;
+    diagnosticsSubsystem[block->subsystem].held -= block->size;
+    portEXIT_CRITICAL(&diagnosticsMux);
+
+    free(block);
+  }
+
+  /**
+   * @brief Counts a block of the C heap.
+   */
+  void diagnosticsMalloc(){
+
+    uint8_t subsystem = diagnosticsRunning();
+
+    portENTER_CRITICAL(&diagnosticsMux);
+    diagnosticsSubsystem[subsystem].mallocs++;
+    if(subsystem < TRACE_STAGES){
+      diagnosticsTickAllocations++;
+      diagnosticsTickStage = subsystem;
+      diagnosticsTickFault = true;
+    }
+    portEXIT_CRITICAL(&diagnosticsMux);
+  }
+
+  extern "C" void *__wrap_malloc(size_t size){ diagnosticsMalloc(); return __real_malloc(size); }
+  extern "C" void *__wrap_calloc(size_t count, size_t size){ diagnosticsMalloc(); return __real_calloc(count, size); }
+  extern "C" void *__wrap_realloc(void *p, size_t size){ diagnosticsMalloc(); return __real_realloc(p, size); }
+
+  void *operator new(size_t size){
+    void *p = diagnosticsAllocate(size);
+    if(p == NULL) throw std::bad_alloc();
+    return p;
+  }
+  void *operator new[](size_t size){ return operator new(size); }
+  void *operator new(size_t size, const std::nothrow_t &) noexcept { return diagnosticsAllocate(size); }
+  void *operator new[](size_t size, const std::nothrow_t &) noexcept { return diagnosticsAllocate(size); }
+  void operator delete(void *p) noexcept { diagnosticsFree(p); }
+  void operator delete[](void *p) noexcept { diagnosticsFree(p); }
+  void operator delete(void *p, const std::nothrow_t &) noexcept { diagnosticsFree(p); }
+  void operator delete[](void *p, const std::nothrow_t &) noexcept { diagnosticsFree(p); }
+
+
+  /**
+   * @brief Adds a task to the stack report.
+   *
+   * @param handle
+   * @param name
+   */
+  void diagnosticsWatchTask(TaskHandle_t handle, const char *name){
+    if(handle == NULL || diagnosticsTasks == DIAGNOSTICS_MAX_TASKS) return;
+    diagnosticsTaskHandle[diagnosticsTasks] = handle;
+    diagnosticsTaskName[diagnosticsTasks] = name;
+    diagnosticsTasks++;
+  }
+
+  /**
+   * @brief Prints a line of the report.
+   *
+   * @param line 0 heap, 1 control tick, 2 stacks, then the subsystems
+   * @return true if there are more lines
+   */
+  bool printDiagnosticsLine(int line){
+
+    char text[96];                                            // Serial.printf() would take a block for long lines
+    int length = 0;
+
+    if(line == 0){
+      size_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+      size_t largest = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+      length = snprintf(text, sizeof(text), "diag heap free %u min %u block %u (%u%% fragmented)\n",
+                        (unsigned)freeHeap, (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT),
+                        (unsigned)largest, freeHeap > 0 ? (unsigned)(100 - largest * 100 / freeHeap) : 0);
+    }
+    else if(line == 1){
+      portENTER_CRITICAL(&diagnosticsMux);
+      uint32_t allocations = diagnosticsTickAllocations;
+      uint8_t stage = diagnosticsTickStage;
+      diagnosticsTickAllocations = 0;
+      portEXIT_CRITICAL(&diagnosticsMux);
+
+      if(allocations > 0)
+        length = snprintf(text, sizeof(text), "diag ERROR %u allocations inside the control tick, last in %s\n",
+                          (unsigned)allocations, diagnosticsNames[stage]);
+      else length = snprintf(text, sizeof(text), "diag control tick: no allocations\n");
+    }
+    else if(line == 2){
+      length = snprintf(text, sizeof(text), "diag stack free");
+      for(int t = 0; t < diagnosticsTasks && length < (int)sizeof(text) - 24; t++)
+        length += snprintf(text + length, sizeof(text) - length, " %s %u",
+                           diagnosticsTaskName[t], (unsigned)uxTaskGetStackHighWaterMark(diagnosticsTaskHandle[t]));
+      length += snprintf(text + length, sizeof(text) - length, "\n");
+    }
+    else{
+      diagnosticsCounters c;
+      portENTER_CRITICAL(&diagnosticsMux);
+      c = diagnosticsSubsystem[line - 3];
+      portEXIT_CRITICAL(&diagnosticsMux);
+
+      if(c.taken > 0 || c.given > 0 || c.mallocs > 0)
+        length = snprintf(text, sizeof(text), "diag %-9s new %7u delete %7u bytes %9u held %7d malloc %6u\n",
+                          diagnosticsNames[line - 3], (unsigned)c.taken, (unsigned)c.given, (unsigned)c.bytes,
+                          (int)c.held, (unsigned)c.mallocs);
+    }
+
+    if(length > 0) Serial.print(text);
+    return line + 1 < 3 + DIAGNOSTICS_SUBSYSTEMS;
+  }
+
+  /**
+   * @brief Opens the serial and starts counting. Call it at the beginning of setup().
+   */
+  void startDiagnostics(){
+
+    if(!DEBUG) Serial.begin(BAUD_RATE);
+
+    diagnosticsLoopTask = xTaskGetCurrentTaskHandle();
+    diagnosticsWatchTask(diagnosticsLoopTask, "loop");
+    diagnosticsLastReport = millis();
+    diagnosticsStarted = true;
+  }
+
+  /**
+   * @brief The control tick begins: the next blocks are taken by the first stage.
+   */
+  void diagnosticsLoopStart(){
+    diagnosticsCurrent = 0;
+  }
+
+  /**
+   * @brief A stage of loop() is over: checks its allocations and prints the report after the last one.
+   *
+   * @param stage see FlightTrace.h
+   */
+  void diagnosticsStage(uint8_t stage){
+
+    #if DIAGNOSTICS_STRICT == true
+      if(diagnosticsTickFault){
+        Serial.print("DIAGNOSTICS: allocation inside the control tick, in ");
+        Serial.println(diagnosticsNames[stage]);
+        Serial.flush();
+        abort();
+      }
+    #endif
+    diagnosticsTickFault = false;
+
+    diagnosticsCurrent = stage + 1;
+    if(diagnosticsCurrent != DIAGNOSTICS_LOOP) return;
+
+    // the control tick is over: one line of the report, if any
+    if(diagnosticsLine < 0 && millis() - diagnosticsLastReport >= DIAGNOSTICS_PERIOD){
+      diagnosticsLastReport = millis();
+      diagnosticsLine = 0;
+      diagnosticsLoops = 0;
+    }
+    if(diagnosticsLine < 0 || diagnosticsLoops++ % DIAGNOSTICS_LINE_LOOPS != 0) return;
+
+    if(printDiagnosticsLine(diagnosticsLine)) diagnosticsLine++;
+    else diagnosticsLine = -1;
+  }
+
+#else
+
+  void startDiagnostics(){}
+
+  void diagnosticsWatchTask(TaskHandle_t handle, const char *name){ (void)handle; (void)name; }
+
+  void diagnosticsLoopStart(){}
+
+  void diagnosticsStage(uint8_t stage){ (void)stage; }
+
+  #ifndef SIMULATOR
+    extern "C" void *__wrap_malloc(size_t size){ return __real_malloc(size); }
+    extern "C" void *__wrap_calloc(size_t count, size_t size){ return __real_calloc(count, size); }
+    extern "C" void *__wrap_realloc(void *p, size_t size){ return __real_realloc(p, size); }
+  #endif
+
+#endif
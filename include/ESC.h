@@ -22,6 +22,7 @@ void droneStart(){
 
       anglePitch = anglePitchAcc;                                          //Set the gyro pitch angle equal to the accelerometer pitch angle when the quadcopter is started.
       angleRoll = angleRollAcc;                                            //Set the gyro roll angle equal to the accelerometer roll angle when the quadcopter is started.
+      angleYaw = compassCalibrated ? actualCompassHeading : 0;             //The heading of the compass, without it the nose is the north (see Compass.h).
       gyroAnglesSet = true;                                                //Set the IMU started flag.
 
       //Reset the PID controllers for a bumpless start.
@@ -50,33 +51,28 @@ void setEscPulses(){
     case 2:
       
       // set throttle for altitude hold
-      if (flightMode >= 2) {                                             //If altitude mode is active.
-        throttle = 1500 + pidOutputAltitude;                             // add the altitude hold
-      }
-      if (flightMode >= 3 && waypointGPS == 1) {
-        pidOutputRoll = 1500 + GPSRollAdjust;
-        pidOutputPitch = 1500 + GPSPitchAdjust;
+      if (flightMode >= 2 && failsafeState == FAILSAFE_NONE) {           //If altitude mode is active (the failsafe gives its own throttle, see Failsafe.h).
+        throttle = 1500 + pidOutputAltitude + manualThrottle;            // add the altitude hold, and the stick out of the center
       }
 
       if (throttle > 1800) throttle = 1800;                              //We need some room to keep full control at full throttle.
 
-      esc1 = throttle - pidOutputPitch + pidOutputRoll - pidOutputYaw;   //Calculate the pulse for esc 1 (front-right - CCW)
-      esc2 = throttle + pidOutputPitch + pidOutputRoll + pidOutputYaw;   //Calculate the pulse for esc 2 (rear-right - CW)
-      esc3 = throttle + pidOutputPitch - pidOutputRoll - pidOutputYaw;   //Calculate the pulse for esc 3 (rear-left - CCW)
-      esc4 = throttle - pidOutputPitch - pidOutputRoll + pidOutputYaw;   //Calculate the pulse for esc 4 (front-left - CW)
+      mixMotors(MIXER_TABLE, MIXER_MOTORS, throttle,                     // see Mixer.h
+                pidOutputRoll, pidOutputPitch, pidOutputYaw, 1100, 2000, MIXER_AIRMODE, mixerOutput);
 
-      #if BATTERY_COMPENSATION 
-        if (batteryVoltage > DANGER_BATTERY_VOLTAGE &&
-            batteryVoltage < MAX_BATTERY_VOLTAGE){                       // is the battery connected?
+      esc1 = mixerOutput[0];                                             //Pulse for esc 1 (front-right - CCW, front with QUAD_PLUS)
+      esc2 = mixerOutput[1];                                             //Pulse for esc 2 (rear-right - CW, right with QUAD_PLUS)
+      esc3 = mixerOutput[2];                                             //Pulse for esc 3 (rear-left - CCW, rear with QUAD_PLUS)
+      esc4 = mixerOutput[3];                                             //Pulse for esc 4 (front-left - CW, left with QUAD_PLUS)
 
-            escCorr = (int16_t)                                          // correction factor
-            ((MAX_BATTERY_VOLTAGE - batteryVoltage) / batteryCurvePendency);
+      #if BATTERY_COMPENSATION 
+        thrustScale = voltageScale(batteryVoltage,                       // 1 if the battery is not connected
+                                   BATTERY_REFERENCE_VOLTAGE, DANGER_BATTERY_VOLTAGE);
 
-            esc1 += escCorr;                                             // Compensate the esc-1 pulse for voltage drop.
-            esc2 += escCorr;                                             // Compensate the esc-2 pulse for voltage drop.
-            esc3 += escCorr;                                             // Compensate the esc-3 pulse for voltage drop.
-            esc4 += escCorr;                                             // Compensate the esc-4 pulse for voltage drop.
-        }
+        esc1 = compensatePulse(esc1, thrustScale, thrustCurveExpo);      // Compensate the esc-1 pulse for voltage drop.
+        esc2 = compensatePulse(esc2, thrustScale, thrustCurveExpo);      // Compensate the esc-2 pulse for voltage drop.
+        esc3 = compensatePulse(esc3, thrustScale, thrustCurveExpo);      // Compensate the esc-3 pulse for voltage drop.
+        esc4 = compensatePulse(esc4, thrustScale, thrustCurveExpo);      // Compensate the esc-4 pulse for voltage drop.
       #endif
 
       if (esc1 < 1100) esc1 = 1100;                                      // Keep the motors running.
@@ -112,15 +108,23 @@ void setEscPulses(){
     ledcWrite(pwmChannel3, (uint32_t)((float)esc3/2000.*(float)MAX_DUTY_CYCLE));
     ledcWrite(pwmChannel4, (uint32_t)((float)esc4/2000.*(float)MAX_DUTY_CYCLE));
 
+  #elif defined(MOTOR_PULSE_BY_DSHOT)
+
+    writeDShot();
+
+  #elif defined(MOTOR_PULSE_BY_ONESHOT)
+
+    writeOneShot();
+
   #endif
 
   #if DEBUG && defined(DEBUG_ESC)
-    Serial.printf("%u   %u   %u   %u   %i\n", 
+    Serial.printf("%u   %u   %u   %u   %.3f\n", 
       (uint32_t)((float)esc1/2000.*(float)MAX_DUTY_CYCLE), 
       (uint32_t)((float)esc2/2000.*(float)MAX_DUTY_CYCLE), 
       (uint32_t)((float)esc3/2000.*(float)MAX_DUTY_CYCLE), 
       (uint32_t)((float)esc4/2000.*(float)MAX_DUTY_CYCLE),
-      escCorr);
+      thrustScale);
     
     // Serial.printf("%i   %i   %i   %i \n", 
     //   esc1, 
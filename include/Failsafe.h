@@ -0,0 +1,292 @@
+/**
+ * @file Failsafe.h
+ * @author @sebastiano123-c
+ * @brief Failsafe supervisor: what the drone does by itself when it loses the receiver, the GPS or the battery.
+ *
+ * At every loop updateFailsafe() reads four conditions, each one with the millis() at which it started and at which
+ * it became active (see failsafeCondition):
+ *  @li receiver: the oldest good pulse of the five channels (see myISR()) is older than FAILSAFE_RC_TIMEOUT. It
+ *      ends after FAILSAFE_RECOVERY_TIME of good pulses;
+ *  @li GPS: no fix for FAILSAFE_GPS_TIMEOUT, or less than FAILSAFE_GPS_SATELLITES;
+ *  @li low battery, empty battery: the resting voltage (see Battery.h) is below FAILSAFE_LOW_CELL_VOLTAGE,
+ *      FAILSAFE_CRITICAL_CELL_VOLTAGE for FAILSAFE_BATTERY_TIME. They end only when the motors stop.
+ *
+ * The states are nested, and each condition asks for one of them:
+ *
+ *          NONE  <  HOLD  <  RTH (climb, return)  <  LAND
+ *
+ *  @li the receiver asks for HOLD, and for RTH after FAILSAFE_HOLD_TIME;
+ *  @li the low battery asks for RTH, the empty battery for LAND;
+ *  @li without the GPS (or without the home) HOLD and RTH become LAND.
+ * While a condition is on, the state only goes up: the RTH climbs to its altitude, flies home (flight mode 5, see
+ * Mission.h) and lands, and nothing brings it back to HOLD. When all the conditions are off, the state is NONE and
+ * the pilot has the drone again. The low battery is given back also when the pilot moves the SWC, with the receiver
+ * working.
+ * Without the GPS and without a failsafe, the GPS hold and the missions become altitude hold (error 4).
+ *
+ * During a failsafe applyFailsafeSticks() puts the roll, pitch and yaw sticks in the center and the throttle stick
+ * is given by a climb rate controller on the estimated altitude and vertical speed (see Altitude.h): the hover
+ * throttle is learnt while the pilot flies, and a PI on the climb rate holds the altitude (HOLD, RTH) or descends at
+ * FAILSAFE_LAND_SPEED (LAND). When the drone does not descend anymore with the throttle well below the hover, it has
+ * landed: after FAILSAFE_LANDED_TIME the motors stop. Without the altitude sensor the drone descends with the
+ * hover throttle less FAILSAFE_BLIND_DESCENT, and the motors stop after FAILSAFE_BLIND_LAND_TIME.
+ *
+ * The ages of the receiver pulses are the only inputs not read by the sensors: the flight recorder saves them (see
+ * FlightRecorder.h), so that a replay takes the same decisions.
+ *
+ * @version 0.1
+ * @date 2022-06-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#define FAILSAFE_CLIMB_P            60.0f                     // (us per m/s) of the climb rate controller
+#define FAILSAFE_CLIMB_I            40.0f                     // (us per m)
+#define FAILSAFE_CLIMB_MAX_I        200.0f                    // (us)
+#define FAILSAFE_ALTITUDE_P         0.8f                      // (m/s per m) climb rate asked to hold the altitude
+#define FAILSAFE_MAX_CLIMB          1.5f                      // (m/s)
+#define FAILSAFE_LANDED_PULSE       60.0f                     // (us) below the hover throttle, not descending: landed
+#define FAILSAFE_BLIND_DESCENT      40                        // (us) below the hover throttle, without altitude sensor
+#define FAILSAFE_BLIND_LAND_TIME    30000                     // (ms) then the motors stop, without altitude sensor
+#define FAILSAFE_LOOP_TIME          0.004f                    // (s)
+
+
+/**
+ * @brief Reads a condition: it becomes active after it has been bad for onDelay, and ends after it has been good
+ * for offDelay.
+ *
+ * @param condition
+ * @param bad as read now
+ * @param now (ms) millis()
+ * @param onDelay (ms)
+ * @param offDelay (ms) UINT32_MAX to never end
+ */
+void updateFailsafeCondition(failsafeCondition &condition, bool bad, uint32_t now, uint32_t onDelay, uint32_t offDelay){
+
+  if(bad != condition.bad){
+    condition.bad = bad;
+    condition.since = now;
+  }
+
+  if(!condition.active && bad && now - condition.since >= onDelay){
+    condition.active = true;
+    condition.time = now;
+  }
+  else if(condition.active && !bad && offDelay != UINT32_MAX && now - condition.since >= offDelay){
+    condition.active = false;
+    condition.time = now;
+  }
+}
+
+/**
+ * @brief (ms) since the oldest of the last good pulses of the receiver channels.
+ *
+ * @return uint16_t at most 65535
+ */
+uint16_t receiverPulseAge(){
+
+  uint32_t now = (uint32_t)micros();
+  int32_t oldest = 0;
+
+  for(int ch = 0; ch < 5; ch++){
+    int32_t age = (int32_t)(now - receiverPulseTime[ch]);     // negative if a pulse came after now
+    if(age > oldest) oldest = age;
+  }
+
+  oldest /= 1000;
+  return oldest > 65535 ? 65535 : (uint16_t)oldest;
+}
+
+/**
+ * @brief (m) from the position of the drone to the home.
+ */
+float failsafeHomeDistance(){
+  float position[2];
+  int32_t home[2] = {failsafeHome.latitude, failsafeHome.longitude};
+  missionLocalPosition(latNorth ? latActualGPS : -latActualGPS, lonEast ? lonActualGPS : -lonActualGPS, home,
+                       cosf((float)home[0] * 1e-6f * (float)M_PI / 180.0f), position);
+  return sqrtf(position[0] * position[0] + position[1] * position[1]);
+}
+
+/**
+ * @brief Changes the state of the failsafe.
+ *
+ * @param state
+ * @param now (ms) millis()
+ */
+void enterFailsafe(failsafeLevel state, uint32_t now){
+
+  if(state == FAILSAFE_RTH_CLIMB){
+    if(failsafeHomeDistance() < FAILSAFE_RTH_MIN_DISTANCE) state = FAILSAFE_LAND;             // already at home
+    else failsafeTargetAltitude = fmaxf(estimatedAltitude, failsafeHomeAltitude + FAILSAFE_RTH_ALTITUDE);
+  }
+  if(state == FAILSAFE_HOLD) failsafeTargetAltitude = estimatedAltitude;
+  if(state == FAILSAFE_LAND) failsafeLandedTime = 0;
+
+  if(failsafeState == FAILSAFE_NONE) failsafeClimbI = 0.0f;                                    // bumpless start
+  failsafeState = state;
+  failsafeStateTime = now;
+
+  #if DEBUG
+    Serial.printf("failsafe: state %i (receiver %i, GPS %i, battery %i %i)\n", state, failsafeReceiver.active,
+                  failsafeGPS.active, failsafeLowBattery.active, failsafeEmptyBattery.active);
+  #endif
+}
+
+/**
+ * @brief Reads the conditions and moves the state of the failsafe. Call it in loop() after the flight mode of the
+ * SWC is set and before readGPS(): during a failsafe it sets the flight mode.
+ */
+void updateFailsafe(){
+
+  uint32_t now = millis();
+  uint8_t pilotMode = flightMode;                                                               // as asked by the SWC
+
+  uint16_t age = receiverPulseAge();
+  traceInput(TRACE_RECEIVER_AGE, &age, sizeof(age));                                           // see FlightRecorder.h
+  updateFailsafeCondition(failsafeReceiver, age > FAILSAFE_RC_TIMEOUT, now, 0, FAILSAFE_RECOVERY_TIME);
+
+  #if GPS != OFF
+    bool noGPS = now - timerGPSFix > FAILSAFE_GPS_TIMEOUT || GPSSatNumber < FAILSAFE_GPS_SATELLITES;
+  #else
+    bool noGPS = true;
+  #endif
+  updateFailsafeCondition(failsafeGPS, noGPS, now, 0, FAILSAFE_RECOVERY_TIME);
+
+  // the motors are off: nothing to do, the home is taken at the next start
+  if(start != 2){
+    failsafeLowBattery.active = failsafeEmptyBattery.active = false;
+    failsafeLowBattery.bad = failsafeEmptyBattery.bad = false;
+    failsafeBatteryCancelled = false;
+    failsafeArmed = false;
+    failsafeState = FAILSAFE_NONE;
+    failsafePilotMode = pilotMode;
+    return;
+  }
+
+  if(!failsafeArmed){
+    failsafeArmed = true;
+    failsafeHomeSet = !failsafeGPS.active;
+    failsafeHome.latitude = latNorth ? latActualGPS : -latActualGPS;
+    failsafeHome.longitude = lonEast ? lonActualGPS : -lonActualGPS;
+    failsafeHome.radius = 0.0f;                                                                // the default ones
+    failsafeHome.speed = 0.0f;
+    failsafeHomeAltitude = estimatedAltitude;
+  }
+
+  // the battery, with the resting voltage (below 2V per cell it is not connected, e.g. on the USB)
+  bool connected = batteryRestingVoltage > 2.0f * BATTERY_NUMBER_OF_CELLS;
+  updateFailsafeCondition(failsafeLowBattery,
+                          connected && batteryRestingVoltage < FAILSAFE_LOW_CELL_VOLTAGE * BATTERY_NUMBER_OF_CELLS,
+                          now, FAILSAFE_BATTERY_TIME, UINT32_MAX);
+  updateFailsafeCondition(failsafeEmptyBattery,
+                          connected && batteryRestingVoltage < FAILSAFE_CRITICAL_CELL_VOLTAGE * BATTERY_NUMBER_OF_CELLS,
+                          now, FAILSAFE_BATTERY_TIME, UINT32_MAX);
+
+  // the pilot moves the SWC: the return for the low battery is cancelled
+  if(failsafeLowBattery.active && !failsafeReceiver.active && pilotMode != failsafePilotMode && pilotMode != 5)
+    failsafeBatteryCancelled = true;
+
+  // the state asked by the conditions
+  failsafeLevel wanted = FAILSAFE_NONE;
+  if(failsafeReceiver.active)
+    wanted = now - failsafeReceiver.time < FAILSAFE_HOLD_TIME ? FAILSAFE_HOLD : FAILSAFE_RTH_CLIMB;
+  if(failsafeLowBattery.active && !failsafeBatteryCancelled && wanted < FAILSAFE_RTH_CLIMB)
+    wanted = FAILSAFE_RTH_CLIMB;
+  if(failsafeEmptyBattery.active)
+    wanted = FAILSAFE_LAND;
+
+  if(wanted == FAILSAFE_NONE){
+    if(failsafeState != FAILSAFE_NONE) enterFailsafe(FAILSAFE_NONE, now);                     // the pilot flies again
+    if(flightMode == 5) flightMode = failsafePilotMode;                                        // only the failsafe sets it
+    failsafePilotMode = flightMode;
+
+    if(flightMode >= 3 && failsafeGPS.active){                                                 // no GPS hold without GPS
+      flightMode = 2;
+      error = 4;
+    }
+    return;
+  }
+
+  if(failsafeGPS.active || (wanted >= FAILSAFE_RTH_CLIMB && !failsafeHomeSet)) wanted = FAILSAFE_LAND;
+
+  // inside the return to home
+  if(failsafeState == FAILSAFE_RTH_CLIMB && estimatedAltitude > failsafeTargetAltitude - 1.0f)
+    enterFailsafe(FAILSAFE_RTH_RETURN, now);
+  if(failsafeState == FAILSAFE_RTH_RETURN && missionEngaged == 5 && missionTarget.engagement == missionEngagement &&
+     missionTarget.state == MISSION_DONE)
+    enterFailsafe(FAILSAFE_LAND, now);                                                          // at home
+
+  if(wanted > failsafeState) enterFailsafe(wanted, now);
+
+  switch(failsafeState){
+    case FAILSAFE_RTH_RETURN:
+      flightMode = 5;
+      break;
+
+    case FAILSAFE_LAND:
+      flightMode = failsafeGPS.active ? 1 : 3;                                                  // on the spot, if it can
+      break;
+
+    default:                                                                                    // HOLD, RTH climbing
+      flightMode = 3;
+  }
+}
+
+/**
+ * @brief Gives the sticks during a failsafe: roll, pitch and yaw in the center, the throttle of the climb rate
+ * controller. Call it in loop() after convertAllSignals().
+ */
+void applyFailsafeSticks(){
+
+  uint32_t now = millis();
+
+  if(start != 2){
+    if(failsafeReceiver.active){                                                                // the stale sticks cannot start the motors
+      receiverInputChannel3 = 1000;
+      receiverInputChannel4 = 1500;
+    }
+    failsafeHoverThrottle = 1500.0f;
+    return;
+  }
+
+  if(failsafeState == FAILSAFE_NONE){
+    if(throttle > 1300) failsafeHoverThrottle += 0.002f * ((float)throttle - failsafeHoverThrottle);  // flying, 2s
+    return;
+  }
+
+  #if ALTITUDE_SENSOR != OFF
+    float climb = -FAILSAFE_LAND_SPEED;
+    if(failsafeState != FAILSAFE_LAND)
+      climb = fmaxf(-FAILSAFE_MAX_CLIMB, fminf(FAILSAFE_MAX_CLIMB, FAILSAFE_ALTITUDE_P * (failsafeTargetAltitude - estimatedAltitude)));
+
+    float error = climb - verticalSpeed;
+    failsafeClimbI += FAILSAFE_CLIMB_I * error * FAILSAFE_LOOP_TIME;
+    failsafeClimbI = fmaxf(-FAILSAFE_CLIMB_MAX_I, fminf(FAILSAFE_CLIMB_MAX_I, failsafeClimbI));
+    float output = failsafeHoverThrottle + FAILSAFE_CLIMB_P * error + failsafeClimbI;
+
+    // landed: not descending anymore, with the throttle well below the hover
+    bool landed = failsafeState == FAILSAFE_LAND && verticalSpeed > -0.25f * FAILSAFE_LAND_SPEED &&
+                  output < failsafeHoverThrottle - FAILSAFE_LANDED_PULSE;
+  #else
+    float output = failsafeHoverThrottle - (failsafeState == FAILSAFE_LAND ? FAILSAFE_BLIND_DESCENT : 0);
+    bool landed = failsafeState == FAILSAFE_LAND && now - failsafeStateTime > FAILSAFE_BLIND_LAND_TIME - FAILSAFE_LANDED_TIME;
+  #endif
+
+  failsafeThrottle = (int16_t)fmaxf(1100.0f, fminf(1800.0f, output));
+
+  if(!landed) failsafeLandedTime = 0;
+  else if(failsafeLandedTime == 0) failsafeLandedTime = now;
+  else if(now - failsafeLandedTime > FAILSAFE_LANDED_TIME){
+    start = 0;                                                                                  // stop the motors
+    #if DEBUG
+      Serial.println("failsafe: landed, motors off");
+    #endif
+  }
+
+  receiverInputChannel1 = 1500;
+  receiverInputChannel2 = 1500;
+  receiverInputChannel3 = start == 2 ? failsafeThrottle : 1000;
+  receiverInputChannel4 = 1500;
+}
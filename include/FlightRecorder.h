@@ -0,0 +1,212 @@
+/**
+ * @file FlightRecorder.h
+ * @author @sebastiano123-c
+ * @brief Records the inputs of the flight controller, to replay the flight on the computer.
+ *
+ * With FLIGHT_RECORDER true the FLIGHT_CONTROLLER sketch writes a trace (see FlightTrace.h) on the serial:
+ *  @li the sensors call traceInput() with the raw bytes just read (gyroscope, barometer, compass, GPS, battery
+ *      snapshot, reference of the mission, age of the receiver pulses);
+ *  @li loop() calls traceLoopStart() first, which stores the receiver channels, and traceStage() after every stage.
+ * The records of a loop are collected in traceFrame and written with a single Serial.write() at the start of the
+ * next loop: about 70 bytes every 4ms, so RECORDER_BAUD_RATE must be at least 230400.
+ *
+ * test/simulator/replay.cpp replays the trace through the same loop() on the computer: there, these functions
+ * give back the recorded inputs instead of writing them.
+ *
+ * traceLoopStart() and traceStage() are the hooks of loop(): they also tell the diagnostics which stage is running
+ * (see Diagnostics.h), with or without the recorder.
+ *
+ * @version 0.1
+ * @date 2022-06-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#if UPLOADED_SKETCH == FLIGHT_CONTROLLER
+
+/**
+ * @brief Copies the parameters that can change during the flight.
+ *
+ * @param p
+ */
+void getTraceParameters(traceParameters &p){
+  p.roll[0] = PGainRoll;            p.roll[1] = IGainRoll;            p.roll[2] = DGainRoll;
+  p.pitch[0] = PGainPitch;          p.pitch[1] = IGainPitch;          p.pitch[2] = DGainPitch;
+  p.yaw[0] = PGainYaw;              p.yaw[1] = IGainYaw;              p.yaw[2] = DGainYaw;
+  p.altitude[0] = PGainAltitude;    p.altitude[1] = IGainAltitude;    p.altitude[2] = DGainAltitude;
+  p.gps[0] = PGainGPS;              p.gps[1] = DGainGPS;              p.gps[2] = IGainGPS;
+  p.filter[0] = GYROSCOPE_ROLL_FILTER;  p.filter[1] = GYROSCOPE_PITCH_FILTER;
+  p.correction[0] = GYROSCOPE_ROLL_CORR;  p.correction[1] = GYROSCOPE_PITCH_CORR;
+}
+
+/**
+ * @brief Sets the parameters that can change during the flight.
+ *
+ * @param p
+ */
+void setTraceParameters(const traceParameters &p){
+  PGainRoll = p.roll[0];            IGainRoll = p.roll[1];            DGainRoll = p.roll[2];
+  PGainPitch = p.pitch[0];          IGainPitch = p.pitch[1];          DGainPitch = p.pitch[2];
+  PGainYaw = p.yaw[0];              IGainYaw = p.yaw[1];              DGainYaw = p.yaw[2];
+  PGainAltitude = p.altitude[0];    IGainAltitude = p.altitude[1];    DGainAltitude = p.altitude[2];
+  PGainGPS = p.gps[0];              DGainGPS = p.gps[1];              IGainGPS = p.gps[2];
+  GYROSCOPE_ROLL_FILTER = p.filter[0];  GYROSCOPE_PITCH_FILTER = p.filter[1];
+  GYROSCOPE_ROLL_CORR = p.correction[0];  GYROSCOPE_PITCH_CORR = p.correction[1];
+}
+
+#endif
+
+
+#if defined(FLIGHT_REPLAY)
+
+  // traceInput(), traceLoopStart(), traceStage() and startFlightRecorder() are defined by test/simulator/replay.cpp
+
+#elif FLIGHT_RECORDER == true && UPLOADED_SKETCH == FLIGHT_CONTROLLER
+
+  #if DEBUG == true
+    #error "FLIGHT_RECORDER: the trace is written on the serial, set DEBUG false"
+  #endif
+
+  static_assert(EEPROM_SIZE == TRACE_EEPROM_SIZE, "FLIGHT_RECORDER: update TRACE_EEPROM_SIZE in FlightTrace.h");
+  static_assert(sizeof(batteryState) == 5 * sizeof(float), "FLIGHT_RECORDER: update TRACE_BATTERY in FlightTrace.h");
+  static_assert(sizeof(missionSetpoint) == 28, "FLIGHT_RECORDER: update TRACE_MISSION in FlightTrace.h");
+  static_assert(sizeof(compassCalibration) == 48, "FLIGHT_RECORDER: update TRACE_COMPASS_CALIBRATION in FlightTrace.h");
+
+  uint8_t traceFrame[512];                                    // records of the current loop
+  uint16_t traceFrameLength = 0;
+  uint16_t traceLastGPS = 0;                                  // position of the length of the last GPS record, 0 if none
+  uint16_t traceTiming[TRACE_STAGES];
+  traceParameters traceLastParameters;
+  unsigned long traceTickStart;
+
+
+  /**
+   * @brief Writes the records collected so far.
+   */
+  void flushTraceFrame(){
+    if(traceFrameLength > 0) Serial.write(traceFrame, traceFrameLength);
+    traceFrameLength = 0;
+    traceLastGPS = 0;
+  }
+
+  /**
+   * @brief Appends a record to the frame.
+   *
+   * @param record see FlightTrace.h
+   * @param data payload
+   * @param size payload bytes
+   */
+  void appendTraceRecord(uint8_t record, const void *data, uint8_t size){
+    if(traceFrameLength + 1 + size > sizeof(traceFrame)) flushTraceFrame();   // only in setup(), where there are no ticks
+    traceFrame[traceFrameLength++] = record;
+    memcpy(traceFrame + traceFrameLength, data, size);
+    traceFrameLength += size;
+  }
+
+  /**
+   * @brief Records an input just read by the sketch.
+   *
+   * @param record see FlightTrace.h
+   * @param data raw bytes
+   * @param size bytes
+   */
+  void traceInput(uint8_t record, void *data, uint8_t size){
+
+    if(record != TRACE_GPS){
+      appendTraceRecord(record, data, size);
+      return;
+    }
+
+    // the GPS bytes are read one by one: add them to the last GPS record if they follow it
+    if(traceLastGPS > 0 && traceLastGPS + 1 + traceFrame[traceLastGPS] == traceFrameLength &&
+       traceFrame[traceLastGPS] + size <= 255 && traceFrameLength + size <= sizeof(traceFrame)){
+      memcpy(traceFrame + traceFrameLength, data, size);
+      traceFrame[traceLastGPS] += size;
+      traceFrameLength += size;
+      return;
+    }
+
+    if(traceFrameLength + 2 + size > sizeof(traceFrame)) flushTraceFrame();
+    traceFrame[traceFrameLength++] = TRACE_GPS;
+    traceLastGPS = traceFrameLength;
+    traceFrame[traceFrameLength++] = size;
+    memcpy(traceFrame + traceFrameLength, data, size);
+    traceFrameLength += size;
+  }
+
+  /**
+   * @brief Records the end of a stage of loop().
+   *
+   * @param stage see FlightTrace.h
+   */
+  void traceStage(uint8_t stage){
+    traceTiming[stage] = (uint16_t)(micros() - traceTickStart);
+    diagnosticsStage(stage);                                  // see Diagnostics.h
+  }
+
+  /**
+   * @brief Closes the previous loop and records the receiver channels of this one.
+   */
+  void traceLoopStart(){
+
+    unsigned long now = micros();
+
+    if(traceTickStart != 0) appendTraceRecord(TRACE_TIMING, traceTiming, sizeof(traceTiming));
+    flushTraceFrame();                                        // the UART sends it while this loop runs
+
+    traceTickStart = now;
+    uint8_t tick[4 + 2 * TRACE_RECEIVER_CHANNELS];
+    memcpy(tick, &now, 4);
+    for(int ch = 0; ch < TRACE_RECEIVER_CHANNELS; ch++) memcpy(tick + 4 + 2 * ch, (const void *)&trimCh[ch].actual, 2);
+    appendTraceRecord(TRACE_TICK, tick, sizeof(tick));
+
+    // the parameters, only when they change
+    traceParameters parameters;
+    getTraceParameters(parameters);
+    if(memcmp(&parameters, &traceLastParameters, sizeof(parameters)) != 0){
+      appendTraceRecord(TRACE_PARAMETERS, &parameters, sizeof(parameters));
+      traceLastParameters = parameters;
+    }
+
+    diagnosticsLoopStart();                                   // see Diagnostics.h
+  }
+
+  /**
+   * @brief Opens the serial and writes the header of the trace. Call it after initEEPROM().
+   */
+  void startFlightRecorder(){
+
+    Serial.begin(RECORDER_BAUD_RATE);
+
+    traceHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = TRACE_MAGIC;
+    header.version = TRACE_VERSION;
+    header.stages = TRACE_STAGES;
+    header.options[0] = GYROSCOPE;
+    header.options[1] = ALTITUDE_SENSOR;
+    header.options[2] = GPS;
+    header.options[3] = PROXIMITY_SENSOR;
+    header.options[4] = AUTOTUNE_PID_GYROSCOPE;
+    header.options[5] = FRAME_TYPE;
+    header.options[6] = COMPASS;
+    memcpy(header.eeprom, eepromData, TRACE_EEPROM_SIZE);
+    Serial.write((const uint8_t *)&header, sizeof(header));
+
+    memset(traceTiming, 0, sizeof(traceTiming));
+    memset(&traceLastParameters, 0, sizeof(traceLastParameters));
+    traceTickStart = 0;
+  }
+
+#else
+
+  void traceInput(uint8_t record, void *data, uint8_t size){ (void)record; (void)data; (void)size; }
+
+  void traceStage(uint8_t stage){ diagnosticsStage(stage); }
+
+  void traceLoopStart(){ diagnosticsLoopStart(); }
+
+  void startFlightRecorder(){}
+
+#endif
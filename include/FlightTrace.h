@@ -0,0 +1,117 @@
+/**
+ * @file FlightTrace.h
+ * @author @sebastiano123-c
+ * @brief Format of the flight traces written by the flight recorder (see FlightRecorder.h).
+ *
+ * A trace is a traceHeader followed by a stream of records, each one being a traceRecord byte and its payload:
+ *
+ *          header | setup records | TICK inputs TIMING | TICK inputs TIMING | ...
+ *
+ * The records before the first TICK are the inputs read by setup() (e.g. the gyroscope calibration), then every
+ * loop() begins with a TICK and ends with a TIMING. The inputs are stored in the order loop() reads them, raw,
+ * as they come from the sensors: replaying them through the same code gives the same outputs, bit by bit.
+ * All the values are little endian, as on the ESP32 and on the computers.
+ *
+ * These definitions do not depend on the board, so they can be used in the host programs of the /test dir.
+ *
+ * @version 0.1
+ * @date 2022-06-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdint.h>
+
+#ifndef FLIGHT_TRACE_H
+#define FLIGHT_TRACE_H
+
+#define TRACE_MAGIC                 0x52544944                // "DITR"
+#define TRACE_VERSION               4
+#define TRACE_EEPROM_SIZE           36                        // same as EEPROM_SIZE
+#define TRACE_RECEIVER_CHANNELS     5                         // trimCh[0..4]
+
+/**
+ * @brief Records of the trace, with their payload.
+ */
+enum traceRecord {
+  TRACE_TICK = 1,                   // uint32_t micros() at the start of loop(), int16_t trimCh[0..4].actual
+  TRACE_GYROSCOPE,                  // 14 bytes read from the MPU-6050 registers 0x3B-0x48
+  TRACE_BAROMETER,                  // 8 bytes read from the BMP280 registers 0xF7-0xFE
+  TRACE_BAROMETER_TRIMS,            // 32 bytes of the BMP280 compensation registers, as read by readTrim()
+  TRACE_GPS,                        // uint8_t length, then the bytes read from the GPS UART
+  TRACE_BATTERY,                    // batteryState snapshot copied by the loop
+  TRACE_PARAMETERS,                 // traceParameters, at the start of a loop when they changed (e.g. by the WiFi)
+  TRACE_TIMING,                     // uint16_t (us) from the start of loop() to the end of each traceStage
+  TRACE_MISSION,                    // missionSetpoint taken by the loop, at every GPS sample of a mission
+  TRACE_RECEIVER_AGE,               // uint16_t (ms) since the oldest last good pulse of the receiver channels
+  TRACE_COMPASS,                    // 6 bytes read from the data registers of the compass
+  TRACE_COMPASS_CALIBRATION         // compassCalibration read from the flash by setup()
+};
+
+/**
+ * @brief The stages of loop(), in order.
+ */
+enum traceStage {
+  STAGE_GPS,                        // flight mode and readGPS()
+  STAGE_GYROSCOPE,                  // calculateAnglePRY() and readCompass()
+  STAGE_RECEIVER,                   // convertAllSignals() and the starting sequence
+  STAGE_PROXIMITY,                  // readProximitySensor()
+  STAGE_ALTITUDE,                   // calculateAltitudeHold()
+  STAGE_PID,                        // calculatePID()
+  STAGE_BATTERY,                    // readBatteryVoltage()
+  STAGE_ESC,                        // setEscPulses()
+  STAGE_TELEMETRY,                  // sendWiFiTelemetry()
+  STAGE_AUTOTUNE,                   // sampleAutoPID()
+  TRACE_STAGES
+};
+
+const char *const traceStageNames[TRACE_STAGES] = {"gps", "gyroscope", "receiver", "proximity", "altitude",
+                                                   "pid", "battery", "esc", "telemetry", "autotune"};
+
+/**
+ * @brief First bytes of the trace: what the replay needs to start as the board did.
+ */
+struct traceHeader {
+  uint32_t magic;                   // TRACE_MAGIC
+  uint8_t version;                  // TRACE_VERSION
+  uint8_t stages;                   // TRACE_STAGES
+  uint8_t options[7];               // GYROSCOPE, ALTITUDE_SENSOR, GPS, PROXIMITY_SENSOR, AUTOTUNE_PID_GYROSCOPE, FRAME_TYPE,
+                                    // COMPASS
+  uint8_t eeprom[TRACE_EEPROM_SIZE];// as read by initEEPROM()
+};
+
+/**
+ * @brief The parameters that can change during the flight.
+ */
+struct traceParameters {
+  float roll[3], pitch[3], yaw[3];  // P, I, D gains
+  float altitude[3];                // P, I, D gains
+  float gps[3];                     // position P, velocity P and I gains
+  float filter[2];                  // GYROSCOPE_ROLL_FILTER, GYROSCOPE_PITCH_FILTER
+  float correction[2];              // GYROSCOPE_ROLL_CORR, GYROSCOPE_PITCH_CORR
+};
+
+/**
+ * @brief Payload size of a record with a fixed size.
+ *
+ * @param record
+ * @return int bytes, -1 for TRACE_GPS (the length is the first byte) and for unknown records
+ */
+inline int tracePayloadSize(uint8_t record){
+  switch(record){
+    case TRACE_TICK:              return 4 + 2 * TRACE_RECEIVER_CHANNELS;
+    case TRACE_GYROSCOPE:         return 14;
+    case TRACE_BAROMETER:         return 8;
+    case TRACE_BAROMETER_TRIMS:   return 32;
+    case TRACE_BATTERY:           return 5 * sizeof(float);
+    case TRACE_PARAMETERS:        return sizeof(traceParameters);
+    case TRACE_TIMING:            return 2 * TRACE_STAGES;
+    case TRACE_MISSION:           return 28;                  // sizeof(missionSetpoint)
+    case TRACE_RECEIVER_AGE:      return 2;
+    case TRACE_COMPASS:           return 6;
+    case TRACE_COMPASS_CALIBRATION: return 48;                // sizeof(compassCalibration)
+    default:                      return -1;
+  }
+}
+
+#endif /* FLIGHT_TRACE_H */
@@ -44,6 +44,8 @@
  * @link http://aprs.gids.nl/nmea/ @endlink
  */
 
+#define GPS_SAMPLE_PERIOD           0.02f                     // (s) between two GPS samples of the loop, see readGPS()
+
 // new serial
 HardwareSerial SerialGPS(1);
 
@@ -77,6 +79,7 @@ void setupGPS(void) {
 
 void readGPSSerialLine(){
     char read_serial_byte = SerialGPS.read();                                              // new serial byte
+    traceInput(TRACE_GPS, &read_serial_byte, 1);                                           // see FlightRecorder.h
 
     if (read_serial_byte == '$') {                                                         // $ signals the first char of the string
       for (GPSStringCounter = 0; GPSStringCounter < 100; GPSStringCounter ++) {            // clear data
@@ -85,7 +88,7 @@ void readGPSSerialLine(){
       GPSStringCounter = 0;                                                                // reset the counter o start writing at the begin of the array
     }
     else                                                                                   // else, it is not at beginning
-        if (GPSStringCounter < 100)                                                        // increment the counter
+        if (GPSStringCounter < 99)                                                         // increment the counter, GPSString has 100 chars
             GPSStringCounter ++;
 
     GPSString[GPSStringCounter] = read_serial_byte;                                        // write the new received byte to the new position in the array
@@ -156,26 +159,25 @@ void calculateLatLonGPSGA(){
     GPSSatNumber = ((int)GPSString[46] - 48) * (long)10;                                     // filter the number of satellites from the GGA line
     GPSSatNumber += (int)GPSString[47] - 48;                                                 // filter the number of satellites from the GGA line
 
-    if (latGPSPrevious == 0 && lonGPSPrevious == 0) {                                        // if no readings are found for GPS 
-        latGPSPrevious = latActualGPS;                                                         // set the latGPSPrevious variable to the latActualGPS variable
-        lonGPSPrevious = lonActualGPS;                                                         // set the lonGPSPrevious variable to the lonActualGPS variable
+    longLatGPS = latNorth ? latActualGPS : -latActualGPS;                                   // the position with its sign, for the GPS controller
+    longLonGPS = lonEast ? lonActualGPS : -lonActualGPS;
+
+    // without the RMC lines (see calculateVelocityGPS()) the velocity is the change of the position since the previous fix
+    static int32_t previousFix[2];
+    float fixTime = (float)(millis() - timerGPSFix) / 1000.0f;                               // (s) from the previous fix
+    if (millis() - timerGPSVelocity > 1000 && previousFix[0] != 0 && fixTime > 0.05f && fixTime < 1.0f) {
+        float moved[2];
+        missionLocalPosition(longLatGPS, longLonGPS, previousFix, cosf((float)longLatGPS * 1e-6f * 0.017453f), moved);
+        GPSVelocity[0] += 0.5f * (moved[0] / fixTime - GPSVelocity[0]);                    // the positions are noisy
+        GPSVelocity[1] += 0.5f * (moved[1] / fixTime - GPSVelocity[1]);
     }
-
-    latLoop = (float)(latActualGPS - latGPSPrevious) / 10.0;                              
-    lonLoop = (float)(lonActualGPS - lonGPSPrevious) / 10.0;                              
-
-    longLatGPS = latGPSPrevious;                                                              
-    longLonGPS = lonGPSPrevious;                                                              
-
-    // set the next loop.
-    latGPSPrevious = latActualGPS;                                                                 
-    lonGPSPrevious = lonActualGPS;                                                                 
+    previousFix[0] = longLatGPS;
+    previousFix[1] = longLonGPS;
 
     // the GPS is set to a 5Hz refresh rate. Between every 2 GPS measurements, 9 GPS values are simulated.
     GPSAddCounter = 5;                                                                       // set the GPSAddCounter variable to 5 as a count down loop timer
     newGPSDataCounter = 9;                                                                   // set to to 9, simulated values between 2 GPS measurements
-    latGPSAdd = 0;                                                                           // reset the latGPSAdd variable
-    lonGPSAdd = 0;                                                                           // reset the lonGPSAdd variable
+    GPSFixAge = 0;                                                                           // the position moves with the velocity from now on
     newGPSDataAvailable = 1;                                                                 // set to indicate that there is new data available
 
     // create float variables
@@ -183,6 +185,69 @@ void calculateLatLonGPSGA(){
     longitudeGPS = (float)lonActualGPS/1e6;
 }
 
+/**
+ * @brief Field of the NMEA line in GPSString.
+ *
+ * @param field 1 for the one after the line type
+ * @return const char* its first char, NULL if the line is shorter
+ */
+const char* fieldGPS(uint8_t field){
+    for (uint8_t i = 0; i < GPSStringCounter && GPSString[i] != '*'; i ++) {
+        if (GPSString[i] == ',' && --field == 0) return &GPSString[i + 1];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Reads the velocity of a RMC line: the speed over ground (knots) and the course (deg from the north).
+ * The GPS measures it from the doppler shift, which is much more precise than the change of the position.
+ */
+void calculateVelocityGPS(){
+    const char* status = fieldGPS(2);
+    const char* speed = fieldGPS(7);
+    const char* course = fieldGPS(8);
+    if (status == NULL || *status != 'A' || speed == NULL || course == NULL || *speed == ',') return;
+
+    float groundSpeed = strtof(speed, NULL) * 0.514444f;                                       // knots to m/s
+    float heading = strtof(course, NULL) * 0.017453f;                                          // empty when still: 0
+    GPSVelocity[0] = groundSpeed * cosf(heading);
+    GPSVelocity[1] = groundSpeed * sinf(heading);
+    timerGPSVelocity = millis();
+}
+
+/**
+ * @brief Starts the GPS hold from the position of the drone.
+ */
+void setWaypointGPS(){
+    waypointGPS = 1;
+    longLatWaypoint = longLatGPS;
+    longLonWaypoint = longLonGPS;
+    latGPSAdjust = lonGPSAdjust = 0;
+    GPSCosLatitude = cosf((float)longLatGPS * 1e-6f * 0.017453f);                              // once: over some km it does not change
+    GPSVelocityI[0] = GPSVelocityI[1] = 0;
+}
+
+/**
+ * @brief Stops the GPS hold, and its correction of the sticks.
+ */
+void resetWaypointGPS(){
+    waypointGPS = 0;
+    longLatWaypoint = longLonWaypoint = 0;
+    GPSRollAdjust = GPSPitchAdjust = 0;
+    GPSVelocityI[0] = GPSVelocityI[1] = 0;
+}
+
+/**
+ * @brief The GPS controller, at every GPS sample of the loop (50Hz). Two loops in the north and east frame:
+ *  @li position: the error from the waypoint, in meters, asks a velocity (PGainGPS), at most PID_MAX_GPS_SPEED, plus
+ *      the velocity of the reference of a mission (or of the sticks in the GPS hold);
+ *  @li velocity: the error from the velocity measured by the GPS asks a tilt of the drone toward the north and the
+ *      east (DGainGPS and IGainGPS: the I holds against the wind), at most PID_MAX_GPS_ANGLE.
+ * The tilt is then turned with the heading of the drone, angleYaw (true with the compass, see Compass.h), into the
+ * roll and pitch angles, and given to setPID() as the sticks of the pilot would be (15us per degree, see
+ * correctionPitchRoll).
+ * Between two fixes (5Hz) the position moves with the velocity of the GPS.
+ */
 void calculatePIDFromGPS(){
     if (GPSSatNumber < 8)
         ledcWrite(pwmLedChannel, abs(MAX_DUTY_CYCLE - (int)ledcRead(pwmLedChannel)));                // change the LED on the STM32 to indicate GPS reception.
@@ -192,84 +257,67 @@ void calculatePIDFromGPS(){
     timerGPS = millis();                                                                        // reset the GPS timer.
     newGPSDataAvailable = 0;                                                                    // reset the newGPSDataAvailable variable
 
-    if (flightMode >= 3 && waypointGPS == 0) {                                                 // if the flight mode is 3 (GPS hold) and no waypoints are set
-      waypointGPS = 1;                                                                         // waypoints are set
-      longLatWaypoint = longLatGPS;                                                            // remember the current latitude as GPS hold waypoint
-      longLonWaypoint = longLonGPS;                                                            // remember the current longitude as GPS hold waypoint
+    if (flightMode >= 3 && waypointGPS == 0) setWaypointGPS();                                // the GPS hold starts here
+
+    #if UPLOADED_SKETCH == FLIGHT_CONTROLLER
+      updateMissionWaypoint();                                                                 // in flight mode 4 the waypoint is the reference of the mission
+    #endif
+
+    float feedForward[2] = {missionVelocityNorth, missionVelocityEast};                       // (m/s) of the reference
+    float heading = angleYaw * 0.017453f;
+    float cosHeading = cosf(heading), sinHeading = sinf(heading);
+
+    // GPS hold: the sticks move the waypoint, up to PID_MAX_GPS_SPEED forward and to the right
+    if (flightMode == 3 && failsafeState == FAILSAFE_NONE /*&& takeoffDetected == 1*/) {     // the sticks are not the pilot's during a failsafe
+      float forward = 0, right = 0;
+      if (abs(receiverInputChannel2 - 1500) > 16) forward = (float)(1500 - receiverInputChannel2) / 500.0f * PID_MAX_GPS_SPEED;
+      if (abs(receiverInputChannel1 - 1500) > 16) right = (float)(receiverInputChannel1 - 1500) / 500.0f * PID_MAX_GPS_SPEED;
+      feedForward[0] = forward * cosHeading - right * sinHeading;
+      feedForward[1] = forward * sinHeading + right * cosHeading;
+
+      latGPSAdjust += feedForward[0] * GPS_SAMPLE_PERIOD / MICRODEGREE_TO_METERS;
+      lonGPSAdjust += feedForward[1] * GPS_SAMPLE_PERIOD / (MICRODEGREE_TO_METERS * GPSCosLatitude);
+      longLatWaypoint += (int32_t)latGPSAdjust;                                               // the integer part, the rest the next time
+      longLonWaypoint += (int32_t)lonGPSAdjust;
+      latGPSAdjust -= (int32_t)latGPSAdjust;
+      lonGPSAdjust -= (int32_t)lonGPSAdjust;
     }
 
-    if (flightMode >= 3 && waypointGPS == 1) {                                                          //If the GPS hold mode and the waypoints are stored.
-      //GPS stick move adjustments
-      if (flightMode == 3 /*&& takeoffDetected == 1*/) {
-        if (!latNorth) {
-          latGPSAdjust += 0.0015 * (((trimCh[2].actual - 1500) * cos(GPSManAdjustHeading * 0.017453)) + ((trimCh[1].actual - 1500) * cos((GPSManAdjustHeading - 90) * 0.017453))); //South correction
-        }
-        else {
-          latGPSAdjust -= 0.0015 * (((trimCh[2].actual - 1500) * cos(GPSManAdjustHeading * 0.017453)) + ((trimCh[1].actual - 1500) * cos((GPSManAdjustHeading - 90) * 0.017453))); //North correction
-        }
-
-        if (!lonEast) {
-          lonGPSAdjust -= (0.0015 * (((trimCh[1].actual - 1500) * cos(GPSManAdjustHeading * 0.017453)) + ((trimCh[2].actual - 1500) * cos((GPSManAdjustHeading + 90) * 0.017453)))) / cos(((float)longLatGPS / 1000000.0) * 0.017453); //West correction
-        }
-
-        else {
-          lonGPSAdjust += (0.0015 * (((trimCh[1].actual - 1500) * cos(GPSManAdjustHeading * 0.017453)) + ((trimCh[2].actual - 1500) * cos((GPSManAdjustHeading + 90) * 0.017453)))) / cos(((float)longLatGPS / 1000000.0) * 0.017453); //East correction
-        }
-      }
-
-      if (latGPSAdjust > 1) {
-        longLatWaypoint ++;
-        latGPSAdjust --;
-      }
-      if (latGPSAdjust < -1) {
-        longLatWaypoint --;
-        latGPSAdjust ++;
-      }
-
-      if (lonGPSAdjust > 1) {
-        longLonWaypoint ++;
-        lonGPSAdjust --;
-      }
-      if (lonGPSAdjust < -1) {
-        longLonWaypoint --;
-        lonGPSAdjust ++;
-      }
-
-      GPSLonError = longLonWaypoint - longLonGPS;                                                         //Calculate the latitude error between waypoint and actual position.
-      GPSLatError = longLatGPS - longLatWaypoint;                                                         //Calculate the longitude error between waypoint and actual position.
-
-      GPSLatAvarage -=  GPSLatRotatingMem[ GPSRotatingMemLocation];                         //Subtract the current memory position to make room for the new value.
-      GPSLatRotatingMem[ GPSRotatingMemLocation] = GPSLatError - GPSLatErrorPrevious;          //Calculate the new change between the actual pressure and the previous measurement.
-      GPSLatAvarage +=  GPSLatRotatingMem[ GPSRotatingMemLocation];                         //Add the new value to the long term avarage value.
-
-      GPSLonAvarage -=  GPSLonRotatingMem[ GPSRotatingMemLocation];                         //Subtract the current memory position to make room for the new value.
-      GPSLonRotatingMem[ GPSRotatingMemLocation] = GPSLonError - GPSLonErrorPrevious;          //Calculate the new change between the actual pressure and the previous measurement.
-      GPSLonAvarage +=  GPSLonRotatingMem[ GPSRotatingMemLocation];                         //Add the new value to the long term avarage value.
-      GPSRotatingMemLocation++;                                                                        //Increase the rotating memory location.
-      if ( GPSRotatingMemLocation == 35) GPSRotatingMemLocation = 0;                                //Start at 0 when the memory location 35 is reached.
+    if (flightMode < 3 || waypointGPS != 1) return;
 
-      GPSLatErrorPrevious = GPSLatError;                                                             //Remember the error for the next loop.
-      GPSLonErrorPrevious = GPSLonError;                                                             //Remember the error for the next loop.
+    // the position, moved with the velocity since the fix
+    int32_t waypoint[2] = {longLatWaypoint, longLonWaypoint};
+    float position[2], since = (float)GPSFixAge * GPS_SAMPLE_PERIOD;
+    missionLocalPosition(longLatGPS, longLonGPS, waypoint, GPSCosLatitude, position);
 
-      //Calculate the GPS pitch and roll correction as if the nose of the multicopter is facing north.
-      //The Proportional part = (float)GPSLatError * GPS_P_GAIN.
-      //The Derivative part = (float)GPSLatAvarage * GPS_D_GAIN.
-      GPSPitchAdjustNorth = (float)GPSLatError * PGainGPS + (float)GPSLatAvarage * DGainGPS;
-      GPSRollAdjustNorth = (float)GPSLonError * PGainGPS + (float)GPSLonAvarage * DGainGPS;
-
-      if (!latNorth)GPSPitchAdjustNorth *= -1;                                                   //Invert the pitch adjustmet because the quadcopter is flying south of the equator.
-      if (!lonEast)GPSRollAdjustNorth *= -1;                                                     //Invert the roll adjustmet because the quadcopter is flying west of the prime meridian.
-
-      //Because the correction is calculated as if the nose was facing north, we need to convert it for the current heading.
-      GPSRollAdjust = ((float)GPSRollAdjustNorth * cos(gyroAxis[3] * 0.017453)) + ((float)GPSPitchAdjustNorth * cos((gyroAxis[3] - 90) * 0.017453));
-      GPSPitchAdjust = ((float)GPSPitchAdjustNorth * cos(gyroAxis[3] * 0.017453)) + ((float)GPSRollAdjustNorth * cos((gyroAxis[3] + 90) * 0.017453));
+    // the position loop asks a velocity
+    float velocity[2];
+    for (int i = 0; i < 2; i ++) velocity[i] = -(position[i] + GPSVelocity[i] * since) * PGainGPS;
+    float size = sqrtf(velocity[0] * velocity[0] + velocity[1] * velocity[1]);
+    for (int i = 0; i < 2; i ++) {
+      if (size > PID_MAX_GPS_SPEED) velocity[i] *= PID_MAX_GPS_SPEED / size;                   // same direction, slower
+      velocity[i] += feedForward[i];
+    }
 
-      //Limit the maximum correction to 300. This way we still have full control with the pitch and roll stick on the transmitter.
-      if (GPSRollAdjust > 300) GPSRollAdjust = 300;
-      if (GPSRollAdjust < -300) GPSRollAdjust = -300;
-      if (GPSPitchAdjust > 300) GPSPitchAdjust = 300;
-      if (GPSPitchAdjust < -300) GPSPitchAdjust = -300;
+    // the velocity loop asks a tilt, (deg) toward the north and the east
+    float tilt[2], error[2];
+    for (int i = 0; i < 2; i ++) {
+      error[i] = velocity[i] - GPSVelocity[i];
+      tilt[i] = DGainGPS * error[i] + GPSVelocityI[i];
+    }
+    size = sqrtf(tilt[0] * tilt[0] + tilt[1] * tilt[1]);
+    for (int i = 0; i < 2; i ++) {
+      if (size > PID_MAX_GPS_ANGLE) tilt[i] *= PID_MAX_GPS_ANGLE / size;
+      else GPSVelocityI[i] += IGainGPS * error[i] * GPS_SAMPLE_PERIOD;                        // no wind up when saturated
+      if (GPSVelocityI[i] > PID_MAX_GPS_ANGLE) GPSVelocityI[i] = PID_MAX_GPS_ANGLE;
+      else if (GPSVelocityI[i] < -PID_MAX_GPS_ANGLE) GPSVelocityI[i] = -PID_MAX_GPS_ANGLE;
     }
+
+    // from the north and the east to the nose and the right of the drone: the nose down goes forward
+    float forwardTilt = tilt[0] * cosHeading + tilt[1] * sinHeading;
+    float rightTilt = -tilt[0] * sinHeading + tilt[1] * cosHeading;
+    GPSPitchAdjust = -forwardTilt * correctionPitchRoll;
+    GPSRollAdjust = rightTilt * correctionPitchRoll;
 }
 
 #if GPS == BN_880
@@ -290,12 +338,10 @@ void calculatePIDFromGPS(){
         // if no GPS fix or latitude/longitude information available
         if (GPSString[4] == 'L' && GPSString[5] == 'L' && GPSString[7] == ',') {                
 
-        ledcWrite(pwmLedChannel, abs(MAX_DUTY_CYCLE - ledcRead(pwmLedChannel)));              // led blink to signal
+        ledcWrite(pwmLedChannel, abs(MAX_DUTY_CYCLE - (int)ledcRead(pwmLedChannel)));              // led blink to signal
         
         longLatGPS = 0;
         longLonGPS = 0;
-        latGPSPrevious = 0;
-        lonGPSPrevious = 0;
         GPSSatNumber = 0;
 
         }
@@ -304,8 +350,16 @@ void calculatePIDFromGPS(){
         if (GPSString[4] == 'G' && GPSString[5] == 'A' && (GPSString[44] == '1' || GPSString[44] == '2')){
           calculateGPSTimeUTC();
           calculateLatLonGPSGA();
+          timerGPSFix = millis();                                                              // the failsafe watches it, see Failsafe.h
+          #if UPLOADED_SKETCH == FLIGHT_CONTROLLER
+            publishMissionFix();                                                             // for the mission task, see Mission.h
+          #endif
         }
 
+        // if the line starts with MC (RMC) the velocity
+        if (GPSString[4] == 'M' && GPSString[5] == 'C')
+            calculateVelocityGPS();
+
         // if the line starts with SA and if there is a GPS fix we can scan the line for the fix type (none, 2D or 3D).
         if (GPSString[4] == 'S' && GPSString[5] == 'A')
             GPSFixType = (int)GPSString[9] - 48;
@@ -317,18 +371,7 @@ void calculatePIDFromGPS(){
         newGPSDataAvailable = 1;                                                      // set the newGPSDataAvailable to indicate there is new data available
         newGPSDataCounter --;                                                         // decrement the newGPSDataCounter so there will be only 9 simulations
         GPSAddCounter = 5;                                                            // set the GPSAddCounter variable to 5 as a count down loop timer
-
-        latGPSAdd += latLoop;                                                         // add the simulated part to a buffer float variable because the longLatGPS can only hold integers.
-        if (abs(latGPSAdd) >= 1) {                                                    // if the absolute value of latGPSAdd is larger then 1
-            longLatGPS += (int)latGPSAdd;                                             // increment the latGPSAdd value with the latGPSAdd value as an integer
-            latGPSAdd -= (int)latGPSAdd;                                              // subtract the latGPSAdd value as an integer so the decimal value remains.
-        }
-
-        lonGPSAdd += lonLoop;                                                         // add the simulated part to a buffer float variable because the longLatGPS can only hold integers.
-        if (abs(lonGPSAdd) >= 1) {                                                    // if the absolute value of lonGPSAdd is larger then 1
-            longLonGPS += (int)lonGPSAdd;                                             // increment the lonGPSAdd value with the lonGPSAdd value as an integer
-            lonGPSAdd -= (int)lonGPSAdd;                                              // subtract the lonGPSAdd value as an integer so the decimal value remains.
-        }
+        if (GPSFixAge < 25) GPSFixAge ++;                                             // the controller moves the position with the velocity, 0.5s at most
     }
 
     // if there is a new set of GPS data available
@@ -336,38 +379,10 @@ void calculatePIDFromGPS(){
         calculatePIDFromGPS();
     }
 
-    // if the timer is exceeded the GPS signal is missing
-    if (timerGPS + 1000 < millis()) {                                                             
-        if (flightMode >= 3 && start > 0) {                                                         //If flight mode is set to 3 (GPS hold).
-        flightMode = 2;                                                                           //Set the flight mode to 2.
-        error = 4;                                                                                //Output an error.
-        }
-    }
+    // without the GPS signal the failsafe changes the flight mode (see Failsafe.h)
 
     // if the GPS hold mode is disabled and the waypoints are set
-    if (flightMode < 3 && waypointGPS > 0) {                                                              
-          GPSRollAdjust = 0;                                                                                  //Reset the GPSRollAdjust variable to disable the correction.
-          GPSPitchAdjust = 0;                                                                                 //Reset the GPSPitchAdjust variable to disable the correction.
-          if (waypointGPS == 1) {                                                                              //If the waypoints are stored
-          GPSRotatingMemLocation = 0;                                                                      //Set the GPSRotatingMemLocation to zero so we can empty the
-          waypointGPS = 2;                                                                                   //Set the waypointGPS variable to 2 as an indication that the buffer is not cleared.
-          }
-          GPSLonRotatingMem[ GPSRotatingMemLocation] = 0;                                                 //Reset the current GPSLonRotatingMem location.
-          GPSLatRotatingMem[ GPSRotatingMemLocation] = 0;                                                 //Reset the current GPSLonRotatingMem location.
-          GPSRotatingMemLocation++;                                                                          //Increment the GPSRotatingMemLocation variable for the next loop.
-          if (GPSRotatingMemLocation == 36) {                                                                //If the GPSRotatingMemLocation equals 36, all the buffer locations are cleared.
-          waypointGPS = 0;                                                                                   //Reset the waypointGPS variable to 0.
-          //Reset the variables that are used for the D-controller.
-          GPSLatErrorPrevious = 0;
-          GPSLonErrorPrevious = 0;
-          GPSLatAvarage = 0;
-          GPSLonAvarage = 0;
-          GPSRotatingMemLocation = 0;
-          //Reset the waypoints.
-          longLatWaypoint = 0;
-          longLonWaypoint = 0;
-          }
-      }
+    if (flightMode < 3 && waypointGPS > 0) resetWaypointGPS();
   }
 
 #elif GPS == OFF
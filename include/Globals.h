@@ -9,6 +9,7 @@
  *  @li PWM channels: for the use of the ledWrite;
  *  @li BATTERY: battery constants and calculation of the battery level;
  *  @li ALTIMETER: constants;
+ *  @li PROXIMITY: rangefinder and low altitude estimator;
  *  @li RC-CONTROLLER: structure and variables used for the RX;
  *  @li GPS: variables used for the GPS calculations.
  * 
@@ -54,14 +55,15 @@ float DGainYaw                   = PID_D_GAIN_YAW;                //Gain setting
 /**
  *    (ALTITUDE PID)
  */
-float PGainAltitude              = PID_P_GAIN_ALTITUDE;           //Gain setting for the altitude P-controller (default = 1.4).
-float IGainAltitude              = PID_I_GAIN_ALTITUDE;           //Gain setting for the altitude I-controller (default = 0.2).
-float DGainAltitude              = PID_D_GAIN_ALTITUDE;           //Gain setting for the altitude D-controller (default = 0.75).
+float PGainAltitude              = PID_P_GAIN_ALTITUDE;           //Gain setting for the altitude P-controller (default = 50.0).
+float IGainAltitude              = PID_I_GAIN_ALTITUDE;           //Gain setting for the altitude I-controller (default = 15.0).
+float DGainAltitude              = PID_D_GAIN_ALTITUDE;           //Gain setting for the altitude D-controller (default = 60.0).
 /**
  *    (GPS PID) 
  */
-float PGainGPS                   = PID_P_GAIN_GPS;                //Gain setting for the GPS P-controller (default = 2.7).
-float DGainGPS                   = PID_D_GAIN_GPS;                //Gain setting for the GPS D-controller (default = 6.5).
+float PGainGPS                   = PID_P_GAIN_GPS;                //Gain of the GPS position loop (default = 0.8).
+float DGainGPS                   = PID_D_GAIN_GPS;                //P gain of the GPS velocity loop (default = 6.0).
+float IGainGPS                   = PID_I_GAIN_GPS;                //I gain of the GPS velocity loop (default = 1.5).
 /**
  *    (PID UNDECLARED VARIABLES) 
  */
@@ -72,13 +74,8 @@ float pidErrorTemp;
 /**
  *    (ALTITUDE PID UNDECLARED VARIABLES) 
  */
-float pidErrorGainAltitude;
 float pidIMemAltitude, pidAltitudeSetpoint, pidAltitudeInput, pidOutputAltitude;
-uint8_t parachuteRotatingMemLocation;
-int32_t parachuteBuffer[35], parachuteThrottle;
-float pressureParachutePrevious;
-int32_t pressureRotatingMem[50], pressureTotalAverage;
-uint8_t pressureRotatingMemLocation;
+bool altitudeHoldEngaged         = false;                        // the set point has been taken
 uint8_t manualAltitudeChange;
 int16_t manualThrottle;
 
@@ -87,20 +84,18 @@ int16_t manualThrottle;
  * -----------------------------------------------------------------------------------------------------------
  * AUTOPID:    
  * 
- *    AutoPID uses a back-propagation neural network (BPNN) for the pitch/roll PID and yaw PID.
- *    Both NN are defined by the layer structure here below, defining the number of neurons for each layer.
+ *    AutoPID uses a back-propagation neural network (BPNN) for each of the roll, pitch and yaw PIDs.
+ *    The NN are defined by the layer structure here below, defining the number of neurons for each layer.
  */
-std::vector<int> structure       = {4, 5, 3};                 // inputs: 1-set point, 2-gyroscope, 3-error, 4-error speed
+constexpr int structure[]        = {4, 5, 3};                 // inputs: 1-set point, 2-gyroscope, 3-error, 4-error speed
+constexpr int numberOfLayers     = sizeof(structure) / sizeof(structure[0]);
 /**
  *    The NN uses a online learning method, i.e. at the end every forward propagation (feeding the NN with inputs) the 
  *    BP process propagates the error backwards to change the weights of the NN. 
- */
-const char* learningType         = "online";                  // do not change
-/**
+ *
  *    The non linearity of the NN is represented by the activation functions defined for the input->hidden layer and hidden->ouput layer here below.
  */
-std::vector<const char*> 
-            activationFunctionN  = {"tanh", "SoftPlus"};      // others: logistic, ReLU, PReLU, ELU, identity, SoftPlus, tanh
+const char *const activationFunctionN[] = {"tanh", "SoftPlus"};     // others: logistic, ReLU, PReLU, ELU, identity, SoftPlus, tanh
 /**
  *    For each NN define the learning rate and momentum factor.
  *    Their combination must be set carefully: the NN must converge and be stable to the point.
@@ -108,40 +103,52 @@ std::vector<const char*>
  */
 float learningRateRoll           = 0.0000003F;//0.0000007F;
 float momentumFactorRoll         = 0.997F;//0.995F;
+float learningRatePitch          = 0.0000003F;                // as the roll
+float momentumFactorPitch        = 0.997F;
 float learningRateYaw            = 0.00003F;//0.00003F;
 float momentumFactorYaw          = 0.995F;//0.995F;
 /**
- *    Straight forward declaration of the weights and biases.
- *    Weights and biases for the roll's neural network.
- */
-const int numberOfLayers         = structure.size();              // define number of layers  
-std::vector<std::vector<float>> zLRoll(numberOfLayers);           // define the layers input states             
-std::vector<std::vector<float>> aLRoll(numberOfLayers);           // define the layers output states               
-std::vector<std::vector<float>> biasRoll(numberOfLayers-1);       // define the bias vectors (rows of the matrix)
-std::vector<std::vector<std::vector<float>>>                                                                                       
-                             weightsRoll(numberOfLayers-1);       // define the weights matrices (rows of the tensor)
-std::vector<std::vector<float>> deltaBiasRoll(numberOfLayers-1);  // define the deltas of the gradients: has the same dimension of bias and weights
-std::vector<std::vector<std::vector<float>>> deltaWeightsRoll(numberOfLayers-1);
-/**
- *    Weights and biases for the yaw's neural network.
- */
-std::vector<std::vector<float>> zLYaw(numberOfLayers);           // define the layers input states             
-std::vector<std::vector<float>> aLYaw(numberOfLayers);           // define the layers output states               
-std::vector<std::vector<float>> biasYaw(numberOfLayers-1);       // define the bias vectors (rows of the matrix)
-std::vector<std::vector<std::vector<float>>>                                                                                       
-                             weightsYaw(numberOfLayers-1);       // define the weights matrices (rows of the tensor)
-std::vector<std::vector<float>> deltaBiasYaw(numberOfLayers-1);  // define the deltas of the gradients: has the same dimension of bias and weights
-std::vector<std::vector<std::vector<float>>> deltaWeightsYaw(numberOfLayers-1);
-/**
- *    Misc. variables. 
- */
-float yKRoll, yK_1Roll = .0f;
-float uKRoll, uK_1Roll = .0f, eKRoll = .0f, eK_1Roll = .0f, eK_2Roll = .0f;
-float yKPitch, yK_1Pitch = .0f;
-float uKPitch, uK_1Pitch = .0f, eKPitch = .0f, eK_1Pitch = .0f, eK_2Pitch = .0f;
-float yKYaw, yK_1Yaw = .0f;
-float uKYaw, uK_1Yaw = .0f, eKYaw = .0f, eK_1Yaw = .0f, eK_2Yaw = .0f;
-float sgnError;
+ *    The three networks live in a single block of floats (see NeuralNetwork.h), and are propagated together as a
+ *    batch: every float of a network is followed by the same float of the others, in the order of autoPIDAxis.
+ *    autoPIDLayout tells where the biases, the weights, their increments and the states of the layers are.
+ */
+enum autoPIDAxis { AUTOPID_ROLL, AUTOPID_PITCH, AUTOPID_YAW, AUTOPID_AXES };
+networkLayout autoPIDLayout;
+float autoPID[networkFloats(structure, numberOfLayers) * AUTOPID_AXES];
+/**
+ *    (SAMPLES)
+ *    The networks learn from the variables of a loop and from their differences with the previous loop, that
+ *    readAutoPIDSample() takes from autoPIDLast.
+ */
+struct autoPIDSample {
+  float setpoint[AUTOPID_AXES];                                           // (deg/s) pidRollSetpoint, ...
+  float gyro[AUTOPID_AXES];                                               // (deg/s) y(k): gyroRollInput, ...
+  float error[AUTOPID_AXES];                                              // (deg/s) e(k): pidLastRollDError, ...
+  float output[AUTOPID_AXES];                                             // u(k): pidOutputRoll, ...
+  float lastGyro[AUTOPID_AXES];                                           // y(k-1)
+  float lastError[AUTOPID_AXES];                                          // e(k-1)
+  float lastError2[AUTOPID_AXES];                                         // e(k-2)
+  float lastOutput[AUTOPID_AXES];                                         // u(k-1)
+};
+autoPIDSample autoPIDLast;                                                // sample of the previous loop
+/**
+ *    (AUTOTUNE TASK)
+ *    In the FLIGHT_CONTROLLER the networks learn in the autotune task on core 0. The loop puts a sample every
+ *    AUTOTUNE_DECIMATION loops in autoPIDQueue, the task publishes the gains in one of the two autoPIDPublished and
+ *    the loop takes the last ones at its start: neither of them ever waits for the other, see AutoPID.h.
+ */
+struct autoPIDGains {
+  float P[AUTOPID_AXES], I[AUTOPID_AXES], D[AUTOPID_AXES];
+};
+autoPIDSample autoPIDQueue[AUTOTUNE_QUEUE_SIZE];
+std::atomic<uint32_t> autoPIDQueueHead(0);                                // samples put by the loop
+std::atomic<uint32_t> autoPIDQueueTail(0);                                // samples taken by the task
+uint32_t autoPIDDropped          = 0;                                    // samples lost because the queue was full
+int autoPIDLoops                 = 0;                                    // loops since the last sample
+autoPIDGains autoPIDPublished[2];
+std::atomic<uint32_t> autoPIDSequence(0);                                 // the last gains are in autoPIDPublished[sequence & 1]
+uint32_t autoPIDApplied          = 0;                                    // sequence of the gains of the PIDs
+TaskHandle_t autotuneTaskHandle;
 
 
 /**
@@ -156,7 +163,7 @@ float sgnError;
  * 
  */
 float GYROSCOPE_ROLL_FILTER      = 0.9996;                     // stabler value is 0.9996
-float GYROSCOPE_PITCH_FILTER     = GYROSCOPE_PITCH_FILTER;    
+float GYROSCOPE_PITCH_FILTER     = GYROSCOPE_ROLL_FILTER;      // same as the roll
 /**
  *    (ANGLE CORRECTION)
  *    Find the most horizontal plane you got, and turn on the drone on it.
@@ -171,6 +178,7 @@ float GYROSCOPE_PITCH_CORR       = 0.;                         // (-1.65.) after
 
 const int gyroFrequency          = 250;                         // (Hz)
 const float gyroSensibility      = 65.5;                                
+const float accSensibility       = 4096.0;                      // (LSB/g) +/- 8g full scale range
 const int correctionPitchRoll    = 15;                          // correction for the pitch and roll
 float convDegToRad               = 180.0 / PI;                  // conversion between degrees and radians  
 float travelCoeff                = 1.0f/((float)gyroFrequency * // converts gyro into an angular distance
@@ -187,6 +195,7 @@ boolean gyroAnglesSet;
 int16_t gyroTemp, accAxis[4], gyroAxis[4];   
 double gyroAxisCalibration[4], accAxisCalibration[4];
 float angleRollAcc, anglePitchAcc, anglePitch, angleRoll;
+float angleYaw;                                                 // (deg) heading: true with the compass, otherwise 0 the nose at the start of the motors
 float rollLevelAdjust, pitchLevelAdjust;
 long accTotalVector;
 
@@ -211,6 +220,12 @@ const int pwmChannel1            = 1;                            // ESC1 pwm cha
 const int pwmChannel2            = 2;                            // ESC2 pwm channel
 const int pwmChannel3            = 3;                            // ESC3 pwm channel
 const int pwmChannel4            = 4;                            // ESC4 pwm channel
+/**
+ *    (DSHOT TELEMETRY)
+ *    With bidirectional DShot the ESCs send back the electrical RPM, RPM = eRPM * 2 / MOTOR_POLES.
+ */
+uint32_t motorERPM[4]            = {0, 0, 0, 0};                 // eRPM of the four motors
+uint32_t dshotTelemetryErrors    = 0;                            // corrupted answers of the ESCs
 /**
  *    (PWM used for RC-controller inputs) 
  */
@@ -259,20 +274,50 @@ float maximumWidth               = pow(2., (float)adcBits)-1;             // max
  *    Finally, minBatteryLevelThreshold is the board minimum voltage under which it is not safe to go.
  */ 
 float fromWidthToV              = (BOARD_LIMIT_VOLTAGE / maximumWidth) / (TOTAL_DROP);    
+/**
+ *    (ADC SAMPLING)
+ *    The battery pin is sampled by a background task on core 0, so the 4ms loop never waits for the ADC.
+ *    Every batterySamplePeriod the task averages batteryOversampling readings and converts them to millivolts
+ *    using the calibration burned in the eFuse of the chip (see esp_adc_cal.h).
+ */
+const int batteryOversampling    = 16;                                    // number of ADC readings averaged together
+const int batterySamplePeriod    = 10;                                    // (ms) period of the battery task
+const float batteryFilter        = 0.9;                                   // low pass filter of the battery voltage
+/**
+ *    (STATE OF CHARGE)
+ *    The state of charge (SoC) is read from the resting voltage of each cell using the discharge curve below,
+ *    then it is followed during the flight by counting the charge drawn by the motors.
+ *    cellDischargeCurve[i] is the resting cell voltage when the SoC is i*100/(cellDischargeCurveSize-1) %.
+ *    socVoltageWeight is how much the voltage curve corrects the charge counting at each sample.
+ */
+const float cellDischargeCurve[] = {3.27, 3.61, 3.69, 3.71, 3.73, 3.75, 3.77, 3.79, 3.80, 3.82, 3.84,
+                                    3.85, 3.87, 3.91, 3.95, 3.98, 4.02, 4.08, 4.11, 4.15, 4.20};
+const int cellDischargeCurveSize = sizeof(cellDischargeCurve) / sizeof(cellDischargeCurve[0]);
+const float socVoltageWeight     = 0.001;
+/**
+ *    (BATTERY SNAPSHOT)
+ *    The battery task writes the snapshot, the loop copies it with readBatteryVoltage().
+ */
+struct batteryState{
+  float voltage;                                                          // (V) filtered voltage under load
+  float restingVoltage;                                                   // (V) voltage compensated for the sag
+  float current;                                                          // (A) estimated current
+  float consumed;                                                         // (mAh) charge drawn since the start
+  float percentage;                                                       // (%) state of charge
+} batterySnapshot;
+portMUX_TYPE batteryMux          = portMUX_INITIALIZER_UNLOCKED;
+TaskHandle_t batteryTaskHandle;
 /**
  *     (BATTERY COMPENSATION*)
- *     WORK IN PROGRESS: use these parameters only, or vary by small steps
- *     In the first flight use the parameters here.
- *     STUDY THIS: After a complete flight experience, using the esp-cam telemetryAnalysis tool, you can analyses the data readings saved on your SD.
- *     The analysis program fits the battery data (the plot on the bottom right) and gives you the m rect pendency and the intercept b.
- *     Use put here the results.
+ *     After a complete flight experience, using the esp-cam telemetryAnalysis tool, you can fit the hover throttle
+ *     against the battery voltage: the curvature of the fit is the thrust curve expo (see ThrustCurve.h).
  */
-float  batteryCurvePendency      = 6e-1;                                 // compensate the rotors power loss when battery drops down
+float thrustCurveExpo            = THRUST_CURVE_EXPO;                    // curvature of the thrust curve
 /**
  *    (BATTERY UNDECLARED VARIABLES)
  */
-float pinPulseWidth, batteryVoltage, batteryPercentage;
-int16_t escCorr;
+float pinPulseWidth, batteryVoltage, batteryPercentage, batteryRestingVoltage, batteryCurrent;
+float thrustScale                = 1.0f;                                 // BATTERY_REFERENCE_VOLTAGE / batteryVoltage
 
 
 
@@ -297,10 +342,40 @@ unsigned long int pressCal;
 /**
  *    (ALTIMETER UNDECLARED VARIABLES)
  */
-float pressure, altitudeMeasure, pressureSampled;
+float pressure, altitudeMeasure;
 float temperature;
 uint8_t barometerCounter;
-float actualPressure, actualPressureSlow, actualPressureFast, actualPressureDiff, pressureForPID;
+/**
+ *    (ALTITUDE ESTIMATOR, see AltitudeEstimator.h)
+ */
+altitudeEstimator verticalEstimator;
+float estimatedAltitude, verticalSpeed;                                   // (m), (m/s) up positive, at every loop
+
+
+
+
+/**
+ * -----------------------------------------------------------------------------------------------------------
+ * @brief PROXIMITY
+ * 
+ *    (LOW ALTITUDE ESTIMATOR)
+ *    Close to the ground the rangefinder is much more precise than the barometer.
+ *    Below PROXIMITY_BLEND_ALTITUDE the two readings are blended: the rangefinder weight goes from 1 at
+ *    PROXIMITY_BLEND_ALTITUDE - proximityBlendBand down to 0 at PROXIMITY_BLEND_ALTITUDE.
+ *    hPaPerMeter converts the ground distance into the barometer units used by the altitude PID.
+ */
+const float proximityBlendBand   = 1.0;                                  // (m) width of the blending band
+const float proximityFilter      = 0.7;                                  // low pass filter of the rangefinder readings
+const float groundPressureFilter = 0.98;                                 // low pass filter of the ground pressure reference
+const float hPaPerMeter          = 0.12;                                 // (hPa/m) pressure gradient close to the sea level
+/**
+ *    (PROXIMITY UNDECLARED VARIABLES)
+ */
+volatile unsigned long proximityEchoStart, proximityEchoWidth;
+volatile boolean proximityNewEcho;
+unsigned long proximityTriggerTimer;
+boolean proximityValid;
+float proximityDistance, groundAltitude, groundPressure;
 
 
 
@@ -315,15 +390,49 @@ float actualPressure, actualPressureSlow, actualPressureFast, actualPressureDiff
 const char *ssid                 = "DroneInoTelemetry";
 const char *password             = "DroneIno";                            
 const int refreshRate            = 200;                                   // (ms) the refresh rate of the page
-int refreshCounter               = 0;
 /**
- *    (UART)
- *    Defines the number of elements and the that ESP32 waits to receive from telemetry system
- */
-const int numChars = 2000;
-char receivedChars[numChars];
-char tempChars[numChars];                           // temporary array for use when parsing
-boolean newData = false;
+ *    (FRAMES)
+ *    Every TELEMETRY_DECIMATION loops the loop takes a telemetryFrame (see TelemetryLink.h). With NATIVE it goes in
+ *    telemetryQueue and the telemetry task on core 0 sends it on the WebSocket; with ESP_CAM it is written on the
+ *    UART, see WiFiTelemetry.h.
+ */
+telemetryFrame telemetryQueue[TELEMETRY_QUEUE_SIZE];
+std::atomic<uint32_t> telemetryQueueHead(0);                              // frames put by the loop
+std::atomic<uint32_t> telemetryQueueTail(0);                              // frames taken by the task
+uint32_t telemetryDropped        = 0;                                    // frames lost because the queue was full
+int telemetryLoops               = 0;                                    // loops since the last frame
+TaskHandle_t telemetryTaskHandle;
+/**
+ *    (ESP32-CAM AND MAVLINK LINK)
+ *    The bytes received from the ESP32-CAM, or from the ground station, wait in linkReceived until a whole frame
+ *    arrives. The parameters in linkParametersPending (a bit per id) are sent back, one per loop; the ones of a batch
+ *    wait in linkParametersStaged until the next loop has applied it.
+ */
+uint8_t linkReceived[2 * MAVLINK_MAX_FRAME];
+size_t linkReceivedLength        = 0;
+uint32_t linkErrors              = 0;                                    // broken frames received
+uint32_t linkParametersPending   = 0;
+uint32_t linkParametersStaged    = 0;
+/**
+ *    (MAVLINK)
+ *    Every message of mavlinkStreams is sent when its loop comes (see WiFiTelemetry.h), one message per loop.
+ */
+struct mavlinkStream {
+  uint32_t id;                                                           // mavlinkMessageId
+  uint16_t period;                                                       // (loops)
+  uint32_t due;                                                          // loop of the next one
+};
+mavlinkStream mavlinkStreams[] = {
+  {MAVLINK_MSG_HEARTBEAT,           250 / MAVLINK_RATE_HEARTBEAT,           0},
+  {MAVLINK_MSG_SYS_STATUS,          250 / MAVLINK_RATE_SYS_STATUS,          0},
+  {MAVLINK_MSG_ATTITUDE,            250 / MAVLINK_RATE_ATTITUDE,            0},
+  {MAVLINK_MSG_GLOBAL_POSITION_INT, 250 / MAVLINK_RATE_GLOBAL_POSITION_INT, 0},
+  {MAVLINK_MSG_RC_CHANNELS,         250 / MAVLINK_RATE_RC_CHANNELS,         0}
+};
+uint32_t mavlinkLoops            = 0;
+uint8_t mavlinkSequence          = 0;
+uint32_t mavlinkSkipped          = 0;                                    // messages late for the UART or the loop time
+float mavlinkGroundAltitude      = 0.0f;                                 // (m) estimatedAltitude when armed
 
 
 
@@ -347,13 +456,17 @@ struct trimPosition{
 volatile int receiverInputChannel1, receiverInputChannel2, receiverInputChannel3, receiverInputChannel4, receiverInputChannel5;
 byte lastChannel1, lastChannel2, lastChannel3, lastChannel4, lastChannel5;
 unsigned long timer1, timer2, timer3, timer4, timer5, currentTime, loopTimer;
+volatile uint32_t receiverPulseTime[5];                  // (us) micros() of the last good pulse of trimCh[0..4], see Failsafe.h
 int16_t esc1, esc2, esc3, esc4;
 int16_t throttle;
+float mixerOutput[MIXER_MOTORS];                         // see Mixer.h
 /**
  *   (FLIGHT MODE)
  *    1 = only auto leveling (or nothing if AUTO_LEVELING = false)
  *    2 = altitude hold*
  *    3 = GPS**
+ *    4 = mission** (see Mission.h)
+ *    5 = return to home** (only by the failsafe, see Failsafe.h)
  */
 byte flightMode;                                           
 /**
@@ -379,31 +492,126 @@ uint8_t NMEANewline              = false;
 /**
  *    (COMPASS) 
  */
-int16_t compassX, compassY, compassZ;
-int16_t compassCalValues[6];
-float compassXHorizontal, compassYHorizontal, actualCompassHeading;
-float compassScaleY, compassScaleZ;
-int16_t compassOffsetX, compassOffsetY, compassOffsetZ, compassCalibrationOn;
+int16_t compassX, compassY, compassZ;                                   // (LSB) last reading, axes of the drone (see CompassFit.h)
+compassCalibration compassCal;                                          // saved on the flash by the CALIBRATION sketch
+bool compassCalibrated           = false;                               // without a calibration the heading is the gyro one
+float actualCompassHeading;                                             // (deg) true heading of the last reading
+uint8_t compassLoopCounter;                                             // loops since the last reading
 /**
  *    (GPS UNDECLARED VARIABLES) 
  */
 static char GPSString[100];
 char GPSIncomingString;
 uint8_t GPSSatNumber, latNorth, lonEast, GPSFixType, newGPSDataCounter, newGPSDataAvailable, waypointGPS;
-uint8_t GPSRotatingMemLocation;
+uint8_t GPSFixAge;                                                       // GPS samples of the loop since the fix
 uint16_t GPSStringCounter;
 uint16_t GPSAddCounter;
-int32_t longLatGPS, longLonGPS, latGPSPrevious, lonGPSPrevious, longLatWaypoint, longLonWaypoint;
+int32_t longLatGPS, longLonGPS, longLatWaypoint, longLonWaypoint;        // (deg * 1e6) negative south and west
 int32_t latActualGPS, lonActualGPS;
-int32_t GPSLatError, GPSLonError;
-int32_t GPSLatErrorPrevious, GPSLonErrorPrevious;
-int32_t GPSLatRotatingMem[40], GPSLonRotatingMem[40];
-int32_t GPSLatAvarage, GPSLonAvarage;
-uint32_t timerGPS;
-float latLoop, lonLoop, latGPSAdd, lonGPSAdd;
-float GPSPitchAdjustNorth, GPSPitchAdjust, GPSRollAdjustNorth, GPSRollAdjust;
-
-float latGPSAdjust, lonGPSAdjust, GPSManAdjustHeading;
+uint32_t timerGPS, timerGPSFix, timerGPSVelocity;                        // (ms) of the last GPS sample, fix, RMC velocity
+float GPSCosLatitude;                                                    // of the waypoint, for the meters east
+float GPSVelocity[2];                                                    // (m/s) north and east
+float GPSVelocityI[2];                                                   // (deg) tilt north and east of the I gain
+float GPSPitchAdjust, GPSRollAdjust;                                     // (us) added to the pitch and roll sticks
+float latGPSAdjust, lonGPSAdjust;                                        // (deg * 1e6) fraction of the waypoint moved by the sticks
 float latitudeGPS, longitudeGPS;
 
 const char* timeUTC = "None";
+/**
+ *    (MISSION)
+ *    The loop publishes every fix in one of the two missionFixes, the mission task publishes the reference in one
+ *    of the two missionSetpoints: neither of them ever waits for the other, see Mission.h.
+ */
+struct missionFix {
+  int32_t latitude, longitude;                                            // (deg * 1e6) negative south and west
+  uint32_t time;                                                          // (ms) millis() of the fix
+  uint32_t sample;                                                        // missionSamples of the fix
+  uint8_t engagement;                                                     // 0 if the mission is not flying
+  uint8_t route;                                                          // flight mode: 4 the mission, 5 home
+};
+missionWaypoint missionWaypoints[MISSION_MAX_WAYPOINTS];                  // saved on the flash
+int missionCount                 = 0;
+missionFix missionFixes[2];
+std::atomic<uint32_t> missionFixSequence(0);                              // the last fix is in missionFixes[sequence & 1]
+missionSetpoint missionSetpoints[2];
+std::atomic<uint32_t> missionSetpointSequence(0);                         // the last reference is in missionSetpoints[sequence & 1]
+missionSetpoint missionTarget;                                            // the reference taken by the loop
+missionPath missionRoute;                                                 // of the mission task only
+uint32_t missionSamples          = 0;                                    // GPS samples of the loop
+uint8_t missionEngagement        = 0;                                    // counts the missions started
+uint8_t missionEngaged           = 0;                                    // flight mode of the route flown, 0 for none
+float missionVelocityNorth, missionVelocityEast;                          // (m/s) of the reference
+TaskHandle_t missionTaskHandle;
+/**
+ *    (FAILSAFE)
+ *    Each condition remembers when it started: see Failsafe.h.
+ *    The states are ordered: while the failsafe is on, the state only goes up.
+ */
+enum failsafeLevel {
+  FAILSAFE_NONE,                                                          // the pilot flies
+  FAILSAFE_HOLD,                                                          // holding the position
+  FAILSAFE_RTH_CLIMB,                                                     // return to home: climbing
+  FAILSAFE_RTH_RETURN,                                                    // return to home: flying back
+  FAILSAFE_LAND                                                           // landing where it is
+};
+struct failsafeCondition {
+  bool bad;                                                               // as read in this loop
+  bool active;                                                            // after the delays
+  uint32_t since;                                                         // (ms) millis() when bad changed
+  uint32_t time;                                                          // (ms) millis() when active changed
+};
+failsafeCondition failsafeReceiver, failsafeGPS, failsafeLowBattery, failsafeEmptyBattery;
+failsafeLevel failsafeState      = FAILSAFE_NONE;
+uint32_t failsafeStateTime       = 0;                                    // (ms) millis() of the last change of state
+uint8_t failsafePilotMode        = 1;                                    // flight mode asked by the SWC before the failsafe
+bool failsafeBatteryCancelled    = false;                                // the pilot took back the drone
+bool failsafeArmed               = false;                                // the home is taken at the start of the motors
+bool failsafeHomeSet             = false;                                // with the GPS fix
+missionWaypoint failsafeHome;                                             // the mission task flies it in flight mode 5
+float failsafeHomeAltitude, failsafeTargetAltitude;                       // (m)
+float failsafeHoverThrottle      = 1500.0f;                               // (us) learnt flying
+float failsafeClimbI             = 0.0f;                                  // (us)
+int16_t failsafeThrottle         = 1500;                                  // (us) in place of the throttle stick
+uint32_t failsafeLandedTime      = 0;                                    // (ms) since when the drone does not descend, 0 if it does
+
+
+
+/**
+ * -----------------------------------------------------------------------------------------------------------
+ * PARAMETERS:
+ * 
+ * 
+ *    The parameters that can change during the flight (e.g. from the telemetry) are kept in one NVS blob, see
+ *    Parameters.h. The id of a parameter is its index in parameterTable: add the new ones at the end, before
+ *    PARAMETERS, and never reorder them, so that the blobs already saved keep their meaning.
+ */
+enum parameterId {
+  PARAM_ROLL_P, PARAM_ROLL_I, PARAM_ROLL_D,
+  PARAM_PITCH_P, PARAM_PITCH_I, PARAM_PITCH_D,
+  PARAM_YAW_P, PARAM_YAW_I, PARAM_YAW_D,
+  PARAM_ALTITUDE_P, PARAM_ALTITUDE_I, PARAM_ALTITUDE_D,
+  PARAM_GPS_P, PARAM_GPS_D,
+  PARAM_GYROSCOPE_ROLL_FILTER, PARAM_GYROSCOPE_PITCH_FILTER,
+  PARAM_GYROSCOPE_ROLL_CORR, PARAM_GYROSCOPE_PITCH_CORR,
+  PARAM_THRUST_CURVE_EXPO,
+  PARAM_GPS_I,
+  PARAMETERS
+};
+static_assert(PARAMETERS <= LINK_MAX_PARAMETERS, "parameterId: a bit per parameter in linkParametersPending");
+uint32_t parameterDefault[PARAMETERS];                                  // values of Config.h, raw bits
+volatile bool parametersDirty    = false;                               // changed since the last commit
+volatile unsigned long parametersChanged = 0;                           // (ms) time of the last change
+/**
+ *    (UPDATES)
+ *    The telemetry never writes the parameters: it puts a batch of checked values in parameterQueue and the loop
+ *    applies all of them at its start (see applyParameterUpdates() in Parameters.h), so a PID never runs with half
+ *    of a change. One writer only: the web server task with NATIVE, the loop itself with ESP_CAM.
+ */
+struct parameterBatch {
+  uint8_t count;
+  uint8_t id[PARAMETERS];
+  float value[PARAMETERS];
+};
+parameterBatch parameterQueue[PARAMETERS_QUEUE_SIZE];
+std::atomic<uint32_t> parameterQueueHead(0);                              // batches put by the telemetry
+std::atomic<uint32_t> parameterQueueTail(0);                              // batches applied by the loop
@@ -106,13 +106,17 @@ void readGyroscopeStatus(){
   Wire.endTransmission();
   Wire.requestFrom(GYRO_ADDRESS, 14);                           // request a total of 14 registers
 
-  accAxis[1]  = Wire.read()<<8|Wire.read();                     // 0x3B (ACCEL_XOUT_H) & 0x3C (ACCEL_XOUT_L)
-  accAxis[2]  = Wire.read()<<8|Wire.read();                     // 0x3D (ACCEL_YOUT_H) & 0x3E (ACCEL_YOUT_L)
-  accAxis[3]  = Wire.read()<<8|Wire.read();                     // 0x3F (ACCEL_ZOUT_H) & 0x40 (ACCEL_ZOUT_L)
-  gyroTemp    = Wire.read()<<8|Wire.read();                     // 0x41 (TEMP_OUT_H) & 0x42 (TEMP_OUT_L)
-  gyroAxis[1] = Wire.read()<<8|Wire.read();                     // 0x43 (GYRO_XOUT_H) & 0x44 (GYRO_XOUT_L)
-  gyroAxis[2] = Wire.read()<<8|Wire.read();                     // 0x45 (GYRO_YOUT_H) & 0x46 (GYRO_YOUT_L)
-  gyroAxis[3] = Wire.read()<<8|Wire.read();                     // 0x47 (GYRO_ZOUT_H) & 0x48 (GYRO_ZOUT_L)
+  uint8_t data[14];
+  for(int i = 0; i < 14; i++) data[i] = Wire.read();
+  traceInput(TRACE_GYROSCOPE, data, 14);                        // see FlightRecorder.h
+
+  accAxis[1]  = data[0]<<8|data[1];                             // 0x3B (ACCEL_XOUT_H) & 0x3C (ACCEL_XOUT_L)
+  accAxis[2]  = data[2]<<8|data[3];                             // 0x3D (ACCEL_YOUT_H) & 0x3E (ACCEL_YOUT_L)
+  accAxis[3]  = data[4]<<8|data[5];                             // 0x3F (ACCEL_ZOUT_H) & 0x40 (ACCEL_ZOUT_L)
+  gyroTemp    = data[6]<<8|data[7];                             // 0x41 (TEMP_OUT_H) & 0x42 (TEMP_OUT_L)
+  gyroAxis[1] = data[8]<<8|data[9];                             // 0x43 (GYRO_XOUT_H) & 0x44 (GYRO_XOUT_L)
+  gyroAxis[2] = data[10]<<8|data[11];                           // 0x45 (GYRO_YOUT_H) & 0x46 (GYRO_YOUT_L)
+  gyroAxis[3] = data[12]<<8|data[13];                           // 0x47 (GYRO_ZOUT_H) & 0x48 (GYRO_ZOUT_L)
   
   #if UPLOADED_SKETCH == CALIBRATION || UPLOADED_SKETCH == FLIGHT_CONTROLLER
 
@@ -225,6 +229,11 @@ void calculateAnglePRY(){
   anglePitch -= angleRoll * sin((float)gyroAxis[3] * travelCoeffToRad);            //If the IMU has yawed transfer the roll angle to the pitch angel.
   angleRoll += anglePitch * sin((float)gyroAxis[3] * travelCoeffToRad);            //If the IMU has yawed transfer the pitch angle to the roll angel.
 
+  //The heading, for the GPS controller: the gyro only, it drifts slowly
+  angleYaw += (float)gyroAxis[3] * travelCoeff;
+  if(angleYaw < 0) angleYaw += 360;
+  else if(angleYaw >= 360) angleYaw -= 360;
+
 
   //Accelerometer angle calculations
   accTotalVector = sqrt((accAxis[2]*accAxis[2])+
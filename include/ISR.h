@@ -10,7 +10,7 @@
  */
 
 /** 
- * @brief Measures the receiver input signal length. 
+ * @brief Measures the receiver input signal length, and remembers when the last good pulse of each channel came.
  * @todo Use pwm to read the receivers signals, avoid digitalRead.
  */
 void IRAM_ATTR myISR(){//void *dummy){
@@ -28,6 +28,7 @@ void IRAM_ATTR myISR(){//void *dummy){
   else if(lastChannel1 == 1){                                             //Input 8 is not high and changed from 1 to 0.
       lastChannel1 = 0;                                                     //Remember current input state.
       trimCh[1].actual = currentTime - timer1;                             //Channel 1 is currentTime - timer1.
+      if(trimCh[1].actual > 900 && trimCh[1].actual < 2100) receiverPulseTime[1] = currentTime; //A good pulse (see Failsafe.h).
   }
 
 
@@ -42,6 +43,7 @@ void IRAM_ATTR myISR(){//void *dummy){
     else if(lastChannel2 == 1){                                             //Input 9 is not high and changed from 1 to 0.
         lastChannel2 = 0;                                                     //Remember current input state.
         trimCh[2].actual = currentTime - timer2;                             //Channel 2 is currentTime - timer2.
+        if(trimCh[2].actual > 900 && trimCh[2].actual < 2100) receiverPulseTime[2] = currentTime; //A good pulse (see Failsafe.h).
     }
 
 
@@ -56,6 +58,7 @@ void IRAM_ATTR myISR(){//void *dummy){
     else if(lastChannel3 == 1){                                             //Input 10 is not high and changed from 1 to 0.
         lastChannel3 = 0;                                                     //Remember current input state.
         trimCh[3].actual = currentTime - timer3;                             //Channel 3 is currentTime - timer3.
+        if(trimCh[3].actual > 900 && trimCh[3].actual < 2100) receiverPulseTime[3] = currentTime; //A good pulse (see Failsafe.h).
     }
 
 
@@ -70,6 +73,7 @@ void IRAM_ATTR myISR(){//void *dummy){
     else if(lastChannel4 == 1){                                             //Input 11 is not high and changed from 1 to 0.
         lastChannel4 = 0;                                                     //Remember current input state.
         trimCh[4].actual = currentTime - timer4;                             //Channel 4 is currentTime - timer4.
+        if(trimCh[4].actual > 900 && trimCh[4].actual < 2100) receiverPulseTime[4] = currentTime; //A good pulse (see Failsafe.h).
     }
 
   
@@ -84,5 +88,6 @@ void IRAM_ATTR myISR(){//void *dummy){
     else if(lastChannel5 == 1){                                             //Input 11 is not high and changed from 1 to 0.
         lastChannel5 = 0;                                                     //Remember current input state.
         trimCh[0].actual = currentTime - timer5;                             //Channel 4 is currentTime - timer4.
+        if(trimCh[0].actual > 900 && trimCh[0].actual < 2100) receiverPulseTime[0] = currentTime; //A good pulse (see Failsafe.h).
     }
 }
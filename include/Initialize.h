@@ -127,6 +127,14 @@ void setupPins(){
     ledcWrite(pwmChannel3, 1000);
     ledcWrite(pwmChannel4, 1000);
 
+  #elif defined(MOTOR_PULSE_BY_DSHOT)
+
+    setupDShot();                                                                         // DShot ESCs do not beep
+
+  #elif defined(MOTOR_PULSE_BY_ONESHOT)
+
+    setupOneShot();
+
   #endif
 
   // RECEIVER pinmode
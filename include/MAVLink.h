@@ -0,0 +1,314 @@
+/**
+ * @file MAVLink.h
+ * @author @sebastiano123-c
+ * @brief The MAVLink v2 messages spoken by DroneIno (WIFI_TELEMETRY MAVLINK, see WiFiTelemetry.h): the ground
+ * stations (QGroundControl, Mission Planner, MAVProxy) see the flight and read and set the parameters.
+ *
+ * Only the messages below are known, from the common.xml dialect:
+ *  @li HEARTBEAT, SYS_STATUS, ATTITUDE, GLOBAL_POSITION_INT, RC_CHANNELS, PARAM_VALUE sent;
+ *  @li PARAM_REQUEST_LIST, PARAM_REQUEST_READ, PARAM_SET received.
+ * A frame is
+ *
+ *          0xFD | length | incompat flags | compat flags | sequence | system | component | id (3 bytes) |
+ *          payload (length bytes) | CRC-16/MCRF4XX of everything after 0xFD and of the CRC_EXTRA of the message
+ *
+ * with the fields of the payload sorted by size (see the structs below, already in that order) and its zeros at
+ * the end cut away. The signed frames are read but the signature is not checked, MAVLink v1 frames (0xFE) are not
+ * read.
+ *
+ * As TelemetryLink.h, nothing here depends on the board: the messages are written into the buffers of the caller
+ * and read in place, and the host programs of the /test dir check them (see test/simulator/mavlink.cpp).
+ *
+ * @version 0.1
+ * @date 2022-06-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef MAVLINK_H
+#define MAVLINK_H
+
+#define MAVLINK_STX                 0xFD
+#define MAVLINK_HEADER_SIZE         10                        // stx, length, flags, flags, sequence, system, component, id
+#define MAVLINK_SIGNATURE_SIZE      13
+#define MAVLINK_MAX_PAYLOAD         255
+#define MAVLINK_MAX_FRAME           (MAVLINK_HEADER_SIZE + MAVLINK_MAX_PAYLOAD + 2 + MAVLINK_SIGNATURE_SIZE)
+#define MAVLINK_IFLAG_SIGNED        0x01
+#define MAVLINK_PARAM_ID_LENGTH     16                        // not '\0' terminated when it is 16 characters long
+
+enum mavlinkMessageId {
+  MAVLINK_MSG_HEARTBEAT           = 0,
+  MAVLINK_MSG_SYS_STATUS          = 1,
+  MAVLINK_MSG_PARAM_REQUEST_READ  = 20,
+  MAVLINK_MSG_PARAM_REQUEST_LIST  = 21,
+  MAVLINK_MSG_PARAM_VALUE         = 22,
+  MAVLINK_MSG_PARAM_SET           = 23,
+  MAVLINK_MSG_ATTITUDE            = 30,
+  MAVLINK_MSG_GLOBAL_POSITION_INT = 33,
+  MAVLINK_MSG_RC_CHANNELS         = 65
+};
+
+// some values of the common.xml enums
+#define MAV_TYPE_QUADROTOR          2
+#define MAV_TYPE_HEXAROTOR          13
+#define MAV_TYPE_OCTOROTOR          14
+#define MAV_TYPE_GCS                6
+#define MAV_AUTOPILOT_GENERIC       0
+#define MAV_MODE_FLAG_CUSTOM_MODE_ENABLED   0x01
+#define MAV_MODE_FLAG_STABILIZE_ENABLED     0x10
+#define MAV_MODE_FLAG_SAFETY_ARMED          0x80
+#define MAV_STATE_STANDBY           3
+#define MAV_STATE_ACTIVE            4
+#define MAV_PARAM_TYPE_REAL32       9
+#define MAV_SYS_STATUS_SENSOR_3D_GYRO           0x01
+#define MAV_SYS_STATUS_SENSOR_3D_ACCEL          0x02
+#define MAV_SYS_STATUS_SENSOR_ABSOLUTE_PRESSURE 0x08
+#define MAV_SYS_STATUS_SENSOR_GPS               0x20
+#define MAV_SYS_STATUS_SENSOR_RC_RECEIVER       0x10000
+
+/**
+ * @brief Length of the payload, without the extensions, and CRC_EXTRA of a message.
+ */
+struct mavlinkMessageInfo {
+  uint32_t id;
+  uint8_t length;
+  uint8_t crcExtra;
+};
+
+const mavlinkMessageInfo mavlinkMessages[] = {
+  {MAVLINK_MSG_HEARTBEAT,           9,  50},
+  {MAVLINK_MSG_SYS_STATUS,          31, 124},
+  {MAVLINK_MSG_PARAM_REQUEST_READ,  20, 214},
+  {MAVLINK_MSG_PARAM_REQUEST_LIST,  2,  159},
+  {MAVLINK_MSG_PARAM_VALUE,         25, 220},
+  {MAVLINK_MSG_PARAM_SET,           23, 168},
+  {MAVLINK_MSG_ATTITUDE,            28, 39},
+  {MAVLINK_MSG_GLOBAL_POSITION_INT, 28, 104},
+  {MAVLINK_MSG_RC_CHANNELS,         42, 118}
+};
+
+/**
+ * @brief The payloads, with the fields in the order of the wire (the sizes go down, so there is no padding but at
+ * the end: only the first mavlinkMessageInfo::length bytes are sent).
+ */
+struct mavlinkHeartbeat {
+  uint32_t customMode;                                        // flightMode
+  uint8_t type, autopilot, baseMode, systemStatus, mavlinkVersion;
+};
+
+struct mavlinkSysStatus {
+  uint32_t sensorsPresent, sensorsEnabled, sensorsHealth;     // MAV_SYS_STATUS_SENSOR_*
+  uint16_t load;                                              // (1/1000) of the loop
+  uint16_t voltageBattery;                                    // (mV)
+  int16_t currentBattery;                                     // (cA) -1 unknown
+  uint16_t dropRateComm, errorsComm, errorsCount[4];
+  int8_t batteryRemaining;                                    // (%) -1 unknown
+};
+
+struct mavlinkParamRequestRead {
+  int16_t paramIndex;                                         // -1: use paramId
+  uint8_t targetSystem, targetComponent;
+  char paramId[MAVLINK_PARAM_ID_LENGTH];
+};
+
+struct mavlinkParamRequestList {
+  uint8_t targetSystem, targetComponent;
+};
+
+struct mavlinkParamValue {
+  float paramValue;
+  uint16_t paramCount, paramIndex;
+  char paramId[MAVLINK_PARAM_ID_LENGTH];
+  uint8_t paramType;                                          // MAV_PARAM_TYPE_*
+};
+
+struct mavlinkParamSet {
+  float paramValue;
+  uint8_t targetSystem, targetComponent;
+  char paramId[MAVLINK_PARAM_ID_LENGTH];
+  uint8_t paramType;
+};
+
+struct mavlinkAttitude {
+  uint32_t timeBootMs;
+  float roll, pitch, yaw;                                     // (rad)
+  float rollSpeed, pitchSpeed, yawSpeed;                      // (rad/s)
+};
+
+struct mavlinkGlobalPositionInt {
+  uint32_t timeBootMs;
+  int32_t lat, lon;                                           // (deg * 1e7)
+  int32_t alt, relativeAlt;                                   // (mm) above the sea, above the ground
+  int16_t vx, vy, vz;                                         // (cm/s)
+  uint16_t hdg;                                               // (cdeg) UINT16_MAX unknown
+};
+
+struct mavlinkRCChannels {
+  uint32_t timeBootMs;
+  uint16_t chan[18];                                          // (us) UINT16_MAX unused
+  uint8_t chanCount, rssi;                                    // rssi 255 unknown
+};
+
+static_assert(offsetof(mavlinkSysStatus, batteryRemaining) == 30, "mavlinkSysStatus: wire order");
+static_assert(offsetof(mavlinkParamValue, paramType) == 24, "mavlinkParamValue: wire order");
+static_assert(offsetof(mavlinkParamSet, paramType) == 22, "mavlinkParamSet: wire order");
+static_assert(offsetof(mavlinkRCChannels, rssi) == 41, "mavlinkRCChannels: wire order");
+
+/**
+ * @brief A frame found by mavlinkScan(), pointing inside the scanned buffer.
+ */
+struct mavlinkFrame {
+  uint32_t id;
+  uint8_t sequence, system, component;
+  uint8_t length;                                             // maybe less than the one of the message, see mavlinkDecode()
+  const uint8_t *payload;                                     // NULL if no frame was found
+};
+
+
+/**
+ * @brief Length and CRC_EXTRA of a message.
+ *
+ * @param id
+ * @return const mavlinkMessageInfo* NULL if DroneIno does not know it
+ */
+inline const mavlinkMessageInfo *mavlinkFindMessage(uint32_t id){
+  for(size_t i = 0; i < sizeof(mavlinkMessages) / sizeof(mavlinkMessages[0]); i++)
+    if(mavlinkMessages[i].id == id) return &mavlinkMessages[i];
+  return NULL;
+}
+
+/**
+ * @brief CRC-16/MCRF4XX (the X.25 of MAVLink).
+ *
+ * @param crc 0xFFFF at the start, then the value returned for the previous bytes
+ * @param data
+ * @param size
+ * @return uint16_t
+ */
+inline uint16_t mavlinkCRC(uint16_t crc, const uint8_t *data, size_t size){
+  for(size_t i = 0; i < size; i++){
+    uint8_t t = data[i] ^ (uint8_t)(crc & 0xFF);
+    t ^= t << 4;
+    crc = (crc >> 8) ^ ((uint16_t)t << 8) ^ ((uint16_t)t << 3) ^ (t >> 4);
+  }
+  return crc;
+}
+
+/**
+ * @brief Writes a frame.
+ *
+ * @param frame at least MAVLINK_HEADER_SIZE + the length of the message + 2 bytes
+ * @param sequence
+ * @param system
+ * @param component
+ * @param id see mavlinkMessageId
+ * @param payload the struct of the message
+ * @return size_t the bytes of the frame, 0 if the message is unknown
+ */
+inline size_t mavlinkEncode(uint8_t *frame, uint8_t sequence, uint8_t system, uint8_t component, uint32_t id,
+                            const void *payload){
+
+  const mavlinkMessageInfo *info = mavlinkFindMessage(id);
+  if(info == NULL) return 0;
+
+  // the zeros at the end are not sent, but the first byte always is
+  const uint8_t *bytes = (const uint8_t *)payload;
+  uint8_t length = info->length;
+  while(length > 1 && bytes[length - 1] == 0) length--;
+
+  frame[0] = MAVLINK_STX;
+  frame[1] = length;
+  frame[2] = 0;
+  frame[3] = 0;
+  frame[4] = sequence;
+  frame[5] = system;
+  frame[6] = component;
+  frame[7] = id & 0xFF;
+  frame[8] = (id >> 8) & 0xFF;
+  frame[9] = (id >> 16) & 0xFF;
+  memcpy(frame + MAVLINK_HEADER_SIZE, bytes, length);
+
+  uint16_t crc = mavlinkCRC(0xFFFF, frame + 1, MAVLINK_HEADER_SIZE - 1 + length);
+  crc = mavlinkCRC(crc, &info->crcExtra, 1);
+  frame[MAVLINK_HEADER_SIZE + length] = crc & 0xFF;
+  frame[MAVLINK_HEADER_SIZE + length + 1] = crc >> 8;
+  return MAVLINK_HEADER_SIZE + length + 2;
+}
+
+/**
+ * @brief Looks for the first good frame of a known message in the buffer, as linkScan() does (see
+ * TelemetryLink.h). The frames of the unknown messages are skipped as noise: their CRC_EXTRA is not known, so
+ * they cannot be checked.
+ *
+ * @param buffer
+ * @param size
+ * @param frame the frame found, payload NULL if none
+ * @param errors incremented for every broken frame skipped
+ * @return size_t the bytes read: up to the end of the frame found, or up to the first byte that can still begin one
+ */
+inline size_t mavlinkScan(const uint8_t *buffer, size_t size, mavlinkFrame &frame, uint32_t &errors){
+
+  frame.payload = NULL;
+  size_t i = 0;
+
+  while(i < size){
+    if(buffer[i] != MAVLINK_STX){ i++; continue; }
+    if(i + MAVLINK_HEADER_SIZE > size) return i;             // the header is not complete
+
+    // a false 0xFD of the noise rarely has the id and the length of a known message: it is left at once
+    const uint8_t *header = buffer + i;
+    uint8_t length = header[1];
+    uint32_t id = header[7] | (uint32_t)header[8] << 8 | (uint32_t)header[9] << 16;
+    const mavlinkMessageInfo *info = mavlinkFindMessage(id);
+    if(info == NULL || (header[2] & ~MAVLINK_IFLAG_SIGNED) || length > info->length + 24){ i++; continue; }
+
+    size_t total = MAVLINK_HEADER_SIZE + length + 2 + (header[2] & MAVLINK_IFLAG_SIGNED ? MAVLINK_SIGNATURE_SIZE : 0);
+    if(i + total > size) return i;                           // the frame is not complete
+
+    uint16_t crc = mavlinkCRC(0xFFFF, header + 1, MAVLINK_HEADER_SIZE - 1 + length);
+    crc = mavlinkCRC(crc, &info->crcExtra, 1);
+    if(crc != (header[MAVLINK_HEADER_SIZE + length] | (uint16_t)header[MAVLINK_HEADER_SIZE + length + 1] << 8)){
+      errors++;
+      i++;
+      continue;
+    }
+
+    frame.id = id;
+    frame.sequence = header[4];
+    frame.system = header[5];
+    frame.component = header[6];
+    frame.length = length;
+    frame.payload = header + MAVLINK_HEADER_SIZE;
+    return i + total;
+  }
+  return i;
+}
+
+/**
+ * @brief Copies the payload of a frame into the struct of its message, with the zeros cut away by the sender.
+ *
+ * @param frame
+ * @param payload
+ * @param size sizeof the struct
+ */
+inline void mavlinkDecode(const mavlinkFrame &frame, void *payload, size_t size){
+  memset(payload, 0, size);
+  memcpy(payload, frame.payload, frame.length < size ? frame.length : size);
+}
+
+/**
+ * @brief Writes a name in the id of a parameter: zero filled, without the '\0' when it is 16 characters long.
+ *
+ * @param paramId
+ * @param name
+ */
+inline void mavlinkSetParamId(char *paramId, const char *name){
+  memset(paramId, 0, MAVLINK_PARAM_ID_LENGTH);
+  memcpy(paramId, name, strnlen(name, MAVLINK_PARAM_ID_LENGTH));
+}
+
+#endif /* MAVLINK_H */
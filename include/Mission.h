@@ -0,0 +1,300 @@
+/**
+ * @file Mission.h
+ * @author @sebastiano123-c
+ * @brief Waypoint missions: the list on the flash, the task that flies it and the reference of the GPS controller.
+ *
+ * The waypoints are saved in the NVS as one blob, like the parameters (see Parameters.h):
+ *
+ *          magic | version | count | checksum || waypoint 0 | waypoint 1 | ... | waypoint count-1
+ *
+ * setMission() checks and saves a new list, with the motors off only; loadMission() reads it at the start, and a
+ * blob that is not valid gives no mission. With a mission, SWC DOWN is flight mode 4 instead of the GPS hold.
+ *
+ * The mission runs in a task on core 0, at the rate of the GPS, and never waits for the loop:
+ *  @li at every fix readGPS() publishes the position in one of the two missionFixes (publishMissionFix());
+ *  @li the task takes the last fix, moves the reference along the legs (see MissionPath.h) and publishes it in one
+ *      of the two missionSetpoints;
+ *  @li at every GPS sample of the loop (50Hz, see readGPS()) updateMissionWaypoint() takes the last setpoint, moves
+ *      it by its velocity for the time since its fix, and gives it to the GPS controller as the waypoint.
+ * The loop copies the setpoint only in flight mode 4, and the flight recorder saves the copy, so that a replay
+ * reads the same references (see FlightRecorder.h).
+ *
+ * The return to home of the failsafe (flight mode 5, see Failsafe.h) is flown the same way, as a mission with only
+ * one waypoint: the home, at FAILSAFE_RTH_SPEED.
+ *
+ * @version 0.1
+ * @date 2022-06-24
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#define MISSION_MAGIC               0x5353494d                // "MISS"
+#define MISSION_VERSION             1
+#define MISSION_NAMESPACE           "mission"
+#define MISSION_KEY                 "blob"
+#define MISSION_MAX_SPEED           10.0f                     // (m/s) of a leg
+#define MISSION_MAX_RADIUS          50.0f                     // (m) acceptance radius
+#define MISSION_SAMPLE_PERIOD       0.02f                     // (s) between two GPS samples of the loop
+#define MISSION_MAX_EXTRAPOLATION   0.5f                      // (s) a setpoint older than this is not moved anymore
+
+struct missionBlob {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;                                             // waypoints saved
+  uint32_t checksum;                                          // of the waypoints
+  missionWaypoint waypoints[MISSION_MAX_WAYPOINTS];
+};
+
+
+/**
+ * @brief Checks a list of waypoints.
+ *
+ * @param waypoints
+ * @param count
+ * @return true if they can be flown
+ */
+bool validMission(const missionWaypoint *waypoints, int count){
+
+  if(count < 0 || count > MISSION_MAX_WAYPOINTS || (count > 0 && waypoints == NULL)) return false;
+
+  for(int i = 0; i < count; i++){
+    const missionWaypoint &w = waypoints[i];
+    if(w.latitude < -90000000L || w.latitude > 90000000L || w.longitude < -180000000L || w.longitude > 180000000L) return false;
+    if(!(w.radius >= 0.0f && w.radius <= MISSION_MAX_RADIUS)) return false;    // NaN too
+    if(!(w.speed >= 0.0f && w.speed <= MISSION_MAX_SPEED)) return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Reads the mission saved on the flash. Call it in setup(), before initMissionTask().
+ */
+void loadMission(){
+
+  missionBlob blob;
+  const size_t header = sizeof(blob) - sizeof(blob.waypoints);
+  missionCount = 0;
+
+  preferences.begin(MISSION_NAMESPACE, true);
+  size_t length = preferences.getBytes(MISSION_KEY, &blob, sizeof(blob));
+  preferences.end();
+
+  int count = length >= header ? blob.count : 0;
+  if(length < header || blob.magic != MISSION_MAGIC || blob.version != MISSION_VERSION ||
+     count > MISSION_MAX_WAYPOINTS || length != header + count * sizeof(missionWaypoint) ||
+     blob.checksum != parametersChecksum((const uint32_t *)blob.waypoints, count * sizeof(missionWaypoint) / sizeof(uint32_t)) ||
+     !validMission(blob.waypoints, count)){
+
+    #if DEBUG
+      if(length > 0) Serial.println("loadMission: the saved mission is not valid");
+    #endif
+    return;
+  }
+
+  memcpy(missionWaypoints, blob.waypoints, count * sizeof(missionWaypoint));
+  missionCount = count;
+
+  #if DEBUG
+    Serial.printf("loadMission: %i waypoints\n", count);
+  #endif
+}
+
+/**
+ * @brief Saves a new mission on the flash, replacing the old one. Only with the motors off: writing the flash stops
+ * both the cores, and the task must not fly the old list while it changes.
+ *
+ * @param waypoints
+ * @param count 0 deletes the mission
+ * @return true if the mission was saved
+ */
+bool setMission(const missionWaypoint *waypoints, int count){
+
+  if(start != 0 || !validMission(waypoints, count)) return false;
+
+  missionBlob blob;
+  const size_t length = sizeof(blob) - sizeof(blob.waypoints) + count * sizeof(missionWaypoint);
+  blob.magic = MISSION_MAGIC;
+  blob.version = MISSION_VERSION;
+  blob.count = count;
+  if(count > 0) memcpy(blob.waypoints, waypoints, count * sizeof(missionWaypoint));
+  blob.checksum = parametersChecksum((const uint32_t *)blob.waypoints, count * sizeof(missionWaypoint) / sizeof(uint32_t));
+
+  preferences.begin(MISSION_NAMESPACE, false);
+  bool written = preferences.putBytes(MISSION_KEY, &blob, length) == length;
+  preferences.end();
+
+  if(written){
+    if(count > 0) memcpy(missionWaypoints, waypoints, count * sizeof(missionWaypoint));
+    missionCount = count;
+  }
+
+  #if DEBUG
+    Serial.println(written ? "setMission: saved" : "setMission: the flash cannot be written");
+  #endif
+  return written;
+}
+
+/**
+ * @brief Publishes the fix just read, for the mission task. Call it in readGPS(), after calculateLatLonGPSGA().
+ */
+void publishMissionFix(){
+
+  missionFix fix;
+  fix.latitude = latNorth ? latActualGPS : -latActualGPS;
+  fix.longitude = lonEast ? lonActualGPS : -lonActualGPS;
+  fix.time = millis();
+  fix.sample = missionSamples;
+  fix.engagement = missionEngaged != 0 && start == 2 ? missionEngagement : 0;
+  fix.route = missionEngaged;
+
+  uint32_t sequence = missionFixSequence.load(std::memory_order_relaxed) + 1;
+  missionFixes[sequence & 1] = fix;
+  missionFixSequence.store(sequence, std::memory_order_release);
+}
+
+/**
+ * @brief Takes the last fix published by the loop (mission task).
+ *
+ * @param fix
+ * @param taken sequence of the last fix taken, updated
+ * @return true if there is a new fix
+ */
+bool takeMissionFix(missionFix &fix, uint32_t &taken){
+
+  uint32_t sequence = missionFixSequence.load(std::memory_order_acquire);
+  if(sequence == taken) return false;
+
+  fix = missionFixes[sequence & 1];
+
+  // the loop published while copying, thus the copy can be mixed: take the new one next time
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(missionFixSequence.load(std::memory_order_relaxed) != sequence) return false;
+
+  taken = sequence;
+  return true;
+}
+
+/**
+ * @brief Publishes the reference of the mission (mission task).
+ *
+ * @param setpoint
+ */
+void publishMissionSetpoint(const missionSetpoint &setpoint){
+  uint32_t sequence = missionSetpointSequence.load(std::memory_order_relaxed) + 1;
+  missionSetpoints[sequence & 1] = setpoint;
+  missionSetpointSequence.store(sequence, std::memory_order_release);
+}
+
+/**
+ * @brief Copies the last reference published by the task in missionTarget, and traces it. A copy mixed by a new
+ * publication is discarded, and missionTarget keeps the previous one.
+ */
+void takeMissionSetpoint(){
+
+  uint32_t sequence = missionSetpointSequence.load(std::memory_order_acquire);
+  missionSetpoint setpoint = missionSetpoints[sequence & 1];
+
+  // the task published while copying, thus the copy can be mixed: keep the previous one
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(missionSetpointSequence.load(std::memory_order_relaxed) == sequence) missionTarget = setpoint;
+
+  traceInput(TRACE_MISSION, &missionTarget, sizeof(missionTarget));                        // see FlightRecorder.h
+}
+
+/**
+ * @brief Gives the reference of the mission to the GPS controller. Call it at every GPS sample, before the errors
+ * of calculatePIDFromGPS() are computed: it counts the samples also outside the flight modes 4 and 5.
+ */
+void updateMissionWaypoint(){
+
+  missionSamples++;
+
+  if(flightMode != 4 && flightMode != 5){
+    missionEngaged = 0;
+    missionVelocityNorth = missionVelocityEast = 0.0f;
+    return;
+  }
+  if(missionEngaged != flightMode){                           // a new route starts from where the drone is
+    missionEngaged = flightMode;
+    if(++missionEngagement == 0) missionEngagement = 1;
+  }
+
+  takeMissionSetpoint();
+
+  // until the task has seen a fix of this mission, hold the position
+  if(waypointGPS != 1 || missionTarget.engagement != missionEngagement){
+    missionVelocityNorth = missionVelocityEast = 0.0f;
+    return;
+  }
+
+  float elapsed = (float)(missionSamples - missionTarget.sample) * MISSION_SAMPLE_PERIOD;
+  if(elapsed > MISSION_MAX_EXTRAPOLATION) elapsed = MISSION_MAX_EXTRAPOLATION;
+
+  int32_t latitude = missionTarget.latitude + (int32_t)lroundf(missionTarget.velocity[0] * elapsed / MICRODEGREE_TO_METERS);
+  int32_t longitude = missionTarget.longitude +
+                      (int32_t)lroundf(missionTarget.velocity[1] * elapsed / (MICRODEGREE_TO_METERS * missionTarget.cosLatitude));
+
+  longLatWaypoint = latitude;
+  longLonWaypoint = longitude;
+  missionVelocityNorth = missionTarget.velocity[0];
+  missionVelocityEast = missionTarget.velocity[1];
+}
+
+/**
+ * @brief Background task: moves the reference of the mission at every fix of the GPS.
+ *
+ * @param parameter not used
+ */
+void missionTask(void *parameter){
+
+  (void)parameter;
+  missionFix fix;
+  missionSetpoint setpoint;
+  uint32_t taken = 0, lastTime = 0;
+  uint8_t engagement = 0;
+
+  for(;;){
+    if(takeMissionFix(fix, taken)){
+      memset(&setpoint, 0, sizeof(setpoint));
+
+      if(fix.engagement == 0) engagement = 0;                 // not flying the mission
+
+      else if(fix.engagement != engagement){                  // a new mission, from this fix
+        engagement = fix.engagement;
+        if(fix.route == 5)                                    // home, taken before the start of the motors
+          startMissionPath(missionRoute, &failsafeHome, 1, fix.latitude, fix.longitude,
+                           FAILSAFE_RTH_SPEED, MISSION_ACCEPTANCE_RADIUS, MISSION_ACCELERATION, MISSION_LEASH);
+        else
+          startMissionPath(missionRoute, missionWaypoints, missionCount, fix.latitude, fix.longitude,
+                           MISSION_CRUISE_SPEED, MISSION_ACCEPTANCE_RADIUS, MISSION_ACCELERATION, MISSION_LEASH);
+      }
+      else {
+        float drone[2], dt = (float)(fix.time - lastTime) / 1000.0f;
+        if(dt > 1.0f) dt = 1.0f;                              // e.g. some fixes lost
+        missionLocalPosition(fix.latitude, fix.longitude, missionRoute.origin, missionRoute.cosLatitude, drone);
+        if(dt > 0.0f) stepMissionPath(missionRoute, drone, dt);
+      }
+
+      if(engagement != 0) missionPathSetpoint(missionRoute, setpoint);
+      setpoint.sample = fix.sample;
+      setpoint.engagement = engagement;
+      publishMissionSetpoint(setpoint);
+      lastTime = fix.time;
+    }
+
+    vTaskDelay(MISSION_POLL_PERIOD / portTICK_PERIOD_MS);
+  }
+}
+
+/**
+ * @brief Starts the mission task on core 0. Call it after loadMission().
+ */
+void initMissionTask(){
+  missionFixSequence.store(0);
+  missionSetpointSequence.store(0);
+  memset(&missionTarget, 0, sizeof(missionTarget));
+
+  xTaskCreatePinnedToCore(missionTask, "mission", 3072, NULL, 1, &missionTaskHandle, 0);
+  diagnosticsWatchTask(missionTaskHandle, "mission");                                     // see Diagnostics.h
+}
@@ -0,0 +1,243 @@
+/**
+ * @file MissionPath.h
+ * @author @sebastiano123-c
+ * @brief Waypoints of a mission and the reference that flies them, as a smooth velocity.
+ *
+ * A mission is a list of missionWaypoint: the drone flies to each of them in order, at the cruise speed of the leg,
+ * and the leg ends when the drone is within the acceptance radius of its waypoint (and the reference, below, is on
+ * it). After the last one the drone holds that position.
+ *
+ * The mission does not give the waypoints to the GPS controller: it moves a reference point along the legs and the
+ * controller follows the reference. At every GPS fix stepMissionPath() moves the reference by a velocity that
+ *  @li points to the waypoint, and is at most the cruise speed of the leg;
+ *  @li brakes on the waypoint: the speed is at most sqrt(v^2 + 2 a d), d being the distance from the waypoint and v
+ *      the speed of the corner (0 on the last waypoint, slower on the sharper turns);
+ *  @li changes by MISSION_ACCELERATION per second at most, direction included, so that also a new leg starts
+ *      smoothly;
+ *  @li brakes when the drone is farther than MISSION_LEASH from the reference (e.g. with head wind), to stop at
+ *      twice that distance: the reference never runs away from the drone.
+ *
+ * The positions are in meters, north and east of the origin, the point where the mission started: over some km the
+ * flat earth is good enough, and the cosine of the latitude is computed once.
+ *
+ * These routines do not depend on the board, so they can be used in the host programs of the /test dir.
+ *
+ * @version 0.1
+ * @date 2022-06-24
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cmath>
+#include <stdint.h>
+
+#ifndef MISSION_PATH_H
+#define MISSION_PATH_H
+
+#define MICRODEGREE_TO_METERS       0.111195f                 // (m) of a 1e-6 deg of latitude
+#define MISSION_MAX_WAYPOINTS       32                        // of a mission
+
+/**
+ * @brief A waypoint, as saved on the flash.
+ */
+struct missionWaypoint {
+  int32_t latitude, longitude;      // (deg * 1e6) negative south and west
+  float radius;                     // (m) acceptance radius, 0 for the default one
+  float speed;                      // (m/s) cruise speed of the leg to this waypoint, 0 for the default one
+};
+
+/**
+ * @brief What the mission is doing.
+ */
+enum missionState {
+  MISSION_IDLE,                     // not started
+  MISSION_FLYING,                   // flying to the waypoint "leg"
+  MISSION_DONE                      // holding the last waypoint
+};
+
+/**
+ * @brief The reference of the GPS controller, published at every fix (see Mission.h).
+ */
+struct missionSetpoint {
+  int32_t latitude, longitude;      // (deg * 1e6) of the reference, negative south and west
+  float velocity[2];                // (m/s) north and east
+  float cosLatitude;                // of the origin, to move the reference between two fixes
+  uint32_t sample;                  // GPS sample of the fix it comes from
+  uint8_t engagement;               // of the fix, 0 if the mission was not flying
+  uint8_t leg;                      // waypoint flown to
+  uint8_t state;                    // missionState
+  uint8_t reserved;
+};
+
+/**
+ * @brief The reference flying a mission.
+ */
+struct missionPath {
+  int count;                        // waypoints
+  float waypoint[MISSION_MAX_WAYPOINTS][2];                   // (m) north and east from the origin
+  float radius[MISSION_MAX_WAYPOINTS];                        // (m)
+  float speed[MISSION_MAX_WAYPOINTS];                         // (m/s)
+  float corner[MISSION_MAX_WAYPOINTS];                        // (m/s) speed of the reference on the waypoint
+  int32_t origin[2];                                          // (deg * 1e6) latitude and longitude
+  float cosLatitude;
+  float acceleration, leash;                                  // (m/s^2), (m)
+  float reference[2];                                         // (m) north and east
+  float velocity[2];                                          // (m/s)
+  int leg;
+  missionState state;
+};
+
+/**
+ * @brief (m) north and east of a point from an origin.
+ *
+ * @param latitude (deg * 1e6)
+ * @param longitude (deg * 1e6)
+ * @param origin (deg * 1e6) latitude and longitude
+ * @param cosLatitude of the origin
+ * @param position (m) north and east
+ */
+inline void missionLocalPosition(int32_t latitude, int32_t longitude, const int32_t origin[2], float cosLatitude,
+                                 float position[2]){
+  position[0] = (float)(latitude - origin[0]) * MICRODEGREE_TO_METERS;
+  position[1] = (float)(longitude - origin[1]) * MICRODEGREE_TO_METERS * cosLatitude;
+}
+
+/**
+ * @brief Starts a mission from the position of the drone: the reference is on the drone, still.
+ *
+ * @param path
+ * @param waypoints
+ * @param count
+ * @param latitude (deg * 1e6) of the drone
+ * @param longitude (deg * 1e6) of the drone
+ * @param cruiseSpeed (m/s) of the legs without a speed
+ * @param radius (m) of the waypoints without a radius
+ * @param acceleration (m/s^2)
+ * @param leash (m)
+ */
+inline void startMissionPath(missionPath &path, const missionWaypoint *waypoints, int count,
+                             int32_t latitude, int32_t longitude, float cruiseSpeed, float radius,
+                             float acceleration, float leash){
+
+  path.count = count < MISSION_MAX_WAYPOINTS ? count : MISSION_MAX_WAYPOINTS;
+  path.origin[0] = latitude;
+  path.origin[1] = longitude;
+  path.cosLatitude = cosf((float)latitude * 1e-6f * (float)M_PI / 180.0f);
+  path.acceleration = acceleration;
+  path.leash = leash;
+
+  for(int i = 0; i < path.count; i++){
+    missionLocalPosition(waypoints[i].latitude, waypoints[i].longitude, path.origin, path.cosLatitude, path.waypoint[i]);
+    path.radius[i] = waypoints[i].radius > 0.0f ? waypoints[i].radius : radius;
+    path.speed[i] = waypoints[i].speed > 0.0f ? waypoints[i].speed : cruiseSpeed;
+  }
+
+  // the speed on a waypoint: the cosine of the turn times the speed of the next leg (0 when turning back)
+  for(int i = 0; i < path.count; i++){
+    path.corner[i] = 0.0f;
+    if(i + 1 >= path.count) continue;
+
+    float previous[2] = {0.0f, 0.0f};
+    if(i > 0){ previous[0] = path.waypoint[i - 1][0]; previous[1] = path.waypoint[i - 1][1]; }
+    float in[2] = {path.waypoint[i][0] - previous[0], path.waypoint[i][1] - previous[1]};
+    float out[2] = {path.waypoint[i + 1][0] - path.waypoint[i][0], path.waypoint[i + 1][1] - path.waypoint[i][1]};
+    float lengths = sqrtf(in[0] * in[0] + in[1] * in[1]) * sqrtf(out[0] * out[0] + out[1] * out[1]);
+    if(lengths < 1e-3f) continue;
+
+    float turn = (in[0] * out[0] + in[1] * out[1]) / lengths;
+    if(turn > 0.0f) path.corner[i] = turn * fminf(path.speed[i], path.speed[i + 1]);
+  }
+
+  path.reference[0] = path.reference[1] = 0.0f;
+  path.velocity[0] = path.velocity[1] = 0.0f;
+  path.leg = 0;
+  path.state = path.count > 0 ? MISSION_FLYING : MISSION_DONE;
+}
+
+/**
+ * @brief Moves the reference, at a new fix of the GPS.
+ *
+ * @param path
+ * @param drone (m) north and east of the drone
+ * @param dt (s) from the previous fix
+ */
+inline void stepMissionPath(missionPath &path, const float drone[2], float dt){
+
+  if(path.state != MISSION_FLYING){
+    path.velocity[0] = path.velocity[1] = 0.0f;
+    return;
+  }
+
+  const float *target = path.waypoint[path.leg];
+  float toTarget[2] = {target[0] - path.reference[0], target[1] - path.reference[1]};
+  float distance = sqrtf(toTarget[0] * toTarget[0] + toTarget[1] * toTarget[1]);
+  float now = sqrtf(path.velocity[0] * path.velocity[0] + path.velocity[1] * path.velocity[1]);
+  float limit = path.acceleration * dt;
+
+  // the leg ends when the reference is on the waypoint and the drone is close to it
+  float dn = target[0] - drone[0], de = target[1] - drone[1];
+  if(distance <= fmaxf(0.05f, now * dt) && dn * dn + de * de <= path.radius[path.leg] * path.radius[path.leg]){
+
+    if(path.leg + 1 < path.count){
+      target = path.waypoint[++path.leg];
+      toTarget[0] = target[0] - path.reference[0];
+      toTarget[1] = target[1] - path.reference[1];
+      distance = sqrtf(toTarget[0] * toTarget[0] + toTarget[1] * toTarget[1]);
+    }
+    else if(now <= limit){
+      path.state = MISSION_DONE;                              // hold the last waypoint
+      path.reference[0] = target[0];
+      path.reference[1] = target[1];
+      path.velocity[0] = path.velocity[1] = 0.0f;
+      return;
+    }
+  }
+
+  // the speed asked on the leg: cruise, braking on the waypoint, waiting for the drone
+  float corner = path.corner[path.leg];
+  float speed = fminf(path.speed[path.leg], sqrtf(corner * corner + 2.0f * path.acceleration * distance));
+  speed = fminf(speed, distance / dt);                        // never beyond the waypoint
+
+  float lead = sqrtf((path.reference[0] - drone[0]) * (path.reference[0] - drone[0]) +
+                     (path.reference[1] - drone[1]) * (path.reference[1] - drone[1]));
+  if(lead > path.leash)                                       // brake to stop at twice the leash
+    speed = fminf(speed, sqrtf(2.0f * path.acceleration * fmaxf(0.0f, 2.0f * path.leash - lead)));
+
+  float wanted[2] = {0.0f, 0.0f};
+  if(distance > 1e-3f){
+    wanted[0] = toTarget[0] / distance * speed;
+    wanted[1] = toTarget[1] / distance * speed;
+  }
+
+  // the velocity changes smoothly, also turning
+  float change[2] = {wanted[0] - path.velocity[0], wanted[1] - path.velocity[1]};
+  float size = sqrtf(change[0] * change[0] + change[1] * change[1]);
+  if(size > limit){
+    change[0] *= limit / size;
+    change[1] *= limit / size;
+  }
+  path.velocity[0] += change[0];
+  path.velocity[1] += change[1];
+
+  path.reference[0] += path.velocity[0] * dt;
+  path.reference[1] += path.velocity[1] * dt;
+}
+
+/**
+ * @brief The reference of the path, for the GPS controller.
+ *
+ * @param path
+ * @param setpoint
+ */
+inline void missionPathSetpoint(const missionPath &path, missionSetpoint &setpoint){
+  setpoint.latitude = path.origin[0] + (int32_t)lroundf(path.reference[0] / MICRODEGREE_TO_METERS);
+  setpoint.longitude = path.origin[1] + (int32_t)lroundf(path.reference[1] / (MICRODEGREE_TO_METERS * path.cosLatitude));
+  setpoint.velocity[0] = path.velocity[0];
+  setpoint.velocity[1] = path.velocity[1];
+  setpoint.cosLatitude = path.cosLatitude;
+  setpoint.leg = (uint8_t)path.leg;
+  setpoint.state = (uint8_t)path.state;
+  setpoint.reserved = 0;
+}
+
+#endif /* MISSION_PATH_H */
@@ -0,0 +1,115 @@
+/**
+ * @file Mixer.h
+ * @author @sebastiano123-c
+ * @brief Table-driven motor mixer with desaturation.
+ *
+ * Every frame type is a table with one row per motor, and the columns are the factors of the roll, pitch and
+ * yaw PID outputs: the pulse of the motor i is
+ *
+ *          pulse[i] = throttle + table[i][0] * roll + table[i][1] * pitch + table[i][2] * yaw.
+ *
+ * Motors are numbered clockwise starting from the front-right one; positive roll raises the right motors,
+ * positive pitch the rear motors and positive yaw the CW motors (as the original quad X mixer of ESC.h).
+ *
+ * Clamping each motor on its own changes the ratio between roll, pitch and yaw when a motor saturates.
+ * mixMotors() desaturates instead:
+ *  @li if the corrections do not fit in the pulse range, they are all scaled by the same factor;
+ *  @li the throttle is lowered until the highest motor fits;
+ *  @li with airmode the throttle is also raised until the lowest motor fits, so the drone keeps its authority
+ *      at zero throttle.
+ *
+ * These routines do not depend on the board, so they can be used in the host programs of the /test dir.
+ *
+ * @version 0.1
+ * @date 2022-06-15
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdint.h>
+
+#ifndef MIXER_H
+#define MIXER_H
+
+//                                    roll      pitch     yaw
+static const float quadXMixer[4][3] = {
+                                    {  1.0f,    -1.0f,    -1.0f },     // front-right, CCW
+                                    {  1.0f,     1.0f,     1.0f },     // rear-right, CW
+                                    { -1.0f,     1.0f,    -1.0f },     // rear-left, CCW
+                                    { -1.0f,    -1.0f,     1.0f }      // front-left, CW
+                                  };
+
+static const float quadPlusMixer[4][3] = {
+                                    {  0.0f,    -1.0f,    -1.0f },     // front, CCW
+                                    {  1.0f,     0.0f,     1.0f },     // right, CW
+                                    {  0.0f,     1.0f,    -1.0f },     // rear, CCW
+                                    { -1.0f,     0.0f,     1.0f }      // left, CW
+                                  };
+
+static const float hexXMixer[6][3] = {
+                                    {  0.5f,    -0.866f,  -1.0f },     // front-right, CCW
+                                    {  1.0f,     0.0f,     1.0f },     // right, CW
+                                    {  0.5f,     0.866f,  -1.0f },     // rear-right, CCW
+                                    { -0.5f,     0.866f,   1.0f },     // rear-left, CW
+                                    { -1.0f,     0.0f,    -1.0f },     // left, CCW
+                                    { -0.5f,    -0.866f,   1.0f }      // front-left, CW
+                                  };
+
+static const float octoXMixer[8][3] = {
+                                    {  0.414f,  -1.0f,    -1.0f },     // front-right, CCW
+                                    {  1.0f,    -0.414f,   1.0f },     // right-front, CW
+                                    {  1.0f,     0.414f,  -1.0f },     // right-rear, CCW
+                                    {  0.414f,   1.0f,     1.0f },     // rear-right, CW
+                                    { -0.414f,   1.0f,    -1.0f },     // rear-left, CCW
+                                    { -1.0f,     0.414f,   1.0f },     // left-rear, CW
+                                    { -1.0f,    -0.414f,  -1.0f },     // left-front, CCW
+                                    { -0.414f,  -1.0f,     1.0f }      // front-left, CW
+                                  };
+
+
+/**
+ * @brief Mixes throttle and PID outputs into the motor pulses.
+ *
+ * @param table mixer table of the frame
+ * @param motors number of rows of the table
+ * @param throttle (us) throttle pulse
+ * @param roll roll PID output
+ * @param pitch pitch PID output
+ * @param yaw yaw PID output
+ * @param minPulse (us) lowest pulse of a running motor
+ * @param maxPulse (us) highest pulse
+ * @param airmode true to raise the throttle when the lowest motor saturates
+ * @param output (us) motor pulses, one for each row of the table
+ */
+inline void mixMotors(const float (*table)[3], int motors, float throttle, float roll, float pitch, float yaw,
+                      float minPulse, float maxPulse, bool airmode, float *output){
+
+  float lowest = 0.0f, highest = 0.0f;
+
+  for(int i = 0; i < motors; i++){
+    output[i] = table[i][0] * roll + table[i][1] * pitch + table[i][2] * yaw;
+    if(i == 0 || output[i] < lowest) lowest = output[i];
+    if(i == 0 || output[i] > highest) highest = output[i];
+  }
+
+  // keep the ratio of the corrections
+  float range = highest - lowest;
+  if(range > maxPulse - minPulse){
+    float scale = (maxPulse - minPulse) / range;
+    for(int i = 0; i < motors; i++) output[i] *= scale;
+    lowest *= scale;
+    highest *= scale;
+  }
+
+  // move the throttle to fit the corrections
+  if(throttle + highest > maxPulse) throttle = maxPulse - highest;
+  if(airmode && throttle + lowest < minPulse) throttle = minPulse - lowest;
+
+  for(int i = 0; i < motors; i++){
+    output[i] += throttle;
+    if(output[i] < minPulse) output[i] = minPulse;
+    else if(output[i] > maxPulse) output[i] = maxPulse;
+  }
+}
+
+#endif /* MIXER_H */
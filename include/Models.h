@@ -21,6 +21,11 @@
   #include "pinmaps/pinmap.ESP32.h"
 #endif
 
+// the WiFi driver owns the ADC2: every reading of the battery would fail and the drone would never start
+#if defined(PIN_BATTERY_ADC_UNIT) && PIN_BATTERY_ADC_UNIT == 2 && WIFI_TELEMETRY == NATIVE
+  #error "PIN_BATTERY_LEVEL: the ADC2 cannot be read with WIFI_TELEMETRY NATIVE, move the battery to an ADC1 pin (GPIO 32-39)"
+#endif
+
 // GYROSCOPE SENSOR
 #if GYROSCOPE == MPU6050
   #include "sensors/gyroscope.MPU6050.h"
@@ -28,14 +33,15 @@
 
 // ALTITUDE SENSOR
 #if ALTITUDE_SENSOR == BMP280
-  #include "sensors\altitude_sensor.BMP280.h"
+  #include "sensors/altitude_sensor.BMP280.h"
 #elif ALTITUDE_SENSOR == BME280
-  #include "sensors\altitude_sensor.BME280.h"
+  #include "sensors/altitude_sensor.BME280.h"
 #endif
+#include "AltitudeEstimator.h"
 
 // PROXIMITY SENSOR
 #if PROXIMITY_SENSOR == HCSR04
-  #include <HCSR04.h>
+  #include "sensors/proximity_sensor.HCSR04.h"
 #endif
 
 // SERIAL
@@ -44,7 +50,9 @@
 #endif
 
 // WIFI TELEMETRY
-#if UPLOADED_SKETCH == FLIGHT_CONTROLLER && WIFI_TELEMETRY == ESP_CAM
+#include "TelemetryLink.h"
+#include "MAVLink.h"
+#if UPLOADED_SKETCH == FLIGHT_CONTROLLER && (WIFI_TELEMETRY == ESP_CAM || WIFI_TELEMETRY == MAVLINK)
   #include "wifi/wifi_telemetry.esp_cam.h"
 #elif UPLOADED_SKETCH == FLIGHT_CONTROLLER && WIFI_TELEMETRY == NATIVE
   #include "wifi/wifi_telemetry.native.h"
@@ -57,6 +65,26 @@
 #if GPS == BN_880
   #include "sensors/gps.BN_880.h"
 #endif
+#include "MissionPath.h"
+
+
+/**
+ *  COMPASS
+ */
+#if COMPASS == HMC5883L
+  #include "sensors/compass.HMC5883L.h"
+#elif COMPASS == QMC5883L
+  #include "sensors/compass.QMC5883L.h"
+#endif
+#include "CompassFit.h"
+
+
+/**
+ *  BATTERY
+ */
+#include "driver/adc.h"
+#include "esp_adc_cal.h"
+#include "ThrustCurve.h"
 
 
 /**
@@ -67,10 +95,39 @@
    #include "soc/mcpwm_reg.h"
    #include "soc/mcpwm_struct.h"
 #endif
+#ifdef MOTOR_PULSE_BY_DSHOT
+   #include "driver/rmt.h"
+   #include "DShotFrame.h"
+#endif
+#ifdef MOTOR_PULSE_BY_ONESHOT
+   #include "driver/rmt.h"
+   #include "OneShotPulse.h"
+#endif
+
+/**
+ *  FLIGHT RECORDER
+ */
+#include "FlightTrace.h"
+
+/**
+ *  MIXER
+ */
+#include "Mixer.h"
+#if FRAME_TYPE == QUAD_X
+   #define MIXER_TABLE  quadXMixer
+   #define MIXER_MOTORS 4
+#elif FRAME_TYPE == QUAD_PLUS
+   #define MIXER_TABLE  quadPlusMixer
+   #define MIXER_MOTORS 4
+#else
+   #error "FRAME_TYPE: only four ESC outputs are available, use QUAD_X or QUAD_PLUS"
+#endif
 
 /**
  *  AUTOTUNE PID 
  */
+#include "NeuralNetwork.h"
+#include <atomic>
 #if AUTOTUNE_PID_GYROSCOPE == true
   #include <stdio.h>
   #include <stdlib.h>
@@ -0,0 +1,287 @@
+/**
+ * @file NeuralNetwork.h
+ * @author @sebastiano123-c
+ * @brief Back propagation neural networks stored in a single block of floats.
+ *
+ * A network is an arena, i.e. an array of networkFloats() floats, and a networkLayout with the offsets of every
+ * array inside it. An arena can also hold a batch of networks with the same structure (e.g. one for each axis):
+ * then every float of a single network becomes layout.batch consecutive floats, one for each network, so the same
+ * loops propagate the whole batch and the inner one runs over the networks. The arena is ordered as
+ *
+ *          bias | weights | delta bias | delta weights || a | z | delta
+ *
+ * the first layout.parameters floats are everything the network learns (with the momentum of the increments), so
+ * the network can be copied, saved or restored with a single memcpy(); the rest holds the states of the last
+ * propagation. The weights from the layer l-1 to the layer l are a size[l-1] x size[l] matrix, row by row, so that
+ * both propagations walk the arena linearly and never take memory from the heap.
+ *
+ * The propagations follow lib/BPNN/BPNN.h:
+ *  @li networkForward(): z = a_prev * W + b, a = f(z) for each layer;
+ *  @li networkBackward(): the output error a - y is propagated backwards and the "online" learning updates
+ *      deltaW = momentumFactor * deltaW + learningRate * a_prev * delta, then W -= deltaW (same for b).
+ * The derivatives of the activation functions are taken from the outputs a of the forward propagation whenever
+ * possible (f' = 1 - a^2 for tanh), so that the back propagation computes few exponentials. The increments
+ * smaller than NETWORK_TINY are zeroed: when an input stays 0 (e.g. the set point in hover) the momentum would take
+ * them down to the denormal floats, which are much slower.
+ *
+ * These routines do not depend on the board, so they can be used in the host programs of the /test dir.
+ *
+ * @version 0.1
+ * @date 2022-06-21
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <math.h>
+#include <string.h>
+
+#ifndef NEURAL_NETWORK_H
+#define NEURAL_NETWORK_H
+
+#define NETWORK_MAX_LAYERS          4
+#define NETWORK_MAX_BATCH           4
+#define NETWORK_TINY                1e-30f                  // smaller increments are zeroed, see networkBackward()
+
+enum networkActivation {
+  ACTIVATION_LOGISTIC,              // also "sigmoid", the default
+  ACTIVATION_RELU,
+  ACTIVATION_PRELU,
+  ACTIVATION_ELU,
+  ACTIVATION_IDENTITY,
+  ACTIVATION_SOFTPLUS,
+  ACTIVATION_TANH
+};
+
+/**
+ * @brief Offsets (in floats) of the arrays of a network inside its arena. The arrays of the layer l are at index
+ * l, being 0 the input layer, which has only a. The element k of the network b of the batch is at offset + k * batch + b.
+ */
+struct networkLayout {
+  int layers;
+  int batch;                        // networks in the arena
+  int size[NETWORK_MAX_LAYERS];
+  networkActivation activation[NETWORK_MAX_LAYERS];
+  int bias[NETWORK_MAX_LAYERS], weights[NETWORK_MAX_LAYERS];
+  int deltaBias[NETWORK_MAX_LAYERS], deltaWeights[NETWORK_MAX_LAYERS];
+  int a[NETWORK_MAX_LAYERS], z[NETWORK_MAX_LAYERS], delta[NETWORK_MAX_LAYERS];
+  int parameters;                   // floats learnt by the networks, at the beginning of the arena
+  int floats;                       // size of the arena
+};
+
+/**
+ * @brief Size of the arena of a network, to declare it at compile time (multiply it by the batch).
+ *
+ * @param size neurons of each layer, e.g. {n_in, n_h1, ..., n_out}
+ * @param layers
+ * @param l (do not set)
+ * @return constexpr int floats
+ */
+constexpr int networkFloats(const int *size, int layers, int l = 1){
+  return l == layers ? size[0] : 5 * size[l] + 2 * size[l - 1] * size[l] + networkFloats(size, layers, l + 1);
+}
+
+/**
+ * @brief Activation function by name, as in lib/BPNN/BPNN.h.
+ *
+ * @param name logistic (or sigmoid), ReLU, PReLU, ELU, identity, SoftPlus, tanh
+ * @return networkActivation
+ */
+inline networkActivation networkActivationByName(const char *name){
+  if(strcmp(name, "ReLU") == 0)       return ACTIVATION_RELU;
+  if(strcmp(name, "PReLU") == 0)      return ACTIVATION_PRELU;
+  if(strcmp(name, "ELU") == 0)        return ACTIVATION_ELU;
+  if(strcmp(name, "identity") == 0)   return ACTIVATION_IDENTITY;
+  if(strcmp(name, "SoftPlus") == 0)   return ACTIVATION_SOFTPLUS;
+  if(strcmp(name, "tanh") == 0)       return ACTIVATION_TANH;
+  return ACTIVATION_LOGISTIC;
+}
+
+/**
+ * @brief Activation function.
+ *
+ * @param f
+ * @param z
+ * @return float f(z)
+ */
+inline float activate(networkActivation f, float z){
+  switch(f){
+    case ACTIVATION_RELU:       return z > 0.0f ? z : 0.0f;
+    case ACTIVATION_PRELU:      return z > 0.0f ? z : 0.01f * z;
+    case ACTIVATION_ELU:        return z > 0.0f ? z : expf(z) - 1.0f;
+    case ACTIVATION_IDENTITY:   return z;
+    case ACTIVATION_SOFTPLUS:   return logf(1.0f + expf(z));
+    case ACTIVATION_TANH:       return tanhf(z);
+    default:                    return 1.0f / (1.0f + expf(-z));
+  }
+}
+
+/**
+ * @brief Derivative of the activation function.
+ *
+ * @param f
+ * @param z
+ * @param a f(z)
+ * @return float f'(z)
+ */
+inline float activateDerivative(networkActivation f, float z, float a){
+  switch(f){
+    case ACTIVATION_RELU:       return z > 0.0f ? 1.0f : 0.0f;
+    case ACTIVATION_PRELU:      return z > 0.0f ? 1.0f : 0.01f;
+    case ACTIVATION_ELU:        return z > 0.0f ? 1.0f : a + 1.0f;
+    case ACTIVATION_IDENTITY:   return 1.0f;
+    case ACTIVATION_SOFTPLUS:   return 1.0f - expf(-a);                 // logistic(z), being e^a = 1 + e^z
+    case ACTIVATION_TANH:       return 1.0f - a * a;
+    default:                    return a * (1.0f - a);
+  }
+}
+
+/**
+ * @brief Computes the offsets of the arrays of a network.
+ *
+ * @param layout
+ * @param size neurons of each layer, e.g. {n_in, n_h1, ..., n_out}
+ * @param layers at most NETWORK_MAX_LAYERS
+ * @param activation names of the activation functions of the layers 1, 2, ...
+ * @param batch networks in the arena, at most NETWORK_MAX_BATCH
+ */
+inline void setNetworkLayout(networkLayout &layout, const int *size, int layers, const char *const *activation,
+                             int batch = 1){
+
+  memset(&layout, 0, sizeof(layout));
+  layout.layers = layers;
+  layout.batch = batch;
+  for(int l = 0; l < layers; l++) layout.size[l] = size[l];
+
+  int offset = 0;
+  for(int l = 1; l < layers; l++){ layout.bias[l] = offset;          offset += size[l] * batch; }
+  for(int l = 1; l < layers; l++){ layout.weights[l] = offset;       offset += size[l - 1] * size[l] * batch; }
+  for(int l = 1; l < layers; l++){ layout.deltaBias[l] = offset;     offset += size[l] * batch; }
+  for(int l = 1; l < layers; l++){ layout.deltaWeights[l] = offset;  offset += size[l - 1] * size[l] * batch; }
+  layout.parameters = offset;
+
+  for(int l = 0; l < layers; l++){ layout.a[l] = offset;             offset += size[l] * batch; }
+  for(int l = 1; l < layers; l++){ layout.z[l] = offset;             offset += size[l] * batch; }
+  for(int l = 1; l < layers; l++){ layout.delta[l] = offset;         offset += size[l] * batch; }
+  layout.floats = offset;
+
+  for(int l = 1; l < layers; l++) layout.activation[l] = networkActivationByName(activation[l - 1]);
+}
+
+/**
+ * @brief An element of a network of the batch.
+ *
+ * @param layout
+ * @param arena
+ * @param offset of the array, e.g. layout.weights[l]
+ * @param k element of the array
+ * @param b network of the batch
+ * @return float&
+ */
+inline float &networkValue(const networkLayout &layout, float *arena, int offset, int k, int b){
+  return arena[offset + k * layout.batch + b];
+}
+
+/**
+ * @brief Output layer of the last propagation.
+ *
+ * @param layout
+ * @param arena
+ * @return const float* size[layers - 1] outputs, each one with a value for every network of the batch
+ */
+inline const float *networkOutput(const networkLayout &layout, const float *arena){
+  return arena + layout.a[layout.layers - 1];
+}
+
+/**
+ * @brief Forward propagation of the whole batch.
+ *
+ * @param layout
+ * @param arena
+ * @param input size[0] inputs, each one with a value for every network of the batch
+ */
+inline void networkForward(const networkLayout &layout, float *arena, const float *input){
+
+  const int batch = layout.batch;
+  memcpy(arena + layout.a[0], input, layout.size[0] * batch * sizeof(float));
+
+  for(int l = 1; l < layout.layers; l++){
+    const int rows = layout.size[l - 1], columns = layout.size[l] * batch;
+    const float *previous = arena + layout.a[l - 1];
+    const float *w = arena + layout.weights[l];
+    float *z = arena + layout.z[l];
+    float *a = arena + layout.a[l];
+
+    memcpy(z, arena + layout.bias[l], columns * sizeof(float));
+    for(int i = 0; i < rows; i++, previous += batch)
+      for(int j = 0; j < columns; j += batch, w += batch)
+        for(int b = 0; b < batch; b++) z[j + b] += previous[b] * w[b];
+
+    for(int j = 0; j < columns; j++) a[j] = activate(layout.activation[l], z[j]);
+  }
+}
+
+/**
+ * @brief Back propagation of the whole batch with the online learning: call it after networkForward().
+ *
+ * @param layout
+ * @param arena
+ * @param y size[layers - 1] expected outputs, each one with a value for every network of the batch
+ * @param learningRate one for every network of the batch
+ * @param momentumFactor one for every network of the batch
+ */
+inline void networkBackward(const networkLayout &layout, float *arena, const float *y,
+                            const float *learningRate, const float *momentumFactor){
+
+  const int batch = layout.batch;
+
+  // output layer
+  const int last = layout.layers - 1;
+  for(int j = 0; j < layout.size[last] * batch; j++){
+    float a = arena[layout.a[last] + j];
+    arena[layout.delta[last] + j] = (a - y[j]) * activateDerivative(layout.activation[last], arena[layout.z[last] + j], a);
+  }
+
+  // hidden layers
+  for(int l = last - 1; l >= 1; l--){
+    const int columns = layout.size[l + 1] * batch;
+    const float *w = arena + layout.weights[l + 1];
+
+    for(int i = 0; i < layout.size[l] * batch; i += batch){
+      float sum[NETWORK_MAX_BATCH] = {0.0f};
+      const float *next = arena + layout.delta[l + 1];
+      for(int j = 0; j < columns; j += batch, w += batch, next += batch)
+        for(int b = 0; b < batch; b++) sum[b] += w[b] * next[b];
+
+      for(int b = 0; b < batch; b++){
+        int k = i + b;
+        arena[layout.delta[l] + k] = sum[b] * activateDerivative(layout.activation[l], arena[layout.z[l] + k],
+                                                                 arena[layout.a[l] + k]);
+      }
+    }
+  }
+
+  // update the biases and the weights
+  for(int l = 1; l < layout.layers; l++){
+    const int rows = layout.size[l - 1], columns = layout.size[l] * batch;
+    const float *previous = arena + layout.a[l - 1];
+    const float *delta = arena + layout.delta[l];
+    float *bias = arena + layout.bias[l], *deltaBias = arena + layout.deltaBias[l];
+    float *w = arena + layout.weights[l], *dw = arena + layout.deltaWeights[l];
+
+    for(int j = 0; j < columns; j += batch)
+      for(int b = 0; b < batch; b++){
+        float increment = momentumFactor[b] * deltaBias[j + b] + learningRate[b] * delta[j + b];
+        deltaBias[j + b] = fabsf(increment) < NETWORK_TINY ? 0.0f : increment;
+        bias[j + b] -= deltaBias[j + b];
+      }
+    for(int i = 0; i < rows; i++, previous += batch)
+      for(int j = 0; j < columns; j += batch, w += batch, dw += batch)
+        for(int b = 0; b < batch; b++){
+          float increment = momentumFactor[b] * dw[b] + learningRate[b] * previous[b] * delta[j + b];
+          dw[b] = fabsf(increment) < NETWORK_TINY ? 0.0f : increment;
+          w[b] -= dw[b];
+        }
+  }
+}
+
+#endif /* NEURAL_NETWORK_H */
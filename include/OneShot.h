@@ -0,0 +1,80 @@
+/**
+ * @file OneShot.h
+ * @author @sebastiano123-c
+ * @brief OneShot125 and Multishot motor output using the ESP32 RMT peripheral.
+ *
+ * With LEDC the ESC pulses repeat at the PWM frequency, which is not synchronized with the loop: the new pulse
+ * starts only at the next PWM period, so it reaches the ESC up to a full period (2ms at 500Hz) after the mixer.
+ * Here every motor has its own RMT TX channel (0-3) that sends a single pulse as soon as setEscPulses() calls
+ * writeOneShot(): the four pulses start together right after the mixer, and the ESC gets exactly one pulse
+ * per loop (see OneShotPulse.h for the widths).
+ * The ESCs must support the protocol and, as with the standard PWM, must be calibrated.
+ *
+ * @version 0.1
+ * @date 2022-06-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#define ONESHOT_RMT_CLOCK_DIVIDER   1                                           // 80MHz RMT ticks, 12.5ns each
+#define ONESHOT_NS_TO_TICKS(ns)     ((ns) * 2 / 25)
+
+const rmt_channel_t oneShotChannel[4] = {RMT_CHANNEL_0, RMT_CHANNEL_1, RMT_CHANNEL_2, RMT_CHANNEL_3};
+const gpio_num_t oneShotPin[4]        = {(gpio_num_t)PIN_ESC_1, (gpio_num_t)PIN_ESC_2, (gpio_num_t)PIN_ESC_3, (gpio_num_t)PIN_ESC_4};
+rmt_item32_t oneShotItems[4][2];                                                // the pulse and the end marker
+
+
+/**
+ * @brief Setup the RMT channels for the four motors.
+ *
+ */
+void setupOneShot(){
+
+  for(int i = 0; i < 4; i++){
+
+    rmt_config_t txConfig = {};
+    txConfig.rmt_mode = RMT_MODE_TX;
+    txConfig.channel = oneShotChannel[i];
+    txConfig.gpio_num = oneShotPin[i];
+    txConfig.mem_block_num = 1;
+    txConfig.clk_div = ONESHOT_RMT_CLOCK_DIVIDER;
+    txConfig.tx_config.loop_en = false;
+    txConfig.tx_config.carrier_en = false;
+    txConfig.tx_config.idle_output_en = true;
+    txConfig.tx_config.idle_level = RMT_IDLE_LEVEL_LOW;
+
+    rmt_config(&txConfig);
+    rmt_driver_install(oneShotChannel[i], 0, 0);
+
+    oneShotItems[i][1].val = 0;                                                 // end marker
+  }
+}
+
+
+/**
+ * @brief Sends a single pulse to each of the four ESCs.
+ *
+ */
+void writeOneShot(){
+
+  int16_t pulse[4] = {esc1, esc2, esc3, esc4};
+
+  for(int i = 0; i < 4; i++){
+
+    #if ONESHOT_PROTOCOL == MULTISHOT
+      uint32_t width = multishotWidth(pulse[i]);
+    #else
+      uint32_t width = oneShot125Width(pulse[i]);
+    #endif
+
+    oneShotItems[i][0].level0 = 1;
+    oneShotItems[i][0].duration0 = ONESHOT_NS_TO_TICKS(width);
+    oneShotItems[i][0].level1 = 0;
+    oneShotItems[i][0].duration1 = 1;
+
+    rmt_fill_tx_items(oneShotChannel[i], oneShotItems[i], 2, 0);
+  }
+
+  for(int i = 0; i < 4; i++) rmt_tx_start(oneShotChannel[i], true);           // the four pulses start together
+}
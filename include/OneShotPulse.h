@@ -0,0 +1,47 @@
+/**
+ * @file OneShotPulse.h
+ * @author @sebastiano123-c
+ * @brief Pulse widths of the OneShot125 and Multishot protocols.
+ *
+ * OneShot125 and Multishot are the standard 1000-2000us pulse scaled down, and the pulse is sent once per loop:
+ *  @li OneShot125: 125-250us, i.e. the standard pulse divided by 8;
+ *  @li Multishot: 5-25us.
+ *
+ * These routines do not depend on the board, so they can be used in the host programs of the /test dir.
+ *
+ * @version 0.1
+ * @date 2022-06-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdint.h>
+
+#ifndef ONESHOT_PULSE_H
+#define ONESHOT_PULSE_H
+
+/**
+ * @brief OneShot125 pulse width.
+ *
+ * @param pulse (us) ESC pulse, 1000-2000
+ * @return uint32_t (ns) pulse width
+ */
+inline uint32_t oneShot125Width(int16_t pulse){
+  if(pulse < 1000) pulse = 1000;
+  else if(pulse > 2000) pulse = 2000;
+  return (uint32_t)pulse * 125;
+}
+
+/**
+ * @brief Multishot pulse width.
+ *
+ * @param pulse (us) ESC pulse, 1000-2000
+ * @return uint32_t (ns) pulse width
+ */
+inline uint32_t multishotWidth(int16_t pulse){
+  if(pulse < 1000) pulse = 1000;
+  else if(pulse > 2000) pulse = 2000;
+  return 5000 + (uint32_t)(pulse - 1000) * 20;
+}
+
+#endif /* ONESHOT_PULSE_H */
@@ -15,11 +15,22 @@
  */
 void setPID(){
 
+  //The GPS hold moves the drone as the pilot would do, adding its correction to the roll and pitch sticks.
+  int rollInput = receiverInputChannel1, pitchInput = receiverInputChannel2;
+  if(flightMode >= 3 && waypointGPS == 1){
+    rollInput += GPSRollAdjust;
+    pitchInput += GPSPitchAdjust;
+    if(rollInput > 1900) rollInput = 1900;
+    else if(rollInput < 1100) rollInput = 1100;
+    if(pitchInput > 1900) pitchInput = 1900;
+    else if(pitchInput < 1100) pitchInput = 1100;
+  }
+
   //In the case of deviding by 3 the max roll rate is aprox 164 degrees per second ( (500-8)/3 = 164d/s ).
   pidRollSetpoint = 0;
   //We need a little dead band of 16us for better results.
-  if(receiverInputChannel1 > 1508)pidRollSetpoint = receiverInputChannel1 - 1508;
-  else if(receiverInputChannel1 < 1492)pidRollSetpoint = receiverInputChannel1 - 1492;
+  if(rollInput > 1508)pidRollSetpoint = rollInput - 1508;
+  else if(rollInput < 1492)pidRollSetpoint = rollInput - 1492;
 
   pidRollSetpoint -= rollLevelAdjust;                                   //Subtract the angle correction from the standardized receiver roll input value.
   pidRollSetpoint /= 3.0;                                                 //Divide the setpoint for the PID roll controller by 3 to get angles in degrees.
@@ -28,8 +39,8 @@ void setPID(){
   //In the case of deviding by 3 the max pitch rate is aprox 164 degrees per second ( (500-8)/3 = 164d/s ).
   pidPitchSetpoint = 0;
   //We need a little dead band of 16us for better results.
-  if(receiverInputChannel2 > 1508)pidPitchSetpoint = receiverInputChannel2 - 1508;
-  else if(receiverInputChannel2 < 1492)pidPitchSetpoint = receiverInputChannel2 - 1492;
+  if(pitchInput > 1508)pidPitchSetpoint = pitchInput - 1508;
+  else if(pitchInput < 1492)pidPitchSetpoint = pitchInput - 1492;
 
   pidPitchSetpoint -= pitchLevelAdjust;                                  //Subtract the angle correction from the standardized receiver pitch input value.
   pidPitchSetpoint /= 3.0;                                               //Divide the setpoint for the PID pitch controller by 3 to get angles in degrees.
@@ -59,8 +70,8 @@ void calculatePID(){
   //Roll calculations
   pidErrorTemp = gyroRollInput - pidRollSetpoint;
   pidIMemRoll += pidErrorTemp;
-  if(pidIMemRoll > PID_MAX_ROLL*IGainRoll)pidIMemRoll = PID_MAX_ROLL;
-  else if(pidIMemRoll < PID_MAX_ROLL * (-IGainRoll))pidIMemRoll = PID_MAX_ROLL * -1;
+  if(pidIMemRoll > PID_MAX_ROLL / IGainRoll)pidIMemRoll = PID_MAX_ROLL / IGainRoll;          //Limit the I-controller output to PID_MAX_ROLL.
+  else if(pidIMemRoll < PID_MAX_ROLL / -IGainRoll)pidIMemRoll = PID_MAX_ROLL / -IGainRoll;
 
   pidOutputRoll = (PGainRoll * pidErrorTemp) + (IGainRoll * pidIMemRoll) + (DGainRoll * (pidErrorTemp - pidLastRollDError));
   if(pidOutputRoll > PID_MAX_ROLL)pidOutputRoll = PID_MAX_ROLL;
@@ -72,8 +83,8 @@ void calculatePID(){
   //Pitch calculations
   pidErrorTemp = gyroPitchInput - pidPitchSetpoint;
   pidIMemPitch += pidErrorTemp;
-  if(pidIMemPitch > PID_MAX_PITCH*IGainPitch)pidIMemPitch = PID_MAX_PITCH;
-  else if(pidIMemPitch < PID_MAX_PITCH * (-IGainPitch))pidIMemPitch = PID_MAX_PITCH * -1;
+  if(pidIMemPitch > PID_MAX_PITCH / IGainPitch)pidIMemPitch = PID_MAX_PITCH / IGainPitch;          //Limit the I-controller output to PID_MAX_PITCH.
+  else if(pidIMemPitch < PID_MAX_PITCH / -IGainPitch)pidIMemPitch = PID_MAX_PITCH / -IGainPitch;
 
   pidOutputPitch = (PGainPitch * pidErrorTemp) + (IGainPitch * pidIMemPitch) + (DGainPitch * (pidErrorTemp - pidLastPitchDError));
   if(pidOutputPitch > PID_MAX_PITCH)pidOutputPitch = PID_MAX_PITCH;
@@ -85,8 +96,8 @@ void calculatePID(){
   //Yaw calculations
   pidErrorTemp = gyroYawInput - pidYawSetpoint;
   pidIMemYaw += pidErrorTemp;
-  if(pidIMemYaw > PID_MAX_YAW * IGainYaw)pidIMemYaw = PID_MAX_YAW;
-  else if(pidIMemYaw < PID_MAX_YAW * (-IGainYaw))pidIMemYaw = PID_MAX_YAW * -1;
+  if(pidIMemYaw > PID_MAX_YAW / IGainYaw)pidIMemYaw = PID_MAX_YAW / IGainYaw;          //Limit the I-controller output to PID_MAX_YAW.
+  else if(pidIMemYaw < PID_MAX_YAW / -IGainYaw)pidIMemYaw = PID_MAX_YAW / -IGainYaw;
 
   pidOutputYaw = (PGainYaw * pidErrorTemp) + (IGainYaw * pidIMemYaw) + (DGainYaw * (pidErrorTemp - pidLastYawDError));
   if(pidOutputYaw > PID_MAX_YAW)pidOutputYaw = PID_MAX_YAW;
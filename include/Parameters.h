@@ -0,0 +1,329 @@
+/**
+ * @file Parameters.h
+ * @author @sebastiano123-c
+ * @brief Registry of the parameters that can change during the flight, saved on the flash as a single blob.
+ *
+ * Every parameter has an id (see parameterId in Globals.h), which is its index in parameterTable: the table tells
+ * its name, its type, the global variable that holds it and its limits, so that getParameter() and setParameter()
+ * find it in O(1) and never accept a value out of range.
+ *
+ * The telemetry runs on another task (NATIVE) or in the middle of the loop (ESP_CAM), so it never calls
+ * setParameter(): it fills a parameterBatch with addParameterUpdate() and hands it to stageParameterUpdate(), that
+ * checks every value and queues the batch only if all of them are good. applyParameterUpdates(), at the start of
+ * the loop, applies the queued batches: the PIDs see the whole change from the same loop on.
+ * With AUTOTUNE_PID_GYROSCOPE the gains of roll, pitch and yaw are the outputs of the networks (see AutoPID.h), so
+ * the batches that change them are refused: the telemetry would acknowledge a value that lasts one publication.
+ *
+ * The values are saved in the NVS (which spreads the writings over the flash pages) as one blob:
+ *
+ *          magic | version | count | checksum || value 0 | value 1 | ... | value count-1
+ *
+ * each value being the 4 bytes of a float or of an int32_t. A change marks the parameters as dirty and
+ * commitParameters() writes the whole blob with a single putBytes(), PARAMETERS_COMMIT_DELAY after the last change
+ * and only with the motors off, since writing the flash stops both the cores for some milliseconds.
+ * loadParameters() reads the blob at the start:
+ *  @li if the magic, the version or the checksum are wrong, the values of Config.h are kept;
+ *  @li the ids are only appended, so a blob with fewer values (older firmware) sets the ones it has, and the
+ *      others keep the values of Config.h. Increase PARAMETERS_VERSION if the meaning of an id changes.
+ *
+ * The receiver calibration stays in the EEPROM bytes written by the SETUP sketch, and the weights of the networks
+ * in their own namespaces (see AutoPID.h): they are written by their sketches, never during the flight.
+ *
+ * @version 0.1
+ * @date 2022-06-22
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#define PARAMETERS_MAGIC            0x4d524150                // "PARM"
+#define PARAMETERS_VERSION          3                         // 2: the GPS gains of the position and velocity loops
+                                                              // 3: the altitude gains on (m) and (m/s)
+#define PARAMETERS_NAMESPACE        "parameters"
+#define PARAMETERS_KEY              "blob"
+
+enum parameterType {
+  PARAM_FLOAT,
+  PARAM_INT                                                   // int32_t
+};
+
+struct parameterInfo {
+  const char *name;                                           // as in the telemetry
+  parameterType type;
+  void *value;                                                // global variable
+  float minimum, maximum;
+};
+
+struct parameterBlob {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;                                             // values saved
+  uint32_t checksum;                                          // of the values
+  uint32_t values[PARAMETERS];
+};
+
+const parameterInfo parameterTable[PARAMETERS] = {
+  {"rollP",             PARAM_FLOAT,  &PGainRoll,               0.0f,   20.0f},
+  {"rollI",             PARAM_FLOAT,  &IGainRoll,               0.0f,    1.0f},
+  {"rollD",             PARAM_FLOAT,  &DGainRoll,               0.0f,  100.0f},
+  {"pitchP",            PARAM_FLOAT,  &PGainPitch,              0.0f,   20.0f},
+  {"pitchI",            PARAM_FLOAT,  &IGainPitch,              0.0f,    1.0f},
+  {"pitchD",            PARAM_FLOAT,  &DGainPitch,              0.0f,  100.0f},
+  {"yawP",              PARAM_FLOAT,  &PGainYaw,                0.0f,   20.0f},
+  {"yawI",              PARAM_FLOAT,  &IGainYaw,                0.0f,    1.0f},
+  {"yawD",              PARAM_FLOAT,  &DGainYaw,                0.0f,  100.0f},
+  {"altitudeP",         PARAM_FLOAT,  &PGainAltitude,           0.0f,  200.0f},
+  {"altitudeI",         PARAM_FLOAT,  &IGainAltitude,           0.0f,  100.0f},
+  {"altitudeD",         PARAM_FLOAT,  &DGainAltitude,           0.0f,  300.0f},
+  {"gpsP",              PARAM_FLOAT,  &PGainGPS,                0.0f,    5.0f},
+  {"gpsD",              PARAM_FLOAT,  &DGainGPS,                0.0f,   30.0f},
+  {"filterRoll",        PARAM_FLOAT,  &GYROSCOPE_ROLL_FILTER,   0.9f,    1.0f},
+  {"filterPitch",       PARAM_FLOAT,  &GYROSCOPE_PITCH_FILTER,  0.9f,    1.0f},
+  {"correctionRoll",    PARAM_FLOAT,  &GYROSCOPE_ROLL_CORR,   -20.0f,   20.0f},
+  {"correctionPitch",   PARAM_FLOAT,  &GYROSCOPE_PITCH_CORR,  -20.0f,   20.0f},
+  {"thrustCurveExpo",   PARAM_FLOAT,  &thrustCurveExpo,         0.0f,    1.0f},
+  {"gpsI",              PARAM_FLOAT,  &IGainGPS,                0.0f,   20.0f}
+};
+
+
+/**
+ * @brief Checksum of the values of a blob (FNV-1a).
+ *
+ * @param values
+ * @param count
+ * @return uint32_t
+ */
+uint32_t parametersChecksum(const uint32_t *values, int count){
+
+  const uint8_t *bytes = (const uint8_t *)values;
+  uint32_t hash = 2166136261UL;
+
+  for(size_t i = 0; i < count * sizeof(uint32_t); i++){
+    hash ^= bytes[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+/**
+ * @brief Value of a parameter.
+ *
+ * @param id see parameterId
+ * @return float the value, NAN if the id does not exist
+ */
+float getParameter(int id){
+
+  if(id < 0 || id >= PARAMETERS) return NAN;
+
+  const parameterInfo &p = parameterTable[id];
+  return p.type == PARAM_FLOAT ? *(float *)p.value : (float)*(int32_t *)p.value;
+}
+
+/**
+ * @brief Checks a value without changing the parameter.
+ *
+ * @param id see parameterId
+ * @param value
+ * @return true if setParameter() would accept it
+ */
+bool checkParameter(int id, float value){
+  if(id < 0 || id >= PARAMETERS || isnan(value)) return false;
+  return value >= parameterTable[id].minimum && value <= parameterTable[id].maximum;
+}
+
+/**
+ * @brief Changes a parameter: it will be saved by commitParameters().
+ *
+ * @param id see parameterId
+ * @param value
+ * @return true if the value is in the limits of the parameter, false if not (nothing changes)
+ */
+bool setParameter(int id, float value){
+
+  if(!checkParameter(id, value)) return false;
+
+  const parameterInfo &p = parameterTable[id];
+  if(p.type == PARAM_FLOAT) *(float *)p.value = value;
+  else *(int32_t *)p.value = (int32_t)lroundf(value);
+
+  parametersChanged = millis();
+  parametersDirty = true;
+  return true;
+}
+
+/**
+ * @brief Adds a value to a batch; a second value of the same parameter replaces the first one.
+ *
+ * @param batch start from count = 0
+ * @param id see parameterId
+ * @param value
+ * @return true if the id exists
+ */
+bool addParameterUpdate(parameterBatch &batch, int id, float value){
+
+  if(id < 0 || id >= PARAMETERS) return false;
+
+  for(int i = 0; i < batch.count; i++)
+    if(batch.id[i] == id){
+      batch.value[i] = value;
+      return true;
+    }
+
+  batch.id[batch.count] = id;                                 // never full: an id appears once
+  batch.value[batch.count] = value;
+  batch.count++;
+  return true;
+}
+
+/**
+ * @brief Checks a batch and queues it for the loop (telemetry). Nothing changes if a value is refused.
+ *
+ * @param batch
+ * @return parameterStatus
+ */
+parameterStatus stageParameterUpdate(const parameterBatch &batch){
+
+  if(batch.count == 0) return PARAMETERS_EMPTY;
+  for(int i = 0; i < batch.count; i++){
+    if(!checkParameter(batch.id[i], batch.value[i])) return PARAMETERS_REFUSED;
+    #if AUTOTUNE_PID_GYROSCOPE == true
+      if(batch.id[i] <= PARAM_YAW_D) return PARAMETERS_TUNED;   // the next gains of the autotune task would undo it
+    #endif
+  }
+
+  uint32_t head = parameterQueueHead.load(std::memory_order_relaxed);
+  if(head - parameterQueueTail.load(std::memory_order_acquire) == PARAMETERS_QUEUE_SIZE) return PARAMETERS_BUSY;
+
+  parameterQueue[head & (PARAMETERS_QUEUE_SIZE - 1)] = batch;
+  parameterQueueHead.store(head + 1, std::memory_order_release); // the loop sees the batch only now
+  return PARAMETERS_STAGED;
+}
+
+/**
+ * @brief Applies the batches queued by the telemetry. Call it at the start of the loop.
+ */
+void applyParameterUpdates(){
+
+  uint32_t tail = parameterQueueTail.load(std::memory_order_relaxed);
+  uint32_t head = parameterQueueHead.load(std::memory_order_acquire);
+  if(tail == head) return;
+
+  for(; tail != head; tail++){
+    const parameterBatch &batch = parameterQueue[tail & (PARAMETERS_QUEUE_SIZE - 1)];
+    for(int i = 0; i < batch.count; i++) setParameter(batch.id[i], batch.value[i]);
+  }
+  parameterQueueTail.store(tail, std::memory_order_release); // the telemetry can write them again
+}
+
+/**
+ * @brief Id of a parameter from its name (for the messages of the telemetry: prefer the ids in the code).
+ *
+ * @param name
+ * @return int the id, -1 if there is no parameter with that name
+ */
+int findParameter(const char *name){
+  for(int id = 0; id < PARAMETERS; id++)
+    if(strcmp(parameterTable[id].name, name) == 0) return id;
+  return -1;
+}
+
+/**
+ * @brief Fills a blob with the values of the parameters.
+ *
+ * @param blob
+ */
+void packParameters(parameterBlob &blob){
+  blob.magic = PARAMETERS_MAGIC;
+  blob.version = PARAMETERS_VERSION;
+  blob.count = PARAMETERS;
+  for(int id = 0; id < PARAMETERS; id++) memcpy(&blob.values[id], parameterTable[id].value, sizeof(uint32_t));
+  blob.checksum = parametersChecksum(blob.values, PARAMETERS);
+}
+
+/**
+ * @brief Sets the parameters back to the values of Config.h (saved by the next commitParameters()).
+ */
+void resetParameters(){
+  for(int id = 0; id < PARAMETERS; id++) memcpy(parameterTable[id].value, &parameterDefault[id], sizeof(uint32_t));
+  parametersChanged = millis();
+  parametersDirty = true;
+}
+
+/**
+ * @brief Reads the parameters saved on the flash. Call it at the beginning of setup(), after initEEPROM().
+ */
+void loadParameters(){
+
+  // the values of Config.h
+  for(int id = 0; id < PARAMETERS; id++) memcpy(&parameterDefault[id], parameterTable[id].value, sizeof(uint32_t));
+
+  #if PARAMETERS_RESET == true
+    resetParameters();
+    return;
+  #endif
+
+  parameterBlob blob;
+  const size_t header = sizeof(blob) - sizeof(blob.values);
+
+  preferences.begin(PARAMETERS_NAMESPACE, true);
+  size_t length = preferences.getBytes(PARAMETERS_KEY, &blob, sizeof(blob));
+  preferences.end();
+
+  int count = length >= header ? blob.count : 0;
+  if(length < header || blob.magic != PARAMETERS_MAGIC || blob.version != PARAMETERS_VERSION ||
+     count > PARAMETERS || length != header + count * sizeof(uint32_t) ||
+     blob.checksum != parametersChecksum(blob.values, count)){
+
+    #if DEBUG
+      if(length > 0) Serial.println("loadParameters: the saved parameters are not valid, using Config.h");
+    #endif
+    return;
+  }
+
+  // the values out of the limits (e.g. changed in a newer firmware) keep the ones of Config.h
+  for(int id = 0; id < count; id++){
+    float value;
+    if(parameterTable[id].type == PARAM_FLOAT) memcpy(&value, &blob.values[id], sizeof(value));
+    else value = (float)(int32_t)blob.values[id];
+    setParameter(id, value);
+  }
+  parametersDirty = count < PARAMETERS;                       // save the new ones too
+
+  #if DEBUG
+    Serial.printf("loadParameters: %i parameters from the flash\n", count);
+  #endif
+}
+
+/**
+ * @brief Writes the changed parameters on the flash, as a single blob, when the motors are off.
+ *
+ * @return true if the blob was written
+ */
+bool commitParameters(){
+
+  if(!parametersDirty || start != 0 || millis() - parametersChanged < PARAMETERS_COMMIT_DELAY) return false;
+
+  parametersDirty = false;                                    // before packing: a change from now on is saved next time
+
+  parameterBlob blob;
+  packParameters(blob);
+
+  preferences.begin(PARAMETERS_NAMESPACE, false);
+  bool written = preferences.putBytes(PARAMETERS_KEY, &blob, sizeof(blob)) == sizeof(blob);
+  preferences.end();
+
+  if(!written) parametersDirty = true;
+
+  #if DEBUG
+    Serial.println(written ? "commitParameters: saved" : "commitParameters: the flash cannot be written");
+  #endif
+  return written;
+}
+
+/**
+ * @brief Prints the parameters.
+ */
+void printParameters(){
+  for(int id = 0; id < PARAMETERS; id++)
+    Serial.printf("%2i %-18s %f\n", id, parameterTable[id].name, getParameter(id));
+}
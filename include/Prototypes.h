@@ -93,6 +93,14 @@ void configureReceiverTrims();                                // see Initialize.
 
     void printBarometer();                                    // see Altitude.h
 
+    void setupProximitySensor();                              // see Proximity.h
+
+    void readProximitySensor();                               // see Proximity.h
+
+    void printProximitySensor();                              // see Proximity.h
+
+    float blendLowAltitude(float barometerPressure);          // see Proximity.h
+
     void initBattery();                                       // see Battery.h
 
     void readBatteryVoltage();                                // see Battery.h
@@ -107,7 +115,15 @@ void configureReceiverTrims();                                // see Initialize.
 
     void printGPSSerialLine();                                // see GPS.h
 
-    void calibrateAutoPID(std::vector<int> structure);
+    void setupCompass();                                      // see Compass.h
+
+    void readCompass();                                       // see Compass.h
+
+    void printCompass();                                      // see Compass.h
+
+    void calibrateCompass();                                  // see Compass.h
+
+    void calibrateAutoPID();
     void calculatePID();                                      // see PID.h
 
 #elif UPLOADED_SKETCH == FLIGHT_CONTROLLER
@@ -128,6 +144,15 @@ void configureReceiverTrims();                                // see Initialize.
     void calculateAltitudeHold();                             // see Altitude.h
 
 
+    void setupProximitySensor();                              // see Proximity.h
+
+    void readProximitySensor();                               // see Proximity.h
+
+    void printProximitySensor();                              // see Proximity.h
+
+    float blendLowAltitude(float barometerPressure);          // see Proximity.h
+
+
     void calculatePID();                                      // see PID.h
 
     void printInputSignalsPID();
@@ -140,23 +165,74 @@ void configureReceiverTrims();                                // see Initialize.
     void printBatteryVoltage();                               
 
 
+    void initAutotuneTask();                                  // see AutoPID.h
+
+    void sampleAutoPID();                                     // see AutoPID.h
+
+    void applyAutoPIDGains();                                 // see AutoPID.h
+
+
+    void loadParameters();                                    // see Parameters.h
+
+    bool commitParameters();                                  // see Parameters.h
+
+    bool setParameter(int id, float value);                   // see Parameters.h
+
+    float getParameter(int id);                               // see Parameters.h
+
+    void applyParameterUpdates();                             // see Parameters.h
+
+
     void setupGPS();                                          // see GPS.h
 
     void readGPS();                                           // see GPS.h
 
 
+    void setupCompass();                                      // see Compass.h
+
+    void readCompass();                                       // see Compass.h
+
+
+    void loadMission();                                       // see Mission.h
+
+    bool setMission(const missionWaypoint *waypoints, int count);// see Mission.h
+
+    void initMissionTask();                                   // see Mission.h
+
+    void publishMissionFix();                                 // see Mission.h
+
+    void updateMissionWaypoint();                             // see Mission.h
+
+
+    void updateFailsafe();                                    // see Failsafe.h
+
+    void applyFailsafeSticks();                               // see Failsafe.h
+
+
     #if WIFI_TELEMETRY == NATIVE
 
         void notFound(AsyncWebServerRequest *request);
 
-        const char* index_html();
+        void setWebParameters(AsyncWebServerRequest *request);
+
+        size_t writeParametersJSON(char *json, size_t size);
 
-        String processor(const String& var);
+        void initTelemetryTask();                             // see WiFiTelemetry.h
 
     #elif WIFI_TELEMETRY == ESP_CAM
 
         void writeDataTransfer();
 
+    #elif WIFI_TELEMETRY == MAVLINK
+
+        bool writeMAVLink(uint32_t id, const void *payload);  // see WiFiTelemetry.h
+
+        bool writeMAVLinkParameter(int id);
+
+        bool writeMAVLinkStream(uint32_t id);
+
+        void parseMAVLink(const mavlinkFrame &frame);
+
     #endif
 
     void sendWiFiTelemetry();                                 // see WiFi.h
@@ -170,4 +246,30 @@ void convertAllSignals();                                 // see ESC.h
 void setEscPulses();                                      // see ESC.h
 
 
-void waitController();                                    // see Controller.h               
+#if defined(MOTOR_PULSE_BY_DSHOT)
+void setupDShot();                                        // see DShot.h
+void readDShotTelemetry();                                // see DShot.h
+void writeDShot();                                        // see DShot.h
+void printDShotTelemetry();                               // see DShot.h
+#endif
+
+
+#if defined(MOTOR_PULSE_BY_ONESHOT)
+void setupOneShot();                                      // see OneShot.h
+void writeOneShot();                                      // see OneShot.h
+#endif
+
+
+void waitController();                                    // see Controller.h
+
+
+void startFlightRecorder();                               // see FlightRecorder.h
+void traceInput(uint8_t record, void *data, uint8_t size);// see FlightRecorder.h
+void traceLoopStart();                                    // see FlightRecorder.h
+void traceStage(uint8_t stage);                           // see FlightRecorder.h
+
+
+void startDiagnostics();                                  // see Diagnostics.h
+void diagnosticsWatchTask(TaskHandle_t handle, const char *name);  // see Diagnostics.h
+void diagnosticsLoopStart();                              // see Diagnostics.h
+void diagnosticsStage(uint8_t stage);                     // see Diagnostics.h
@@ -0,0 +1,183 @@
+/**
+ * @file Proximity.h
+ * @author @sebastiano123-c
+ * @brief Rangefinder routines and low altitude estimator.
+ *
+ * Depending on the PROXIMITY_SENSOR macro value:
+ *
+ *  @li HCSR04: ultrasonic rangefinder pointing to the ground;
+ *  @li OFF: no rangefinder, the altitude hold uses only the barometer.
+ *
+ * The HC-SR04 is triggered with a 10us pulse, then it raises the echo pin for a time proportional to the distance.
+ * Instead of waiting the echo with pulseIn (which would block the loop up to 30ms), both edges of the echo pin
+ * fire proximityISR(), which stores the echo width.
+ * readProximitySensor() is called every loop: it converts the last echo into a distance and triggers a new ping
+ * every PROXIMITY_CYCLE_MS.
+ *
+ * Close to the ground, blendLowAltitude() mixes the rangefinder distance with the barometer readings so that
+ * takeoff and landing are governed by the rangefinder, while above PROXIMITY_BLEND_ALTITUDE only the barometer is used.
+ *
+ * @version 0.1
+ * @date 2022-06-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#if PROXIMITY_SENSOR == HCSR04
+
+/**
+ * @brief Measures the echo width of the rangefinder.
+ *
+ */
+void IRAM_ATTR proximityISR(){
+
+  if(digitalRead(PIN_PROXIMITY_SENSOR_ECHO) == HIGH)                        // echo started
+    proximityEchoStart = micros();
+  else {                                                                     // echo finished
+    proximityEchoWidth = micros() - proximityEchoStart;
+    proximityNewEcho = true;
+  }
+}
+
+/**
+ * @brief Setup the rangefinder pins and the echo interrupt.
+ *
+ */
+void setupProximitySensor(){
+
+  pinMode(PIN_PROXIMITY_SENSOR_TRIG, OUTPUT);
+  pinMode(PIN_PROXIMITY_SENSOR_ECHO, INPUT);
+  digitalWrite(PIN_PROXIMITY_SENSOR_TRIG, LOW);
+
+  attachInterrupt(digitalPinToInterrupt(PIN_PROXIMITY_SENSOR_ECHO), proximityISR, CHANGE);
+
+  proximityTriggerTimer = millis();
+  proximityValid = false;
+
+#if DEBUG
+  Serial.println("Proximity sensor: OK");
+#endif
+}
+
+/**
+ * @brief Converts the echo width into a distance.
+ *
+ * @param echoWidth (us) width of the echo pulse
+ * @return float distance in meters, negative if out of range
+ */
+float echoToDistance(unsigned long echoWidth){
+
+  if(echoWidth > PROXIMITY_TIMEOUT_US) return -1.0f;                        // nothing in front of the sensor
+
+  float distance = (float)echoWidth * PROXIMITY_US_TO_M;                    // the sound goes and comes back
+
+  if(distance < PROXIMITY_MIN_RANGE || distance > PROXIMITY_MAX_RANGE) return -1.0f;
+
+  return distance;
+}
+
+/**
+ * @brief Reads the last echo and triggers the next ping.
+ *
+ */
+void readProximitySensor(){
+
+  if(proximityNewEcho){
+
+    proximityNewEcho = false;
+
+    float distance = echoToDistance(proximityEchoWidth);
+
+    if(distance > 0){
+      distance *= cos(angleRoll / convDegToRad) * cos(anglePitch / convDegToRad);   // vertical component of the tilted reading
+
+      if(proximityValid) proximityDistance = proximityDistance * proximityFilter + distance * (1.0f - proximityFilter);
+      else proximityDistance = distance;                                     // first reading after a loss
+
+      proximityValid = true;
+    }
+    else proximityValid = false;
+  }
+
+  // trigger a new ping
+  if(millis() - proximityTriggerTimer >= PROXIMITY_CYCLE_MS){
+
+    if(micros() - proximityEchoStart > PROXIMITY_TIMEOUT_US &&              // wrap safe
+       digitalRead(PIN_PROXIMITY_SENSOR_ECHO) == HIGH)
+      proximityValid = false;                                                // echo stuck high, sensor out of range
+
+    proximityTriggerTimer = millis();
+
+    digitalWrite(PIN_PROXIMITY_SENSOR_TRIG, HIGH);
+    delayMicroseconds(PROXIMITY_TRIGGER_US);
+    digitalWrite(PIN_PROXIMITY_SENSOR_TRIG, LOW);
+  }
+
+  #if DEBUG && defined(DEBUG_PROXIMITY)
+    printProximitySensor();
+  #endif
+}
+
+/**
+ * @brief Blends the rangefinder distance with the barometer pressure.
+ *
+ * The ground pressure (i.e. the pressure the barometer would read on the ground below the drone) is tracked
+ * while the rangefinder is valid. In this way, the rangefinder distance can be converted into barometer units
+ * and the altitude PID sees a continuous input when the drone goes in and out of the blending band.
+ *
+ * @param barometerPressure (hPa) pressure read by the barometer
+ * @return float (hPa) pressure to be used by the altitude PID
+ */
+float blendLowAltitude(float barometerPressure){
+
+  if(proximityValid == false || proximityDistance > PROXIMITY_BLEND_ALTITUDE){
+
+    if(groundPressure > 0) groundAltitude = (groundPressure - barometerPressure) / hPaPerMeter;
+
+    return barometerPressure;                                                // far from the ground, barometer only
+  }
+
+  float groundPressureNow = barometerPressure + proximityDistance * hPaPerMeter;
+
+  if(groundPressure > 0) groundPressure = groundPressure * groundPressureFilter + groundPressureNow * (1.0f - groundPressureFilter);
+  else groundPressure = groundPressureNow;
+
+  // weight of the rangefinder: 1 at the bottom of the band, 0 at PROXIMITY_BLEND_ALTITUDE
+  float weight = (PROXIMITY_BLEND_ALTITUDE - proximityDistance) / proximityBlendBand;
+  if(weight > 1.0f) weight = 1.0f;
+  else if(weight < 0.0f) weight = 0.0f;
+
+  groundAltitude = weight * proximityDistance + (1.0f - weight) * (groundPressure - barometerPressure) / hPaPerMeter;
+
+  return weight * (groundPressure - proximityDistance * hPaPerMeter) + (1.0f - weight) * barometerPressure;
+}
+
+/**
+ * @brief Prints the rangefinder readings.
+ *
+ */
+void printProximitySensor(){
+  Serial.printf("echo: %lu us, distance: %f m, valid: %i, ground altitude: %f m\n", proximityEchoWidth, proximityDistance, proximityValid, groundAltitude);
+}
+
+#else
+
+void setupProximitySensor()
+{
+  return;
+}
+void readProximitySensor()
+{
+  return;
+}
+float blendLowAltitude(float barometerPressure)
+{
+  return barometerPressure;
+}
+void printProximitySensor()
+{
+  return;
+}
+
+#endif
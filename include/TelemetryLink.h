@@ -0,0 +1,198 @@
+/**
+ * @file TelemetryLink.h
+ * @author @sebastiano123-c
+ * @brief Frames of the telemetry: the UART link between the flight controller and the ESP32-CAM, and the
+ * WebSocket messages of the page.
+ *
+ * On the UART every frame is
+ *
+ *          0xD5 0x4C | type | length | payload (length bytes) | CRC-16 of type, length and payload
+ *
+ * (CRC-16/CCITT-FALSE, little endian). The receiver looks for the two sync bytes, so it finds the next frame after
+ * a lost byte, and the CRC drops the broken ones. linkScan() finds the frames in place, in the buffer where the
+ * UART put the bytes: nothing is copied to read them.
+ *
+ * The WebSocket messages (NATIVE and ESP32-CAM alike) are a telemetryBatch followed by its frames.
+ *
+ * These definitions do not depend on the board, so they are used by the flight controller, by the firmware of the
+ * ESP32-CAM (../esp32cam) and by the host programs of the /test dir. All the values are little endian.
+ *
+ * @version 0.1
+ * @date 2022-06-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifndef TELEMETRY_LINK_H
+#define TELEMETRY_LINK_H
+
+#define LINK_SYNC_0                 0xD5
+#define LINK_SYNC_1                 0x4C                      // "L"
+#define LINK_HEADER_SIZE            4                         // sync, sync, type, length
+#define LINK_MAX_PAYLOAD            96
+#define LINK_MAX_FRAME              (LINK_HEADER_SIZE + LINK_MAX_PAYLOAD + 2)
+#define LINK_NAME_LENGTH            20                        // of the parameters, '\0' included
+#define LINK_MAX_PARAMETERS         32
+#define LINK_SET_PAIR_SIZE          5                         // uint8_t id, float value
+#define LINK_MAX_SET_PAIRS          ((LINK_MAX_PAYLOAD - 2) / LINK_SET_PAIR_SIZE)
+
+/**
+ * @brief Frames of the link, with their payload.
+ */
+enum linkType {
+  LINK_TELEMETRY = 1,               // flight controller -> camera: telemetryFrame
+  LINK_PARAMETER,                   // flight controller -> camera: linkParameter, one per parameter
+  LINK_STATUS,                      // flight controller -> camera: uint8_t sequence of a LINK_SET, uint8_t parameterStatus
+  LINK_SET,                         // camera -> flight controller: uint8_t sequence, uint8_t count, count x (uint8_t id, float value)
+  LINK_REQUEST                      // camera -> flight controller: no payload, send all the parameters
+};
+
+/**
+ * @brief Answer to a batch of parameters (see stageParameterUpdate()), sent in LINK_STATUS too.
+ */
+enum parameterStatus {
+  PARAMETERS_STAGED,                // applied at the start of the next loop
+  PARAMETERS_EMPTY,                 // no values in the batch
+  PARAMETERS_REFUSED,               // an id does not exist or a value is out of its limits
+  PARAMETERS_BUSY,                  // the queue is full, try again
+  PARAMETERS_TUNED                  // a gain of roll, pitch or yaw while the autotune task sets them
+};
+
+const char *const parameterStatusText[] = {"staged", "empty", "refused", "busy", "tuned"};
+
+/**
+ * @brief The flight, as sent by the flight controller (see sendWiFiTelemetry()). The page reads the bytes at
+ * these offsets: change TELEMETRY_FRAME_VERSION and web/index.html with it.
+ */
+#define TELEMETRY_FRAME_VERSION     1
+struct telemetryFrame {
+  uint32_t time;                    // (ms) millis()
+  float angle[2];                   // (deg) roll, pitch
+  float rate[3];                    // (deg/s) gyroRollInput, ...
+  float setpoint[3];                // (deg/s) pidRollSetpoint, ...
+  float batteryVoltage;             // (V)
+  float altitude;                   // altitudeMeasure
+  float latitude, longitude;        // (deg)
+  int16_t esc[4];                   // (us)
+  uint16_t loopTime;                // (us) from the start of the loop
+  uint8_t flightMode, start;
+};
+static_assert(sizeof(telemetryFrame) == 64, "telemetryFrame: the page reads 64 bytes");
+
+/**
+ * @brief Header of a WebSocket message, followed by frames telemetryFrame.
+ */
+struct telemetryBatch {
+  uint16_t frameSize;               // sizeof(telemetryFrame)
+  uint16_t frames;
+  uint32_t dropped;                 // frames lost since the start
+};
+
+/**
+ * @brief A parameter of the flight controller, sent when asked and after every change.
+ */
+struct linkParameter {
+  uint8_t id;                       // see parameterId
+  uint8_t count;                    // parameters of the flight controller
+  uint8_t reserved[2];
+  float value;
+  char name[LINK_NAME_LENGTH];      // as in parameterTable
+};
+
+/**
+ * @brief A frame found by linkScan(), pointing inside the scanned buffer.
+ */
+struct linkFrame {
+  uint8_t type;
+  uint8_t length;
+  const uint8_t *payload;           // NULL if no frame was found
+};
+
+
+/**
+ * @brief CRC-16/CCITT-FALSE.
+ *
+ * @param crc 0xFFFF at the start, then the value returned for the previous bytes
+ * @param data
+ * @param size
+ * @return uint16_t
+ */
+inline uint16_t linkCRC(uint16_t crc, const uint8_t *data, size_t size){
+
+  // four bits at a time: a table of 32 bytes instead of 512
+  static const uint16_t table[16] = {0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+                                     0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef};
+  for(size_t i = 0; i < size; i++){
+    crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ table[(crc >> 12) ^ (data[i] & 0x0F)]);
+  }
+  return crc;
+}
+
+/**
+ * @brief Writes a frame.
+ *
+ * @param frame at least LINK_HEADER_SIZE + length + 2 bytes
+ * @param type see linkType
+ * @param payload
+ * @param length at most LINK_MAX_PAYLOAD
+ * @return size_t the bytes of the frame, 0 if the payload is too long
+ */
+inline size_t linkEncode(uint8_t *frame, uint8_t type, const void *payload, size_t length){
+
+  if(length > LINK_MAX_PAYLOAD) return 0;
+
+  frame[0] = LINK_SYNC_0;
+  frame[1] = LINK_SYNC_1;
+  frame[2] = type;
+  frame[3] = (uint8_t)length;
+  if(length > 0) memcpy(frame + LINK_HEADER_SIZE, payload, length);
+
+  uint16_t crc = linkCRC(0xFFFF, frame + 2, length + 2);
+  frame[LINK_HEADER_SIZE + length] = crc & 0xFF;
+  frame[LINK_HEADER_SIZE + length + 1] = crc >> 8;
+  return LINK_HEADER_SIZE + length + 2;
+}
+
+/**
+ * @brief Looks for the first good frame in the buffer.
+ *
+ * Call it again from the returned offset until it finds no frame, then keep the bytes from there on: they are the
+ * beginning of a frame not yet received.
+ *
+ * @param buffer
+ * @param size
+ * @param frame the frame found, payload NULL if none
+ * @param errors incremented for every broken frame skipped
+ * @return size_t the bytes read: up to the end of the frame found, or up to the first byte that can still begin one
+ */
+inline size_t linkScan(const uint8_t *buffer, size_t size, linkFrame &frame, uint32_t &errors){
+
+  frame.payload = NULL;
+  size_t i = 0;
+
+  while(i < size){
+    if(buffer[i] != LINK_SYNC_0){ i++; continue; }
+    if(i + 1 < size && buffer[i + 1] != LINK_SYNC_1){ i++; continue; }
+    if(i + LINK_HEADER_SIZE > size) return i;                // the header is not complete
+
+    uint8_t length = buffer[i + 3];
+    if(length > LINK_MAX_PAYLOAD){ errors++; i++; continue; }
+    if(i + LINK_HEADER_SIZE + length + 2 > size) return i;   // the frame is not complete
+
+    uint16_t crc = buffer[i + LINK_HEADER_SIZE + length] | (uint16_t)buffer[i + LINK_HEADER_SIZE + length + 1] << 8;
+    if(crc != linkCRC(0xFFFF, buffer + i + 2, length + 2)){ errors++; i++; continue; }
+
+    frame.type = buffer[i + 2];
+    frame.length = length;
+    frame.payload = buffer + i + LINK_HEADER_SIZE;
+    return i + LINK_HEADER_SIZE + length + 2;
+  }
+  return i;
+}
+
+#endif /* TELEMETRY_LINK_H */
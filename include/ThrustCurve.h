@@ -0,0 +1,88 @@
+/**
+ * @file ThrustCurve.h
+ * @author @sebastiano123-c
+ * @brief Thrust linearization and battery sag compensation of the motor pulses.
+ *
+ * The thrust of a propeller does not grow linearly with the ESC pulse, and for the same pulse it drops
+ * as the battery drains, since the motor speed is proportional to the voltage it receives.
+ * The thrust is modelled as
+ *
+ *          thrust = (1 - expo) * x + expo * x^2,       x = command * voltage / referenceVoltage,
+ *
+ * being command = (pulse - 1000) / 1000 and expo the fitted curvature of the thrust curve.
+ * compensatePulse() reads the mixer output as the requested thrust, inverts the curve and rescales it by
+ * referenceVoltage / voltage, so that the same mixer output gives the same thrust for the whole discharge.
+ *
+ * These routines do not depend on the board, so they can be used by the host simulations in the /test dir.
+ *
+ * @version 0.1
+ * @date 2022-06-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cmath>
+#include <stdint.h>
+
+#ifndef THRUST_CURVE_H
+#define THRUST_CURVE_H
+
+/**
+ * @brief Normalized thrust given by a normalized command at the reference voltage.
+ *
+ * @param command (0-1) normalized command
+ * @param expo (0-1) curvature of the thrust curve
+ * @return float (0-1) normalized thrust
+ */
+inline float commandToThrust(float command, float expo){
+  return (1.0f - expo) * command + expo * command * command;
+}
+
+/**
+ * @brief Normalized command needed to get a normalized thrust at the reference voltage.
+ *
+ * @param thrust (0-1) normalized thrust
+ * @param expo (0-1) curvature of the thrust curve
+ * @return float (0-1) normalized command
+ */
+inline float thrustToCommand(float thrust, float expo){
+  if(expo < 1e-3f) return thrust;                                               // linear curve
+  return (-(1.0f - expo) + sqrtf((1.0f - expo) * (1.0f - expo) + 4.0f * expo * thrust)) / (2.0f * expo);
+}
+
+/**
+ * @brief Ratio between the reference voltage and the measured voltage.
+ *
+ * @param voltage (V) battery voltage under load
+ * @param referenceVoltage (V) voltage at which the thrust curve has been fitted
+ * @param minimumVoltage (V) below this the battery is considered not connected
+ * @return float scale to apply to the commands, limited to 0.8-1.4
+ */
+inline float voltageScale(float voltage, float referenceVoltage, float minimumVoltage){
+  if(voltage < minimumVoltage) return 1.0f;                                     // battery not connected, no compensation
+  float scale = referenceVoltage / voltage;
+  if(scale < 0.8f) scale = 0.8f;
+  else if(scale > 1.4f) scale = 1.4f;
+  return scale;
+}
+
+/**
+ * @brief Converts the mixer output into the ESC pulse giving the requested thrust.
+ *
+ * @param pulse (us) mixer output, 1000-2000
+ * @param scale referenceVoltage / voltage (see voltageScale())
+ * @param expo (0-1) curvature of the thrust curve
+ * @return int16_t (us) compensated pulse, 1000-2000
+ */
+inline int16_t compensatePulse(int16_t pulse, float scale, float expo){
+  float thrust = (float)(pulse - 1000) / 1000.0f;
+  if(thrust <= 0.0f) return pulse;
+  if(thrust > 1.0f) thrust = 1.0f;
+
+  float command = thrustToCommand(thrust, expo) * scale;
+  if(command > 1.0f) command = 1.0f;
+
+  return (int16_t)(1000.0f + command * 1000.0f + 0.5f);
+}
+
+#endif /* THRUST_CURVE_H */
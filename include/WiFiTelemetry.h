@@ -10,16 +10,31 @@
  *   @li ESP_CAM: allow you to use an ESP32-CAM mounting a OV2640 camera as a
  * telemetry system.
  *
- * NATIVE it is not actually a proper telemetry system since it allows only to
- * change PID very easily and on the fly, but not to see telemetry data. It is
- * so because the ping time between the message sent and the received positive
- * response is an eternity (like 10ms) with respect to the 4ms rate.
+ * NATIVE allows to change the PID very easily and on the fly, and shows the
+ * flight on the page. The page (web/index.html) is gzip'd at build time by
+ * web/gzip_web_ui.py and served as it is from the flash; it reads the values
+ * from "/parameters" (JSON) and sets them with "/set?<name>=<value>&...", a
+ * batch applied by the loop at its start (see Parameters.h). A request to the
+ * web server takes an eternity (like 10ms) with respect to the 4ms rate, so the
+ * loop never sends anything: every TELEMETRY_DECIMATION loops it copies a
+ * frame in a lock free queue, and the telemetry task on core 0 sends the
+ * frames in a binary message every TELEMETRY_PUSH_PERIOD on the WebSocket
+ * "/ws". The message is
+ *          frame size (uint16) | frames (uint16) | frames dropped (uint32) || frames
+ * and the frame is telemetryFrame (see Globals.h).
  *
  * ESP_CAM, connected to DroneIno accordingly to the documentation on GitHub,
  * provides a full telemetry system, a video streaming and the possibility to
- * set PID parameters back to DroneIno.
+ * set PID parameters back to DroneIno. Its firmware is in ../esp32cam: the
+ * two boards talk with the binary frames of TelemetryLink.h on the UART, the
+ * loop writing a frame only if the UART has room for it (it never waits).
  *
- * Both uses,
+ * MAVLINK speaks MAVLink v2 (see MAVLink.h) on the same UART, to a telemetry
+ * radio or a WiFi bridge: the ground station sees the flight and reads and sets
+ * the parameters (PARAM_SET is a batch, as above). The loop writes a message
+ * at most, at the rates of Config.h, only if there is time and room for it.
+ *
+ * NATIVE and ESP_CAM use,
  *  network name "DroneInoTelemetry"
  *  passwork "DroneIno"
  *  server IP "192.168.4.1"
@@ -34,6 +49,34 @@
  *
  */
 
+/**
+ * @brief Takes a frame of the flight, at the end of the control tick.
+ *
+ * @param frame
+ */
+void fillTelemetryFrame(telemetryFrame &frame) {
+  frame.time = millis();
+  frame.angle[0] = angleRoll;
+  frame.angle[1] = anglePitch;
+  frame.rate[0] = gyroRollInput;
+  frame.rate[1] = gyroPitchInput;
+  frame.rate[2] = gyroYawInput;
+  frame.setpoint[0] = pidRollSetpoint;
+  frame.setpoint[1] = pidPitchSetpoint;
+  frame.setpoint[2] = pidYawSetpoint;
+  frame.batteryVoltage = batteryVoltage;
+  frame.altitude = altitudeMeasure;
+  frame.latitude = latitudeGPS;
+  frame.longitude = longitudeGPS;
+  frame.esc[0] = esc1;
+  frame.esc[1] = esc2;
+  frame.esc[2] = esc3;
+  frame.esc[3] = esc4;
+  frame.loopTime = (uint16_t)(micros() - loopTimer);
+  frame.flightMode = flightMode;
+  frame.start = start;
+}
+
 #if WIFI_TELEMETRY == OFF
 
 void setupWiFiTelemetry() { return; }
@@ -41,22 +84,6 @@ void sendWiFiTelemetry() { return; }
 
 #elif WIFI_TELEMETRY == NATIVE
 
-/**
- *    (ESP32 BROWSER TAGS)
- */
-const char *P_ROLL_GET = "rollP";
-const char *I_ROLL_GET = "rollI";
-const char *D_ROLL_GET = "rollD";
-const char *P_YAW_GET = "yawP";
-const char *I_YAW_GET = "yawI";
-const char *D_YAW_GET = "yawD";
-const char *FILTER_P_R_GET = "filterPitchRoll";
-const char *ROLL_CORR_GET = "correctionRoll";
-const char *PITCH_CORR_GET = "correctionPitch";
-const char *P_ALTITUDE_GET = "altitudeP";
-const char *I_ALTITUDE_GET = "altitudeI";
-const char *D_ALTITUDE_GET = "altitudeD";
-
 /**
  * @brief Not found response.
  *
@@ -67,221 +94,67 @@ void notFound(AsyncWebServerRequest *request) {
 }
 
 /**
- * @brief HTML source of the web page.
+ * @brief Adds a value of a request to a batch: the name is a name of
+ * parameterTable or an id.
+ *
+ * @param batch
+ * @param name
+ * @param text the value
+ * @return true if the name and the number are good (the limits are checked later)
+ */
+bool addWebParameter(parameterBatch &batch, const char *name, const char *text) {
+
+  char *end;
+  float value = strtof(text, &end);
+  if (end == text || *end != 0)
+    return false;
+
+  int id = findParameter(name);
+  if (id < 0 && isdigit((unsigned char)name[0]))
+    id = atoi(name);
+  return addParameterUpdate(batch, id, value);
+}
+
+/**
+ * @brief Handler of /set: all the values of the request are applied together at the start of a loop,
+ * or none of them (400 if one is wrong, 503 if the loop has not taken the previous batches yet).
  *
- * @return const char*
+ * @param request
  */
-const char *index_html() {
-
-  String indexHTMLHead = R"rawliteral(<!DOCTYPE HTML><html><head>
-        <title>DroneInoTelemetry</title>
-        <meta name="viewport" content="width=device-width, initial-scale=1">
-        <style>
-        html {
-        font-family: Arial; 
-        display: inline-block; 
-        text-align: center;
-      }
-      p { 
-        font-size: 1.2rem;
-      }
-      body {  
-        margin: 0;
-      }
-      .topnav { 
-        overflow: hidden; 
-        background-color: #50B8B4; 
-        color: white; 
-        font-size: 1rem; 
-      }
-      .content { 
-        padding: 20px; 
-      }
-      .card { 
-        background-color: white; 
-        max-width: 500px; 
-        box-shadow: 2px 2px 12px 1px rgba(140,140,140,.5); 
-      }
-      .cards { 
-        max-width: 800px; 
-        margin: 0 auto; 
-        display: grid; 
-        grid-gap: 2rem; 
-        grid-template-columns: repeat(auto-fit, minmax(200px, 1fr)); }
-      .reading { 
-        font-size: 1.4rem;  
-      }
-      .pid-input{
-        max-width: 50px;
-      }
-      .pid-label{
-        background-color:teal;
-        color: white;
-      }
-      </style>
-    </head>)rawliteral";
-  String indexHTMLBody = indexHTMLHead + R"rawliteral(<body>
-        <div class="topnav">
-            <h1>PID values</h1>
-        </div>
-        <div class="content">
-            <div class="cards">
-                <div class="card">
-                    <p >  Pitch/Roll </p>
-                    <form action="get">
-                        P: <label class="pid-label" id="rollPVal">)rawliteral";
-  String rollPInput = indexHTMLBody + String(PID_P_GAIN_ROLL, 4);
-  String indexHTMLBody1 =
-      rollPInput +
-      R"rawliteral(</label><input class="pid-input" type="text" id="rollPInput" name="rollP">
-                        <input type="submit" id="rollP" onclick="showInput(this);" value="set">
-                    </form>
-                    <form action="get">
-                        I: <label class="pid-label" id="rollIVal">)rawliteral";
-  String rollIInput = indexHTMLBody1 + String(PID_I_GAIN_ROLL, 5);
-  String indexHTMLBody2 =
-      rollIInput +
-      R"rawliteral(</label><input class="pid-input" type="text" id="rollIInput" name="rollI">
-                        <input type="submit" id="rollI" onclick="showInput(this);" value="set">
-                    </form>
-                    <form action="get">
-                        D: <label class="pid-label" id="rollDVal">)rawliteral";
-  String rollDInput = indexHTMLBody2 + String(PID_D_GAIN_ROLL, 4);
-  String indexHTMLBody3 =
-      rollDInput +
-      R"rawliteral(</label><input class="pid-input" type="text" id="rollDInput" name="rollD">
-                        <input type="submit" id="rollD" onclick="showInput(this);" value="set">
-                    </form>
-                </div>
-                <div class="card">
-                    <p >  Yaw </p>
-                    <form action="get">
-                        P: <label class="pid-label" id="yawPVal">)rawliteral";
-  String yawPInput = indexHTMLBody3 + String(PID_P_GAIN_YAW, 4);
-  String indexHTMLBody4 =
-      yawPInput +
-      R"rawliteral(</label><input class="pid-input" type="text" id="yawPInput" name="yawP">
-                        <input type="submit" id="yawP" onclick="showInput(this);" value="set">
-                    </form>
-                    <form action="get">
-                        I: <label class="pid-label" id="yawIVal">)rawliteral";
-  String yawIInput = indexHTMLBody4 + String(PID_I_GAIN_YAW, 4);
-  String indexHTMLBody5 =
-      yawIInput +
-      R"rawliteral(</label><input class="pid-input" type="text" id="yawIInput" name="yawI">
-                        <input type="submit" id="yawI" onclick="showInput(this);" value="set">
-                    </form>
-                    <form action="get">
-                        D: <label class="pid-label" id="yawDVal">)rawliteral";
-  String yawDInput = indexHTMLBody5 + String(PID_D_GAIN_YAW, 4);
-  String indexHTMLBody6 =
-      yawDInput +
-      R"rawliteral(</label><input class="pid-input" type="text" id="yawDInput" name="yawD">
-                        <input type="submit" id="yawD" onclick="showInput(this);" value="set">
-                    </form>
-                </div>)rawliteral";
-
-  String indexHTMLBody7 = indexHTMLBody6 + R"rawliteral(<div class="card">
-                <p >  Gyroscope </p>
-                <form action="get">
-                  P/R filter: <label class="pid-label" id="filterPitchRollVal">)rawliteral";
-  String filterPitchRollHTML =
-      indexHTMLBody7 + String(GYROSCOPE_ROLL_FILTER, 4);
-  String indexHTMLBody8 =
-      filterPitchRollHTML +
-      R"rawliteral((&#37;)</label><input class="pid-input" type="text" id="filterPitchRollInput" name="filterPitchRoll">
-                  <input type="submit" id="filterPitchRoll" onclick="showInput(this);" value="set">
-                </form> 
-                <form action="get">
-                  roll corr.: <label class="pid-label" id="correctionRollVal">)rawliteral";
-  String corrRollHTML = indexHTMLBody8 + String(GYROSCOPE_ROLL_CORR, 4);
-  String indexHTMLBody9 =
-      corrRollHTML +
-      R"rawliteral((&deg;)</label><input class="pid-input" type="text" id="correctionRollInput" name="correctionRoll">
-                  <input type="submit" id="correctionRoll" onclick="showInput(this);" value="set">
-                </form> 
-                <form action="get">
-                  pitch corr.: <label class="pid-label" id="correctionPitchVal">)rawliteral";
-  String corrPitchHTML = indexHTMLBody9 + String(GYROSCOPE_PITCH_CORR, 4);
-  String indexHTMLBody10 =
-      corrPitchHTML +
-      R"rawliteral((&deg;)</label><input class="pid-input" type="text" id="correctionPitchInput" name="correctionPitch">
-                  <input type="submit" id="correctionPitch" onclick="showInput(this);" value="set">
-                </form> 
-              </div>)rawliteral";
-  String indexHTMLBody11 = indexHTMLBody10 + R"rawliteral(<div class="card">
-                <p >  Altitude </p>
-                <form action="get">
-                  P: <label class="pid-label" id="altitudePVal">)rawliteral";
-  String altitudePHTML = indexHTMLBody11 + String(PID_P_GAIN_ALTITUDE, 4);
-  String indexHTMLBody12 =
-      altitudePHTML +
-      R"rawliteral(</label><input class="pid-input" type="text" id="altitudePInput" name="altitudeP">
-                  <input type="submit" id="altitudeP" onclick="showInput(this);" value="set">
-                </form> 
-                <form action="get">
-                  I: <label class="pid-label" id="altitudeIVal">)rawliteral";
-  String altitudeIHTML = indexHTMLBody12 + String(PID_I_GAIN_ALTITUDE, 4);
-  String indexHTMLBody13 =
-      altitudeIHTML +
-      R"rawliteral(</label><input class="pid-input" type="text" id="altitudeIInput" name="altitudeI">
-                  <input type="submit" id="altitudeI" onclick="showInput(this);" value="set">
-                </form> 
-                <form action="get">
-                  D: <label class="pid-label" id="altitudeDVal">)rawliteral";
-  String altitudeDHTML = indexHTMLBody13 + String(PID_D_GAIN_ALTITUDE, 4);
-  String indexHTMLBody14 =
-      altitudeDHTML +
-      R"rawliteral(</label><input class="pid-input" type="text" id="altitudeDInput" name="altitudeD">
-                  <input type="submit" id="altitudeD" onclick="showInput(this);" value="set">
-                </form> 
-              </div>)rawliteral";
-  String indexHTMLBody15 = indexHTMLBody14 + R"rawliteral(</div>
-        <p> Don't forget these values! Copy them in the Constant.h file from <button id="copyToConstants" onclick="copyToConstants();">here</button> </p>
-        </div>
-        <script  type="text/javascript">
-          function showInput(elem) {
-            document.getElementById(elem.id+"Val").innerHTML = document.getElementById(elem.id+"Input").value;
-          }
-          // alert setup values
-          function copyToConstants(){
-            var stringToPrint = "";
-            stringToPrint += "PID_P_GAIN_ROLL            = " + document.getElementById("rollPVal").innerHTML + ";\n";
-            stringToPrint += "PID_I_GAIN_ROLL            = " + document.getElementById("rollIVal").innerHTML + ";\n";
-            stringToPrint += "PID_D_GAIN_ROLL            = " + document.getElementById("rollDVal").innerHTML + ";\n\n";
-            stringToPrint += "PID_P_GAIN_YAW             = " + document.getElementById("yawPVal").innerHTML + ";\n";
-            stringToPrint += "PID_I_GAIN_YAW             = " + document.getElementById("yawIVal").innerHTML + ";\n";
-            stringToPrint += "PID_D_GAIN_YAW             = " + document.getElementById("yawDVal").innerHTML + ";\n\n";
-            stringToPrint += "PID_P_GAIN_ALTITUDE        = " + document.getElementById("altitudePVal").innerHTML + ";\n";
-            stringToPrint += "PID_I_GAIN_ALTITUDE        = " + document.getElementById("altitudeIVal").innerHTML + ";\n";
-            stringToPrint += "PID_D_GAIN_ALTITUDE        = " + document.getElementById("altitudeDVal").innerHTML + ";\n\n";
-            stringToPrint += "GYROSCOPE_ROLL_FILTER      = " + document.getElementById("filterPitchRollVal").innerHTML + ";\n";
-            stringToPrint += "GYROSCOPE_ROLL_CORR        = " + document.getElementById("correctionRollVal").innerHTML + ";\n";
-            stringToPrint += "GYROSCOPE_PITCH_CORR       = " + document.getElementById("correctionPitchVal").innerHTML + ";\n";
-            alert(stringToPrint);
-          }
-        </script>
-      </body></html>)rawliteral";
-
-  return indexHTMLBody15.c_str();
+void setWebParameters(AsyncWebServerRequest *request) {
+
+  parameterBatch batch;
+  batch.count = 0;
+  bool good = true;
+  for (size_t i = 0; i < request->params() && good; i++) {
+    AsyncWebParameter *p = request->getParam(i);
+    good = addWebParameter(batch, p->name().c_str(), p->value().c_str());
+  }
+
+  parameterStatus status = good ? stageParameterUpdate(batch) : PARAMETERS_REFUSED;
+  if (DEBUG)
+    Serial.printf("wifi command: %i parameters, %s\n", batch.count, parameterStatusText[status]);
+
+  request->send_P(status == PARAMETERS_STAGED ? 200 : (status == PARAMETERS_BUSY ? 503 : 400), "text/plain",
+                  parameterStatusText[status]);
 }
 
 /**
- * @brief Substittue the HTML tag with the variable.
+ * @brief Writes the parameters as a JSON object {"rollP":0.6560,...}, in a buffer of the
+ * module (the server sends it from there, no String is made).
  *
- * @param var
- * @return String
+ * @param json
+ * @param size
+ * @return size_t the length
  */
-String processor(const String &var) {
-
-  if (var == "PITCHANGLE")
-    return String(anglePitch);
-  else if (var == "ROLLANGLE")
-    return String(angleRoll);
-  else if (var == "FLIGHTMODE")
-    return String(flightMode);
-  else if (var == "BATTERY")
-    return String(batteryPercentage);
+size_t writeParametersJSON(char *json, size_t size) {
+  size_t length = snprintf(json, size, "{");
+  for (int id = 0; id < PARAMETERS && length < size; id++)
+    length += snprintf(json + length, size - length, "%s\"%s\":%.6g", id > 0 ? "," : "",
+                       parameterTable[id].name, getParameter(id));
+  if (length < size)
+    length += snprintf(json + length, size - length, "}");
+  return length < size ? length : size - 1;
 }
 
 /**
@@ -295,115 +168,123 @@ void setupWiFiTelemetry() {
 
   // Serial.printf("\nIP address: " + WiFi.softAPIP() + "\n");
 
-  // Send web page with input fields to client
+  // the page, gzip'd in the flash (see web/index.html): the browser unzips it
   server.on("/", HTTP_GET, [](AsyncWebServerRequest *request) {
-    request->send(200, "text/html", index_html());
+    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", WEB_UI, WEB_UI_LENGTH);
+    response->addHeader("Content-Encoding", "gzip");
+    request->send(response);
   });
 
-  // Send a GET request to <ESP_IP>/get?input1=<inputMessage>
-  server.on("/get", HTTP_GET, [](AsyncWebServerRequest *request) {
-    String inputMessage;
-    String inputParam;
-    // pitch/roll
-    if (request->hasParam(P_ROLL_GET)) {
-      inputMessage = request->getParam(P_ROLL_GET)->value();
-      inputParam = P_ROLL_GET;
-      PID_P_GAIN_ROLL = inputMessage.toFloat();
-      PID_P_GAIN_PITCH = inputMessage.toFloat();
-    }
-    //
-    else if (request->hasParam(I_ROLL_GET)) {
-      inputMessage = request->getParam(I_ROLL_GET)->value();
-      inputParam = I_ROLL_GET;
-      PID_I_GAIN_ROLL = inputMessage.toFloat();
-      PID_I_GAIN_PITCH = inputMessage.toFloat();
-    }
-    //
-    else if (request->hasParam(D_ROLL_GET)) {
-      inputMessage = request->getParam(D_ROLL_GET)->value();
-      inputParam = D_ROLL_GET;
-      PID_D_GAIN_ROLL = inputMessage.toFloat();
-      PID_D_GAIN_PITCH = inputMessage.toFloat();
-    }
-    // yaw
-    else if (request->hasParam(P_YAW_GET)) {
-      inputMessage = request->getParam(P_YAW_GET)->value();
-      inputParam = P_YAW_GET;
-      PID_P_GAIN_YAW = inputMessage.toFloat();
-    } else if (request->hasParam(I_YAW_GET)) {
-      inputMessage = request->getParam(I_YAW_GET)->value();
-      inputParam = I_YAW_GET;
-      PID_I_GAIN_YAW = inputMessage.toFloat();
-    } else if (request->hasParam(D_YAW_GET)) {
-      inputMessage = request->getParam(D_YAW_GET)->value();
-      inputParam = D_YAW_GET;
-      PID_D_GAIN_YAW = inputMessage.toFloat();
-    }
-    // gyroscope
-    else if (request->hasParam(FILTER_P_R_GET)) {
-      inputMessage = request->getParam(FILTER_P_R_GET)->value();
-      inputParam = FILTER_P_R_GET;
-      GYROSCOPE_ROLL_FILTER = inputMessage.toFloat();
-      GYROSCOPE_PITCH_FILTER = inputMessage.toFloat();
-    } else if (request->hasParam(ROLL_CORR_GET)) {
-      inputMessage = request->getParam(ROLL_CORR_GET)->value();
-      inputParam = ROLL_CORR_GET;
-      GYROSCOPE_ROLL_CORR = inputMessage.toFloat();
-    } else if (request->hasParam(PITCH_CORR_GET)) {
-      inputMessage = request->getParam(PITCH_CORR_GET)->value();
-      inputParam = PITCH_CORR_GET;
-      GYROSCOPE_PITCH_CORR = inputMessage.toFloat();
-    }
-    // altitude
-    else if (request->hasParam(P_ALTITUDE_GET)) {
-      inputMessage = request->getParam(P_ALTITUDE_GET)->value();
-      inputParam = P_ALTITUDE_GET;
-      PID_P_GAIN_ALTITUDE = inputMessage.toFloat();
-    } else if (request->hasParam(I_ALTITUDE_GET)) {
-      inputMessage = request->getParam(I_ALTITUDE_GET)->value();
-      inputParam = I_ALTITUDE_GET;
-      PID_I_GAIN_ALTITUDE = inputMessage.toFloat();
-    } else if (request->hasParam(D_ALTITUDE_GET)) {
-      inputMessage = request->getParam(D_ALTITUDE_GET)->value();
-      inputParam = D_ALTITUDE_GET;
-      PID_D_GAIN_ALTITUDE = inputMessage.toFloat();
-    } else {
-      inputMessage = "No message sent";
-      inputParam = "none";
-    }
-    if (DEBUG)
-      Serial.printf("wifi command: %s\n", inputMessage.c_str());
-    if (DEBUG)
-      Serial.printf("wifi tag id: %s\n", inputParam.c_str());
-
-    request->send(200, "text/html", index_html());
+  // the values of the parameters, read by the page
+  server.on("/parameters", HTTP_GET, [](AsyncWebServerRequest *request) {
+    char json[PARAMETERS * 32];
+    writeParametersJSON(json, sizeof(json));
+    request->send(200, "application/json", json);             // the response keeps its own copy, sent later
   });
 
+  // a batch of parameters, /set?<name or id>=<value>&... (GET, or POST as a form)
+  server.on("/set", HTTP_GET, setWebParameters);
+  server.on("/set", HTTP_POST, setWebParameters);
+
+  server.addHandler(&ws);
   server.onNotFound(notFound);
   server.begin();
+
+  initTelemetryTask();
 }
 
 /**
- * @brief Updates '\events' of the web server with the sensor readings.
- * @note refresh rate browser is about 20 Hertz (i.e. they refresh the screen
- * about 20 times per second) - i.e. every 50 milliseconds, thus for flight
- * stability, with NATIVE WiFi, no telemetry is available.
+ * @brief Takes the oldest frame of the queue (telemetry task).
  *
- * @return * void
+ * @param frame
+ * @return true if there was one
  */
-void sendWiFiTelemetry() { return; }
+bool takeTelemetryFrame(telemetryFrame &frame) {
+  uint32_t tail = telemetryQueueTail.load(std::memory_order_relaxed);
+  if (tail == telemetryQueueHead.load(std::memory_order_acquire))
+    return false;
+
+  frame = telemetryQueue[tail & (TELEMETRY_QUEUE_SIZE - 1)];
+  telemetryQueueTail.store(tail + 1, std::memory_order_release); // the loop can write it again
+  return true;
+}
+
+/**
+ * @brief Sends the frames of the queue on the WebSocket, every TELEMETRY_PUSH_PERIOD (core 0).
+ *
+ * @param parameter
+ */
+void telemetryTask(void *parameter) {
+
+  // the message, out of the stack: the header, then the frames
+  static uint8_t message[sizeof(telemetryBatch) + TELEMETRY_QUEUE_SIZE * sizeof(telemetryFrame)];
+  telemetryBatch *batch = (telemetryBatch *)message;
+  telemetryFrame *frames = (telemetryFrame *)(message + sizeof(telemetryBatch));
+  TickType_t wake = xTaskGetTickCount();
+
+  for (;;) {
+    vTaskDelayUntil(&wake, TELEMETRY_PUSH_PERIOD / portTICK_PERIOD_MS);
+    ws.cleanupClients();
+
+    // take the frames anyway, so that the queue never fills without clients
+    uint16_t count = 0;
+    while (count < TELEMETRY_QUEUE_SIZE && takeTelemetryFrame(frames[count]))
+      count++;
+
+    if (count == 0 || ws.count() == 0 || !ws.availableForWriteAll())
+      continue;                                               // a slow client loses the batch, never the loop
+
+    batch->frameSize = sizeof(telemetryFrame);
+    batch->frames = count;
+    batch->dropped = telemetryDropped;
+    ws.binaryAll(message, sizeof(telemetryBatch) + count * sizeof(telemetryFrame));
+  }
+}
+
+/**
+ * @brief Starts the telemetry task on core 0.
+ *
+ */
+void initTelemetryTask() {
+  xTaskCreatePinnedToCore(telemetryTask, "telemetry", 4096, NULL, 1, &telemetryTaskHandle, 0);
+  diagnosticsWatchTask(telemetryTaskHandle, "telemetry"); // see Diagnostics.h
+}
+
+/**
+ * @brief Copies a frame of the flight in the queue every TELEMETRY_DECIMATION
+ * loops: the loop never waits for the WiFi, and if the queue is full the frame
+ * is dropped.
+ *
+ */
+void sendWiFiTelemetry() {
+
+  if (++telemetryLoops < TELEMETRY_DECIMATION)
+    return;
+  telemetryLoops = 0;
+
+  uint32_t head = telemetryQueueHead.load(std::memory_order_relaxed);
+  if (head - telemetryQueueTail.load(std::memory_order_acquire) == TELEMETRY_QUEUE_SIZE) {
+    telemetryDropped++;
+    return;
+  }
+
+  fillTelemetryFrame(telemetryQueue[head & (TELEMETRY_QUEUE_SIZE - 1)]);
+  telemetryQueueHead.store(head + 1, std::memory_order_release); // the task sees the frame only now
+}
 
 #elif WIFI_TELEMETRY == ESP_CAM
 
 HardwareSerial SUART(2);
 
 /**
- * @brief Setup the UART communication with ESP32-CAM.
+ * @brief Setup the UART communication with ESP32-CAM: the camera gets all the
+ * parameters first.
  * @note Web app link: 192.168.4.1
  *
  */
 void setupWiFiTelemetry() {
   SUART.begin(WIFI_BAUD_RATE, SERIAL_8N1, PIN_RX1, PIN_TX1);
+  linkParametersPending = (uint32_t)((1ULL << PARAMETERS) - 1);
 
 #if DEBUG
   Serial.println("SUART enabled");
@@ -411,166 +292,403 @@ void setupWiFiTelemetry() {
 }
 
 /**
- * @brief Writes on the UART serial the telemetry.
+ * @brief Writes a frame on the UART, only if the UART takes it without waiting.
  *
+ * @param type see linkType
+ * @param payload
+ * @param length
+ * @return true if written
  */
-void writeDataTransfer() {
+bool writeLinkFrame(uint8_t type, const void *payload, size_t length) {
+
+  uint8_t frame[LINK_MAX_FRAME];
+  size_t size = linkEncode(frame, type, payload, length);
+  if (size == 0 || SUART.availableForWrite() < (int)size)
+    return false;
+
+  SUART.write(frame, size);
 
-  // if(DEBUG) Serial.printf("I'm sending...\n");
-
-  // declarations
-  const char *stringToPrint = "";
-  static char staticCharToPrint[numChars];
-  char *sptr = staticCharToPrint;
-
-  // fill data structure before send
-  sptr += sprintf(sptr, "<%.3f,", angleRoll);//PGainRoll);
-  sptr += sprintf(sptr, "%.3f,", angleRoll);//PGainYaw);
-  sptr += sprintf(sptr, "%x,", flightMode);
-  sptr += sprintf(sptr, "%.1f,", batteryVoltage);
-  sptr += sprintf(sptr, "%.1f,", altitudeMeasure);
-  sptr += sprintf(sptr, "%i,", esc1); // trimCh[1].actual);
-  sptr += sprintf(sptr, "%i,", esc2); // trimCh[2].actual);
-  sptr += sprintf(sptr, "%i,", esc3); // trimCh[4].actual);
-  sptr += sprintf(sptr, "%i,", esc4); // trimCh[3].actual);
-  sptr += sprintf(sptr, "%.1f,", (float)gyroTemp / 340. + 36.53f);
-  sptr += sprintf(sptr, "%.7f,", latitudeGPS);
-  sptr += sprintf(sptr, "%.7f,", longitudeGPS);
-  sptr += sprintf(sptr, "%s\n>", timeUTC);
-
-  // close the string
-  *sptr++ = 0;
-
-  // print in csv format
-  stringToPrint = (const char *)staticCharToPrint;
-
-  SUART.print(stringToPrint);
-
-  // print
   #if DEBUG && defined(DEBUG_WIFI_SEND)
-    Serial.printf(" I'm sending: %s", stringToPrint);
+    Serial.printf(" I'm sending: frame %i, %i bytes\n", type, (int)size);
   #endif
+  return true;
 }
 
+/**
+ * @brief Writes on the UART serial the telemetry.
+ *
+ */
+void writeDataTransfer() {
+  telemetryFrame frame;
+  fillTelemetryFrame(frame);
+  writeLinkFrame(LINK_TELEMETRY, &frame, sizeof(frame));
+}
 
 /**
- * @brief Decode the incoming message in the form < a, b, ... >.
+ * @brief Writes on the UART the first parameter waiting for the camera.
  *
  */
-void recvWithStartEndMarkers() {
-  static boolean recvInProgress = false;
-  static int ndx = 0;
-  char startMarker = '<';
-  char endMarker = '>';
-  char rc;
-
-  while (SUART.available() && newData == false) {
-    rc = SUART.read();
-
-    if (recvInProgress == true) {
-      if (rc != endMarker) {
-        receivedChars[ndx] = rc;
-        ndx++;
-        if (ndx >= numChars) {
-          ndx = numChars - 1;
-        }
-      }
-      else {
-        receivedChars[ndx] = '\0'; // terminate the string
-        recvInProgress = false;
-        ndx = 0;
-        newData = true;
-      }
-    }
-    else if (rc == startMarker) {
-      recvInProgress = true;
-    }
+void writeLinkParameter() {
+
+  int id = 0;
+  while (!(linkParametersPending & (1UL << id)))
+    id++;
+
+  linkParameter parameter;
+  memset(&parameter, 0, sizeof(parameter));
+  parameter.id = id;
+  parameter.count = PARAMETERS;
+  parameter.value = getParameter(id);
+  strncpy(parameter.name, parameterTable[id].name, LINK_NAME_LENGTH - 1);
+
+  if (writeLinkFrame(LINK_PARAMETER, &parameter, sizeof(parameter)))
+    linkParametersPending &= ~(1UL << id);
+}
+
+/**
+ * @brief Converts a LINK_SET frame into a batch of parameters, applied at the
+ * start of the next loop, and answers with its LINK_STATUS. The parameters are
+ * sent back to the camera with their new values, once applied.
+ *
+ * @param frame
+ */
+void parseData(const linkFrame &frame) {
+
+  parameterBatch batch;
+  batch.count = 0;
+  bool good = frame.length >= 2 && frame.length == 2 + frame.payload[1] * LINK_SET_PAIR_SIZE;
+
+  for (int i = 0; good && i < frame.payload[1]; i++) {
+    const uint8_t *pair = frame.payload + 2 + i * LINK_SET_PAIR_SIZE;
+    float value;
+    memcpy(&value, pair + 1, sizeof(value));
+    good = addParameterUpdate(batch, pair[0], value);
   }
+
+  parameterStatus status = good ? stageParameterUpdate(batch) : PARAMETERS_REFUSED;
+  for (int i = 0; status == PARAMETERS_STAGED && i < batch.count; i++)
+    linkParametersStaged |= 1UL << batch.id[i];
+
+  uint8_t answer[2] = {frame.payload[0], (uint8_t)status};
+  writeLinkFrame(LINK_STATUS, answer, sizeof(answer));
+
+  #if DEBUG && defined(DEBUG_WIFI_REC)
+    Serial.printf("...........\n I'm reading: set %i, %i parameters, %s\n", answer[0], batch.count,
+                  parameterStatusText[status]);
+  #endif
 }
 
 /**
- * @brief COnverts the message < a, b, ... > into variables.
+ * @brief Reads from the UART serial the frames of the camera.
  *
  */
-void parseData() { // split the data into its parts
+void readDataTransfer() {
 
-  char *strtokIndx; // this is used by strtok() as an index
+  int available = SUART.available();
+  if (available > 0) {
+    size_t room = sizeof(linkReceived) - linkReceivedLength;
+    linkReceivedLength += SUART.readBytes(linkReceived + linkReceivedLength, (size_t)available < room ? available : room);
+  }
 
-  // fill data structure after receiving
-    strtokIndx = strtok(tempChars,","); PGainRoll     = atof(strtokIndx);
-    strtokIndx = strtok(NULL, ",");     IGainRoll     = atof(strtokIndx);
-    strtokIndx = strtok(NULL, ",");     DGainRoll     = atof(strtokIndx);
+  // the frames are read where they are, then the beginning of the next one is moved to the front
+  size_t used = 0;
+  linkFrame frame;
+  for (;;) {
+    used += linkScan(linkReceived + used, linkReceivedLength - used, frame, linkErrors);
+    if (frame.payload == NULL)
+      break;
+
+    if (frame.type == LINK_SET)
+      parseData(frame);
+    else if (frame.type == LINK_REQUEST)
+      linkParametersPending = (uint32_t)((1ULL << PARAMETERS) - 1);
+  }
+
+  if (used == 0 && linkReceivedLength == sizeof(linkReceived))
+    used = 1;                                                 // never stuck on a full buffer
+  linkReceivedLength -= used;
+  memmove(linkReceived, linkReceived + used, linkReceivedLength);
+}
 
-    PGainPitch    = PGainRoll;
-    IGainPitch    = IGainRoll;
-    DGainPitch    = DGainRoll;
+/**
+ * @brief Sends telemetry via uart to ESP32-CAM, and reads the incoming messages
+ * from the ESP32-CAM: a telemetry frame every TELEMETRY_DECIMATION loops, a
+ * parameter in the loops between.
+ *
+ */
+void sendWiFiTelemetry() {
 
-    strtokIndx = strtok(NULL, ",");     PGainYaw      = atof(strtokIndx);
-    strtokIndx = strtok(NULL, ",");     IGainYaw      = atof(strtokIndx);
-    strtokIndx = strtok(NULL, ",");     DGainYaw      = atof(strtokIndx);
+  // the batches staged in the previous loop are applied now
+  linkParametersPending |= linkParametersStaged;
+  linkParametersStaged = 0;
 
-    strtokIndx = strtok(NULL, ",");     GYROSCOPE_ROLL_FILTER = atof(strtokIndx);
-    GYROSCOPE_PITCH_FILTER  = GYROSCOPE_ROLL_FILTER;
-    strtokIndx = strtok(NULL, ",");     GYROSCOPE_ROLL_CORR = atof(strtokIndx);
-    strtokIndx = strtok(NULL, ",");     GYROSCOPE_PITCH_CORR  = atof(strtokIndx);
+  // reading from ESP32-CAM
+  readDataTransfer();
 
-    strtokIndx = strtok(NULL, ",");     PGainAltitude  = atof(strtokIndx);
-    strtokIndx = strtok(NULL, ",");     IGainAltitude  = atof(strtokIndx);
-    strtokIndx = strtok(NULL, ",");     DGainAltitude  = atof(strtokIndx);
+  // sending to ESP32-CAM
+  if (++telemetryLoops >= TELEMETRY_DECIMATION) {
+    telemetryLoops = 0;
+    writeDataTransfer();
+  }
+  else if (linkParametersPending != 0)
+    writeLinkParameter();
+}
 
-    
-    // signal the right reception of the message
-    ledcWrite(pwmLedChannel, abs((long)ledcRead(pwmLedChannel)-MAX_DUTY_CYCLE));
-    delay(10);
-    ledcWrite(pwmLedChannel, abs((long)ledcRead(pwmLedChannel)-MAX_DUTY_CYCLE));
 
+#elif WIFI_TELEMETRY == MAVLINK
 
-    #if DEBUG && defined(DEBUG_WIFI_REC)
-      Serial.printf("...........\n I'm reading: %s \n PID_ro (%f, %f, %f), PID_pi (%f, %f, %f), PID_ya (%f, %f, %f), corr(%f, %f, %f) PID_al(%f,%f,%f)\n", receivedChars, PID_P_GAIN_ROLL, PID_I_GAIN_ROLL, PID_D_GAIN_ROLL, PID_P_GAIN_PITCH, PID_I_GAIN_PITCH, PID_D_GAIN_PITCH,PID_P_GAIN_YAW, PID_I_GAIN_YAW, PID_D_GAIN_YAW, GYROSCOPE_ROLL_FILTER, GYROSCOPE_ROLL_CORR, GYROSCOPE_PITCH_CORR, PID_P_GAIN_ALTITUDE, PID_I_GAIN_ALTITUDE, PID_D_GAIN_ALTITUDE);
-    #endif
+HardwareSerial SUART(2);
 
+/**
+ * @brief Setup the UART of the ground station: the heartbeat goes first.
+ *
+ */
+void setupWiFiTelemetry() {
+  SUART.begin(WIFI_BAUD_RATE, SERIAL_8N1, PIN_RX1, PIN_TX1);
+
+#if DEBUG
+  Serial.println("MAVLink enabled");
+#endif
 }
 
+/**
+ * @brief Writes a message on the UART, only if the UART takes it without waiting.
+ *
+ * @param id see mavlinkMessageId
+ * @param payload the struct of the message
+ * @return true if written
+ */
+bool writeMAVLink(uint32_t id, const void *payload) {
+
+  uint8_t frame[MAVLINK_HEADER_SIZE + MAVLINK_MAX_PAYLOAD + 2];
+  size_t size = mavlinkEncode(frame, mavlinkSequence, MAVLINK_SYSTEM_ID, MAVLINK_COMPONENT_ID, id, payload);
+  if (size == 0 || SUART.availableForWrite() < (int)size)
+    return false;
+
+  SUART.write(frame, size);
+  mavlinkSequence++;
+
+  #if DEBUG && defined(DEBUG_WIFI_SEND)
+    Serial.printf(" I'm sending: MAVLink %i, %i bytes\n", (int)id, (int)size);
+  #endif
+  return true;
+}
 
 /**
- * @brief Read from the UART serial the PID parameters.
+ * @brief Writes a PARAM_VALUE. All the parameters are REAL32, the integers too.
  *
+ * @param id see parameterId
+ * @return true if written
  */
-void readDataTransfer() {
+bool writeMAVLinkParameter(int id) {
+  mavlinkParamValue message;
+  memset(&message, 0, sizeof(message));
+  message.paramValue = getParameter(id);
+  message.paramCount = PARAMETERS;
+  message.paramIndex = id;
+  mavlinkSetParamId(message.paramId, parameterTable[id].name);
+  message.paramType = MAV_PARAM_TYPE_REAL32;
+  return writeMAVLink(MAVLINK_MSG_PARAM_VALUE, &message);
+}
 
-  // decode message
-  recvWithStartEndMarkers();
+/**
+ * @brief Writes a message of mavlinkStreams, with the values of this loop.
+ *
+ * @param id see mavlinkMessageId
+ * @return true if written
+ */
+bool writeMAVLinkStream(uint32_t id) {
+
+  uint32_t time = millis();
+
+  if (id == MAVLINK_MSG_HEARTBEAT) {
+    mavlinkHeartbeat message;
+    memset(&message, 0, sizeof(message));
+    message.customMode = flightMode;
+    message.type = FRAME_TYPE == HEX_X ? MAV_TYPE_HEXAROTOR : (FRAME_TYPE == OCTO_X ? MAV_TYPE_OCTOROTOR : MAV_TYPE_QUADROTOR);
+    message.autopilot = MAV_AUTOPILOT_GENERIC;
+    message.baseMode = MAV_MODE_FLAG_CUSTOM_MODE_ENABLED | MAV_MODE_FLAG_STABILIZE_ENABLED |
+                       (start == 2 ? MAV_MODE_FLAG_SAFETY_ARMED : 0);
+    message.systemStatus = start == 2 ? MAV_STATE_ACTIVE : MAV_STATE_STANDBY;
+    message.mavlinkVersion = 3;
+    return writeMAVLink(id, &message);
+  }
+
+  if (id == MAVLINK_MSG_SYS_STATUS) {
+    uint32_t sensors = MAV_SYS_STATUS_SENSOR_3D_GYRO | MAV_SYS_STATUS_SENSOR_3D_ACCEL | MAV_SYS_STATUS_SENSOR_RC_RECEIVER;
+    if (ALTITUDE_SENSOR != OFF) sensors |= MAV_SYS_STATUS_SENSOR_ABSOLUTE_PRESSURE;
+    if (GPS != OFF) sensors |= MAV_SYS_STATUS_SENSOR_GPS;
+
+    mavlinkSysStatus message;
+    memset(&message, 0, sizeof(message));
+    message.sensorsPresent = message.sensorsEnabled = message.sensorsHealth = sensors;
+    message.load = (uint16_t)((micros() - loopTimer) / 4);    // (1/1000) of 4000us, up to here
+    message.voltageBattery = (uint16_t)(batteryVoltage * 1000.0f);
+    message.currentBattery = (int16_t)(batteryCurrent * 100.0f);
+    message.errorsComm = (uint16_t)linkErrors;
+    message.errorsCount[0] = (uint16_t)mavlinkSkipped;
+    message.batteryRemaining = (int8_t)batteryPercentage;
+    return writeMAVLink(id, &message);
+  }
 
-  if (newData == true) {
-    strcpy(tempChars, receivedChars);
-    // this temporary copy is necessary to protect the original data
-    //   because strtok() used in parseData() replaces the commas with \0
+  if (id == MAVLINK_MSG_ATTITUDE) {
+    mavlinkAttitude message;
+    message.timeBootMs = time;
+    message.roll = angleRoll * DEG_TO_RAD;
+    message.pitch = anglePitch * DEG_TO_RAD;
+    message.yaw = compassCalibrated ? headingDifference(angleYaw, 0.0f) * DEG_TO_RAD : 0.0f;   // the heading, with the compass
+    message.rollSpeed = gyroRollInput * DEG_TO_RAD;
+    message.pitchSpeed = gyroPitchInput * DEG_TO_RAD;
+    message.yawSpeed = gyroYawInput * DEG_TO_RAD;
+    return writeMAVLink(id, &message);
+  }
+
+  if (id == MAVLINK_MSG_GLOBAL_POSITION_INT) {
+    if (start != 2)
+      mavlinkGroundAltitude = estimatedAltitude;
+
+    mavlinkGlobalPositionInt message;
+    memset(&message, 0, sizeof(message));
+    message.timeBootMs = time;
+    message.lat = latActualGPS * 10;                          // (deg * 1e6) to (deg * 1e7)
+    message.lon = lonActualGPS * 10;
+    message.alt = (int32_t)(estimatedAltitude * 1000.0f);   // see Altitude.h
+    message.relativeAlt = (int32_t)((estimatedAltitude - mavlinkGroundAltitude) * 1000.0f);
+    message.vz = (int16_t)(-verticalSpeed * 100.0f);           // (cm/s) down positive
+    message.hdg = compassCalibrated ? (uint16_t)(angleYaw * 100.0f) : UINT16_MAX;               // (cdeg) unknown without the compass
+    return writeMAVLink(id, &message);
+  }
 
-    parseData();      // convert message to variables
-    newData = false;
+  if (id == MAVLINK_MSG_RC_CHANNELS) {
+    mavlinkRCChannels message;
+    memset(&message, 0xFF, sizeof(message));                  // UINT16_MAX: channel not used
+    message.timeBootMs = time;
+    message.chan[0] = receiverInputChannel1;
+    message.chan[1] = receiverInputChannel2;
+    message.chan[2] = receiverInputChannel3;
+    message.chan[3] = receiverInputChannel4;
+    message.chan[4] = receiverInputChannel5;
+    message.chanCount = 5;
+    message.rssi = 255;                                       // unknown
+    return writeMAVLink(id, &message);
   }
+
+  return false;
 }
 
 /**
- * @brief Sends telemetry via uart to ESP32-CAM, and reads the incoming messages
- * from the ESP32-CAM.
+ * @brief Answers a message of the ground station. A PARAM_SET becomes a batch applied at the start of the next
+ * loop, and its PARAM_VALUE goes back once applied: if it is refused, the PARAM_VALUE has the old value, as MAVLink
+ * wants.
+ *
+ * @param frame
+ */
+void parseMAVLink(const mavlinkFrame &frame) {
+
+  if (frame.id == MAVLINK_MSG_PARAM_REQUEST_LIST) {
+    mavlinkParamRequestList message;
+    mavlinkDecode(frame, &message, sizeof(message));
+    if (message.targetSystem == MAVLINK_SYSTEM_ID)
+      linkParametersPending = (uint32_t)((1ULL << PARAMETERS) - 1);
+  }
+
+  else if (frame.id == MAVLINK_MSG_PARAM_REQUEST_READ) {
+    mavlinkParamRequestRead message;
+    mavlinkDecode(frame, &message, sizeof(message));
+    char name[MAVLINK_PARAM_ID_LENGTH + 1] = {0};
+    memcpy(name, message.paramId, MAVLINK_PARAM_ID_LENGTH);
+    int id = message.paramIndex >= 0 ? message.paramIndex : findParameter(name);
+    if (message.targetSystem == MAVLINK_SYSTEM_ID && id >= 0 && id < PARAMETERS)
+      linkParametersPending |= 1UL << id;
+  }
+
+  else if (frame.id == MAVLINK_MSG_PARAM_SET) {
+    mavlinkParamSet message;
+    mavlinkDecode(frame, &message, sizeof(message));
+    char name[MAVLINK_PARAM_ID_LENGTH + 1] = {0};
+    memcpy(name, message.paramId, MAVLINK_PARAM_ID_LENGTH);
+    int id = findParameter(name);
+    if (message.targetSystem != MAVLINK_SYSTEM_ID || id < 0)
+      return;
+
+    parameterBatch batch;
+    batch.count = 0;
+    parameterStatus status = addParameterUpdate(batch, id, message.paramValue) ? stageParameterUpdate(batch)
+                                                                                : PARAMETERS_REFUSED;
+    if (status == PARAMETERS_STAGED)
+      linkParametersStaged |= 1UL << id;
+    else
+      linkParametersPending |= 1UL << id;
+
+    #if DEBUG && defined(DEBUG_WIFI_REC)
+      Serial.printf("...........\n I'm reading: PARAM_SET %s = %f, %s\n", name, message.paramValue,
+                    parameterStatusText[status]);
+    #endif
+  }
+}
+
+/**
+ * @brief Reads the messages of the ground station, then writes one message: the most late of mavlinkStreams
+ * (the heartbeat first), or a parameter. Nothing is written if the loop is already later than
+ * MAVLINK_LOOP_BUDGET.
  *
  */
 void sendWiFiTelemetry() {
 
-  // sending to ESP32-CAM
-  switch (refreshCounter) {
-  case 20: // refreshCounter * 4 ms
-    writeDataTransfer();
-    refreshCounter = 0;
-    break;
-  default:
-    refreshCounter++;
-    break;
+  // the batches staged in the previous loop are applied now
+  linkParametersPending |= linkParametersStaged;
+  linkParametersStaged = 0;
+  uint32_t loops = mavlinkLoops++;
+
+  // reading from the ground station
+  int available = SUART.available();
+  if (available > 0) {
+    size_t room = sizeof(linkReceived) - linkReceivedLength;
+    linkReceivedLength += SUART.readBytes(linkReceived + linkReceivedLength, (size_t)available < room ? available : room);
   }
 
-  // reading from ESP32-CAM
-  readDataTransfer();
+  size_t used = 0;
+  mavlinkFrame frame;
+  for (;;) {
+    used += mavlinkScan(linkReceived + used, linkReceivedLength - used, frame, linkErrors);
+    if (frame.payload == NULL)
+      break;
+    parseMAVLink(frame);
+  }
+
+  if (used == 0 && linkReceivedLength == sizeof(linkReceived))
+    used = 1;                                                 // never stuck on a full buffer
+  linkReceivedLength -= used;
+  memmove(linkReceived, linkReceived + used, linkReceivedLength);
+
+  // writing to the ground station
+  mavlinkStream *late = NULL;
+  for (size_t i = 0; i < sizeof(mavlinkStreams) / sizeof(mavlinkStreams[0]); i++) {
+    mavlinkStream &stream = mavlinkStreams[i];
+    if ((int32_t)(loops - stream.due) >= 0 && (late == NULL || (int32_t)(stream.due - late->due) < 0))
+      late = &stream;
+  }
+
+  if (micros() - loopTimer > MAVLINK_LOOP_BUDGET) {
+    if (late != NULL) {
+      mavlinkSkipped++;
+      late->due = loops + late->period;
+    }
+    return;
+  }
+
+  if (late != NULL && (late->id == MAVLINK_MSG_HEARTBEAT || linkParametersPending == 0)) {
+    if (!writeMAVLinkStream(late->id))
+      mavlinkSkipped++;
+    late->due = loops + late->period;                         // never a burst to catch up
+  }
+  else if (linkParametersPending != 0) {
+    int id = 0;
+    while (!(linkParametersPending & (1UL << id)))
+      id++;
+    if (writeMAVLinkParameter(id))
+      linkParametersPending &= ~(1UL << id);
+  }
 }
 
 #endif
@@ -33,11 +33,12 @@
 
 //      (BATTERY LEVEL)
 #define PIN_BATTERY_LEVEL           39                         // input pin to read the battery level
-#define PIN_BATTERY_CHANNEL         ADC1_CHANNEL_0             // ADC channel related to GPIO of PIN_BATTERY_LEVEL  
+#define PIN_BATTERY_CHANNEL         ADC1_CHANNEL_3             // ADC channel related to GPIO of PIN_BATTERY_LEVEL
+#define PIN_BATTERY_ADC_UNIT        1                          // ADC unit of PIN_BATTERY_CHANNEL
 
-// PROXIMITY_SENSOR
-// #define PIN_PROXIMITY_SENSOR_ECHO   26
-// #define PIN_PROXIMITY_SENSOR_TRIG   25
+//      (PROXIMITY SENSOR)
+#define PIN_PROXIMITY_SENSOR_ECHO   35                         // echo input, timed by interrupt
+#define PIN_PROXIMITY_SENSOR_TRIG   32                         // trigger output
 
 //      (I2C PINS)
 #define PIN_SDA                     21
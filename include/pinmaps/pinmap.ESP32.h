@@ -33,11 +33,12 @@
 
 //      (BATTERY LEVEL)
 #define PIN_BATTERY_LEVEL           13                         // input pin to read the battery level
-#define PIN_BATTERY_CHANNEL         ADC1_CHANNEL_0             // ADC channel related to GPIO of PIN_BATTERY_LEVEL  
+#define PIN_BATTERY_CHANNEL         ADC2_CHANNEL_4             // ADC channel related to GPIO of PIN_BATTERY_LEVEL
+#define PIN_BATTERY_ADC_UNIT        2                          // ADC unit of PIN_BATTERY_CHANNEL (ADC2 cannot be used with WIFI_TELEMETRY NATIVE)
 
-// PROXIMITY_SENSOR
-// #define PIN_PROXIMITY_SENSOR_ECHO   26
-// #define PIN_PROXIMITY_SENSOR_TRIG   25
+//      (PROXIMITY SENSOR)
+#define PIN_PROXIMITY_SENSOR_ECHO   18                         // echo input, timed by interrupt
+#define PIN_PROXIMITY_SENSOR_TRIG   5                          // trigger output
 
 //      (I2C PINS)
 #define PIN_SDA                     21
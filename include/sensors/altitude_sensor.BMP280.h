@@ -1 +1,2 @@
-#define ALTITUDE_SENSOR_ADDRESS 0x76             // if not working, try 0x77
\ No newline at end of file
+#define ALTITUDE_SENSOR_ADDRESS 0x76             // if not working, try 0x77
+#define ALTITUDE_SENSOR_SKIPPED 0x80000          // raw pressure of a measurement not done
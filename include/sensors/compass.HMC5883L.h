@@ -0,0 +1,10 @@
+#define COMPASS_ADDRESS         0x1E
+#define COMPASS_CONFIG_A        0x00                        // 8 samples averaged, 75Hz, normal measurement
+#define COMPASS_CONFIG_B        0x01                        // gain
+#define COMPASS_MODE            0x02                        // continuous or single measurement
+#define COMPASS_DATA            0x03                        // X, Z, Y, big endian
+#define COMPASS_IDENTIFICATION  0x0A                        // "H43"
+#define COMPASS_CONFIG_A_BITS   0x78
+#define COMPASS_CONFIG_B_BITS   0x20                        // +/- 1.3 Gauss, 1090 LSB/Gauss
+#define COMPASS_MODE_BITS       0x00                        // continuous
+#define COMPASS_OVERFLOW        -4096                       // reading of a saturated axis
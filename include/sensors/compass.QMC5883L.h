@@ -0,0 +1,7 @@
+#define COMPASS_ADDRESS         0x0D
+#define COMPASS_DATA            0x00                        // X, Y, Z, little endian
+#define COMPASS_CONTROL_1       0x09
+#define COMPASS_SET_RESET       0x0B
+#define COMPASS_IDENTIFICATION  0x0D                        // 0xFF
+#define COMPASS_CONTROL_1_BITS  0x1D                        // oversampling 512, +/- 8 Gauss, 200Hz, continuous
+#define COMPASS_SET_RESET_BITS  0x01                        // as the datasheet suggests
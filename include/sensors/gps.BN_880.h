@@ -1,2 +1 @@
-
-#define COMPASS_ADDRESS         0x1E
\ No newline at end of file
+// the compass of the BN 880 is a HMC5883L (a QMC5883L on the newer ones): see COMPASS in Config.h
@@ -0,0 +1,6 @@
+#define PROXIMITY_TRIGGER_US        10                        // (us) width of the trigger pulse
+#define PROXIMITY_CYCLE_MS          60                        // (ms) minimum time between two pings (datasheet)
+#define PROXIMITY_TIMEOUT_US        30000                     // (us) echo longer than this is out of range
+#define PROXIMITY_MIN_RANGE         0.02                      // (m) minimum measurable distance
+#define PROXIMITY_MAX_RANGE         4.00                      // (m) maximum measurable distance
+#define PROXIMITY_US_TO_M           0.0001715                 // (m/us) half the speed of sound at 20 C
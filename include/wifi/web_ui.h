@@ -0,0 +1,141 @@
+/**
+ * @file web_ui.h
+ * @brief web/index.html gzip'd (2648 bytes, 7532 before), written by web/gzip_web_ui.py: do not change it.
+ */
+
+const size_t WEB_UI_LENGTH = 2648;
+const uint8_t WEB_UI[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0xff, 0x9d, 0x59, 0x7b, 0x6f, 0xdb, 0x38, 0x12, 0xff, 0xbf, 0x9f,
+  0x82, 0xd1, 0xe2, 0x36, 0xf2, 0xad, 0x2d, 0xd9, 0x4e, 0xda, 0xcb, 0xf9, 0x55, 0xa4, 0x76, 0xd2, 0xf5, 0x21, 0xdb, 0x18,
+  0xa9, 0xdb, 0xa2, 0xc8, 0x05, 0x05, 0x2d, 0xd1, 0x36, 0x5b, 0x49, 0xd4, 0x52, 0x74, 0x1c, 0xb7, 0xc8, 0x77, 0xbf, 0x19,
+  0x52, 0x4f, 0x3f, 0x9a, 0x5c, 0x0d, 0xc4, 0x91, 0xc8, 0xe1, 0x6f, 0x9e, 0x9c, 0x21, 0xc7, 0xbd, 0xa3, 0xd1, 0xf5, 0x70,
+  0xfa, 0x79, 0x72, 0x41, 0xfe, 0x9c, 0xfe, 0x75, 0x35, 0xe8, 0x2d, 0x55, 0x18, 0xc0, 0x37, 0xa3, 0xfe, 0xe0, 0x05, 0x21,
+  0x3d, 0xc5, 0x55, 0xc0, 0x06, 0x23, 0x29, 0x22, 0x36, 0x8e, 0xc4, 0x94, 0x05, 0x2c, 0x64, 0x4a, 0x6e, 0x7a, 0xae, 0x99,
+  0x40, 0x12, 0x18, 0xa0, 0x24, 0xa2, 0x21, 0xeb, 0x5b, 0xf7, 0x9c, 0xad, 0x63, 0x21, 0x95, 0x45, 0x3c, 0x11, 0x29, 0x16,
+  0xa9, 0xbe, 0xb5, 0xe6, 0xbe, 0x5a, 0xf6, 0x7d, 0x76, 0xcf, 0x3d, 0xd6, 0xd0, 0x2f, 0x75, 0xc2, 0x23, 0xae, 0x38, 0x0d,
+  0x1a, 0x89, 0x47, 0x03, 0xd6, 0x6f, 0x59, 0x1a, 0xe6, 0xa8, 0xd1, 0x80, 0x7f, 0x84, 0x4c, 0xe8, 0x82, 0x11, 0x31, 0x27,
+  0x6a, 0xc9, 0x88, 0xca, 0xf8, 0xd5, 0x49, 0xc2, 0xe4, 0x3d, 0xf3, 0xc9, 0x6c, 0xa3, 0x27, 0xe6, 0x01, 0x5f, 0x2c, 0x95,
+  0xe6, 0x22, 0x45, 0x10, 0x30, 0x49, 0xec, 0x77, 0xe7, 0xd3, 0xf1, 0xc7, 0x0b, 0x24, 0x64, 0xc0, 0xc0, 0x0b, 0x56, 0x3e,
+  0x73, 0x3f, 0xf1, 0x4b, 0x9e, 0xcb, 0xec, 0x2c, 0x6b, 0x84, 0x46, 0x39, 0xc4, 0xc5, 0xfb, 0xc9, 0x49, 0xbb, 0x31, 0x3c,
+  0xff, 0x4b, 0x73, 0xb5, 0x59, 0x12, 0x9f, 0xb4, 0x3d, 0x1a, 0xba, 0xd9, 0xda, 0x21, 0x0d, 0xdf, 0x23, 0x4f, 0x09, 0xeb,
+  0x1c, 0x32, 0x56, 0x84, 0x27, 0x99, 0x10, 0x8b, 0xef, 0x3c, 0x3e, 0xf6, 0xc9, 0x5c, 0x8a, 0x30, 0x95, 0x86, 0x26, 0xcb,
+  0x0e, 0xa1, 0x73, 0x05, 0x82, 0x78, 0x4b, 0x1a, 0x2d, 0x78, 0xb4, 0x20, 0x5c, 0xd5, 0x89, 0x5c, 0x45, 0x1a, 0xde, 0x8a,
+  0x37, 0x6a, 0x29, 0x22, 0xb2, 0x66, 0x33, 0x17, 0x57, 0x7f, 0x81, 0x87, 0x2f, 0x2b, 0xee, 0xc4, 0x1b, 0x8b, 0xd8, 0x93,
+  0x80, 0xaa, 0xb9, 0x90, 0xe1, 0xf8, 0x1a, 0xe9, 0x13, 0x58, 0x48, 0x66, 0x0c, 0x06, 0x18, 0x61, 0xc0, 0x7e, 0x43, 0x66,
+  0x2b, 0x1e, 0xf8, 0x35, 0xa2, 0x04, 0x59, 0xc5, 0x3e, 0x55, 0x85, 0x7a, 0x6b, 0x3e, 0xe7, 0x6e, 0x8a, 0xb4, 0x74, 0x34,
+  0xa3, 0x29, 0x88, 0x73, 0x4f, 0x83, 0x15, 0x4b, 0xc0, 0x38, 0x21, 0x33, 0x32, 0xbe, 0xbd, 0x98, 0x12, 0x37, 0xa6, 0x12,
+  0x7c, 0x04, 0x12, 0x26, 0xc4, 0xfe, 0xcf, 0xfb, 0xeb, 0x77, 0xb5, 0x7a, 0x46, 0x48, 0x81, 0x53, 0xc2, 0x14, 0x59, 0x73,
+  0xb5, 0x34, 0xb4, 0xf0, 0xf6, 0xba, 0x87, 0x2e, 0x1d, 0xf4, 0x7b, 0x9a, 0x68, 0xf0, 0xbb, 0xe3, 0x38, 0xc4, 0xa6, 0x41,
+  0xa0, 0xb9, 0x18, 0xf7, 0x84, 0x84, 0x2a, 0xad, 0x7f, 0x02, 0x94, 0x24, 0x10, 0x22, 0xae, 0x13, 0x21, 0x49, 0x04, 0xb1,
+  0x02, 0xe0, 0x68, 0xea, 0xc2, 0x55, 0x7a, 0x19, 0x95, 0x92, 0xdf, 0x03, 0x43, 0x30, 0x04, 0xce, 0x7c, 0x62, 0xb3, 0xf7,
+  0xc2, 0xfb, 0x06, 0x9c, 0xdd, 0x35, 0x48, 0x91, 0x90, 0x19, 0x8f, 0x28, 0xe8, 0x3b, 0x47, 0x41, 0x41, 0x4a, 0xf4, 0x64,
+  0x1e, 0x01, 0x97, 0x38, 0x08, 0x9a, 0xe7, 0xca, 0xe7, 0x7e, 0xbd, 0xe2, 0xd1, 0x37, 0xf4, 0x51, 0xae, 0x7f, 0xee, 0x59,
+  0x92, 0x28, 0xc9, 0x68, 0x98, 0x68, 0x6e, 0xe0, 0x5b, 0x26, 0x29, 0x58, 0x51, 0xd4, 0x51, 0x80, 0xa5, 0x52, 0x71, 0xc7,
+  0x75, 0x7b, 0x4b, 0x91, 0xa8, 0x41, 0xe7, 0xac, 0xe5, 0x1a, 0x5a, 0x44, 0x69, 0x34, 0x74, 0x40, 0x26, 0x6a, 0x63, 0x22,
+  0x9c, 0x10, 0xdc, 0x14, 0xe4, 0x07, 0x99, 0x43, 0xb8, 0x35, 0xe6, 0x34, 0xe4, 0xc1, 0xa6, 0x43, 0xce, 0x25, 0x84, 0x70,
+  0x97, 0xf8, 0x3c, 0x89, 0x03, 0x0a, 0xef, 0x3c, 0x0a, 0x78, 0xc4, 0x1a, 0xb3, 0x00, 0x54, 0xea, 0x82, 0xdc, 0x0f, 0xaa,
+  0x41, 0x41, 0xf5, 0xa8, 0x43, 0x3c, 0xd8, 0x08, 0x4c, 0x76, 0xc9, 0xa3, 0xc6, 0x8a, 0x33, 0xa0, 0x84, 0x7f, 0x67, 0x1d,
+  0xd2, 0x72, 0xda, 0x92, 0x85, 0xd9, 0xe4, 0x4c, 0xf8, 0x1b, 0x98, 0x0f, 0xa9, 0x84, 0x10, 0xea, 0x90, 0x66, 0x36, 0xee,
+  0x28, 0x11, 0x47, 0xf4, 0x1e, 0xa6, 0x04, 0x84, 0xc4, 0x3c, 0x10, 0xeb, 0x0e, 0x59, 0x72, 0xdf, 0x67, 0x51, 0x97, 0xcc,
+  0xa8, 0xf7, 0x6d, 0x21, 0xc5, 0x2a, 0xf2, 0x1b, 0x9e, 0x08, 0x84, 0xec, 0x90, 0xdf, 0x5e, 0x36, 0xdf, 0x9c, 0xbd, 0x39,
+  0xed, 0x92, 0xf4, 0x7d, 0xbd, 0xe4, 0x8a, 0x75, 0x2b, 0x5c, 0x4b, 0x3c, 0x9d, 0x74, 0xaf, 0x02, 0x78, 0x4c, 0x7d, 0x1f,
+  0x42, 0xb7, 0x43, 0xda, 0xcd, 0xf8, 0xa1, 0x98, 0xa7, 0xd2, 0x87, 0xc9, 0x5d, 0x3e, 0x29, 0x6e, 0x48, 0x1f, 0xcc, 0xce,
+  0xee, 0x90, 0x97, 0x4d, 0xbd, 0x70, 0x26, 0x1e, 0x1a, 0xc9, 0x92, 0xfa, 0x28, 0x66, 0x3b, 0x7e, 0xd0, 0x7f, 0x2d, 0xfd,
+  0x05, 0x7f, 0x72, 0x31, 0xa3, 0x76, 0xeb, 0xb4, 0x59, 0xcf, 0xfe, 0x9c, 0x97, 0xb5, 0x0a, 0xaf, 0x44, 0x5b, 0x20, 0xc7,
+  0x3c, 0x33, 0x98, 0xb9, 0x4d, 0x08, 0x5d, 0x29, 0x51, 0x32, 0xfc, 0x42, 0x72, 0xbf, 0xab, 0xbf, 0x1b, 0x0b, 0x1a, 0x03,
+  0x43, 0xd4, 0x4d, 0xa3, 0xe5, 0x1f, 0x3d, 0xa9, 0x58, 0x08, 0x0b, 0x14, 0x43, 0xe9, 0x57, 0x61, 0x94, 0x74, 0x88, 0x64,
+  0x31, 0xa3, 0xca, 0x46, 0xbc, 0xc6, 0x1c, 0xb7, 0x6b, 0xc8, 0x23, 0x60, 0x6c, 0xb7, 0x91, 0x63, 0x9d, 0xb4, 0xe6, 0xb2,
+  0x56, 0x48, 0x06, 0xd1, 0x81, 0xb6, 0xd9, 0xf6, 0xde, 0x69, 0xd9, 0x92, 0x31, 0xb0, 0xe1, 0x51, 0xbc, 0x52, 0x55, 0x0d,
+  0x5e, 0x96, 0xad, 0x89, 0x34, 0x01, 0x9d, 0xb1, 0x60, 0xaf, 0x49, 0x15, 0xc3, 0xa0, 0xaa, 0xda, 0x37, 0x17, 0x60, 0xbe,
+  0x4a, 0xd8, 0x7e, 0x4f, 0xfc, 0xe6, 0x35, 0x4f, 0xfe, 0xdd, 0x9e, 0x95, 0xcc, 0xa8, 0x83, 0xfd, 0x69, 0x3b, 0x6a, 0x6b,
+  0xa5, 0x16, 0xad, 0xae, 0xe5, 0x21, 0xea, 0x9a, 0xae, 0x6d, 0x35, 0x9b, 0xff, 0x30, 0x04, 0x3d, 0x37, 0xdd, 0x17, 0x3d,
+  0x57, 0x17, 0x89, 0x1e, 0x86, 0xac, 0xde, 0x2f, 0x3e, 0xbf, 0x27, 0x1e, 0x64, 0xc2, 0xa4, 0x6f, 0x99, 0x68, 0xb5, 0xa0,
+  0x8e, 0xb4, 0x06, 0x93, 0xf1, 0x28, 0x4d, 0x34, 0xb0, 0xa2, 0x35, 0xe8, 0xb9, 0x40, 0xb7, 0x4d, 0x9f, 0x46, 0xa0, 0x65,
+  0x76, 0x5b, 0x65, 0x06, 0x63, 0xcf, 0x48, 0x64, 0x11, 0xee, 0xe3, 0x80, 0x79, 0x36, 0xd1, 0x3f, 0x48, 0xfd, 0xdc, 0x43,
+  0x69, 0x71, 0xda, 0xec, 0x62, 0x8b, 0xd0, 0x40, 0x15, 0xb4, 0x22, 0x0a, 0x04, 0xc5, 0xc9, 0xa5, 0x58, 0x0f, 0xf5, 0x98,
+  0xad, 0xe4, 0x8a, 0xd5, 0xba, 0x38, 0xc5, 0xa4, 0x14, 0xb2, 0x32, 0x37, 0xa7, 0x41, 0x82, 0x93, 0xa9, 0x34, 0x99, 0xc0,
+  0xbb, 0x82, 0x25, 0x99, 0x48, 0xf8, 0x98, 0x8b, 0xb2, 0x45, 0x94, 0x4f, 0xc0, 0x54, 0x3c, 0x20, 0x97, 0xa6, 0x72, 0xf5,
+  0xdc, 0xb8, 0x3c, 0x9e, 0x2d, 0x48, 0x83, 0xcc, 0x1a, 0x60, 0x55, 0x83, 0x14, 0x14, 0xd3, 0x48, 0xb3, 0xc0, 0x57, 0x6b,
+  0xd0, 0x00, 0xe3, 0xc3, 0xc8, 0xe0, 0x77, 0x9f, 0x2d, 0xba, 0x24, 0xe6, 0xca, 0x5b, 0x96, 0x68, 0xf4, 0xfb, 0x16, 0xd1,
+  0x53, 0x6c, 0x36, 0x74, 0x4d, 0x24, 0x96, 0x94, 0x02, 0x06, 0x86, 0x6e, 0x60, 0x64, 0x0b, 0xc8, 0x4d, 0x9e, 0x82, 0x9a,
+  0x51, 0xa5, 0xb0, 0x5a, 0x15, 0x48, 0xe9, 0x48, 0x81, 0xf4, 0x11, 0xdd, 0xc2, 0x15, 0x64, 0xef, 0x12, 0x55, 0x36, 0x54,
+  0x90, 0x6d, 0x71, 0x1a, 0x84, 0xa2, 0xb2, 0x00, 0x5f, 0x0b, 0x62, 0x5d, 0x77, 0x4a, 0xb3, 0xf8, 0x5a, 0xcc, 0xae, 0x12,
+  0xe2, 0x4b, 0x11, 0xc7, 0xb0, 0x6d, 0x0a, 0x92, 0x74, 0x64, 0x2f, 0xc3, 0xb2, 0xb7, 0x4b, 0x8f, 0xe0, 0xb8, 0x91, 0x88,
+  0x8e, 0x15, 0xec, 0x7d, 0xb9, 0x60, 0xba, 0xea, 0x25, 0x59, 0xa1, 0x3d, 0x22, 0x43, 0x11, 0x6f, 0x4c, 0x41, 0xe4, 0xa6,
+  0xb2, 0x0d, 0x45, 0x34, 0xe7, 0x0b, 0x67, 0x49, 0xe6, 0x3c, 0x48, 0x6b, 0x70, 0x6f, 0xb6, 0x52, 0x0a, 0xea, 0x8e, 0x80,
+  0xf2, 0xc5, 0xbd, 0x6f, 0x18, 0xf3, 0xf1, 0x66, 0x2a, 0x80, 0x32, 0x51, 0x34, 0x52, 0x89, 0x8d, 0x01, 0xb7, 0x64, 0x92,
+  0xf5, 0x5c, 0x43, 0x39, 0xc8, 0x62, 0xa4, 0xd8, 0x31, 0x89, 0x27, 0x79, 0x0c, 0xcc, 0x37, 0x31, 0x9c, 0xb5, 0xb0, 0xc2,
+  0xb8, 0x5f, 0xe9, 0x3d, 0x35, 0xa3, 0x69, 0x98, 0xb9, 0x2e, 0xc1, 0xa0, 0xab, 0x13, 0x9d, 0x62, 0xea, 0xa4, 0x54, 0xf5,
+  0xb1, 0xc4, 0x2b, 0x01, 0xd2, 0x2f, 0xf1, 0xb8, 0xa4, 0x4b, 0x33, 0x97, 0x89, 0x39, 0xd7, 0x40, 0xf0, 0x47, 0x50, 0xb3,
+  0x7d, 0xe6, 0xf1, 0x10, 0xa2, 0x1f, 0x32, 0x21, 0xf5, 0xa4, 0xc0, 0x3a, 0x9f, 0xa9, 0xa2, 0xd1, 0xef, 0xa9, 0x24, 0x52,
+  0x40, 0xb1, 0xee, 0x93, 0xdb, 0xd4, 0x60, 0xb7, 0xd6, 0x04, 0xe3, 0xce, 0xbd, 0xc1, 0x08, 0xad, 0x13, 0x6b, 0x02, 0x5f,
+  0xb7, 0x3a, 0x5e, 0xf1, 0xc9, 0x04, 0xe5, 0xc4, 0xba, 0xab, 0x93, 0x53, 0x9c, 0x1c, 0x8f, 0xbe, 0x4c, 0xbe, 0xbc, 0x3d,
+  0x1f, 0xbf, 0xfb, 0x72, 0x73, 0x7d, 0x75, 0x05, 0xc3, 0x07, 0x50, 0xc6, 0x39, 0xca, 0x38, 0x47, 0x19, 0x23, 0xca, 0xcb,
+  0x14, 0x65, 0xfc, 0x1c, 0x94, 0x51, 0x8e, 0x32, 0xca, 0x51, 0x46, 0x65, 0x59, 0x46, 0xfb, 0x51, 0x3e, 0xd3, 0x75, 0xa1,
+  0x0a, 0xec, 0x87, 0x7d, 0xf2, 0x7f, 0x3e, 0xff, 0xb4, 0x67, 0xc9, 0x38, 0x5b, 0x32, 0x2e, 0x2f, 0x19, 0xff, 0x6c, 0xc9,
+  0x28, 0x5b, 0xb2, 0x4f, 0xb2, 0xad, 0x25, 0x6f, 0x37, 0x52, 0x24, 0x10, 0x38, 0x4c, 0x8b, 0xe7, 0xde, 0x60, 0x7c, 0x81,
+  0x6f, 0x35, 0x82, 0x79, 0xcc, 0x54, 0x37, 0x6f, 0xda, 0x1c, 0x19, 0xec, 0xdb, 0xcf, 0x37, 0xd7, 0xef, 0x87, 0xd7, 0x93,
+  0x0b, 0xad, 0xef, 0x97, 0xcb, 0xf1, 0xd5, 0xf4, 0xe2, 0xe6, 0x20, 0xba, 0x4e, 0x40, 0x9e, 0x90, 0xd2, 0xd1, 0xe8, 0xf8,
+  0xc4, 0x3c, 0xc5, 0x45, 0xa4, 0x39, 0xec, 0x87, 0x1c, 0x5e, 0xdf, 0x1c, 0x06, 0x34, 0xe9, 0x6a, 0x1f, 0xe2, 0x01, 0x29,
+  0x27, 0xe3, 0xe9, 0xf0, 0xcf, 0x1d, 0xcc, 0xf3, 0x2c, 0x5d, 0xe4, 0x0e, 0xca, 0x12, 0xc8, 0x3e, 0x2f, 0x9d, 0x5f, 0x4d,
+  0xc7, 0xd3, 0x0f, 0xa3, 0x8b, 0x43, 0x08, 0xe3, 0x0a, 0xc2, 0x3e, 0xa7, 0x3d, 0x85, 0x30, 0xaa, 0x20, 0xec, 0xf3, 0x61,
+  0x81, 0xa0, 0x01, 0xee, 0xba, 0xf9, 0x56, 0x2a, 0x6d, 0xce, 0x3e, 0xf9, 0xf1, 0xd8, 0x7d, 0xa1, 0x67, 0xe6, 0xab, 0x48,
+  0x9b, 0xc5, 0x9c, 0xfb, 0x87, 0x58, 0x5c, 0xec, 0x1a, 0xf9, 0x91, 0x72, 0xc7, 0x75, 0xe6, 0x90, 0x84, 0x4b, 0xea, 0xfa,
+  0x0a, 0x44, 0xe1, 0xe0, 0x29, 0xe1, 0xdd, 0x17, 0xde, 0x2a, 0x84, 0x3a, 0xea, 0xc0, 0x26, 0xbf, 0xc0, 0xd3, 0x71, 0xa4,
+  0xde, 0x6c, 0xc6, 0xbe, 0x9d, 0x56, 0xa8, 0x5a, 0x76, 0x2a, 0xc2, 0x2d, 0xec, 0x40, 0x26, 0xbb, 0xa0, 0xde, 0xd2, 0xce,
+  0xd8, 0xd9, 0xb2, 0x60, 0x42, 0x08, 0x9f, 0x13, 0xfb, 0x48, 0x2f, 0xbb, 0x95, 0xb7, 0xcd, 0xbb, 0xbb, 0xf2, 0x1c, 0x21,
+  0xa5, 0x89, 0x32, 0x5b, 0x0f, 0x8a, 0x81, 0x62, 0x29, 0x67, 0xdb, 0x82, 0xb4, 0x55, 0xf0, 0xdc, 0x5a, 0xe6, 0xe8, 0xf2,
+  0xf1, 0x0e, 0xcf, 0xf4, 0x7d, 0x62, 0xea, 0xe4, 0x21, 0x4a, 0x1e, 0x81, 0x76, 0x78, 0x39, 0x45, 0x4a, 0xcc, 0xc4, 0x16,
+  0xf9, 0x83, 0xe0, 0x14, 0xfc, 0xb3, 0x74, 0x92, 0xac, 0x2e, 0xcd, 0x0c, 0xe2, 0x50, 0xc8, 0xf2, 0x91, 0x3f, 0x5c, 0x82,
+  0x15, 0xed, 0xb2, 0x2a, 0x05, 0xf5, 0x63, 0xfe, 0x84, 0x66, 0xc5, 0x3b, 0xd8, 0x4f, 0xd4, 0xc1, 0xe9, 0xb2, 0x3e, 0xf8,
+  0x5e, 0x11, 0x4e, 0xde, 0xb6, 0x50, 0xa6, 0xe3, 0x0e, 0xe9, 0x99, 0x03, 0x5e, 0x5a, 0x22, 0xf3, 0x13, 0x9f, 0x39, 0x2e,
+  0x1c, 0x6b, 0xf1, 0xdb, 0x77, 0x46, 0x83, 0xe3, 0x8f, 0xd4, 0x54, 0x76, 0x4d, 0x31, 0x80, 0xc9, 0xea, 0xd1, 0xb5, 0xfc,
+  0x39, 0xee, 0x99, 0xc3, 0x65, 0x09, 0x57, 0x0f, 0x58, 0xa5, 0x92, 0xb0, 0x97, 0xc7, 0x58, 0x53, 0x3d, 0x0f, 0xdc, 0x40,
+  0x25, 0xab, 0x59, 0xc8, 0x01, 0x4c, 0x97, 0x38, 0x78, 0x65, 0xb8, 0x7c, 0x4b, 0x77, 0x28, 0x5d, 0x9a, 0x0a, 0x54, 0xcf,
+  0x83, 0x08, 0xe2, 0x04, 0x0b, 0xcd, 0x24, 0x8b, 0x6c, 0x1b, 0xa5, 0x80, 0x43, 0xb4, 0x64, 0x6a, 0x25, 0x23, 0xa2, 0x8f,
+  0x56, 0x70, 0x90, 0x2c, 0x90, 0xca, 0x9e, 0x2e, 0x3b, 0x0c, 0x39, 0xe4, 0xc6, 0x7e, 0x4c, 0x9f, 0x1e, 0xb7, 0x76, 0x08,
+  0xd6, 0xad, 0x9c, 0x55, 0x79, 0x97, 0x3c, 0x33, 0xc2, 0x33, 0x13, 0x41, 0xd9, 0x2e, 0xf6, 0x62, 0xed, 0xe0, 0x3e, 0x2a,
+  0x2c, 0x6a, 0xa1, 0xd7, 0x6a, 0x15, 0xef, 0x17, 0x00, 0xb7, 0x29, 0xdd, 0x1d, 0xdc, 0xda, 0x2e, 0xf9, 0x03, 0xc3, 0x85,
+  0x27, 0x77, 0x4f, 0x2a, 0x83, 0x67, 0xd4, 0xbd, 0xca, 0xcc, 0x19, 0xe4, 0x47, 0xdb, 0x2a, 0xdd, 0xe0, 0x81, 0x35, 0xd4,
+  0xef, 0xa8, 0xa4, 0x19, 0x4b, 0x62, 0x70, 0x07, 0x43, 0xf3, 0xa7, 0xa6, 0xce, 0x86, 0x9c, 0xaf, 0x09, 0xfa, 0x05, 0x8c,
+  0x5e, 0xcb, 0x75, 0xdf, 0x5a, 0x8d, 0x14, 0x35, 0x7d, 0xfd, 0x2b, 0xe5, 0x23, 0x1c, 0xec, 0xee, 0x58, 0xb8, 0xbb, 0x2d,
+  0x3e, 0x1c, 0x38, 0x2a, 0xdd, 0x14, 0xb8, 0xf7, 0x27, 0x6b, 0x44, 0x68, 0x37, 0xdb, 0xa6, 0xa3, 0xa0, 0x3b, 0x04, 0xec,
+  0xef, 0x15, 0x8b, 0xbc, 0xbc, 0xb1, 0x03, 0x21, 0xd2, 0x21, 0x70, 0x93, 0xa0, 0x0a, 0x4e, 0x68, 0x70, 0xc7, 0x0f, 0xcc,
+  0x1d, 0xdd, 0xac, 0xcd, 0x88, 0x76, 0x9a, 0x3c, 0x5b, 0xce, 0x67, 0xea, 0x5c, 0xd3, 0xdb, 0xd8, 0xa9, 0x80, 0x33, 0x4b,
+  0xc9, 0x08, 0x2f, 0x4a, 0x3e, 0xce, 0xec, 0x90, 0x72, 0x3b, 0xea, 0xa3, 0x68, 0xe5, 0x48, 0x38, 0xe4, 0x6e, 0x0d, 0x5b,
+  0xf1, 0xb7, 0xde, 0x78, 0x57, 0x3c, 0x51, 0xe0, 0xd9, 0xc5, 0x22, 0x60, 0xb6, 0x95, 0x5e, 0xca, 0xa0, 0x08, 0x1c, 0xe5,
+  0x8c, 0xc4, 0xb7, 0x52, 0x96, 0x00, 0x29, 0xa7, 0x3c, 0x64, 0x62, 0xa5, 0xec, 0xaa, 0x83, 0xe1, 0x2c, 0xd3, 0x04, 0x73,
+  0xee, 0xfb, 0x80, 0x4d, 0x61, 0x2b, 0x04, 0xbc, 0xe8, 0x77, 0x45, 0xb0, 0xb3, 0xf5, 0x49, 0x37, 0xc7, 0x35, 0x5e, 0xce,
+  0x63, 0x2a, 0x8b, 0xfb, 0x4c, 0x06, 0x4c, 0x05, 0xf6, 0x76, 0x94, 0x64, 0x5e, 0x28, 0x2b, 0x5f, 0x92, 0xaf, 0xbc, 0x89,
+  0x4b, 0x79, 0x22, 0x0b, 0x3f, 0x63, 0xbf, 0xd7, 0x00, 0xd2, 0xc7, 0x0c, 0x9c, 0x83, 0x6d, 0x31, 0x31, 0x3e, 0x4c, 0xf3,
+  0x40, 0xd5, 0x41, 0xe9, 0x54, 0x11, 0x43, 0x5a, 0xf4, 0x3a, 0xf8, 0xe3, 0xe9, 0x9d, 0x5e, 0xce, 0x29, 0x1a, 0xae, 0x5a,
+  0x12, 0x75, 0x9e, 0x82, 0xa8, 0x05, 0x89, 0xe0, 0x7a, 0xf0, 0xe1, 0x66, 0x3c, 0x14, 0x21, 0x58, 0x02, 0x13, 0xf7, 0x73,
+  0xdc, 0x6b, 0x12, 0x64, 0xcd, 0xd1, 0x30, 0xb9, 0x30, 0x08, 0x0c, 0x4a, 0xc2, 0xa5, 0xa6, 0xaf, 0x1b, 0x9c, 0x89, 0x13,
+  0xd2, 0xb8, 0xd0, 0x14, 0x87, 0x4a, 0x1b, 0x0e, 0x5f, 0x11, 0x4b, 0x5b, 0x47, 0x03, 0xa1, 0xa2, 0xce, 0x57, 0xc1, 0x23,
+  0xdb, 0xfa, 0xbd, 0xa8, 0x1c, 0xb9, 0x3d, 0x99, 0x7a, 0x8d, 0xa4, 0x9a, 0xc3, 0xcf, 0x36, 0xf4, 0xe1, 0x40, 0xdf, 0xb7,
+  0x1b, 0x29, 0x6c, 0x14, 0x85, 0x6b, 0x56, 0x71, 0x7a, 0x41, 0xa9, 0x5a, 0x72, 0xe7, 0xde, 0x51, 0xb1, 0x23, 0xdc, 0x9f,
+  0xe1, 0x36, 0x37, 0x15, 0x13, 0xf8, 0x87, 0x89, 0xdd, 0xb2, 0xfe, 0x8f, 0x43, 0x43, 0x75, 0xf1, 0x1f, 0x7d, 0x4c, 0xb0,
+  0xa7, 0xa6, 0x4c, 0x1f, 0xfe, 0x80, 0xd5, 0xa1, 0x8c, 0x98, 0xa5, 0x76, 0x13, 0x82, 0xe1, 0x5f, 0x35, 0x6d, 0x45, 0x2c,
+  0xf3, 0x87, 0xab, 0xd5, 0x2f, 0xa4, 0x68, 0x18, 0xea, 0xfe, 0x37, 0xb2, 0xb6, 0x23, 0x8d, 0x18, 0x8b, 0xd9, 0x15, 0xe1,
+  0xf7, 0xe6, 0xb8, 0xb4, 0x31, 0x92, 0x66, 0xa7, 0x3c, 0xe3, 0xd5, 0x31, 0xcd, 0xe0, 0xa5, 0x8a, 0xe1, 0x55, 0x0a, 0x62,
+  0x6e, 0xb7, 0x46, 0xa5, 0x8d, 0x05, 0x73, 0xcd, 0xca, 0x0d, 0xf6, 0x93, 0xe3, 0x9a, 0xee, 0x5b, 0xd4, 0x1c, 0xd3, 0xe4,
+  0x00, 0x37, 0x1c, 0xe9, 0xa5, 0xdb, 0x42, 0xa5, 0x8d, 0xd2, 0x4a, 0xba, 0x34, 0x0d, 0xf0, 0xdd, 0xb6, 0xe9, 0x56, 0xbb,
+  0xb4, 0x2a, 0x23, 0x1c, 0xd1, 0x23, 0xd3, 0x8a, 0xdd, 0x0e, 0x07, 0xd3, 0x9f, 0x85, 0xf0, 0x67, 0xeb, 0xa2, 0x5f, 0x6b,
+  0x5b, 0xeb, 0xa4, 0xe3, 0xba, 0x18, 0xbc, 0x81, 0xf0, 0x28, 0x42, 0x38, 0xd8, 0x47, 0x45, 0x13, 0xbb, 0xeb, 0xd2, 0x41,
+  0xd3, 0x2c, 0x77, 0x4c, 0x5f, 0x77, 0x0a, 0x07, 0x0b, 0x8c, 0x28, 0x2a, 0x25, 0xdd, 0xcc, 0x56, 0xf3, 0x39, 0x5c, 0x5c,
+  0xb6, 0x08, 0xf1, 0x72, 0x2c, 0x12, 0xb6, 0xe7, 0x40, 0x91, 0xe5, 0xa8, 0x42, 0xd2, 0x3a, 0x36, 0xa5, 0x30, 0x83, 0x3e,
+  0xee, 0x80, 0x80, 0x51, 0x12, 0xfc, 0x15, 0xa1, 0x04, 0xc3, 0xee, 0xc1, 0xba, 0xe5, 0x58, 0xd5, 0x49, 0x83, 0x83, 0x56,
+  0x46, 0xb7, 0x11, 0x55, 0xf4, 0x23, 0xbc, 0x1a, 0x42, 0xc7, 0x87, 0xd7, 0x52, 0x8e, 0xd2, 0xa6, 0xe0, 0xdf, 0x11, 0x11,
+  0xd7, 0xa0, 0xc3, 0x3e, 0x40, 0x94, 0xb4, 0x5e, 0x61, 0xc0, 0xea, 0x56, 0x52, 0x3d, 0x73, 0xc6, 0x0e, 0x45, 0x3b, 0xa5,
+  0xe8, 0x56, 0x4e, 0x1e, 0x19, 0x75, 0x9f, 0x34, 0x6b, 0x5b, 0xb9, 0x3c, 0x3d, 0x8c, 0x02, 0xd2, 0x19, 0x18, 0x34, 0xa3,
+  0x6c, 0x90, 0x56, 0x8d, 0xfc, 0x53, 0x4b, 0xb1, 0xbf, 0x68, 0x64, 0x51, 0x0a, 0x25, 0x4a, 0x19, 0x61, 0xb0, 0xef, 0xb5,
+  0x79, 0xb2, 0xca, 0x99, 0xde, 0x52, 0xf5, 0x2c, 0x93, 0xa9, 0x70, 0x09, 0x25, 0x4b, 0x9d, 0xb4, 0xed, 0x39, 0x08, 0x72,
+  0x9a, 0xea, 0x91, 0x1f, 0x6a, 0x5a, 0x25, 0x95, 0x0e, 0x82, 0x9b, 0xa6, 0xd4, 0xd3, 0xe8, 0x67, 0xbf, 0x84, 0x9e, 0xf5,
+  0xaa, 0x9e, 0xc6, 0x6f, 0x37, 0x7f, 0x89, 0x41, 0xd6, 0xc2, 0x7a, 0x9a, 0xc1, 0xc9, 0xab, 0x6d, 0x06, 0xed, 0xe7, 0x30,
+  0xc8, 0xbb, 0x5f, 0xcf, 0x70, 0xc0, 0xaf, 0xa9, 0xa0, 0x1b, 0x62, 0xfb, 0xd1, 0xd3, 0x08, 0x45, 0xf0, 0x57, 0xcd, 0x9d,
+  0x30, 0x3d, 0x88, 0xa8, 0x1b, 0x70, 0x87, 0x11, 0xcf, 0x0c, 0xe0, 0xb3, 0xd4, 0xcf, 0x5a, 0x71, 0x87, 0xd1, 0x40, 0xf9,
+  0xd3, 0x2d, 0xd1, 0x1e, 0x2b, 0x79, 0xb0, 0x7c, 0x4b, 0x36, 0x13, 0xdb, 0x07, 0x69, 0x33, 0x7a, 0x50, 0x86, 0xb4, 0x65,
+  0x0c, 0x65, 0x48, 0x7a, 0x98, 0x9f, 0xd2, 0x5f, 0x86, 0x76, 0xb2, 0x5b, 0x56, 0xdf, 0x8b, 0x1f, 0x8b, 0xd2, 0xf4, 0x55,
+  0xce, 0x9e, 0x5d, 0xd3, 0x22, 0xd7, 0x2d, 0x39, 0xec, 0x91, 0xeb, 0xee, 0x78, 0xcf, 0xd5, 0xbf, 0xaa, 0xbe, 0xf8, 0x1f,
+  0xea, 0x5a, 0x7d, 0xf4, 0x6c, 0x1d, 0x00, 0x00,
+};
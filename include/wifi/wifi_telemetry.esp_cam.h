@@ -1,7 +1,7 @@
 /**
  * @file wifi_telemetry.esp_cam.h
  * @author @sebastiano123-c
- * @brief Defines the UART serial port for the communication with the ESP32-CAM.
+ * @brief Defines the UART serial port for the communication with the ESP32-CAM (or the ground station, with MAVLINK).
  * @version 0.1
  * @date 2022-02-28
  * 
@@ -1,7 +1,7 @@
 /**
  * @file wifi_telemetry.native.h
  * @author @sebastiano123-c
- * @brief Defines the server port and the events location for the native ESP32 WiFi connection.
+ * @brief Defines the server port, the events and the WebSocket locations for the native ESP32 WiFi connection.
  * @version 0.1
  * @date 2022-02-28
  * 
@@ -14,9 +14,13 @@
 #include <WiFiAP.h>
 #include "AsyncTCP.h"
 #include "ESPAsyncWebServer.h"
+#include "web_ui.h"                                           // the page, see web/index.html
 
 // server
 AsyncWebServer server(80);
 
 // Create an Event Source on /events
-AsyncEventSource events("/events");
\ No newline at end of file
+AsyncEventSource events("/events");
+
+// binary frames of the flight on /ws
+AsyncWebSocket ws("/ws");
\ No newline at end of file
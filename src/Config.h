@@ -55,6 +55,13 @@
  *
  *
  *
+ *                               PROXIMITY:
+ *
+ * Set the name of the ultrasonic rangefinder pointing to the ground, if you got.
+ * Below a few meters it refines the barometer readings for takeoff and landing.
+ *
+ *
+ *
  *                                  GPS:
  *
  * Set GPS type, if you got, or leave OFF if you are not using a GPS at all.
@@ -64,12 +71,18 @@
  *
  *
  *
+ *                                COMPASS:
+ *
+ * Set the magnetometer type, if you got, or leave OFF. Calibrate it with the CALIBRATION
+ * sketch (dial c) before flying: the GPS hold uses its heading.
+ *
+ *
+ *
  *                                BATTERY:
  *
  * In this part you set the battery specs, the resistances R1 and R2 you have used for
  * the voltage divider, and more.
- * Battery readings can be useful to compensate the voltage lowering, but, until now, this
- * feature is not stable, thus leave BATTERY_COMPENSATION false.
+ * Battery readings can be used to compensate the voltage lowering through BATTERY_COMPENSATION.
  *
  *
  *
@@ -78,8 +91,9 @@
  * DroneIno uses WiFi for telemetry.
  * It involves the NATIVE ESP32 WiFi access point (AP). Using this, you can easily set PID
  * parameters for the PID adjustment (without continuing stopping and uploading the code).
- * Remember to write the PID changing on a paper or whatever. Indeed, when you turn off the drone,
- * the PID parameter changed are NOT saved anywhere.
+ * The PID parameters changed are saved on the flash PARAMETERS_COMMIT_DELAY after the last change,
+ * with the motors off, so the drone keeps them when you turn it off; set PARAMETERS_RESET true to
+ * go back to the values of this file.
  * On the other hand, as said in the documentation, it is preferable to configure an
  * external ESP32-CAM. This choice will bring:
  *      @li video streaming;
@@ -112,6 +126,8 @@
  * @date 2022-03-30
  * @copyright Copyright (c) 2022
  */
+#ifndef CONFIG_H
+#define CONFIG_H
 
 
 
@@ -153,9 +169,30 @@
  *      LEDC is the most secure, is the one I have used until now. On the other hand, MCPWM seems to be
  *      designed properly for motor control. So far, I noticed that MCPWM, in some ways, has a bigger energy cost
  *      than LEDC (researches are now on the way).
+ *      MOTOR_PULSE_BY_DSHOT sends the pulses as DShot digital frames using the RMT peripheral: your ESCs
+ *      must support DShot (BLHeli_S, BLHeli_32, AM32) and they do not need the calibration.
+ *      With DSHOT_BIDIRECTIONAL the ESCs send back the motor eRPM (BLHeli_32 or BLHeli_S with Bluejay firmware).
+ *      MOTOR_PULSE_BY_ONESHOT sends one OneShot125 or Multishot pulse per loop, right after the mixer, while LEDC
+ *      and MCPWM repeat the pulse at their own frequency. Your ESCs must support the protocol and be calibrated.
  */
 // #define MOTOR_PULSE_BY_MCPWM              // NOT TESTED YET
 #define MOTOR_PULSE_BY_LEDC
+// #define MOTOR_PULSE_BY_DSHOT
+// #define MOTOR_PULSE_BY_ONESHOT
+#define ONESHOT_PROTOCOL            ONESHOT125              // (ONESHOT125, MULTISHOT)
+#define DSHOT_SPEED                 600                     // (150, 300, 600) DShot bit rate in kbit/s
+#define DSHOT_BIDIRECTIONAL         false                   // (true, false) true to read the motors eRPM
+#define MOTOR_POLES                 14                      // number of magnets of the motor bell (eRPM = RPM * poles / 2)
+/**
+ *      (FRAME)
+ *      The frame type selects the mixer table, i.e. how roll, pitch and yaw are shared among the motors (see Mixer.h).
+ *      When a motor saturates, the mixer moves the throttle instead of clipping the motor, so the drone keeps the
+ *      ratio between roll, pitch and yaw. With MIXER_AIRMODE the throttle is also raised at low throttle, so the
+ *      drone stays controllable when the throttle stick is at the bottom.
+ *      * only four ESC outputs are available so far: HEX_X and OCTO_X can be used in the host programs.
+ */
+#define FRAME_TYPE                  QUAD_X                  // (QUAD_X, QUAD_PLUS, HEX_X*, OCTO_X*)
+#define MIXER_AIRMODE               false                   // (true, false)
 /**p
  * 
  *      (DEBUG MODE)
@@ -169,12 +206,44 @@
 // #define DEBUG_GYRO
 // #define DEBUG_BATTERY
 // #define DEBUG_ESC
+// #define DEBUG_DSHOT
 // #define DEBUG_ALTITUDE
+// #define DEBUG_PROXIMITY
 // #define DEBUG_AUTOPID
 // #define DEBUG_PID
 // #define DEBUG_PID_SIGNALS
 // #define DEBUG_WIFI_SEND
 // #define DEBUG_WIFI_REC
+/**
+ *      (FLIGHT RECORDER)
+ *      If true, the FLIGHT_CONTROLLER sketch writes on the serial the raw inputs of every loop (gyroscope, barometer,
+ *      GPS, receiver and battery) and the time spent in each part of the loop, see FlightRecorder.h.
+ *      Save the serial with a logger at RECORDER_BAUD_RATE and replay the flight on your computer with
+ *      test/simulator/replay.cpp. DEBUG must be false, since the serial is used by the recorder.
+ */
+#define FLIGHT_RECORDER             false                    // (true, false)
+#define RECORDER_BAUD_RATE          921600                   // (230400, 460800, 921600)
+/**
+ *      (DIAGNOSTICS)
+ *      If true, the FLIGHT_CONTROLLER sketch counts the memory taken from the heap by each part of the loop, String
+ *      included, and prints on the serial, every DIAGNOSTICS_PERIOD, the free heap, the stack never used by the tasks
+ *      and the allocations done inside the control loop, see Diagnostics.h. It cannot be used with the FLIGHT_RECORDER.
+ *      With DIAGNOSTICS_STRICT true the board stops at the first allocation inside the control loop: use it only on
+ *      the bench, without propellers.
+ */
+#define DIAGNOSTICS                 false                    // (true, false)
+#define DIAGNOSTICS_STRICT          false                    // (true, false)
+#define DIAGNOSTICS_PERIOD          5000                     // (ms) between two reports
+/**
+ *      (PARAMETERS)
+ *      The PID gains and the gyroscope settings changed by the telemetry are saved on the flash, see Parameters.h,
+ *      and the next flights start from them. The flash is written PARAMETERS_COMMIT_DELAY after the last change, and
+ *      only while the motors are off. Set PARAMETERS_RESET true for a flight to go back to the values of this file.
+ *      The telemetry sends the changes in batches, applied all together at the start of a loop.
+ */
+#define PARAMETERS_COMMIT_DELAY     1000                     // (ms) from the last change to the flash writing
+#define PARAMETERS_RESET            false                    // (true, false)
+#define PARAMETERS_QUEUE_SIZE       4                        // (batches) a power of 2, waiting for the next loop
 /**
  *      (SKETCH CONSTANTS)
  */
@@ -231,16 +300,21 @@
 #define PID_MAX_YAW                 400                       //Maximum output of the PID-controller     (+/-)
 /**
  *      ALTITUDE
+ *      On the estimated altitude and vertical speed (see Altitude.h), at every loop.
  */
-#define PID_P_GAIN_ALTITUDE         1.4f                      //Gain setting for the altitude P-controller (default = 1.4).
-#define PID_I_GAIN_ALTITUDE         0.3f                      //Gain setting for the altitude I-controller (default = 0.2).
-#define PID_D_GAIN_ALTITUDE         0.75f                     //Gain setting for the altitude D-controller (default = 0.75).
+#define PID_P_GAIN_ALTITUDE         50.0f                     //Gain setting for the altitude P-controller, (us) per (m) of error (default = 50.0).
+#define PID_I_GAIN_ALTITUDE         15.0f                     //Gain setting for the altitude I-controller, (us/s) per (m) of error (default = 15.0).
+#define PID_D_GAIN_ALTITUDE         60.0f                     //Gain setting for the altitude D-controller, (us) per (m/s) of vertical speed (default = 60.0).
 #define PID_MAX_ALTITUDE            400                       //Maximum output of the PID-controller (+/-).
 /**
  *      GPS 
+ *      Two loops, see GPS.h: the position error asks a velocity, the velocity error asks a tilt of the drone.
  */
-#define PID_P_GAIN_GPS              2.7f                      //Gain setting for the GPS P-controller (default = 2.7).
-#define PID_D_GAIN_GPS              6.5f                      //Gain setting for the GPS D-controller (default = 6.5).
+#define PID_P_GAIN_GPS              0.8f                      //Gain of the position loop, (m/s) asked per (m) of error (default = 0.8).
+#define PID_D_GAIN_GPS              6.0f                      //P gain of the velocity loop, (deg) of tilt per (m/s) of error (default = 6.0).
+#define PID_I_GAIN_GPS              1.5f                      //I gain of the velocity loop, (deg/s) per (m/s) of error: holds against the wind (default = 1.5).
+#define PID_MAX_GPS_SPEED           3.0f                      //(m/s) at most asked by the position error.
+#define PID_MAX_GPS_ANGLE           20.0f                     //(deg) tilt at most asked by the GPS controller.
 
 
 
@@ -249,9 +323,21 @@
  * AUTOMATIC PID:
  * 
  *      Auto-tune PID allow DroneIno to adjust on run the PID parameters to best fit the environmental changes.
- *      If false, the following PID values are set. If true the drone auto calibrates the parameters
+ *      If false, the following PID values are set. If true the drone auto calibrates the parameters.
+ *      In the simulator (test/simulator, -DSIMULATOR_AUTOTUNE) the tuned gains still fly with a rate error 30 to
+ *      60 times the one of the manual gains: set it false to fly with the following PID values.
+ *      When true the telemetry cannot change the gains of roll, pitch and yaw: the new values are refused ("tuned").
  */
 #define AUTOTUNE_PID_GYROSCOPE      true                      // (false, true), "true" is now on testing.
+/**
+ *      The networks learn on core 0, from a sample of the loop every AUTOTUNE_DECIMATION loops, and the new gains
+ *      reach the PIDs every AUTOTUNE_PUBLISH_PERIOD at most, each one changing by AUTOTUNE_GAIN_RATE per second
+ *      at most (1.0 means 100% of its value).
+ */
+#define AUTOTUNE_DECIMATION         2                         // (loops) between two samples, 2 => 125Hz
+#define AUTOTUNE_PUBLISH_PERIOD     40                        // (ms) between two updates of the PID gains
+#define AUTOTUNE_GAIN_RATE          1.0                       // (1/s) maximum relative change of a gain
+#define AUTOTUNE_QUEUE_SIZE         16                        // (samples) a power of 2
 
 
 
@@ -265,6 +351,27 @@
  *      In the future, I will test other sensors.
  */
 #define ALTITUDE_SENSOR             BMP280                   // (OFF, BMP280*, BME280**)
+/**
+ *      The barometer altitude corrects the vertical acceleration of the MPU-6050, which is integrated at every loop
+ *      (see AltitudeEstimator.h): the barometer wins in about ALTITUDE_ESTIMATOR_TIME. Shorter follows the barometer
+ *      and its noise more, longer trusts more the accelerometer, and its vibrations.
+ */
+#define ALTITUDE_ESTIMATOR_TIME     1.0f                     // (s)
+
+
+
+/**
+ * ----------------------------------------------------------------------------------------------------------------------------
+ *  PROXIMITY:
+ *
+ *      An ultrasonic rangefinder pointing downwards measures the distance from the ground.
+ *      Below PROXIMITY_BLEND_ALTITUDE its readings are blended with the barometer ones, so that the altitude hold
+ *      follows the terrain during takeoff and landing.
+ *      The echo is timed with an interrupt, so the 4ms loop never waits for the sensor.
+ *      Leave OFF if you don't have a rangefinder installed.
+ */
+#define PROXIMITY_SENSOR            OFF                      // (OFF, HCSR04*)
+#define PROXIMITY_BLEND_ALTITUDE    3.0                      // (m) above this height only the barometer is used
 
 
 
@@ -278,10 +385,46 @@
  *      Leave OFF if you don't have a GPS installed.
  *      Till now I have tested the Beitian BN 880 (which also incorporates the compass).
  *      For what I know, BN 880 should be very similar to the Ublox M8N.
+ *      The GPS hold needs the heading of the drone: without a compass (see below), the heading is the one of the
+ *      start of the motors, so start them with the nose to the north.
  */
 #define GPS                         OFF                   // (OFF, BN_880*)
 #define GPS_BAUD                    9600                   // (9600, 57600, 115200) 9600 should be ok
 #define UTC_TIME_ZONE               2                        // (0-23) Put your time zone here, for example 2 stands for UTC+2
+/**
+ *      (MISSION)
+ *      With a mission saved on the flash (see Mission.h), SWC DOWN flies its waypoints instead of holding the
+ *      position: the drone goes from one to the next at the cruise speed, accelerating and braking by
+ *      MISSION_ACCELERATION, and holds the last one. A leg ends when the drone is within the acceptance radius of
+ *      its waypoint; each waypoint may have its own radius and speed, otherwise these ones are used.
+ *      The reference the GPS controller follows never gets farther than about MISSION_LEASH from the drone.
+ */
+#define MISSION_CRUISE_SPEED        3.0f                     // (m/s) speed of the legs
+#define MISSION_ACCEPTANCE_RADIUS   2.0f                     // (m) a waypoint is reached within this distance
+#define MISSION_ACCELERATION        1.0f                     // (m/s^2) of the reference
+#define MISSION_LEASH               4.0f                     // (m) the reference waits for the drone beyond this
+#define MISSION_POLL_PERIOD         20                       // (ms) the mission task looks for a new fix
+
+
+
+/**
+ * ----------------------------------------------------------------------------------------------------------------------------
+ *  COMPASS:
+ *
+ *      The magnetometer gives the heading to the GPS hold, the missions and the return to home (see Compass.h).
+ *      The gyroscope heading follows the compass in about COMPASS_FUSION_TIME, so that a noisy reading or the
+ *      magnetic field of the motors do not make the heading jump.
+ *      Mount it flat, with the X arrow to the nose; set COMPASS_UPSIDE_DOWN true if the chip is below its board.
+ *      Before flying, calibrate it with the CALIBRATION sketch (dial c and turn the drone on all its sides): without
+ *      a calibration the compass is not used. It fits the whole soft iron, also the iron not along the axes of the
+ *      drone; the calibrations saved by the older versions, axes only, are not read: calibrate again.
+ *      Set COMPASS_DECLINATION to the one of your place (e.g. from www.ngdc.noaa.gov), positive east.
+ *      The BN 880 has a HMC5883L, the newer ones a QMC5883L: look at the chip.
+ */
+#define COMPASS                     OFF                      // (OFF, HMC5883L*, QMC5883L)
+#define COMPASS_UPSIDE_DOWN         false                    // true if the Z axis of the chip points down
+#define COMPASS_DECLINATION         3.0f                     // (deg) magnetic declination, positive east
+#define COMPASS_FUSION_TIME         5.0f                     // (s) the heading follows the compass in about this time
 
 
 
@@ -297,6 +440,9 @@
  */
 #define BATTERY_NUMBER_OF_CELLS     3                        // (V) battery nominal maximum voltage (use ONLY 11.1V batteries)
 #define WARNING_BATTERY_VOLTAGE     10.00                    // (V) when drone reaches this value, it will not take off
+#define BATTERY_CAPACITY            2200                     // (mAh) battery capacity
+#define BATTERY_CELL_RESISTANCE     0.015                    // (Ohm) internal resistance of each cell, used to estimate the resting voltage
+#define BATTERY_MAX_CURRENT         60.0                     // (A) current drawn by the four motors at full throttle (no current sensor is used)
 /**
  *      (BATTERY_EMERGENCY_STOP)
  *      If the battery reaches the danger WARNING_BATTERY_VOLTAGE, at the next take off the motors will not run.
@@ -308,13 +454,17 @@
 #define BATTERY_EMERGENCY_STOP      false
 /**
  *      (COMPENSATION*)
- *      When flying, the motors rotating cause a voltage diminution.
- *      If true, BATTERY_COMPENSATION will compensate this behavior.
- *
- *      WARNING: THIS FEATURE IS DISABLED DUE TO INCORRECTNESS, PLEASE LEAVE false.
+ *      When flying, the battery voltage drops and the same ESC pulse gives less thrust.
+ *      If true, BATTERY_COMPENSATION rescales the motor pulses by BATTERY_REFERENCE_VOLTAGE / battery voltage and
+ *      linearizes them with the thrust curve, so that the hover throttle stays the same for the whole discharge.
+ *      THRUST_CURVE_EXPO is the curvature of your thrust curve (0 = linear, 1 = quadratic).
+ *      Run test/thrustCompensation.cpp on your computer to see the effect on a full discharge.
  *
+ *      Without compensation the altitude PID has to recover the sag by itself.
  */
-#define BATTERY_COMPENSATION        false                     // (true, false) IMPORTANT: leave false for now
+#define BATTERY_COMPENSATION        false                     // (true, false)
+#define BATTERY_REFERENCE_VOLTAGE   11.4                      // (V) voltage at which the PIDs are tuned
+#define THRUST_CURVE_EXPO           0.3                       // (0-1) fitted curvature of the thrust curve
 /**
  *      (VOLTAGE DIVIDER)
  *      The voltage divider is:
@@ -333,6 +483,38 @@
 #define TOTAL_DROP                  RESISTANCE_2 / (RESISTANCE_1 + RESISTANCE_2)
 
 
+/**
+ * ----------------------------------------------------------------------------------------------------------------------------
+ *  FAILSAFE:
+ *
+ *      What the drone does by itself when something is lost in flight (see Failsafe.h):
+ *          *) the receiver: no pulses for FAILSAFE_RC_TIMEOUT. The drone holds the position for FAILSAFE_HOLD_TIME,
+ *             then returns to home (RTH): it climbs to FAILSAFE_RTH_ALTITUDE above the take off point, flies back
+ *             at FAILSAFE_RTH_SPEED and lands. When the pulses come back for FAILSAFE_RECOVERY_TIME, the pilot has
+ *             the drone again;
+ *          *) the battery: below FAILSAFE_LOW_CELL_VOLTAGE (resting voltage, per cell) the drone returns to home,
+ *             below FAILSAFE_CRITICAL_CELL_VOLTAGE it lands where it is. With the receiver working, the pilot can
+ *             cancel the return by moving the SWC;
+ *          *) the GPS: no fix for FAILSAFE_GPS_TIMEOUT or less than FAILSAFE_GPS_SATELLITES. The GPS hold and the
+ *             missions become altitude hold, and a failsafe that needs the GPS lands instead.
+ *      The home is the position at the start of the motors: start them with the GPS fix to have the return to home.
+ *      Once landed, the motors stop.
+ */
+#define FAILSAFE_RC_TIMEOUT         250                      // (ms) without receiver pulses
+#define FAILSAFE_HOLD_TIME          2000                     // (ms) holding the position before returning to home
+#define FAILSAFE_RECOVERY_TIME      1000                     // (ms) of good signals to end the failsafe
+#define FAILSAFE_GPS_TIMEOUT        1000                     // (ms) without a fix
+#define FAILSAFE_GPS_SATELLITES     6                        // at least
+#define FAILSAFE_LOW_CELL_VOLTAGE   3.70                     // (V) about 15% of charge, return to home
+#define FAILSAFE_CRITICAL_CELL_VOLTAGE 3.50                  // (V) about 3% of charge, land
+#define FAILSAFE_BATTERY_TIME       3000                     // (ms) below the voltage before the failsafe starts
+#define FAILSAFE_RTH_ALTITUDE       10.0f                    // (m) above the home, at least
+#define FAILSAFE_RTH_SPEED          3.0f                     // (m/s)
+#define FAILSAFE_RTH_MIN_DISTANCE   5.0f                     // (m) closer to the home, the drone lands
+#define FAILSAFE_LAND_SPEED         0.5f                     // (m/s)
+#define FAILSAFE_LANDED_TIME        2000                     // (ms) without descending, then the motors stop
+
+
 /**
  * ----------------------------------------------------------------------------------------------------------------------------
  *  TELEMETRY:
@@ -342,9 +524,49 @@
  *      Use it to fine-tune your PID or fix gyroscope set point and altitude hold PID parameters.
  *      Using this you can adjust on the fly these parameters and much more:
  *          *) OFF, no WiFi created;
- *          *) NATIVE, uses the ESP32 wifi AP;
- *          *) ESP_CAM, uses the ESP32CAM wifi.
- *      See https://github.com/sebastiano123-c/Esp32-cam-telemetry for more details.
+ *          *) NATIVE, uses the ESP32 wifi AP (the battery must be on an ADC1 pin: not with the ESP32_DEVKIT pinmap);
+ *          *) ESP_CAM, uses the ESP32CAM wifi;
+ *          *) MAVLINK, speaks MAVLink v2 on the UART of the ESP32-CAM (PIN_RX1, PIN_TX1) to a telemetry radio or a
+ *             WiFi bridge, for the ground stations (QGroundControl, Mission Planner).
+ *      The firmware of the ESP32-CAM is in the esp32cam dir (a PlatformIO project of its own): it streams the camera
+ *      and relays the telemetry, with the same page. Its WIFI_BAUD_RATE (esp32cam/include/CamConfig.h) must be this.
  */
-#define WIFI_TELEMETRY              ESP_CAM                   // (OFF, NATIVE, ESP_CAM) set NATIVE if you don't have an ESP32-CAM
+#define WIFI_TELEMETRY              ESP_CAM                   // (OFF, NATIVE, ESP_CAM, MAVLINK) set NATIVE if you don't have an ESP32-CAM
 #define WIFI_BAUD_RATE              115200                    // (9600, 57600, 115200)
+/**
+ *      With NATIVE the page shows the flight too: the loop copies a frame every TELEMETRY_DECIMATION loops and a task
+ *      on core 0 sends them in batches every TELEMETRY_PUSH_PERIOD on the WebSocket ws://192.168.4.1/ws, so the WiFi
+ *      never touches the timing of the loop.
+ *      With ESP_CAM the loop writes a frame every TELEMETRY_DECIMATION loops on the UART (about 3.5kB/s, a third of
+ *      115200 baud) and the ESP32-CAM sends them on its WebSocket every TELEMETRY_PUSH_PERIOD.
+ */
+#define TELEMETRY_DECIMATION        5                         // (loops) between two frames, 5 => 50Hz
+#define TELEMETRY_PUSH_PERIOD       100                       // (ms) between two batches
+#define TELEMETRY_QUEUE_SIZE        32                        // (frames) a power of 2, more than a batch
+/**
+ *      With MAVLINK the loop writes at most a message, only if the UART takes it without waiting and the loop is not
+ *      later than MAVLINK_LOOP_BUDGET: a message that does not fit is skipped, the next one comes at its rate.
+ *      The rates below take about 1.7kB/s, a seventh of 115200 baud (use at least 57600).
+ */
+#define MAVLINK_SYSTEM_ID           1
+#define MAVLINK_COMPONENT_ID        1                         // MAV_COMP_ID_AUTOPILOT1
+#define MAVLINK_LOOP_BUDGET         3000                      // (us) from the start of the loop
+#define MAVLINK_RATE_HEARTBEAT      1                         // (Hz) of the messages, at most 250
+#define MAVLINK_RATE_SYS_STATUS     2
+#define MAVLINK_RATE_ATTITUDE       25
+#define MAVLINK_RATE_GLOBAL_POSITION_INT 5
+#define MAVLINK_RATE_RC_CHANNELS    5
+
+
+/**
+ * ----------------------------------------------------------------------------------------------------------------------------
+ *  SIMULATOR:
+ *
+ *      The host simulator (see test/simulator) compiles this sketch on your computer with SIMULATOR defined,
+ *      and changes some of the values above in test/simulator/Config.sim.h (e.g. no WiFi).
+ */
+#ifdef SIMULATOR
+  #include "Config.sim.h"
+#endif
+
+#endif /* CONFIG_H */
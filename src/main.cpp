@@ -210,6 +210,12 @@ Preferences preferences;
       initBattery();             
 
 
+      // rangefinder
+      #if PROXIMITY_SENSOR != OFF
+         setupProximitySensor();                           // see Proximity.h
+      #endif
+
+
       calibrationMsg();                                    // introduction
 
 
@@ -275,22 +281,38 @@ Preferences preferences;
          printBatteryVoltage();
       }
 
+      if(msg == 'd'){
+         readProximitySensor();
+         printProximitySensor();
+      }
+
       if(msg == 's'){
          readGPS();
          printGPS();
       }
 
+      if(msg == 'm'){
+         calculateAnglePRY();                                 // see Gyroscope.h
+         readCompass();                                       // see Compass.h
+         printCompass();
+      }
+
+      if(msg == 'c')
+         calibrateCompass();                                  // see Compass.h
+
       if(msg == 'p'){
          // calculatePID();                                      // calculate the PIDs
-         calibrateAutoPID(structure);                                  // calibrate autoPID parameters
+         calibrateAutoPID();                                           // calibrate autoPID parameters
       }
    } 
 
    #include <Calibration.h>
    #include <Battery.h>
+   #include <Proximity.h>
    #include <Altitude.h>
    #include <PID.h>
    #include <GPS.h>
+   #include <Compass.h>
 
 /**
  *    (FLIGHT_CONTROLLER)
@@ -309,6 +331,13 @@ Preferences preferences;
       if(DEBUG) Serial.begin(BAUD_RATE);                   // use serial only if debugging mode
 
 
+      startDiagnostics();                                  // see Diagnostics.h
+
+
+      // the parameters saved by the telemetry, before the web page shows them
+      loadParameters();                                    // see Parameters.h
+
+
       // setup wifi AP
       setupWiFiTelemetry();                                // see WiFiTelemtry.h  
 
@@ -320,6 +349,9 @@ Preferences preferences;
       initEEPROM();                                        // see Initialize.h
 
 
+      startFlightRecorder();                               // see FlightRecorder.h
+
+
       configureReceiverTrims();                            // see Initialize.h
 
 
@@ -343,6 +375,8 @@ Preferences preferences;
       // GPS
       #if GPS != OFF
          setupGPS();
+         loadMission();                                    // see Mission.h
+         initMissionTask();                                // the mission flies on core 0
       #endif
 
 
@@ -359,6 +393,18 @@ Preferences preferences;
       #endif
 
 
+      // compass
+      #if COMPASS != OFF
+         setupCompass();                                   // see Compass.h
+      #endif
+
+
+      // rangefinder
+      #if PROXIMITY_SENSOR != OFF
+         setupProximitySensor();                           // see Proximity.h
+      #endif
+
+
       // wait until the rx is connected
       waitController();                                                           
 
@@ -380,8 +426,10 @@ Preferences preferences;
 
 
       // initialize the auto pid objects
-      initAutoPID(structure, zLRoll, aLRoll, biasRoll, deltaBiasRoll, weightsRoll, deltaWeightsRoll, 200, {"roll-bias","roll-weights"});// pitch has the same values
-      initAutoPID(structure, zLYaw, aLYaw, biasYaw, deltaBiasYaw, weightsYaw, deltaWeightsYaw, 200, {"yaw-bias","yaw-weights"});
+      initAutoPID(AUTOPID_ROLL, 200, {"roll-bias","roll-weights"});
+      initAutoPID(AUTOPID_PITCH, 200, {"pitch-bias","pitch-weights"}, AUTOPID_ROLL);// until calibrated, pitch flies with roll
+      initAutoPID(AUTOPID_YAW, 200, {"yaw-bias","yaw-weights"});
+      initAutotuneTask();                                  // the networks learn on core 0, see AutoPID.h
 
  
       #if DEBUG
@@ -394,6 +442,11 @@ Preferences preferences;
 
    void loop() {                                           // loop runs at 250Hz => each loop lasts 4000us
 
+      applyParameterUpdates();                             // the changes of the telemetry, see Parameters.h
+      applyAutoPIDGains();                                 // the gains published by the autotune task, see AutoPID.h
+      traceLoopStart();                                    // see FlightRecorder.h
+
+
       // select mode via SWC of the controller:
       if      (trimCh[0].actual < 1050) flightMode = 1;    // SWC UP: only auto leveling if enabled
 
@@ -401,20 +454,32 @@ Preferences preferences;
                trimCh[0].actual > 1450) flightMode = 2;    // SWC CENTER: altitude hold 
 
            if (trimCh[0].actual < 2050 &&
-               trimCh[0].actual > 1950) flightMode = 3;    // SWC DOWN: GPS*
+               trimCh[0].actual > 1950)                    // SWC DOWN: GPS hold, or the mission if saved (see Mission.h)
+               flightMode = missionCount > 0 ? 4 : 3;
+
+      // the failsafe, when the receiver, the GPS or the battery are lost
+      updateFailsafe();                                    // see Failsafe.h
 
       // GPS
       #if GPS != OFF
          readGPS();
       #endif
+      traceStage(STAGE_GPS);
       
 
       // calculate the gyroscope values for pitch, roll and yaw
       calculateAnglePRY();                                 // see Gyroscope.h
 
+      // the compass corrects the heading, in the loops without the barometer on the bus
+      #if COMPASS != OFF
+         readCompass();                                    // see Compass.h
+      #endif
+      traceStage(STAGE_GYROSCOPE);
+
 
       // convert the signal of the rx
       convertAllSignals();                                 // see ESC.h
+      applyFailsafeSticks();                               // during a failsafe the sticks are not the pilot's
 
 
       // starting sequence of the quadcopter:
@@ -428,32 +493,50 @@ Preferences preferences;
       if(start                 == 2   &&                   // c) stopping the motors: throttle low and yaw right.
          receiverInputChannel3 < 1050 &&  
          receiverInputChannel4 > 1950)    start = 0;      
+      traceStage(STAGE_RECEIVER);
+
+
+      // read the distance from the ground
+      #if PROXIMITY_SENSOR != OFF
+         readProximitySensor();                            // see Proximity.h
+      #endif
+      traceStage(STAGE_PROXIMITY);
 
 
       // calculate the altitude hold pressure parameters
       #if ALTITUDE_SENSOR != OFF
          calculateAltitudeHold();                          // see Altitude.h
       #endif
+      traceStage(STAGE_ALTITUDE);
 
 
       // calculate PID values
       calculatePID();                                      // see PID.h
+      traceStage(STAGE_PID);
 
 
       // battery voltage can affect the efficiency 
       readBatteryVoltage();                                // see Battery.h
+      traceStage(STAGE_BATTERY);
 
 
       // create ESC pulses
       setEscPulses();                                      // see ESC.h
+      traceStage(STAGE_ESC);
 
 
       // send telemetry via wifi
       sendWiFiTelemetry();
+      traceStage(STAGE_TELEMETRY);
+
 
+      // refine PIDs: a sample for the autotune task
+      sampleAutoPID();                                     // see AutoPID.h
+      traceStage(STAGE_AUTOTUNE);
 
-      // refine PIDs
-      autotunePID();
+
+      // save the parameters changed by the telemetry (motors off only)
+      commitParameters();                                  // see Parameters.h
 
 
       // finish the loop
@@ -471,11 +554,15 @@ Preferences preferences;
    }
 
    #include <Battery.h>
+   #include <Parameters.h>
    #include <WiFiTelemetry.h>
    #include <PID.h>
+   #include <Proximity.h>
    #include <Altitude.h>
    #include <GPS.h>
-   // #include <Compass.h>
+   #include <Mission.h>
+   #include <Failsafe.h>
+   #include <Compass.h>
 
 #else 
    #error "NO SKETCH UPLOADED"
@@ -487,4 +574,11 @@ Preferences preferences;
 #include <Gyroscope.h>
 #include <ISR.h>
 #include <ESC.h>
-#include <Controller.h>
\ No newline at end of file
+#if defined(MOTOR_PULSE_BY_DSHOT)
+   #include <DShot.h>
+#elif defined(MOTOR_PULSE_BY_ONESHOT)
+   #include <OneShot.h>
+#endif
+#include <Controller.h>
+#include <FlightRecorder.h>
+#include <Diagnostics.h>
\ No newline at end of file
@@ -0,0 +1,188 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *          DShot Frame           *
+ *                       **********************************
+ *
+ *          Check the DShot frames and the bidirectional telemetry against known vectors.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * The routines of DShotFrame.h, alone:
+ *      frame       the throttle 1046 with no telemetry request is the frame 0x82C6 of the DShot specification, and
+ *                  with bidirectional DShot the CRC is inverted (0x82C9);
+ *      pulse       the ESC pulses 1000-2000us go to the throttle range 48-2047, 1000us and less stop the motor;
+ *      telemetry   an eRPM is encoded as the ESC does (period, GCR, transitions on the line), received as runs of
+ *                  the line level with a jittered bit time, and decoded back; the motor still (0x0FFF) gives 0 eRPM;
+ *      corrupted   every answer with one wrong line bit, and one with a wrong CRC, is refused.
+ * The program prints the results and returns 1 if a check fails.
+ *
+ * Compile and run it on your computer:
+ *      g++ -O2 -I../include dshotFrame.cpp -o dshotFrame && ./dshotFrame
+ *
+ *
+ * @file dshotFrame.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-12
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include "DShotFrame.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ */
+#define DSHOT_SPEED                 600                       // (kbit/s) as in Config.h
+#define BIT_TIME                    (80000000 / (DSHOT_SPEED * 1000) * 4 / 5)   // (ticks) DSHOT_TELEMETRY_BIT_TICKS of DShot.h
+#define ESC_BIT_TIME                (80000.0 / (DSHOT_SPEED * 5.0 / 4.0))       // (ticks) of the ESC, 5/4 the DShot rate
+#define BIT_JITTER                  0.3                       // of ESC_BIT_TIME, on every edge
+#define MAX_ERPM_ERROR              0.01                      // relative, the period has 9 significant bits
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  DO NOT CHANGE THIS VALUES
+ */
+int failures = 0;
+
+void check(bool ok, const char *what){
+  printf("     %-44s %s\n", what, ok ? "ok" : "FAILED");
+  if(!ok) failures++;
+}
+
+/**
+ * @brief The 16 bits telemetry value of an electrical period, with its CRC, as the ESC builds it.
+ *
+ * @param period (us) electrical period, 0x0FFF (without shift) for the motor still
+ * @return uint32_t
+ */
+uint32_t telemetryValue(uint32_t period){
+  uint32_t value = 0x0FFF;
+  if(period != 0x0FFF){
+    uint32_t exponent = 0;
+    while(period > 0x01FF){ period >>= 1; exponent++; }
+    value = (exponent << 9) | period;
+  }
+  uint32_t crc = (~(value ^ (value >> 4) ^ (value >> 8))) & 0x0F;
+  return (value << 4) | crc;
+}
+
+/**
+ * @brief The 21 line bits of a telemetry value: GCR, then a transition on every 1.
+ *
+ * @param value 16 bits telemetry value
+ * @return uint32_t the line bits, MSB first, starting low
+ */
+uint32_t encodeGCR(uint32_t value){
+  static const uint8_t nibbleToGCR[16] = {0x19, 0x1B, 0x12, 0x13, 0x1D, 0x15, 0x16, 0x17,
+                                          0x1A, 0x09, 0x0A, 0x0B, 0x1E, 0x0D, 0x0E, 0x0F};
+  uint32_t gcr = 0;
+  for(int i = 3; i >= 0; i--) gcr = (gcr << 5) | nibbleToGCR[(value >> (4 * i)) & 0x0F];
+
+  uint32_t raw = 0, level = 0;                                            // the answer starts pulling the line low
+  for(int i = 19; i >= 0; i--){
+    level ^= (gcr >> i) & 1;
+    raw = (raw << 1) | level;
+  }
+  return raw;                                                             // the bit 20 is the low start bit
+}
+
+/**
+ * @brief Receives the line bits as the RMT does: runs of the same level, with the bit time of the ESC and a jittered
+ * duration, from the start bit until the line stays high. The runs are decoded with the integer BIT_TIME of DShot.h.
+ *
+ * @param raw the 21 line bits
+ * @return uint32_t the 21 line bits rebuilt by dshotAppendRun() and dshotPadTelemetry()
+ */
+uint32_t receive(uint32_t raw){
+  uint32_t received = 0;
+  int bits = 0, start = 0, lastLow = DSHOT_TELEMETRY_BITS - 1;
+  while(lastLow >= 0 && ((raw >> (DSHOT_TELEMETRY_BITS - 1 - lastLow)) & 1)) lastLow--;        // the tail is idle
+
+  while(start <= lastLow){
+    int level = (raw >> (DSHOT_TELEMETRY_BITS - 1 - start)) & 1, end = start;
+    while(end + 1 <= lastLow && (int)((raw >> (DSHOT_TELEMETRY_BITS - 2 - end)) & 1) == level) end++;
+
+    double jitter = BIT_JITTER * ESC_BIT_TIME * (2.0 * rand() / RAND_MAX - 1.0);
+    dshotAppendRun(received, bits, level, (uint32_t)((end - start + 1) * ESC_BIT_TIME + jitter), BIT_TIME);
+    start = end + 1;
+  }
+  return dshotPadTelemetry(received, bits);
+}
+
+/**
+ * @brief Frames and pulses.
+ */
+void checkFrame(){
+
+  printf("     frame: 1046 -> 0x%04X, bidirectional 0x%04X\n", dshotFrame(1046, false, false), dshotFrame(1046, false, true));
+  check(dshotFrame(1046, false, false) == 0x82C6, "frame: throttle 1046");
+  check(dshotFrame(1046, false, true) == 0x82C9, "frame: inverted CRC of bidirectional DShot");
+  check(dshotFrame(1046, true, false) == 0x82D7, "frame: telemetry request");
+  check(dshotFrame(0, false, false) == 0x0000, "frame: motor stop");
+
+  check(pulseToDShot(1000) == 0 && pulseToDShot(900) == 0, "pulse: stop");
+  check(pulseToDShot(1001) >= DSHOT_MIN_THROTTLE && pulseToDShot(1001) <= DSHOT_MIN_THROTTLE + 2, "pulse: lowest throttle, not a command");
+  check(pulseToDShot(1500) == 1047, "pulse: half throttle");
+  check(pulseToDShot(2000) == DSHOT_MAX_THROTTLE && pulseToDShot(2100) == DSHOT_MAX_THROTTLE, "pulse: full throttle");
+}
+
+/**
+ * @brief Telemetry round trip, from the eRPM of the ESC to the one decoded.
+ */
+void checkTelemetry(){
+
+  srand(7);
+  double worst = 0.0;
+  bool valid = true;
+  for(uint32_t erpm = 1000; erpm <= 200000; erpm += 997){
+    uint32_t value = telemetryValue(60000000UL / erpm);
+    uint32_t decoded = dshotTelemetryToERPM(dshotDecodeGCR(receive(encodeGCR(value))));
+    if(decoded == DSHOT_INVALID_TELEMETRY){ valid = false; continue; }
+    worst = fmax(worst, fabs((double)decoded - erpm) / erpm);
+  }
+  printf("     telemetry: largest eRPM error %.4f\n", worst);
+  check(valid, "telemetry: every answer decoded");
+  check(worst < MAX_ERPM_ERROR, "telemetry: eRPM");
+
+  uint32_t value = telemetryValue(2000);                                   // 30000 eRPM, exponent 2
+  check(dshotDecodeGCR(encodeGCR(value)) == value && dshotTelemetryToERPM(value) == 30000, "telemetry: 2000us period");
+
+  uint32_t still = telemetryValue(0x0FFF);
+  check(dshotTelemetryToERPM(dshotDecodeGCR(receive(encodeGCR(still)))) == 0, "telemetry: motor still (0x0FFF)");
+}
+
+/**
+ * @brief Corrupted answers.
+ */
+void checkCorrupted(){
+
+  uint32_t raw = encodeGCR(telemetryValue(1500));
+  int accepted = 0;
+  for(int i = 0; i < DSHOT_TELEMETRY_BITS - 1; i++)                        // the bit 20 is the start, not decoded
+    if(dshotDecodeGCR(raw ^ (1u << i)) != DSHOT_INVALID_TELEMETRY) accepted++;
+  printf("     corrupted: %i of %i answers with a wrong bit accepted\n", accepted, DSHOT_TELEMETRY_BITS - 1);
+  check(accepted == 0, "corrupted: one wrong line bit");
+
+  check(dshotDecodeGCR(encodeGCR(telemetryValue(1500) ^ 0x01)) == DSHOT_INVALID_TELEMETRY, "corrupted: wrong CRC");
+  check(dshotTelemetryToERPM(DSHOT_INVALID_TELEMETRY) == DSHOT_INVALID_TELEMETRY, "corrupted: no eRPM");
+}
+
+int main(){
+
+  printf("    ----------------------------------------------------\n");
+  checkFrame();
+  printf("    ----------------------------------------------------\n");
+  checkTelemetry();
+  printf("    ----------------------------------------------------\n");
+  checkCorrupted();
+  printf("    ----------------------------------------------------\n");
+
+  return failures > 0 ? 1 : 0;
+}
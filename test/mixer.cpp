@@ -0,0 +1,260 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *             Mixer              *
+ *                       **********************************
+ *
+ *          Check the table-driven mixer and its desaturation on your computer.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * The routines of Mixer.h, alone:
+ *      tables      every frame table has no throttle in its roll, pitch and yaw columns, and the columns are
+ *                  independent, so the corrections can be read back from the motor pulses;
+ *      quad X      when nothing saturates, mixMotors() with quadXMixer gives the pulses of the original mixer of
+ *                  setEscPulses() (ESC.h), and the other tables give throttle + table * corrections;
+ *      saturation  corrections too large for the pulse range, at any throttle with airmode: all the motors stay in
+ *                  the range and the ratio between roll, pitch and yaw is the requested one; at full throttle also
+ *                  without airmode, while clamping each motor (the original mixer) changes it;
+ *      airmode     at zero throttle the corrections are clamped by the lowest pulse, unless with airmode, which
+ *                  raises the throttle.
+ * The program prints the results and returns 1 if a check fails.
+ *
+ * Compile and run it on your computer:
+ *      g++ -O2 -I../include mixer.cpp -o mixer && ./mixer
+ *
+ *
+ * @file mixer.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-15
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include "Mixer.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ */
+#define MIN_PULSE                   1100                      // (us) as setEscPulses()
+#define MAX_PULSE                   2000                      // (us)
+#define RANDOM_CASES                10000
+/**
+ *      (LIMITS)
+ */
+#define MAX_PULSE_ERROR             0.01                      // (us)
+#define MAX_RATIO_ERROR             0.001                     // relative, of the corrections read back
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  DO NOT CHANGE THIS VALUES
+ */
+int failures = 0;
+
+void check(bool ok, const char *what){
+  printf("     %-44s %s\n", what, ok ? "ok" : "FAILED");
+  if(!ok) failures++;
+}
+
+struct frame {
+  const char *name;
+  const float (*table)[3];
+  int motors;
+};
+
+const frame frames[] = {
+  {"quad X", quadXMixer, 4},
+  {"quad +", quadPlusMixer, 4},
+  {"hex X", hexXMixer, 6},
+  {"octo X", octoXMixer, 8}
+};
+
+double uniform(double low, double high){
+  return low + (high - low) * rand() / RAND_MAX;
+}
+
+/**
+ * @brief The mixer of setEscPulses() before Mixer.h: quad X, each motor clamped on its own.
+ */
+void originalMixer(float throttle, float roll, float pitch, float yaw, float *esc){
+  esc[0] = throttle - pitch + roll - yaw;
+  esc[1] = throttle + pitch + roll + yaw;
+  esc[2] = throttle + pitch - roll - yaw;
+  esc[3] = throttle - pitch - roll + yaw;
+  for(int i = 0; i < 4; i++) esc[i] = fmin(MAX_PULSE, fmax(MIN_PULSE, esc[i]));
+}
+
+/**
+ * @brief Reads the throttle and the corrections back from the motor pulses (the columns are orthogonal).
+ *
+ * @param f frame
+ * @param output (us) motor pulses
+ * @param read throttle, roll, pitch, yaw
+ */
+void readBack(const frame &f, const float *output, double read[4]){
+  read[0] = 0.0;
+  for(int i = 0; i < f.motors; i++) read[0] += output[i] / f.motors;
+  for(int j = 0; j < 3; j++){
+    double dot = 0.0, norm = 0.0;
+    for(int i = 0; i < f.motors; i++){ dot += f.table[i][j] * output[i]; norm += f.table[i][j] * f.table[i][j]; }
+    read[j + 1] = dot / norm;
+  }
+}
+
+/**
+ * @brief Largest relative error of the ratio between the corrections read back and the requested ones.
+ */
+double ratioError(const double read[4], const double requested[3]){
+  int largest = 0;
+  for(int j = 1; j < 3; j++) if(fabs(requested[j]) > fabs(requested[largest])) largest = j;
+  double scale = read[largest + 1] / requested[largest], worst = 0.0;
+  for(int j = 0; j < 3; j++) worst = fmax(worst, fabs(read[j + 1] - scale * requested[j]) / fabs(requested[largest]));
+  return worst;
+}
+
+/**
+ * @brief The columns of the tables.
+ */
+void checkTables(){
+
+  for(const frame &f : frames){
+    double worst = 0.0;
+    for(int j = 0; j < 3; j++){
+      double sum = 0.0;
+      for(int i = 0; i < f.motors; i++) sum += f.table[i][j];
+      worst = fmax(worst, fabs(sum));
+      for(int k = j + 1; k < 3; k++){
+        double dot = 0.0;
+        for(int i = 0; i < f.motors; i++) dot += f.table[i][j] * f.table[i][k];
+        worst = fmax(worst, fabs(dot));
+      }
+    }
+    char what[64];
+    snprintf(what, sizeof(what), "tables: %s, columns independent", f.name);
+    check(worst < 0.01, what);
+  }
+}
+
+/**
+ * @brief Without saturation: the original mixer, and throttle + table * corrections.
+ */
+void checkLinear(){
+
+  srand(3);
+  double worstOriginal = 0.0, worstTable[4] = {0.0, 0.0, 0.0, 0.0};
+  float output[8], esc[4];
+
+  for(int n = 0; n < RANDOM_CASES; n++){
+    float throttle = (float)uniform(1300, 1700), roll = (float)uniform(-60, 60), pitch = (float)uniform(-60, 60), yaw = (float)uniform(-60, 60);
+
+    mixMotors(quadXMixer, 4, throttle, roll, pitch, yaw, MIN_PULSE, MAX_PULSE, false, output);
+    originalMixer(throttle, roll, pitch, yaw, esc);
+    for(int i = 0; i < 4; i++) worstOriginal = fmax(worstOriginal, fabs(output[i] - esc[i]));
+
+    for(int k = 0; k < 4; k++){
+      const frame &f = frames[k];
+      mixMotors(f.table, f.motors, throttle, roll, pitch, yaw, MIN_PULSE, MAX_PULSE, false, output);
+      for(int i = 0; i < f.motors; i++){
+        double expected = throttle + f.table[i][0] * roll + f.table[i][1] * pitch + f.table[i][2] * yaw;
+        worstTable[k] = fmax(worstTable[k], fabs(output[i] - expected));
+      }
+    }
+  }
+
+  printf("     quad X: largest distance from the original mixer %.4f us\n", worstOriginal);
+  check(worstOriginal < MAX_PULSE_ERROR, "quad X: same pulses of the original mixer");
+  for(int k = 0; k < 4; k++){
+    char what[64];
+    snprintf(what, sizeof(what), "linear: %s", frames[k].name);
+    check(worstTable[k] < MAX_PULSE_ERROR, what);
+  }
+}
+
+/**
+ * @brief With saturation: the motors in the range and the ratio of the corrections.
+ */
+void checkSaturation(){
+
+  srand(5);
+  float output[8], esc[4];
+
+  for(const frame &f : frames){
+    double worstRatio = 0.0;
+    bool inRange = true;
+    for(int n = 0; n < RANDOM_CASES; n++){
+      double requested[3] = {uniform(-800, 800), uniform(-800, 800), uniform(-400, 400)};
+      float throttle = (float)uniform(1100, 1800);                // with airmode both the ends of the range fit
+      mixMotors(f.table, f.motors, throttle, (float)requested[0], (float)requested[1], (float)requested[2],
+                MIN_PULSE, MAX_PULSE, true, output);
+
+      for(int i = 0; i < f.motors; i++) inRange = inRange && output[i] >= MIN_PULSE && output[i] <= MAX_PULSE;
+      double read[4];
+      readBack(f, output, read);
+      worstRatio = fmax(worstRatio, ratioError(read, requested));
+    }
+    printf("     saturation: %s, largest ratio error %.5f\n", f.name, worstRatio);
+    char what[64];
+    snprintf(what, sizeof(what), "saturation: %s, ratio kept in the range", f.name);
+    check(inRange && worstRatio < MAX_RATIO_ERROR, what);
+  }
+
+  // a full roll with some yaw at full throttle: the original mixer loses the yaw
+  double requested[3] = {500.0, 0.0, 100.0}, read[4];
+  originalMixer(1800, (float)requested[0], (float)requested[1], (float)requested[2], esc);
+  readBack(frames[0], esc, read);
+  double original = ratioError(read, requested);
+  mixMotors(quadXMixer, 4, 1800, (float)requested[0], (float)requested[1], (float)requested[2], MIN_PULSE, MAX_PULSE, false, output);
+  readBack(frames[0], output, read);
+  printf("     saturation: full roll at 1800us, ratio error %.3f original, %.5f desaturated\n", original, ratioError(read, requested));
+  check(ratioError(read, requested) < MAX_RATIO_ERROR && original > 0.05, "saturation: better than the original mixer");
+  check(read[0] < 1800, "saturation: throttle lowered");
+}
+
+/**
+ * @brief At zero throttle, with and without airmode.
+ */
+void checkAirmode(){
+
+  float output[4];
+  double requested[3] = {150.0, -60.0, 40.0}, read[4];
+
+  mixMotors(quadXMixer, 4, MIN_PULSE, (float)requested[0], (float)requested[1], (float)requested[2], MIN_PULSE, MAX_PULSE, false, output);
+  readBack(frames[0], output, read);
+  double without = ratioError(read, requested), rollWithout = read[1];
+
+  mixMotors(quadXMixer, 4, MIN_PULSE, (float)requested[0], (float)requested[1], (float)requested[2], MIN_PULSE, MAX_PULSE, true, output);
+  readBack(frames[0], output, read);
+  bool inRange = true;
+  for(int i = 0; i < 4; i++) inRange = inRange && output[i] >= MIN_PULSE && output[i] <= MAX_PULSE;
+
+  printf("     airmode: roll %.1f of %.1f without, %.1f with, throttle raised to %.1f us\n",
+         rollWithout, requested[0], read[1], read[0]);
+  check(without > 0.1, "airmode: off, corrections clamped");
+  check(inRange && fabs(read[1] - requested[0]) < MAX_PULSE_ERROR && ratioError(read, requested) < MAX_RATIO_ERROR,
+        "airmode: on, full corrections at zero throttle");
+  check(read[0] > MIN_PULSE, "airmode: throttle raised");
+
+  mixMotors(quadXMixer, 4, 1500, 0.0f, 0.0f, 0.0f, MIN_PULSE, MAX_PULSE, true, output);
+  check(output[0] == 1500 && output[1] == 1500 && output[2] == 1500 && output[3] == 1500, "airmode: hover untouched");
+}
+
+int main(){
+
+  printf("    ----------------------------------------------------\n");
+  checkTables();
+  printf("    ----------------------------------------------------\n");
+  checkLinear();
+  printf("    ----------------------------------------------------\n");
+  checkSaturation();
+  printf("    ----------------------------------------------------\n");
+  checkAirmode();
+  printf("    ----------------------------------------------------\n");
+
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,157 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *         Motor Latency          *
+ *                       **********************************
+ *
+ *          Compare the sensor-to-motor latency of the motor pulse providers.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * Every loop reads the gyroscope, runs the controllers and the mixer, and then setEscPulses() writes the pulses.
+ * The latency is the time from the end of the gyroscope reading to the moment the ESC has received the whole
+ * pulse (the ESC reads the width of the pulse at its falling edge, or the last bit of a DShot frame):
+ *  @li LEDC and MCPWM: the PWM timer runs on its own, so the new width is used only from the next PWM period;
+ *      the phase between the PWM timer and the loop is unknown, so it is randomized for every run;
+ *  @li OneShot125 and Multishot: the pulse starts right after the mixer (see OneShot.h);
+ *  @li DShot: the frame starts right after the mixer and lasts 16 bits (see DShot.h).
+ * The processing time of the ESC is not counted, since it is the same for all the modes.
+ *
+ * Compile and run it on your computer:
+ *      g++ -O2 -I../include motorLatency.cpp -o motorLatency && ./motorLatency
+ *
+ *
+ * @file motorLatency.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-14
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include "OneShotPulse.h"
+#include "DShotFrame.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ *
+ *
+ *      (LOOP TIMING)
+ *      Measure them printing micros() - loopTimer in the loop.
+ */
+#define GYRO_READ_END               450.                      // (us) the gyroscope reading ends, from the loop start
+#define MIXER_END                   1900.                     // (us) setEscPulses() is called, from the loop start
+#define MIXER_JITTER                300.                      // (us) the mixer time varies by +/- this value
+/**
+ *      (PWM FREQUENCIES, as in Globals.h and Initialize.h)
+ */
+#define LEDC_FREQUENCY              500.                      // (Hz)
+#define MCPWM_FREQUENCY             250.                      // (Hz)
+#define DSHOT_SPEED                 600                       // (150, 300, 600) as in Config.h
+
+
+
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                              DO NOT CHANGE THIS VALUES
+ *
+ *      (SIMULATION)
+ */
+#define LOOP_TIME                   4000.                     // (us) 250Hz as the flight controller
+#define RUNS                        200                       // number of random PWM phases
+#define LOOPS_PER_RUN               250                       // one second of flight for each phase
+#define RMT_START                   2.                        // (us) time to fill and start the four RMT channels
+
+
+enum motorMode { LEDC, MCPWM, ONESHOT_125, MULTI_SHOT, DSHOT };
+const char *modeName[] = { "LEDC", "MCPWM", "OneShot125", "Multishot", "DShot" };
+
+
+/**
+ * @brief Uniform random number.
+ *
+ * @param min
+ * @param max
+ * @return double
+ */
+double uniform(double min, double max){
+    return min + (max - min) * rand() / (double)RAND_MAX;
+}
+
+
+/**
+ * @brief Time at which the ESC has received the whole pulse.
+ *
+ * @param mode motor pulse provider
+ * @param mixer (us) time at which setEscPulses() is called
+ * @param pulse (us) ESC pulse
+ * @param phase (us) start of a PWM period
+ * @return double (us)
+ */
+double pulseReceived(motorMode mode, double mixer, int16_t pulse, double phase){
+
+    switch(mode){
+        case LEDC:
+        case MCPWM: {
+            double period = 1e6 / (mode == LEDC ? LEDC_FREQUENCY : MCPWM_FREQUENCY);
+            double periodStart = phase + ceil((mixer - phase) / period) * period;   // the first period after the mixer
+            return periodStart + pulse;
+        }
+        case ONESHOT_125:
+            return mixer + RMT_START + oneShot125Width(pulse) / 1000.;
+        case MULTI_SHOT:
+            return mixer + RMT_START + multishotWidth(pulse) / 1000.;
+        default:
+            return mixer + RMT_START + DSHOT_FRAME_BITS * 1000. / DSHOT_SPEED;
+    }
+}
+
+
+int main(){
+
+    srand(1);
+
+    printf("\n Sensor-to-motor latency, from the gyroscope reading to the pulse received by the ESC\n");
+    printf("\n   mode            min        mean         max\n");
+
+    for(int mode = LEDC; mode <= DSHOT; mode++){
+
+        double minimum = 1e9, maximum = 0., sum = 0.;
+        int samples = 0;
+
+        for(int run = 0; run < RUNS; run++){
+
+            double phase = uniform(0., LOOP_TIME);
+
+            for(int loop = 0; loop < LOOPS_PER_RUN; loop++){
+                double loopStart = loop * LOOP_TIME;
+                double mixer = loopStart + MIXER_END + uniform(-MIXER_JITTER, MIXER_JITTER);
+                int16_t pulse = (int16_t)uniform(1100., 2000.);
+
+                double latency = pulseReceived((motorMode)mode, mixer, pulse, phase) - (loopStart + GYRO_READ_END);
+
+                minimum = std::min(minimum, latency);
+                maximum = std::max(maximum, latency);
+                sum += latency;
+                samples++;
+            }
+        }
+
+        printf("\n   %-12s %7.1fus   %7.1fus   %7.1fus", modeName[mode], minimum, sum / samples, maximum);
+    }
+
+    printf("\n\n");
+
+    return 0;
+}
@@ -0,0 +1,86 @@
+/**
+ * @file Config.sim.h
+ * @author @sebastiano123-c
+ * @brief Changes to Config.h when the sketch is compiled by the host simulator.
+ *
+ * Everything not listed here (PID gains, battery, frame, ...) is taken from your Config.h, so the simulator
+ * flies your configuration.
+ *
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#undef UPLOADED_SKETCH
+#define UPLOADED_SKETCH             FLIGHT_CONTROLLER
+
+#undef DEBUG
+#define DEBUG                       false
+
+// the simulated sensors
+#undef GYROSCOPE
+#define GYROSCOPE                   MPU6050
+#undef ALTITUDE_SENSOR
+#define ALTITUDE_SENSOR             BMP280
+#undef GPS
+#define GPS                         BN_880
+
+// the HC-SR04 is only compiled with -DSIMULATOR_PROXIMITY (see proximity.cpp): the world has no echo to give
+#undef PROXIMITY_SENSOR
+#ifdef SIMULATOR_PROXIMITY
+  #define PROXIMITY_SENSOR          HCSR04
+#else
+  #define PROXIMITY_SENSOR          OFF
+#endif
+
+// the HMC5883L flies only if compiled with -DSIMULATOR_COMPASS (see compass.cpp)
+#undef COMPASS
+#ifdef SIMULATOR_COMPASS
+  #define COMPASS                   HMC5883L
+#else
+  #define COMPASS                   OFF
+#endif
+
+// no WiFi on the computer: the ESP32-CAM and the MAVLink telemetries are only a UART, compile with
+// -DSIMULATOR_ESP_CAM or -DSIMULATOR_MAVLINK to keep them
+#undef WIFI_TELEMETRY
+#ifdef SIMULATOR_ESP_CAM
+  #define WIFI_TELEMETRY            ESP_CAM
+#elif defined(SIMULATOR_MAVLINK)
+  #define WIFI_TELEMETRY            MAVLINK
+#else
+  #define WIFI_TELEMETRY            OFF
+#endif
+
+// the simulator flies with the manual PID gains (no autotune task), or with the tuned ones with -DSIMULATOR_AUTOTUNE
+#undef AUTOTUNE_PID_GYROSCOPE
+#ifdef SIMULATOR_AUTOTUNE
+  #define AUTOTUNE_PID_GYROSCOPE    true
+#else
+  #define AUTOTUNE_PID_GYROSCOPE    false
+#endif
+
+// the simulator reads esc1..esc4, the LEDC output is enough
+#undef MOTOR_PULSE_BY_MCPWM
+#undef MOTOR_PULSE_BY_DSHOT
+#undef MOTOR_PULSE_BY_ONESHOT
+#undef MOTOR_PULSE_BY_LEDC
+#define MOTOR_PULSE_BY_LEDC
+
+// the flight recorder writes on the simulated Serial: compile with -DSIMULATOR_RECORDER to save a trace
+#undef FLIGHT_RECORDER
+#ifdef SIMULATOR_RECORDER
+  #define FLIGHT_RECORDER           true
+#else
+  #define FLIGHT_RECORDER           false
+#endif
+
+// the diagnostics print on the simulated Serial: compile with -DSIMULATOR_DIAGNOSTICS to count the allocations
+#undef DIAGNOSTICS
+#ifdef SIMULATOR_DIAGNOSTICS
+  #define DIAGNOSTICS               true
+#else
+  #define DIAGNOSTICS               false
+#endif
@@ -0,0 +1,263 @@
+/**
+ * @file Quadcopter.h
+ * @author @sebastiano123-c
+ * @brief 6-DOF rigid body model of a quad X frame.
+ *
+ * The position and the velocity are in the local NED frame (north, east, down) with the origin at the take off
+ * point, the angular rates in the body FRD frame (front, right, down) and the attitude is a quaternion.
+ * The model includes:
+ *  @li the motor thrust, from the ESC pulse through the thrust curve of ThrustCurve.h, scaled by the battery
+ *      voltage and delayed by the motor time constant;
+ *  @li the yaw torque of the propellers, the linear drag and the rotational damping;
+ *  @li the wind, as an air velocity in NED;
+ *  @li the battery, with the cell discharge curve and the internal resistance;
+ *  @li the ground, which stops the drone and flags a crash if it is hit too fast or too tilted.
+ *
+ * The motors are numbered as the ESCs: 1 front-right CCW, 2 rear-right CW, 3 rear-left CCW, 4 front-left CW.
+ *
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef QUADCOPTER_H
+#define QUADCOPTER_H
+
+#include <cmath>
+#include <stdint.h>
+#include <ThrustCurve.h>
+
+#define GRAVITY                     9.80665                 // (m/s^2)
+
+struct quadcopterParameters {
+  double mass;                                              // (kg)
+  double armLength;                                         // (m) distance between the center and a motor
+  double inertia[3];                                        // (kg m^2) around the body x, y and z axes
+  double maxThrust;                                         // (N) thrust of one motor at full throttle and reference voltage
+  double thrustExpo;                                        // (0-1) curvature of the thrust curve
+  double referenceVoltage;                                  // (V) voltage of maxThrust
+  double motorTimeConstant;                                 // (s) time to reach 63% of a thrust step
+  double torqueCoefficient;                                 // (m) yaw torque / thrust of a propeller
+  double linearDrag;                                        // (N s/m)
+  double angularDrag;                                       // (N m s/rad)
+  int cells;                                                // battery cells
+  double capacity;                                          // (mAh)
+  double cellResistance;                                    // (Ohm)
+  double maxCurrent;                                        // (A) current of the four motors at full throttle
+};
+
+/**
+ * @brief A 450 mm quad X with 10" props and a 3S 2200 mAh battery, as the one of the docs.
+ */
+const quadcopterParameters defaultQuadcopter = {
+  1.2,                                                      // mass
+  0.225,                                                    // armLength
+  {0.012, 0.012, 0.022},                                    // inertia
+  7.5,                                                      // maxThrust
+  0.3,                                                      // thrustExpo
+  11.4,                                                     // referenceVoltage
+  0.03,                                                     // motorTimeConstant
+  0.016,                                                    // torqueCoefficient
+  0.25,                                                     // linearDrag
+  0.01,                                                     // angularDrag
+  3,                                                        // cells
+  2200,                                                     // capacity
+  0.015,                                                    // cellResistance
+  60.0                                                      // maxCurrent
+};
+
+// (V) resting voltage of a LiPo cell from 0% to 100%, every 5% (as in Globals.h)
+const double cellCurve[21] = {3.27, 3.61, 3.69, 3.71, 3.73, 3.75, 3.77, 3.79, 3.80, 3.82, 3.84,
+                              3.85, 3.87, 3.91, 3.95, 3.98, 4.02, 4.08, 4.11, 4.15, 4.20};
+
+class Quadcopter {
+  public:
+    quadcopterParameters parameters;
+
+    double position[3];                                     // (m) NED
+    double velocity[3];                                     // (m/s) NED
+    double acceleration[3];                                 // (m/s^2) NED, of the last step
+    double quaternion[4];                                   // body to NED, {w, x, y, z}
+    double rates[3];                                        // (rad/s) body roll, pitch and yaw rates
+    double thrust[4];                                       // (N) thrust of each motor
+    double wind[3];                                         // (m/s) NED air velocity
+
+    double charge;                                          // (%) state of charge
+    double current;                                         // (A)
+    double voltage;                                         // (V) battery voltage under load
+
+    bool onGround;
+    bool crashed;
+
+    Quadcopter(const quadcopterParameters &p = defaultQuadcopter) : parameters(p){ reset(100.0); }
+
+    void reset(double stateOfCharge){
+      for(int i = 0; i < 3; i++){ position[i] = velocity[i] = acceleration[i] = rates[i] = wind[i] = 0.0; }
+      for(int i = 0; i < 4; i++) thrust[i] = 0.0;
+      quaternion[0] = 1.0; quaternion[1] = quaternion[2] = quaternion[3] = 0.0;
+      charge = stateOfCharge;
+      current = 0.0;
+      voltage = parameters.cells * restingCellVoltage();
+      onGround = true;
+      crashed = false;
+    }
+
+    double restingCellVoltage() const {
+      double x = charge / 5.0;
+      if(x <= 0.0) return cellCurve[0];
+      if(x >= 20.0) return cellCurve[20];
+      int i = (int)x;
+      return cellCurve[i] + (x - i) * (cellCurve[i + 1] - cellCurve[i]);
+    }
+
+    /**
+     * @brief Rotates a body vector into NED.
+     */
+    void bodyToNED(const double body[3], double ned[3]) const {
+      double w = quaternion[0], x = quaternion[1], y = quaternion[2], z = quaternion[3];
+      ned[0] = (1 - 2*(y*y + z*z)) * body[0] + 2*(x*y - w*z) * body[1] + 2*(x*z + w*y) * body[2];
+      ned[1] = 2*(x*y + w*z) * body[0] + (1 - 2*(x*x + z*z)) * body[1] + 2*(y*z - w*x) * body[2];
+      ned[2] = 2*(x*z - w*y) * body[0] + 2*(y*z + w*x) * body[1] + (1 - 2*(x*x + y*y)) * body[2];
+    }
+
+    /**
+     * @brief Rotates a NED vector into the body frame.
+     */
+    void nedToBody(const double ned[3], double body[3]) const {
+      double w = quaternion[0], x = quaternion[1], y = quaternion[2], z = quaternion[3];
+      body[0] = (1 - 2*(y*y + z*z)) * ned[0] + 2*(x*y + w*z) * ned[1] + 2*(x*z - w*y) * ned[2];
+      body[1] = 2*(x*y - w*z) * ned[0] + (1 - 2*(x*x + z*z)) * ned[1] + 2*(y*z + w*x) * ned[2];
+      body[2] = 2*(x*z + w*y) * ned[0] + 2*(y*z - w*x) * ned[1] + (1 - 2*(x*x + y*y)) * ned[2];
+    }
+
+    /**
+     * @brief Roll, pitch and yaw (deg), ZYX convention.
+     */
+    void eulerAngles(double angles[3]) const {
+      double w = quaternion[0], x = quaternion[1], y = quaternion[2], z = quaternion[3];
+      double sinPitch = 2 * (w*y - z*x);
+      if(sinPitch > 1.0) sinPitch = 1.0;
+      else if(sinPitch < -1.0) sinPitch = -1.0;
+      angles[0] = atan2(2 * (w*x + y*z), 1 - 2 * (x*x + y*y)) * 180.0 / M_PI;
+      angles[1] = asin(sinPitch) * 180.0 / M_PI;
+      angles[2] = atan2(2 * (w*z + x*y), 1 - 2 * (y*y + z*z)) * 180.0 / M_PI;
+    }
+
+    /**
+     * @brief Specific force measured by an accelerometer (m/s^2), body frame: about {0, 0, -g} at rest.
+     */
+    void specificForce(double force[3]) const {
+      double ned[3] = {acceleration[0], acceleration[1], acceleration[2] - GRAVITY};
+      nedToBody(ned, force);
+    }
+
+    double altitude() const { return -position[2]; }
+
+    /**
+     * @brief Integrates the model.
+     *
+     * @param pulses (us) ESC pulses
+     * @param dt (s) time step
+     */
+    void step(const int16_t pulses[4], double dt){
+      const quadcopterParameters &p = parameters;
+      const double d = p.armLength / sqrt(2.0);
+      const double motorX[4] = { d, -d, -d,  d};            // front
+      const double motorY[4] = { d,  d, -d, -d};            // right
+      const double spin[4]   = { 1, -1,  1, -1};            // CCW props push the body nose right
+
+      // battery and motors
+      double load = 0.0;
+      for(int i = 0; i < 4; i++){
+        double command = (pulses[i] - 1000) / 1000.0;
+        if(command < 0.0) command = 0.0;
+        else if(command > 1.0) command = 1.0;
+        load += command * sqrt(command);
+
+        double x = command * voltage / p.referenceVoltage;
+        if(x > 1.2) x = 1.2;
+        double target = pulses[i] > 1050 ? p.maxThrust * commandToThrust((float)x, (float)p.thrustExpo) : 0.0;
+        thrust[i] += (target - thrust[i]) * (1.0 - exp(-dt / p.motorTimeConstant));
+      }
+      current = load * p.maxCurrent / 4.0;
+      charge -= current * dt / 3.6 / p.capacity * 100.0;
+      if(charge < 0.0) charge = 0.0;
+      voltage = p.cells * (restingCellVoltage() - current * p.cellResistance);
+
+      // forces and torques in the body frame
+      double totalThrust = 0.0, torque[3] = {0.0, 0.0, 0.0};
+      for(int i = 0; i < 4; i++){
+        totalThrust += thrust[i];
+        torque[0] -= motorY[i] * thrust[i];                 // right motors push the right side up: negative roll
+        torque[1] += motorX[i] * thrust[i];                 // front motors push the nose up: positive pitch
+        torque[2] += spin[i] * p.torqueCoefficient * thrust[i];
+      }
+      for(int i = 0; i < 3; i++) torque[i] -= p.angularDrag * rates[i];
+
+      double bodyThrust[3] = {0.0, 0.0, -totalThrust}, force[3];
+      bodyToNED(bodyThrust, force);
+      for(int i = 0; i < 3; i++) force[i] -= p.linearDrag * (velocity[i] - wind[i]);
+      force[2] += p.mass * GRAVITY;
+
+      // translation
+      for(int i = 0; i < 3; i++){
+        acceleration[i] = force[i] / p.mass;
+        velocity[i] += acceleration[i] * dt;
+        position[i] += velocity[i] * dt;
+      }
+
+      // rotation: I dw/dt = torque - w x (I w)
+      const double *I = p.inertia;
+      double wx = rates[0], wy = rates[1], wz = rates[2];
+      rates[0] += (torque[0] - (wy * I[2] * wz - wz * I[1] * wy)) / I[0] * dt;
+      rates[1] += (torque[1] - (wz * I[0] * wx - wx * I[2] * wz)) / I[1] * dt;
+      rates[2] += (torque[2] - (wx * I[1] * wy - wy * I[0] * wx)) / I[2] * dt;
+
+      double w = quaternion[0], x = quaternion[1], y = quaternion[2], z = quaternion[3];
+      quaternion[0] += 0.5 * dt * (-x * rates[0] - y * rates[1] - z * rates[2]);
+      quaternion[1] += 0.5 * dt * ( w * rates[0] + y * rates[2] - z * rates[1]);
+      quaternion[2] += 0.5 * dt * ( w * rates[1] - x * rates[2] + z * rates[0]);
+      quaternion[3] += 0.5 * dt * ( w * rates[2] + x * rates[1] - y * rates[0]);
+      double norm = sqrt(quaternion[0]*quaternion[0] + quaternion[1]*quaternion[1] +
+                         quaternion[2]*quaternion[2] + quaternion[3]*quaternion[3]);
+      for(int i = 0; i < 4; i++) quaternion[i] /= norm;
+
+      groundContact();
+    }
+
+  private:
+    /**
+     * @brief Stops the drone on the ground; a landing faster than 3 m/s or tilted more than 60 deg is a crash.
+     */
+    void groundContact(){
+      if(position[2] < 0.0){
+        onGround = false;
+        return;
+      }
+
+      double angles[3];
+      eulerAngles(angles);
+      if(!onGround && (velocity[2] > 3.0 || fabs(angles[0]) > 60.0 || fabs(angles[1]) > 60.0)) crashed = true;
+
+      onGround = true;
+      position[2] = 0.0;
+      if(velocity[2] > 0.0){
+        for(int i = 0; i < 3; i++) velocity[i] = acceleration[i] = 0.0;
+      }
+      else{
+        velocity[0] = velocity[1] = 0.0;                    // friction, the drone can only take off
+        acceleration[0] = acceleration[1] = 0.0;
+        if(acceleration[2] > 0.0) acceleration[2] = 0.0;
+      }
+
+      // the legs keep the drone level: only the heading remains
+      if(velocity[2] >= 0.0){
+        double yaw = angles[2] * M_PI / 360.0;
+        quaternion[0] = cos(yaw); quaternion[1] = 0.0; quaternion[2] = 0.0; quaternion[3] = sin(yaw);
+        rates[0] = rates[1] = 0.0;
+      }
+    }
+};
+
+#endif /* QUADCOPTER_H */
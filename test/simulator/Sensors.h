@@ -0,0 +1,382 @@
+/**
+ * @file Sensors.h
+ * @author @sebastiano123-c
+ * @brief Simulated sensors and receiver, fed by the Quadcopter model.
+ *
+ *  @li MPU-6050: I2C registers with the accelerometer (4096 LSB/g) and the gyroscope (65.5 LSB/(deg/s)), a bias,
+ *      white noise and the vibrations of the motors;
+ *  @li BMP280: I2C registers with the calibration words of the datasheet example and raw readings obtained by
+ *      inverting the datasheet compensation, refreshed at the rate set in the 0xF4 and 0xF5 registers;
+ *  @li HMC5883L: I2C registers with the field of the earth turned into the axes of the chip, the hard and soft iron
+ *      of the drone and white noise, refreshed at 75 Hz;
+ *  @li GPS: NMEA GGA sentences at 5 Hz written on the GPS serial, with the columns where GPS.h expects them;
+ *  @li receiver: one PWM pulse per channel every 20 ms, as edges on the receiver pins.
+ *
+ * All the noises come from a seeded generator, so a simulation is repeatable.
+ *
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SENSORS_H
+#define SENSORS_H
+
+#include "Quadcopter.h"
+
+/**
+ * @brief Repeatable gaussian noise (xorshift and Box-Muller).
+ */
+class Noise {
+  public:
+    uint64_t state;
+
+    Noise(uint64_t seed = 1) : state(seed ? seed : 1){}
+
+    double uniform(){
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      return ((state >> 11) + 0.5) / 9007199254740992.0;
+    }
+
+    double gaussian(double sigma){
+      return sigma * sqrt(-2.0 * log(uniform())) * cos(2.0 * M_PI * uniform());
+    }
+};
+
+inline int16_t saturate16(double value){
+  if(value > 32767.0) return 32767;
+  if(value < -32768.0) return -32768;
+  return (int16_t)lround(value);
+}
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  MPU-6050
+ */
+class SimulatedMPU6050 : public halI2CDevice {
+  public:
+    uint8_t registers[128];
+    double gyroBias[3];                                     // (deg/s)
+    double gyroNoise;                                       // (deg/s) standard deviation
+    double accNoise;                                        // (g) standard deviation
+    double vibration;                                       // (g) accelerometer vibration at full throttle
+
+    SimulatedMPU6050() : gyroNoise(0.05), accNoise(0.004), vibration(0.3){
+      memset(registers, 0, sizeof(registers));
+      registers[0x6B] = 0x40;                               // sleeping after the power on
+      registers[0x75] = 0x68;                               // WHO_AM_I
+      gyroBias[0] = 0.8; gyroBias[1] = -0.5; gyroBias[2] = 0.3;
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value){ if(reg < 128) registers[reg] = value; }
+    uint8_t readRegister(uint8_t reg){ return reg < 128 ? registers[reg] : 0; }
+
+    /**
+     * @brief Samples the model into the data registers 0x3B-0x48.
+     */
+    void update(const Quadcopter &quad, Noise &noise){
+      double force[3], throttle = 0.0;
+      quad.specificForce(force);
+      for(int i = 0; i < 4; i++) throttle += quad.thrust[i] / quad.parameters.maxThrust / 4.0;
+
+      // the firmware axes: x front, y right, z up; the gyroscope gives roll right, nose up and nose right positive
+      double acc[3] = {force[0] / GRAVITY, force[1] / GRAVITY, -force[2] / GRAVITY};
+      double gyro[3] = {quad.rates[0] * 180.0 / M_PI, quad.rates[1] * 180.0 / M_PI, quad.rates[2] * 180.0 / M_PI};
+
+      int16_t data[7];
+      for(int i = 0; i < 3; i++){
+        acc[i] += noise.gaussian(accNoise + vibration * throttle);
+        data[i] = saturate16(acc[i] * 4096.0);
+        data[4 + i] = saturate16((gyro[i] + gyroBias[i] + noise.gaussian(gyroNoise)) * 65.5);
+      }
+      data[3] = saturate16((25.0 - 36.53) * 340.0);         // 25 degC
+
+      if(registers[0x6B] & 0x40) memset(data, 0, sizeof(data));
+      for(int i = 0; i < 7; i++){
+        registers[0x3B + 2 * i] = (uint8_t)((uint16_t)data[i] >> 8);
+        registers[0x3C + 2 * i] = (uint8_t)((uint16_t)data[i] & 0xFF);
+      }
+    }
+};
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  BMP280
+ */
+class SimulatedBMP280 : public halI2CDevice {
+  public:
+    uint8_t registers[256];
+    double seaLevelPressure;                                // (Pa)
+    double groundAltitude;                                  // (m) above the sea level of the take off point
+    double temperature;                                     // (degC)
+    double pressureNoise;                                   // (Pa) standard deviation
+    uint64_t nextMeasure;                                   // (us)
+
+    // calibration words of the datasheet example
+    uint16_t T1; int16_t T2, T3;
+    uint16_t P1; int16_t P2, P3, P4, P5, P6, P7, P8, P9;
+
+    SimulatedBMP280() : seaLevelPressure(101325.0), groundAltitude(100.0), temperature(25.0), pressureNoise(2.6),
+                        nextMeasure(0){
+      T1 = 27504; T2 = 26435; T3 = -1000;
+      P1 = 36477; P2 = -10685; P3 = 3024; P4 = 2855; P5 = 140; P6 = -7; P7 = 15500; P8 = -14600; P9 = 6000;
+
+      memset(registers, 0, sizeof(registers));
+      uint16_t words[12] = {T1, (uint16_t)T2, (uint16_t)T3, P1, (uint16_t)P2, (uint16_t)P3, (uint16_t)P4,
+                            (uint16_t)P5, (uint16_t)P6, (uint16_t)P7, (uint16_t)P8, (uint16_t)P9};
+      for(int i = 0; i < 12; i++){
+        registers[0x88 + 2 * i] = (uint8_t)(words[i] & 0xFF);
+        registers[0x89 + 2 * i] = (uint8_t)(words[i] >> 8);
+      }
+      registers[0xD0] = 0x58;                               // chip id
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value){ registers[reg] = value; }
+    uint8_t readRegister(uint8_t reg){ return registers[reg]; }
+
+    /**
+     * @brief (us) time between two measurements in normal mode: standby time of 0xF5 plus the conversion.
+     */
+    uint64_t measurePeriod() const {
+      static const uint32_t standby[8] = {500, 62500, 125000, 250000, 500000, 1000000, 2000000, 4000000};
+      static const uint32_t conversion[6] = {0, 2300, 4300, 8300, 16300, 32300};
+      int osrsT = registers[0xF4] >> 5, osrsP = (registers[0xF4] >> 2) & 0x07;
+      uint32_t t = 1250 + conversion[osrsT > 5 ? 5 : osrsT] + conversion[osrsP > 5 ? 5 : osrsP];
+      return standby[registers[0xF5] >> 5] + t;
+    }
+
+    /**
+     * @brief Floating point compensation of the datasheet (section 8.1).
+     */
+    double compensate(int32_t adcT, int32_t adcP, double &fine) const {
+      double var1 = (adcT / 16384.0 - T1 / 1024.0) * T2;
+      double var2 = (adcT / 131072.0 - T1 / 8192.0) * (adcT / 131072.0 - T1 / 8192.0) * T3;
+      fine = var1 + var2;
+
+      var1 = fine / 2.0 - 64000.0;
+      var2 = var1 * var1 * P6 / 32768.0;
+      var2 = var2 + var1 * P5 * 2.0;
+      var2 = var2 / 4.0 + P4 * 65536.0;
+      var1 = (P3 * var1 * var1 / 524288.0 + P2 * var1) / 524288.0;
+      var1 = (1.0 + var1 / 32768.0) * P1;
+      double p = 1048576.0 - adcP;
+      p = (p - var2 / 4096.0) * 6250.0 / var1;
+      var1 = P9 * p * p / 2147483648.0;
+      var2 = p * P8 / 32768.0;
+      return p + (var1 + var2 + P7) / 16.0;
+    }
+
+    /**
+     * @brief Writes a new measurement in the registers 0xF7-0xFC when the sensor would have one.
+     */
+    void update(const Quadcopter &quad, Noise &noise, uint64_t now){
+      if((registers[0xF4] & 0x03) == 0 || now < nextMeasure) return;           // sleep mode or still measuring
+      nextMeasure = now + measurePeriod();
+
+      double altitude = groundAltitude + quad.altitude();
+      double pressure = seaLevelPressure * pow(1.0 - altitude / 44330.0, 5.255) + noise.gaussian(pressureNoise);
+
+      // the compensated temperature grows with adcT and the compensated pressure drops with adcP: bisection
+      double fine;
+      int32_t low = 0, high = 1 << 20;
+      while(high - low > 1){
+        int32_t middle = (low + high) / 2;
+        if(compensate(middle, 0, fine), fine / 5120.0 < temperature) low = middle; else high = middle;
+      }
+      int32_t adcT = low;
+
+      low = 0; high = 1 << 20;
+      while(high - low > 1){
+        int32_t middle = (low + high) / 2;
+        if(compensate(adcT, middle, fine) > pressure) low = middle; else high = middle;
+      }
+      int32_t adcP = low;
+
+      registers[0xF7] = (uint8_t)(adcP >> 12);
+      registers[0xF8] = (uint8_t)(adcP >> 4);
+      registers[0xF9] = (uint8_t)((adcP & 0x0F) << 4);
+      registers[0xFA] = (uint8_t)(adcT >> 12);
+      registers[0xFB] = (uint8_t)(adcT >> 4);
+      registers[0xFC] = (uint8_t)((adcT & 0x0F) << 4);
+    }
+};
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  HMC5883L
+ */
+class SimulatedCompass : public halI2CDevice {
+  public:
+    uint8_t registers[16];
+    double field[3];                                        // (Gauss) NED, of the earth
+    double hardIron[3];                                     // (Gauss) of the drone, x to the nose, y right, z down
+    double softIron[3][3];                                  // gains of the axes of the drone, and their mixing
+    double fieldNoise;                                      // (Gauss) standard deviation
+    uint64_t period;                                        // (us) 75 Hz
+    uint64_t nextMeasure;
+
+    SimulatedCompass() : fieldNoise(0.002), period(13333), nextMeasure(0){
+      memset(registers, 0, sizeof(registers));
+      registers[0x02] = 0x01;                               // single measurement after the power on
+      registers[0x0A] = 'H'; registers[0x0B] = '4'; registers[0x0C] = '3';
+
+      // Milan: 0.47 Gauss, 62 deg down, declination as in Config.h
+      double horizontal = 0.47 * cos(62.0 * M_PI / 180.0), declination = COMPASS_DECLINATION * M_PI / 180.0;
+      field[0] = horizontal * cos(declination);
+      field[1] = horizontal * sin(declination);
+      field[2] = 0.47 * sin(62.0 * M_PI / 180.0);
+      hardIron[0] = 0.08; hardIron[1] = -0.05; hardIron[2] = 0.12;
+      const double soft[3][3] = {{1.06, 0.03, -0.02}, {0.03, 0.95, 0.04}, {-0.02, 0.04, 1.02}};
+      memcpy(softIron, soft, sizeof(softIron));
+    }
+
+    void writeRegister(uint8_t reg, uint8_t value){ if(reg < 3) registers[reg] = value; }
+    uint8_t readRegister(uint8_t reg){ return reg < 16 ? registers[reg] : 0; }
+
+    /**
+     * @brief (LSB) reading in the axes of the drone, as readCompassField() gives it.
+     */
+    void reading(const Quadcopter &quad, Noise &noise, double value[3]) const {
+      double body[3];
+      quad.nedToBody(field, body);
+      for(int i = 0; i < 3; i++){
+        value[i] = noise.gaussian(fieldNoise);
+        for(int j = 0; j < 3; j++) value[i] += softIron[i][j] * (body[j] + hardIron[j]);
+        value[i] *= 1090.0;
+      }
+    }
+
+    /**
+     * @brief Writes a new measurement in the data registers 0x03-0x08 (X, Z, Y) in continuous mode.
+     */
+    void update(const Quadcopter &quad, Noise &noise, uint64_t now){
+      if((registers[0x02] & 0x03) != 0 || now < nextMeasure) return;
+      nextMeasure = now + period;
+
+      double value[3];
+      reading(quad, noise, value);
+
+      // the chip has its Z axis up, unless it is upside down
+      double chip[3] = {value[0], COMPASS_UPSIDE_DOWN ? value[1] : -value[1], COMPASS_UPSIDE_DOWN ? value[2] : -value[2]};
+      const int order[3] = {0, 2, 1};
+      for(int i = 0; i < 3; i++){
+        int16_t v = fabs(chip[order[i]]) > 2047.0 ? -4096 : (int16_t)lround(chip[order[i]]);
+        registers[0x03 + 2 * i] = (uint8_t)((uint16_t)v >> 8);
+        registers[0x04 + 2 * i] = (uint8_t)((uint16_t)v & 0xFF);
+      }
+    }
+};
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  GPS
+ */
+class SimulatedGPS {
+  public:
+    double homeLatitude, homeLongitude;                     // (deg) of the take off point
+    double positionNoise;                                   // (m) standard deviation of the error
+    double errorTimeConstant;                               // (s) the GPS error wanders slowly
+    uint64_t period;                                        // (us) 5 Hz
+    uint64_t nextSentence;
+    int satellites;
+    double velocityNoise;                                   // (m/s) standard deviation of the doppler velocity
+    double error[2];                                        // (m) north and east error
+    bool lost;                                              // no sentences, e.g. to test the failsafe
+
+    SimulatedGPS() : homeLatitude(45.464211), homeLongitude(9.191383), positionNoise(0.6), errorTimeConstant(5.0),
+                     period(200000), nextSentence(0), satellites(9), velocityNoise(0.05), lost(false){ error[0] = error[1] = 0.0; }
+
+    /**
+     * @brief Writes a sentence with its checksum on the serial.
+     */
+    void send(const char *body, HardwareSerial &serial){
+      uint8_t checksum = 0;
+      for(const char *c = body; *c; c++) checksum ^= (uint8_t)*c;
+
+      char sentence[120];
+      snprintf(sentence, sizeof(sentence), "$%s*%02X\r\n", body, checksum);
+      serial.halReceive(sentence);
+    }
+
+    /**
+     * @brief Writes a RMC (with the velocity) and a GGA sentence on the serial when it is time, as a u-blox does.
+     */
+    void update(const Quadcopter &quad, Noise &noise, uint64_t now, HardwareSerial &serial){
+      if(now < nextSentence) return;
+      nextSentence = now + period;
+      if(lost) return;
+
+      double dt = period / 1e6, a = exp(-dt / errorTimeConstant);
+      for(int i = 0; i < 2; i++) error[i] = a * error[i] + noise.gaussian(positionNoise * sqrt(1.0 - a * a));
+
+      double latitude = homeLatitude + (quad.position[0] + error[0]) / 6371000.0 * 180.0 / M_PI;
+      double longitude = homeLongitude + (quad.position[1] + error[1]) / (6371000.0 * cos(homeLatitude * M_PI / 180.0)) * 180.0 / M_PI;
+
+      double seconds = now / 1e6;
+      int hours = (int)(seconds / 3600) % 24, minutes = (int)(seconds / 60) % 60;
+      double sec = fmod(seconds, 60.0);
+      int latDeg = (int)latitude, lonDeg = (int)longitude;
+
+      double north = quad.velocity[0] + noise.gaussian(velocityNoise), east = quad.velocity[1] + noise.gaussian(velocityNoise);
+      double course = atan2(east, north) * 180.0 / M_PI;
+      if(course < 0.0) course += 360.0;
+
+      char body[100];
+      snprintf(body, sizeof(body), "GPRMC,%02d%02d%05.2f,A,%02d%08.5f,N,%03d%08.5f,E,%.3f,%.2f,250622,,,A",
+               hours, minutes, sec, latDeg, (latitude - latDeg) * 60.0, lonDeg, (longitude - lonDeg) * 60.0,
+               sqrt(north * north + east * east) / 0.514444, course);
+      send(body, serial);
+
+      snprintf(body, sizeof(body), "GPGGA,%02d%02d%05.2f,%02d%08.5f,N,%03d%08.5f,E,1,%02d,0.9,%.1f,M,46.9,M,,",
+               hours, minutes, sec, latDeg, (latitude - latDeg) * 60.0, lonDeg, (longitude - lonDeg) * 60.0,
+               satellites, 100.0 + quad.altitude());
+      send(body, serial);
+    }
+};
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  RECEIVER
+ */
+struct sticks {
+  int roll;                                                 // (us) channel 1, > 1500 rolls right
+  int pitch;                                                // (us) channel 2, > 1500 raises the nose
+  int throttle;                                             // (us) channel 3
+  int yaw;                                                  // (us) channel 4, > 1500 turns right
+  int mode;                                                 // (us) channel 5: 1000 manual, 1500 altitude hold, 2000 GPS hold
+};
+
+class SimulatedReceiver {
+  public:
+    uint64_t nextFrame;                                     // (us)
+    uint64_t period;                                        // (us) 50 Hz
+    bool lost;                                              // no pulses, e.g. to test the failsafe
+
+    SimulatedReceiver() : nextFrame(0), period(20000), lost(false){}
+
+    /**
+     * @brief Sends a pulse on every channel when a new frame is due.
+     */
+    void update(const sticks &s, uint64_t now){
+      if(now < nextFrame) return;
+      nextFrame = now + period;
+      if(lost) return;
+
+      const uint8_t pins[5] = {PIN_RECEIVER_1, PIN_RECEIVER_2, PIN_RECEIVER_3, PIN_RECEIVER_4, PIN_RECEIVER_5};
+      const int widths[5] = {s.roll, s.pitch, s.throttle, s.yaw, s.mode};
+      for(int i = 0; i < 5; i++){
+        halSetPin(pins[i], HIGH, now);
+        halSetPin(pins[i], LOW, now + constrain(widths[i], 900, 2100));
+      }
+    }
+};
+
+#endif /* SENSORS_H */
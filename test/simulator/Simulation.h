@@ -0,0 +1,403 @@
+/**
+ * @file Simulation.h
+ * @author @sebastiano123-c
+ * @brief Software-in-the-loop harness: the real flight controller sketch flying the Quadcopter model.
+ *
+ * src/main.cpp is compiled as it is, with SIMULATOR defined (see Config.sim.h) and the simulated core of the
+ * hal/ dir instead of the ESP32 one. startSimulation() calls setup(), then flySimulation() calls loop() until
+ * the end of the scenario; between two loops halRunTasks() moves the world forward to the simulated clock:
+ *  @li the model is integrated every SIMULATION_STEP with the last esc1..esc4 pulses;
+ *  @li the sensors and the receiver are updated at their own rates;
+ *  @li a simulated pilot moves the sticks following the scenario.
+ *
+ * The sketch lives in global variables, so there can be only one simulation per process: to run many of them
+ * (e.g. a gain sweep), call startSimulation() once and fork() the process after it, so that every child
+ * skips the 11 s of the gyroscope calibration and flies from the same state.
+ *
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#define SIMULATOR
+#include "../../src/main.cpp"
+
+#include <chrono>
+#include "Quadcopter.h"
+#include "Sensors.h"
+
+#define SIMULATION_STEP             1000                    // (us) integration step of the model
+#define ARMING_TIME                 1.0                     // (s) yaw left with throttle low, then the motors start
+#define TAKEOFF_TIME                1.5                     // (s) the pilot starts to climb
+#define ENGAGE_TIME                 8.0                     // (s) the scenario starts (steps, altitude hold, GPS hold)
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  SCENARIOS AND RESULTS
+ */
+enum scenarioType {
+  HOVER,                                                    // manual hover at 2 m
+  STEPS,                                                    // roll, pitch and yaw stick steps while hovering
+  ALTITUDE_HOLD,                                            // altitude hold mode engaged at 3 m
+  GPS_HOLD                                                  // GPS hold mode engaged at 3 m, with wind
+};
+
+const char *scenarioNames[] = {"hover", "steps", "althold", "gpshold"};
+
+struct simulationSettings {
+  scenarioType scenario;
+  double duration;                                          // (s) flight time, after the setup
+  uint64_t seed;                                            // of the sensors noise
+  double wind[3];                                           // (m/s) NED, from ENGAGE_TIME
+  double batteryCharge;                                     // (%) at the beginning
+  const char *tracePath;                                    // csv with one line per loop, NULL for none
+  quadcopterParameters quadcopter;
+  double heading;                                           // (deg) of the nose on the ground, 0 north
+};
+
+const simulationSettings defaultSettings = {HOVER, 30.0, 1, {0.0, 0.0, 0.0}, 100.0, NULL, defaultQuadcopter, 0.0};
+
+struct simulationResult {
+  double setupTime;                                         // (s) simulated time spent in setup()
+  double simulatedTime;                                     // (s)
+  double wallTime;                                          // (s)
+  long loops;
+  bool crashed;
+  double crashTime;                                         // (s)
+  double rateError[3];                                      // (deg/s) RMS of rate - PID set point, roll pitch yaw
+  double angleError[2];                                     // (deg) RMS of the roll and pitch angles
+  double maxAngle;                                          // (deg)
+  double altitudeError;                                     // (m) RMS from the target altitude
+  double drift;                                             // (m) largest horizontal distance from the engage point
+  double overshoot;                                         // (%) largest rate beyond the one asked by a stick step
+  double escNoise;                                          // (us) RMS of the change of the ESC pulses between two loops
+  double saturation;                                        // (%) of loops with a motor at 1100us or 2000us
+  double minVoltage;                                        // (V)
+  double consumed;                                          // (mAh)
+};
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  CHECKS OF THE TEST PROGRAMS
+ */
+int failures = 0;                                           // the programs return 1 if a check failed
+
+/**
+ * @brief Prints a check, and counts it if it failed.
+ *
+ * @param ok
+ * @param what
+ */
+void check(bool ok, const char *what){
+  printf("     %-56s %s\n", what, ok ? "ok" : "FAILED");
+  if(!ok) failures++;
+}
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  WORLD
+ */
+struct simulationWorld {
+  simulationSettings settings;
+  Quadcopter quad;
+  SimulatedMPU6050 mpu;
+  SimulatedBMP280 bmp;
+  SimulatedCompass compass;
+  SimulatedGPS gps;
+  SimulatedReceiver receiver;
+  Noise noise;
+  sticks pilot;
+
+  uint64_t time;                                            // (us) the world is updated up to here
+  uint64_t flightStart;                                     // (us) end of setup()
+  double targetAltitude;                                    // (m) of the pilot
+  double throttleIntegral;
+  double engagePosition[2];
+} world;
+
+
+/**
+ * @brief (V) on the analog pins: the battery through the diode and the voltage divider.
+ */
+float simulatedAnalogVoltage(int pin){
+  if(pin != PIN_BATTERY_LEVEL) return 0.0f;
+  double voltage = (world.quad.voltage - DIODE_DROP) * (TOTAL_DROP);
+  return voltage > 0.0 ? (float)voltage : 0.0f;
+}
+
+/**
+ * @brief The pilot: arms the motors, keeps the altitude with the throttle stick (looking at the drone as a human
+ * would), and then moves the sticks as the scenario says.
+ *
+ * @param t (s) time from the end of the setup, negative during the setup
+ */
+void movePilot(double t){
+  sticks &s = world.pilot;
+  s.roll = 1500; s.pitch = 1500; s.yaw = 1500; s.throttle = 1000; s.mode = 1000;
+
+  if(t < 0.0) return;
+  if(t < ARMING_TIME){ s.yaw = 1000; return; }
+  if(t < TAKEOFF_TIME) return;
+
+  bool engaged = t >= ENGAGE_TIME;
+
+  // manual altitude control
+  double error = world.targetAltitude - world.quad.altitude(), climb = -world.quad.velocity[2];
+  world.throttleIntegral += error * world.receiver.period / 1e6;
+  world.throttleIntegral = constrain(world.throttleIntegral, -5.0, 5.0);
+  double throttle = 1420.0 + 60.0 * error - 80.0 * climb + 12.0 * world.throttleIntegral;
+  s.throttle = (int)constrain(throttle, 1100.0, 1800.0);
+
+  switch(world.settings.scenario){
+    case STEPS:
+      if(engaged){
+        // 0.5s steps, one axis at a time: roll right, roll left, pitch up, pitch down, yaw right, yaw left
+        int phase = (int)((t - ENGAGE_TIME) / 1.5) % 8;
+        bool active = fmod(t - ENGAGE_TIME, 1.5) < 0.5;
+        if(active && phase == 0) s.roll = 1650;
+        if(active && phase == 1) s.roll = 1350;
+        if(active && phase == 2) s.pitch = 1650;
+        if(active && phase == 3) s.pitch = 1350;
+        if(active && phase == 4) s.yaw = 1700;
+        if(active && phase == 5) s.yaw = 1300;
+      }
+      break;
+
+    case ALTITUDE_HOLD:
+    case GPS_HOLD:
+      if(engaged){
+        s.throttle = 1500;                                  // the altitude PID keeps the altitude
+        s.mode = world.settings.scenario == GPS_HOLD ? 2000 : 1500;
+      }
+      break;
+
+    default:
+      break;
+  }
+}
+
+/**
+ * @brief Brings the world up to the simulated clock (called by halRunTasks()).
+ */
+void updateWorld(){
+  while(world.time + SIMULATION_STEP <= halClock){
+    double t = world.flightStart ? (double)(world.time - world.flightStart) / 1e6 : -1.0;
+
+    if(t >= ENGAGE_TIME)
+      for(int i = 0; i < 3; i++) world.quad.wind[i] = world.settings.wind[i];
+
+    int16_t pulses[4] = {esc1, esc2, esc3, esc4};
+    world.quad.step(pulses, SIMULATION_STEP / 1e6);
+    world.time += SIMULATION_STEP;
+
+    world.mpu.update(world.quad, world.noise);
+    world.bmp.update(world.quad, world.noise, world.time);
+    world.compass.update(world.quad, world.noise, world.time);
+    world.gps.update(world.quad, world.noise, world.time, SerialGPS);
+    if(world.time >= world.receiver.nextFrame) movePilot(t);
+    world.receiver.update(world.pilot, world.time);
+  }
+}
+
+
+/**
+ * @brief The calibration of the compass, as the CALIBRATION sketch saves it: the drone turned on all its sides.
+ */
+void calibrateSimulatedCompass(){
+  #if COMPASS != OFF
+    Quadcopter turned = world.quad;
+    compassFit fit;
+    compassCalibration calibration;
+    resetCompassFit(fit);
+
+    for(int i = 0; i < 600; i++){
+      double q[4] = {world.noise.gaussian(1.0), world.noise.gaussian(1.0), world.noise.gaussian(1.0), world.noise.gaussian(1.0)};
+      double norm = sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+      for(int j = 0; j < 4; j++) turned.quaternion[j] = q[j] / norm;
+
+      double value[3];
+      world.compass.reading(turned, world.noise, value);
+      float reading[3] = {(float)value[0], (float)value[1], (float)value[2]};
+      addCompassFitSample(fit, reading);
+    }
+    if(solveCompassFit(fit, calibration)) saveCompassCalibration(calibration);
+  #endif
+}
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  RUN
+ */
+
+/**
+ * @brief Prepares the world and runs setup(): the drone is on the ground, ready to be armed.
+ *
+ * @param settings
+ */
+void startSimulation(const simulationSettings &settings){
+
+  world.settings = settings;
+  world.quad = Quadcopter(settings.quadcopter);
+  world.quad.reset(settings.batteryCharge);
+  world.quad.quaternion[0] = cos(settings.heading * M_PI / 360.0);
+  world.quad.quaternion[3] = sin(settings.heading * M_PI / 360.0);
+  world.noise = Noise(settings.seed);
+  world.time = 0;
+  world.flightStart = 0;
+  world.targetAltitude = settings.scenario == HOVER || settings.scenario == STEPS ? 2.0 : 3.0;
+  world.throttleIntegral = 0.0;
+  movePilot(-1.0);
+
+  // the EEPROM as written by the SETUP sketch: centered sticks, no inversion, MPU-6050
+  for(int ch = 0; ch < 4; ch++){
+    EEPROM.write(ch * 2,      1500 & 0xFF); EEPROM.write(ch * 2 + 1,  1500 >> 8);
+    EEPROM.write(ch * 2 + 8,  2000 & 0xFF); EEPROM.write(ch * 2 + 9,  2000 >> 8);
+    EEPROM.write(ch * 2 + 16, 1000 & 0xFF); EEPROM.write(ch * 2 + 17, 1000 >> 8);
+    EEPROM.write(24 + ch, ch + 1);
+  }
+  EEPROM.write(28, 1); EEPROM.write(29, 2); EEPROM.write(30, 3);
+  EEPROM.write(31, 1); EEPROM.write(32, GYRO_ADDRESS);
+  EEPROM.write(33, 'J'); EEPROM.write(34, 'M'); EEPROM.write(35, 'B');
+
+  Wire.halAttach(GYRO_ADDRESS, &world.mpu);
+  Wire.halAttach(ALTITUDE_SENSOR_ADDRESS, &world.bmp);
+  #if COMPASS != OFF
+    Wire.halAttach(COMPASS_ADDRESS, &world.compass);
+    calibrateSimulatedCompass();
+  #endif
+  halAnalogVoltage = simulatedAnalogVoltage;
+  halWorld = updateWorld;
+
+  #if FLIGHT_RECORDER == true
+    Serial.echo = false;                                    // the trace is binary: keep it in Serial.sent
+    Serial.record = true;
+  #endif
+
+  setup();
+  world.flightStart = halClock;
+}
+
+/**
+ * @brief Flies the scenario from the end of setup().
+ *
+ * @param result
+ */
+void flySimulation(simulationResult &result){
+
+  std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+  const simulationSettings &settings = world.settings;
+
+  FILE *trace = settings.tracePath ? fopen(settings.tracePath, "w") : NULL;
+  if(trace) fprintf(trace, "time,roll,pitch,yaw,north,east,altitude,esc1,esc2,esc3,esc4,voltage,flightMode\n");
+
+  memset(&result, 0, sizeof(result));
+  result.setupTime = world.flightStart / 1e6;
+  result.minVoltage = world.quad.voltage;
+
+  double sums[6] = {0.0, 0.0, 0.0, 0.0, 0.0, 0.0}, altitudeSum = 0.0, escSum = 0.0;
+  long samples = 0, saturated = 0;
+  double holdAltitude = 0.0;
+  bool engaged = false;
+  int16_t lastEsc[4] = {esc1, esc2, esc3, esc4};
+
+  while(halClock - world.flightStart < (uint64_t)(settings.duration * 1e6)){
+    loop();
+    halRunTasks();
+    result.loops++;
+
+    double t = (double)(halClock - world.flightStart) / 1e6, angles[3];
+    world.quad.eulerAngles(angles);
+
+    if(world.quad.crashed && !result.crashed){
+      result.crashed = true;
+      result.crashTime = t;
+    }
+    if(world.quad.voltage < result.minVoltage) result.minVoltage = world.quad.voltage;
+
+    if(trace) fprintf(trace, "%.3f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%d,%d,%d,%d,%.2f,%d\n", t, angles[0], angles[1], angles[2],
+                      world.quad.position[0], world.quad.position[1], world.quad.altitude(), esc1, esc2, esc3, esc4,
+                      world.quad.voltage, flightMode);
+
+    int16_t escs[4] = {esc1, esc2, esc3, esc4};
+    double escChange = 0.0;
+    for(int i = 0; i < 4; i++){
+      escChange += sq((double)(escs[i] - lastEsc[i])) / 4.0;
+      lastEsc[i] = escs[i];
+    }
+
+    // the errors are measured once the drone is flying
+    if(t < ENGAGE_TIME - 3.0) continue;
+    if(t >= ENGAGE_TIME && !engaged){
+      engaged = true;
+      holdAltitude = world.quad.altitude();
+      world.engagePosition[0] = world.quad.position[0];
+      world.engagePosition[1] = world.quad.position[1];
+    }
+
+    double rates[3] = {world.quad.rates[0] * 180.0 / M_PI, world.quad.rates[1] * 180.0 / M_PI,
+                       world.quad.rates[2] * 180.0 / M_PI};
+    double setpoints[3] = {pidRollSetpoint, pidPitchSetpoint, pidYawSetpoint};
+    double stickRates[3] = {(world.pilot.roll - 1500) / 3.0, (world.pilot.pitch - 1500) / 3.0, (world.pilot.yaw - 1500) / 3.0};
+    for(int i = 0; i < 3; i++){
+      sums[i] += sq(rates[i] - setpoints[i]);
+      if(fabs(stickRates[i]) > 20.0){                       // a stick step: compare with the rate asked by the pilot
+        double overshoot = (rates[i] * (stickRates[i] > 0 ? 1.0 : -1.0) - fabs(stickRates[i])) / fabs(stickRates[i]) * 100.0;
+        if(overshoot > result.overshoot) result.overshoot = overshoot;
+      }
+    }
+    sums[3] += sq(angles[0]);
+    sums[4] += sq(angles[1]);
+    if(fabs(angles[0]) > result.maxAngle) result.maxAngle = fabs(angles[0]);
+    if(fabs(angles[1]) > result.maxAngle) result.maxAngle = fabs(angles[1]);
+
+    bool holding = engaged && (settings.scenario == ALTITUDE_HOLD || settings.scenario == GPS_HOLD);
+    altitudeSum += sq(world.quad.altitude() - (holding ? holdAltitude : world.targetAltitude));
+
+    if(engaged){
+      double drift = sqrt(sq(world.quad.position[0] - world.engagePosition[0]) +
+                          sq(world.quad.position[1] - world.engagePosition[1]));
+      if(drift > result.drift) result.drift = drift;
+    }
+
+    escSum += escChange;
+    if(esc1 >= 2000 || esc2 >= 2000 || esc3 >= 2000 || esc4 >= 2000 ||
+       esc1 <= 1100 || esc2 <= 1100 || esc3 <= 1100 || esc4 <= 1100) saturated++;
+    samples++;
+  }
+
+  if(trace) fclose(trace);
+
+  if(samples > 0){
+    for(int i = 0; i < 3; i++) result.rateError[i] = sqrt(sums[i] / samples);
+    for(int i = 0; i < 2; i++) result.angleError[i] = sqrt(sums[3 + i] / samples);
+    result.altitudeError = sqrt(altitudeSum / samples);
+    result.escNoise = sqrt(escSum / samples);
+    result.saturation = 100.0 * saturated / samples;
+  }
+  result.simulatedTime = (double)(halClock - world.flightStart) / 1e6;
+  result.consumed = (settings.batteryCharge - world.quad.charge) / 100.0 * settings.quadcopter.capacity;
+  result.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+}
+
+/**
+ * @brief Flies a scenario, setup included.
+ *
+ * @param settings
+ * @param result
+ */
+void runSimulation(const simulationSettings &settings, simulationResult &result){
+  std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+  startSimulation(settings);
+  flySimulation(result);
+  result.wallTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+}
+
+#endif /* SIMULATION_H */
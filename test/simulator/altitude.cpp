@@ -0,0 +1,207 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *            Altitude            *
+ *                       **********************************
+ *
+ *          Test the altitude estimator and the altitude hold on your computer.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * First the routines of AltitudeEstimator.h, alone:
+ *      tilt        the accelerometer of a tilted drone, still or accelerating up: the vertical acceleration is the
+ *                  true one;
+ *      estimator   a drone going up and down, read by an accelerometer with a bias and the vibrations, and by a
+ *                  noisy barometer every other loop: the estimator finds the altitude, the vertical speed and the
+ *                  bias, and its speed is much better than the difference of the barometer readings.
+ * Then the FLIGHT_CONTROLLER sketch flies the altitude hold in the simulator (see Simulation.h): the estimate must
+ * follow the true altitude and speed, the drone must hold the altitude of the engage point, and the altitude PID
+ * must run at every loop, also in the ones without a barometer reading.
+ * The program prints the results and returns 1 if a check fails.
+ * Write a file name as argument to save one line per loop of the flight in a csv file.
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src simulator/altitude.cpp -o altitude
+ *      ./altitude [flight.csv]
+ *
+ *
+ * @file altitude.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "Simulation.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ */
+#define MOTION_AMPLITUDE            2.0                       // (m) of the synthetic up and down
+#define MOTION_PERIOD               6.0                       // (s)
+#define ACC_BIAS                    0.4                       // (m/s^2) of the synthetic accelerometer
+#define ACC_NOISE                   0.5                       // (m/s^2) vibrations, standard deviation
+#define BARO_NOISE                  0.3                       // (m) standard deviation
+#define BARO_DIFFERENCE             30                        // readings, as the old D-controller of the altitude
+#define FLIGHT_TIME                 60.0                      // (s) after the setup
+/**
+ *      (LIMITS)
+ */
+#define MAX_TILT_ERROR              0.01                      // (m/s^2)
+#define MAX_SPEED_ERROR             0.15                      // (m/s) RMS
+#define MAX_ALTITUDE_ERROR          0.15                      // (m) RMS of the estimate
+#define MAX_BIAS_ERROR              0.05                      // (m/s^2)
+#define MAX_HOLD_ERROR              0.5                       // (m) largest distance from the engage altitude
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  DO NOT CHANGE THIS VALUES
+ */
+/**
+ * @brief The vertical acceleration of a drone turned in many ways.
+ */
+void checkTilt(){
+
+  Quadcopter quad;
+  double worst = 0.0;
+
+  for(int roll = -40; roll <= 40; roll += 10)
+    for(int pitch = -40; pitch <= 40; pitch += 10)
+      for(int climb = -1; climb <= 1; climb++){
+        // ZYX: yaw, then pitch, then roll
+        double y = 0.6, p = pitch * M_PI / 360.0, r = roll * M_PI / 360.0;
+        quad.quaternion[0] = cos(r) * cos(p) * cos(y) + sin(r) * sin(p) * sin(y);
+        quad.quaternion[1] = sin(r) * cos(p) * cos(y) - cos(r) * sin(p) * sin(y);
+        quad.quaternion[2] = cos(r) * sin(p) * cos(y) + sin(r) * cos(p) * sin(y);
+        quad.quaternion[3] = cos(r) * cos(p) * sin(y) - sin(r) * sin(p) * cos(y);
+
+        // the specific force (g) of a drone accelerating up by climb * 3 m/s^2
+        double acceleration = 3.0 * climb, force[3] = {0.0, 0.0, -(1.0 + acceleration / ALTITUDE_ESTIMATOR_GRAVITY)}, body[3];
+        quad.nedToBody(force, body);
+        float vertical = verticalAcceleration((float)body[0], (float)body[1], (float)-body[2], (float)roll, (float)pitch);
+        worst = fmax(worst, fabs(vertical - acceleration));
+      }
+
+  printf("     tilt: largest error %.4f m/s^2\n", worst);
+  check(worst < MAX_TILT_ERROR, "tilt: vertical acceleration");
+}
+
+/**
+ * @brief The estimator on a synthetic up and down, with the loop and the barometer of the flight controller.
+ */
+void checkEstimator(){
+
+  Noise noise(3);
+  altitudeEstimator estimator;
+  resetAltitudeEstimator(estimator, ALTITUDE_ESTIMATOR_TIME);
+
+  const double dt = 1.0 / gyroFrequency, w = 2.0 * M_PI / MOTION_PERIOD;
+  double altitudeSum = 0.0, speedSum = 0.0, differenceSum = 0.0, readings[BARO_DIFFERENCE];
+  long samples = 0, count = 0;
+
+  for(long i = 0; i * dt < 60.0; i++){
+    double t = i * dt, altitude = 100.0 + MOTION_AMPLITUDE * sin(w * t), speed = MOTION_AMPLITUDE * w * cos(w * t);
+    double acceleration = -MOTION_AMPLITUDE * w * w * sin(w * t);
+
+    if(i % 2 == 0){                                           // the barometer, every other loop
+      double reading = altitude + noise.gaussian(BARO_NOISE);
+      correctAltitudeEstimator(estimator, (float)reading);
+
+      double previous = readings[count % BARO_DIFFERENCE];
+      readings[count++ % BARO_DIFFERENCE] = reading;
+      if(count > BARO_DIFFERENCE && t > 10.0)
+        differenceSum += sq((reading - previous) / (BARO_DIFFERENCE * 2 * dt) - speed);
+    }
+    updateAltitudeEstimator(estimator, (float)(acceleration + ACC_BIAS + noise.gaussian(ACC_NOISE)), (float)dt);
+
+    if(t > 10.0){                                             // converged
+      altitudeSum += sq(estimator.altitude - altitude);
+      speedSum += sq(estimator.speed - speed);
+      samples++;
+    }
+  }
+
+  double altitudeError = sqrt(altitudeSum / samples), speedError = sqrt(speedSum / samples);
+  double differenceError = sqrt(differenceSum / (samples / 2));
+  printf("     estimator: altitude %.3f m, speed %.3f m/s (barometer difference %.3f m/s) RMS, bias %.3f m/s^2\n",
+         altitudeError, speedError, differenceError, estimator.bias);
+  check(altitudeError < MAX_ALTITUDE_ERROR, "estimator: altitude");
+  check(speedError < MAX_SPEED_ERROR, "estimator: vertical speed");
+  check(speedError < 0.5 * differenceError, "estimator: better than barometer difference");
+  check(fabs(estimator.bias + ACC_BIAS) < MAX_BIAS_ERROR, "estimator: bias of the accelerometer");
+
+  resetAltitudeEstimator(estimator, ALTITUDE_ESTIMATOR_TIME);
+  correctAltitudeEstimator(estimator, NAN);
+  updateAltitudeEstimator(estimator, 1.0f, (float)dt);
+  check(!estimator.started && estimator.altitude == 0.0f, "estimator: NaN barometer refused");
+}
+
+/**
+ * @brief Flies the altitude hold.
+ *
+ * @param tracePath csv, NULL for none
+ */
+void checkFlight(const char *tracePath){
+
+  simulationSettings settings = defaultSettings;
+  settings.scenario = ALTITUDE_HOLD;
+  startSimulation(settings);
+
+  FILE *trace = tracePath ? fopen(tracePath, "w") : NULL;
+  if(trace) fprintf(trace, "time,altitude,estimatedAltitude,speed,verticalSpeed,pidOutputAltitude,flightMode\n");
+
+  double altitudeSum = 0.0, speedSum = 0.0, holdError = 0.0, holdAltitude = 0.0, ground = world.bmp.groundAltitude;
+  long samples = 0, changes[2] = {0, 0};
+  float lastOutput = 0.0f;
+  bool engaged = false;
+
+  while(halClock - world.flightStart < (uint64_t)(FLIGHT_TIME * 1e6)){
+    loop();
+    halRunTasks();
+
+    double t = (double)(halClock - world.flightStart) / 1e6, altitude = world.quad.altitude(), speed = -world.quad.velocity[2];
+    if(trace) fprintf(trace, "%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%d\n", t, altitude, estimatedAltitude - ground, speed,
+                      verticalSpeed, pidOutputAltitude, flightMode);
+
+    if(t < TAKEOFF_TIME) continue;
+    altitudeSum += sq(estimatedAltitude - ground - altitude);
+    speedSum += sq(verticalSpeed - speed);
+    samples++;
+
+    if(t >= ENGAGE_TIME && !engaged){
+      engaged = true;
+      holdAltitude = altitude;
+    }
+    if(engaged && t > ENGAGE_TIME + 0.1){
+      holdError = fmax(holdError, fabs(altitude - holdAltitude));
+      if(pidOutputAltitude != lastOutput) changes[barometerCounter == 1 ? 1 : 0]++;   // loops without, with a reading
+    }
+    lastOutput = pidOutputAltitude;
+  }
+  if(trace) fclose(trace);
+
+  double altitudeError = sqrt(altitudeSum / samples), speedError = sqrt(speedSum / samples);
+  printf("     flight: estimate %.3f m, %.3f m/s RMS from the true altitude and speed\n", altitudeError, speedError);
+  printf("     flight: %.2f m at most from the engage altitude, %s\n", holdError, world.quad.crashed ? "crashed" : "not crashed");
+  printf("     flight: PID output changed in %li loops without a reading, %li with\n", changes[0], changes[1]);
+  check(altitudeError < MAX_ALTITUDE_ERROR, "flight: estimated altitude");
+  check(speedError < MAX_SPEED_ERROR, "flight: estimated vertical speed");
+  check(holdError < MAX_HOLD_ERROR && !world.quad.crashed, "flight: altitude hold");
+  check(changes[0] > 0.9 * changes[1], "flight: altitude PID at every loop");
+}
+
+int main(int argc, char *argv[]){
+
+  printf("    ----------------------------------------------------\n");
+  checkTilt();
+  printf("    ----------------------------------------------------\n");
+  checkEstimator();
+  printf("    ----------------------------------------------------\n");
+  checkFlight(argc > 1 ? argv[1] : NULL);
+  printf("    ----------------------------------------------------\n");
+
+  return failures > 0 ? 1 : 0;
+}
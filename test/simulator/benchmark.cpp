@@ -0,0 +1,222 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *           Benchmarks           *
+ *                       **********************************
+ *
+ *          Measure the time and the allocations of the functions called by loop(), on your computer.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * The program compiles the FLIGHT_CONTROLLER sketch as the simulator does (see Simulation.h), flies WARMUP_TIME
+ * seconds of hover so that every variable holds a value of a real flight, then calls each function of the list
+ * in a tight loop:
+ *      1) the iterations are increased until a run lasts at least MIN_TIME;
+ *      2) the run is repeated REPETITIONS times and the fastest one is kept (the others were disturbed by the OS);
+ *      3) the global operator new is counted, so that every call to the heap shows up in allocs/op and bytes/op.
+ * The results never go to the heap themselves, and keep() stops the compiler from removing the calls.
+ *
+ * The times are the ones of your computer, not of the ESP32 (about 20 times slower, and with no FPU for double):
+ * use them to compare two versions of the same function, and look at the allocations, which are the same on the
+ * drone. The Wire and the serials are the simulated ones of test/simulator/hal, so readGyroscopeStatus() tells the
+ * cost of the simulated bus, to be subtracted from calculateAnglePRY(). networkForward() and networkBackward() are
+ * timed on the batch of the roll, pitch and yaw networks, with the inputs of autotunePID().
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src simulator/benchmark.cpp -o benchmark
+ *      ./benchmark [name]
+ * where name, if given, runs only the benchmarks whose name contains it.
+ *
+ *
+ * @file benchmark.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-19
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define SIMULATOR_ESP_CAM                                   // writeDataTransfer() needs the ESP32-CAM telemetry
+#define SIMULATOR_AUTOTUNE                                  // sampleAutoPID() feeds the autotune task
+#include "Simulation.h"
+#include <new>
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ */
+#define MIN_TIME                    0.2                       // (s) of each run
+#define REPETITIONS                 5
+#define WARMUP_TIME                 10.0                      // (s) of simulated hover before the benchmarks
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  DO NOT CHANGE THIS VALUES
+ */
+#define MAX_ITERATIONS              (1L << 30)
+
+long heapAllocations = 0;
+long heapBytes = 0;
+
+void *countedAlloc(size_t size){
+  heapAllocations++;
+  heapBytes += size;
+  void *p = malloc(size ? size : 1);
+  if(p == NULL) throw std::bad_alloc();
+  return p;
+}
+void *operator new(size_t size){ return countedAlloc(size); }
+void *operator new[](size_t size){ return countedAlloc(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+/**
+ * @brief Tells the compiler that the value is used, so that the call that made it is not removed.
+ */
+template <typename T> inline void keep(const T &value){ asm volatile("" : : "m"(value) : "memory"); }
+
+const char *benchmarkFilter = NULL;
+
+/**
+ * @brief Runs a benchmark and prints its line.
+ *
+ * @param name
+ * @param body called once per operation
+ */
+template <typename F> void runBenchmark(const char *name, F body){
+
+  if(benchmarkFilter && strstr(name, benchmarkFilter) == NULL) return;
+
+  long iterations = 1;
+  double bestTime = 1e30, allocations = 0.0, bytes = 0.0;
+
+  for(int r = 0; r < REPETITIONS; r++){
+    double elapsed;
+    for(;;){
+      long startAllocations = heapAllocations, startBytes = heapBytes;
+      std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+      for(long i = 0; i < iterations; i++) body();
+      elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+      if(elapsed >= MIN_TIME || iterations >= MAX_ITERATIONS){
+        allocations = (double)(heapAllocations - startAllocations) / iterations;
+        bytes = (double)(heapBytes - startBytes) / iterations;
+        break;
+      }
+      // guess the iterations of MIN_TIME, but never grow more than 10 times
+      double factor = elapsed > 0.0 ? 1.4 * MIN_TIME / elapsed : 10.0;
+      iterations = (long)(iterations * (factor > 10.0 ? 10.0 : (factor < 2.0 ? 2.0 : factor)));
+      if(iterations > MAX_ITERATIONS) iterations = MAX_ITERATIONS;
+    }
+    if(elapsed / iterations < bestTime) bestTime = elapsed / iterations;
+  }
+
+  printf("%-32s %12.1f %14ld %12.2f %12.0f\n", name, bestTime * 1e9, iterations, allocations, bytes);
+}
+
+int main(int argc, char *argv[]){
+
+  if(argc > 1) benchmarkFilter = argv[1];
+
+  // a real state: the sketch after its setup and some seconds of hover
+  simulationSettings settings = defaultSettings;
+  settings.duration = WARMUP_TIME;
+  simulationResult result;
+  startSimulation(settings);
+  flySimulation(result);
+  Serial.echo = false;                                        // telemetry and prints are not timed on the terminal
+
+  // a GGA line as the BN-880 sends it (see calculateLatLonGPSGA())
+  strcpy(GPSString, "$GPGGA,123519.00,4527.85266,N,00911.48298,E,1,08,0.9,545.4,M,46.9,M,,*47");
+
+  printf("%-32s %12s %14s %12s %12s\n", "Benchmark", "ns/op", "Iterations", "allocs/op", "bytes/op");
+  printf("------------------------------------------------------------------------------------------\n");
+
+  int channel = 0;
+  runBenchmark("convertReceiverChannel", [&](){
+    channel = channel % 4 + 1;                                // throttle, roll, pitch and yaw in turn
+    keep(convertReceiverChannel(channel));
+  });
+
+  runBenchmark("readGyroscopeStatus", [](){
+    readGyroscopeStatus();
+    keep(gyroAxis);
+  });
+
+  runBenchmark("calculateAnglePRY", [](){
+    calculateAnglePRY();
+    keep(angleRoll);
+  });
+
+  runBenchmark("calculatePID", [](){
+    calculatePID();
+    keep(pidOutputRoll);
+  });
+
+  runBenchmark("setEscPulses", [](){
+    setEscPulses();
+    keep(esc1);
+  });
+
+  runBenchmark("calibration_T", [](){
+    keep(calibration_T(tempRaw));
+  });
+
+  runBenchmark("calibration_P", [](){
+    keep(calibration_P(presRaw));
+  });
+
+  runBenchmark("calculateAltitudeEstimate", [](){
+    calculateAltitudeEstimate(false);
+    keep(estimatedAltitude);
+  });
+
+  runBenchmark("calculateAltitudeAdjustmentPID", [](){
+    calculateAltitudeAdjustmentPID();
+    keep(pidOutputAltitude);
+  });
+
+  runBenchmark("calculateLatLonGPSGA", [](){
+    calculateLatLonGPSGA();
+    keep(latitudeGPS);
+  });
+
+  runBenchmark("writeDataTransfer", [](){
+    writeDataTransfer();
+  });
+
+  // the roll, pitch and yaw batch, with the inputs of autotunePID()
+  autoPIDSample sample;
+  readAutoPIDSample(sample);
+
+  runBenchmark("networkForward", [&](){
+    float input[4 * AUTOPID_AXES];
+    for(int axis = 0; axis < AUTOPID_AXES; axis++) setAutoPIDInput(input, sample, axis);
+    networkForward(autoPIDLayout, autoPID, input);
+    keep(autoPID[autoPIDLayout.a[numberOfLayers - 1]]);
+  });
+
+  runBenchmark("networkBackward", [&](){
+    float y[3 * AUTOPID_AXES];
+    const float learningRate[AUTOPID_AXES] = {learningRateRoll, learningRatePitch, learningRateYaw};
+    const float momentumFactor[AUTOPID_AXES] = {momentumFactorRoll, momentumFactorPitch, momentumFactorYaw};
+    for(int axis = 0; axis < AUTOPID_AXES; axis++) setAutoPIDTarget(y, sample, axis);
+    networkBackward(autoPIDLayout, autoPID, y, learningRate, momentumFactor);
+    keep(autoPID[autoPIDLayout.weights[1]]);
+  });
+
+  runBenchmark("sampleAutoPID", [](){
+    sampleAutoPID();
+    keep(autoPIDQueueHead);
+  });
+
+  runBenchmark("autotunePID", [](){
+    autotunePID();
+    keep(PGainRoll);
+  });
+
+  return 0;
+}
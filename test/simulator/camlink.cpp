@@ -0,0 +1,176 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *        ESP32-CAM link          *
+ *                       **********************************
+ *
+ *          Test the link between the flight controller and the ESP32-CAM on your computer.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * The FLIGHT_CONTROLLER sketch flies the hover of the simulator (see Simulation.h) with the ESP_CAM telemetry, and
+ * the relay of the ESP32-CAM firmware (../esp32cam/include/Relay.h) is on the other side of its simulated UART:
+ *      1) after every loop the bytes written by the sketch reach the relay in pieces of random size, as the UART
+ *         driver gives them, and some of them are broken on the way (BIT_ERROR_RATE);
+ *      2) every TELEMETRY_PUSH_PERIOD the relay closes a WebSocket message, as the firmware does;
+ *      3) the relay sends some batches of parameters, as /set does: a good one, one with a value out of range,
+ *         and one after the other without waiting.
+ * At the end the program checks that the frames arrived, that the broken ones were dropped, that the relay knows
+ * all the parameters with their last values and that the flight controller applied only the good batches, and
+ * prints the bytes per second used on the UART. It returns 1 if a check fails.
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src -I../esp32cam/include simulator/camlink.cpp -o camlink
+ *      ./camlink [seconds] [seed]
+ *
+ *
+ * @file camlink.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-23
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define SIMULATOR_ESP_CAM
+#include "Simulation.h"
+#include "Relay.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ */
+#define FLIGHT_TIME                 10.0                      // (s) after the setup
+#define BIT_ERROR_RATE              1e-5                      // of the UART, from the flight controller to the camera
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  DO NOT CHANGE THIS VALUES
+ */
+relayState relay;
+
+/**
+ * @brief Sends a batch of parameters to the flight controller, as /set does.
+ *
+ * @return true if the relay made the frame
+ */
+bool sendSet(const char *const *names, const char *const *values, int count, uint8_t sequence){
+  uint8_t frame[LINK_MAX_FRAME];
+  size_t size = relaySetFrame(relay, names, values, count, sequence, frame);
+  if(size == 0) return false;
+  SUART.halReceive(frame, size);
+  return true;
+}
+
+int main(int argc, char *argv[]){
+
+  double duration = argc > 1 ? atof(argv[1]) : FLIGHT_TIME;
+  simulationSettings settings = defaultSettings;
+  settings.seed = argc > 2 ? strtoull(argv[2], NULL, 10) : settings.seed;
+  srand((unsigned)settings.seed);
+
+  relayReset(relay);
+  SUART.record = true;
+  startSimulation(settings);
+
+  uint64_t lastPush = halClock;
+  long loops = 0, messages = 0, messageFrames = 0, bytes = 0, broken = 0;
+  bool goodSent = false, refusedSent = false, burstSent = false;
+  float lastRollP = 0.0f;
+
+  while(halClock - world.flightStart < (uint64_t)(duration * 1e6)){
+    loop();
+    halRunTasks();
+    loops++;
+
+    // the bytes of the loop, broken sometimes, in pieces of 1 to 64 bytes
+    std::vector<uint8_t> &sent = SUART.sent;
+    bytes += sent.size();
+    for(size_t i = 0; i < sent.size(); i++)
+      if((double)rand() / RAND_MAX < BIT_ERROR_RATE * 8){
+        sent[i] ^= (uint8_t)(1 << (rand() % 8));
+        broken++;
+      }
+    for(size_t i = 0; i < sent.size();){
+      size_t room, piece = 1 + rand() % 64;
+      uint8_t *buffer = relayReceiveBuffer(relay, room);
+      if(piece > sent.size() - i) piece = sent.size() - i;
+      if(piece > room) piece = room;
+      memcpy(buffer, sent.data() + i, piece);
+      relayReceived(relay, piece);
+      i += piece;
+    }
+    sent.clear();
+
+    if(halClock - lastPush >= TELEMETRY_PUSH_PERIOD * 1000ULL){
+      size_t size = relayTakeMessage(relay);
+      if(size > 0){
+        telemetryBatch batch;
+        memcpy(&batch, relay.message, sizeof(batch));
+        messages++;
+        messageFrames += batch.frames;
+      }
+      lastPush = halClock;
+    }
+
+    // the page changes the PID gains, once all the parameters are known
+    double t = (double)(halClock - world.flightStart) / 1e6;
+    if(!goodSent && t > 2.0 && relayParametersComplete(relay)){
+      const char *names[] = {"rollP", "pitchP", "thrustCurveExpo"};
+      const char *values[] = {"1.25", "1.25", "0.35"};
+      goodSent = sendSet(names, values, 3, 1);
+    }
+    if(!refusedSent && t > 4.0){
+      const char *names[] = {"rollP", "yawP"};
+      const char *values[] = {"1.5", "99"};
+      refusedSent = sendSet(names, values, 2, 2);
+      lastRollP = PGainRoll;
+    }
+    if(!burstSent && t > 6.0){
+      const char *names[] = {"yawP"};
+      const char *first[] = {"5"}, *second[] = {"4.5"};
+      burstSent = sendSet(names, first, 1, 3) && sendSet(names, second, 1, 4);
+    }
+  }
+  // the last parameters still on their way
+  for(int i = 0; i < 50; i++){
+    loop();
+    halRunTasks();
+    loops++;
+    bytes += SUART.sent.size();
+    size_t room;
+    uint8_t *buffer = relayReceiveBuffer(relay, room);
+    size_t piece = SUART.sent.size() < room ? SUART.sent.size() : room;
+    memcpy(buffer, SUART.sent.data(), piece);
+    relayReceived(relay, piece);
+    SUART.sent.clear();
+  }
+
+  double seconds = (double)(halClock - world.flightStart) / 1e6;
+  int rollP = relayFindParameter(relay, "rollP"), yawP = relayFindParameter(relay, "yawP");
+
+  printf("    ----------------------------------------------------\n");
+  printf("     %ld loops in %.1fs, %.0f bytes/s on the UART (%.0f%% of %d baud)\n", loops, seconds, bytes / seconds,
+         bytes / seconds * 10.0 / WIFI_BAUD_RATE * 100.0, WIFI_BAUD_RATE);
+  printf("     %u telemetry frames, %ld in %ld messages, %u dropped\n", relay.telemetryFrames, messageFrames, messages,
+         relay.dropped);
+  printf("     %ld bytes broken on the UART, %u frames refused by the relay, %u by the flight controller\n", broken,
+         relay.errors, linkErrors);
+  printf("    ----------------------------------------------------\n");
+
+  long expected = loops / TELEMETRY_DECIMATION;
+  check(relay.telemetryFrames >= expected - 2 * broken - 2 && relay.telemetryFrames <= expected,
+        "telemetry frames received (the broken ones dropped)");
+  check(broken == 0 || relay.errors > 0, "broken frames detected by the CRC");
+  check(messageFrames + relay.frames == (long)relay.telemetryFrames - (long)relay.dropped, "frames relayed on the WebSocket");
+  check(relay.parameterCount == PARAMETERS && relayParametersComplete(relay), "all the parameters known by the relay");
+  check(goodSent && PGainRoll == 1.25f && PGainPitch == 1.25f && thrustCurveExpo == 0.35f, "good batch applied");
+  check(rollP >= 0 && relay.parameters[rollP].value == 1.25f, "new values sent back to the relay");
+  check(refusedSent && lastRollP == 1.25f && PGainRoll == 1.25f, "batch with a value out of range refused whole");
+  check(burstSent && PGainYaw == 4.5f && yawP >= 0 && relay.parameters[yawP].value == 4.5f, "two batches in a row, the last wins");
+  check(relay.status == PARAMETERS_STAGED && relay.sequence == 4, "status of the last batch");
+  printf("    ----------------------------------------------------\n");
+
+  return failures > 0 ? 1 : 0;
+}
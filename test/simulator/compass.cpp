@@ -0,0 +1,295 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *            Compass             *
+ *                       **********************************
+ *
+ *          Test the compass calibration and the heading on your computer.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * First the routines of CompassFit.h, alone:
+ *      fit         readings on an ellipsoid with hard and soft iron and noise, with its axes along the ones of
+ *                  the drone and turned: the fit finds them back and brings the readings on a sphere;
+ *      coverage    readings of a drone turned only around the yaw, or too few of them: the fit is refused;
+ *      heading     the field of the earth seen by a tilted drone: the tilt compensated heading is the true one.
+ * Then the FLIGHT_CONTROLLER sketch flies in the simulator with a HMC5883L (see Simulation.h), calibrated as the
+ * CALIBRATION sketch does: the motors start with the nose to START_HEADING, the gyroscope of the yaw drifts by
+ * YAW_DRIFT after its calibration, and the drone holds the position against the wind. The heading of the flight
+ * controller must stay on the true one, and the GPS hold must keep the drone close to the engage point.
+ * The program prints the results and returns 1 if a check fails.
+ * Write a file name as argument to save one line per loop of the flight in a csv file.
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src simulator/compass.cpp -o compass
+ *      ./compass [flight.csv]
+ *
+ *
+ * @file compass.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-27
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define SIMULATOR_COMPASS
+#include "Simulation.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ */
+#define FIT_READINGS                500                       // of the synthetic ellipsoid
+#define FIT_NOISE                   3.0                       // (LSB) standard deviation
+#define START_HEADING               135.0                     // (deg) of the nose at the start of the motors
+#define YAW_DRIFT                   0.5                       // (deg/s) of the gyroscope, after its calibration
+#define WIND_EAST                   1.5                       // (m/s) from ENGAGE_TIME
+#define FLIGHT_TIME                 40.0                      // (s) after the setup
+/**
+ *      (LIMITS)
+ */
+#define MAX_OFFSET_ERROR            3.0                       // (LSB)
+#define MAX_SCALE_ERROR             0.01                      // relative, of the soft iron matrix
+#define MAX_RADIUS_ERROR            0.01                      // relative, RMS of the calibrated field
+#define MAX_TILT_ERROR              0.1                       // (deg) of the tilt compensated heading
+#define MAX_HEADING_ERROR           5.0                       // (deg) of angleYaw, flying
+#define MAX_DRIFT                   4.0                       // (m) from the engage point of the GPS hold
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  DO NOT CHANGE THIS VALUES
+ */
+/**
+ * @brief A random direction, uniform on the sphere.
+ */
+void randomDirection(Noise &noise, double direction[3]){
+  double norm = 0.0;
+  for(int i = 0; i < 3; i++){ direction[i] = noise.gaussian(1.0); norm += direction[i] * direction[i]; }
+  for(int i = 0; i < 3; i++) direction[i] /= sqrt(norm);
+}
+
+/**
+ * @brief The readings of an ellipsoid, fitted: the calibration must turn them back into a sphere.
+ *
+ * @param noise
+ * @param name of the ellipsoid, for the checks
+ * @param offset (LSB) hard iron
+ * @param soft (LSB) symmetric, reading = offset + soft * direction
+ * @param readings x, y, z of every reading
+ * @param calibration the result
+ * @return double relative RMS error of the radius, with the diagonal of the soft iron only
+ */
+double checkEllipsoid(Noise &noise, const char *name, const double offset[3], const double soft[3][3],
+                      std::vector<float> &readings, compassCalibration &calibration){
+
+  compassFit fit;
+  resetCompassFit(fit);
+  readings.clear();
+  for(int i = 0; i < FIT_READINGS; i++){
+    double d[3];
+    randomDirection(noise, d);
+    for(int j = 0; j < 3; j++)
+      readings.push_back((float)(offset[j] + soft[j][0] * d[0] + soft[j][1] * d[1] + soft[j][2] * d[2] +
+                                 noise.gaussian(FIT_NOISE)));
+    addCompassFitSample(fit, &readings[readings.size() - 3]);
+  }
+  bool solved = solveCompassFit(fit, calibration);
+
+  // the soft iron of the calibration undoes the one of the ellipsoid: softIron * soft = mean radius * identity
+  double mean = cbrt(soft[0][0] * (soft[1][1] * soft[2][2] - soft[1][2] * soft[2][1]) -
+                     soft[0][1] * (soft[1][0] * soft[2][2] - soft[1][2] * soft[2][0]) +
+                     soft[0][2] * (soft[1][0] * soft[2][1] - soft[1][1] * soft[2][0]));
+  double offsetError = 0.0, scaleError = 0.0, spread = 0.0, diagonalSpread = 0.0;
+  for(int i = 0; i < 3; i++){
+    offsetError = fmax(offsetError, fabs(calibration.offset[i] - offset[i]));
+    for(int j = 0; j < 3; j++){
+      double product = 0.0;
+      for(int k = 0; k < 3; k++) product += calibration.softIron[i][k] * soft[k][j];
+      scaleError = fmax(scaleError, fabs(product / mean - (i == j ? 1.0 : 0.0)));
+    }
+  }
+  compassCalibration diagonal = calibration;
+  for(int i = 0; i < 3; i++)
+    for(int j = 0; j < 3; j++) if(i != j) diagonal.softIron[i][j] = 0.0f;
+  for(int i = 0; i < FIT_READINGS; i++){
+    float field[3];
+    applyCompassCalibration(calibration, &readings[3 * i], field);
+    spread += sq(sqrt(sq(field[0]) + sq(field[1]) + sq(field[2])) / mean - 1.0) / FIT_READINGS;
+    applyCompassCalibration(diagonal, &readings[3 * i], field);
+    diagonalSpread += sq(sqrt(sq(field[0]) + sq(field[1]) + sq(field[2])) / mean - 1.0) / FIT_READINGS;
+  }
+  printf("     fit: %s, offsets %.1f %.1f %.1f, soft iron error %.4f\n", name, calibration.offset[0],
+         calibration.offset[1], calibration.offset[2], scaleError);
+  printf("     fit: %s, radius %.2f%% RMS, %.2f%% with the diagonal only\n", name, 100.0 * sqrt(spread),
+         100.0 * sqrt(diagonalSpread));
+
+  char what[64];
+  snprintf(what, sizeof(what), "fit: %s, solved", name);
+  check(solved, what);
+  snprintf(what, sizeof(what), "fit: %s, hard iron", name);
+  check(solved && offsetError < MAX_OFFSET_ERROR, what);
+  snprintf(what, sizeof(what), "fit: %s, soft iron", name);
+  check(solved && scaleError < MAX_SCALE_ERROR && sqrt(spread) < MAX_RADIUS_ERROR, what);
+  snprintf(what, sizeof(what), "fit: %s, valid calibration", name);
+  check(solved && validCompassCalibration(calibration), what);
+  return sqrt(diagonalSpread);
+}
+
+/**
+ * @brief The routines of CompassFit.h on synthetic readings.
+ */
+void checkFit(){
+
+  Noise noise(7);
+  const double offset[3] = {150.0, -90.0, 60.0}, radius[3] = {560.0, 470.0, 505.0};
+  compassFit fit;
+  compassCalibration calibration;
+  std::vector<float> readings;
+
+  // an ellipsoid with the axes of the drone
+  const double aligned[3][3] = {{radius[0], 0.0, 0.0}, {0.0, radius[1], 0.0}, {0.0, 0.0, radius[2]}};
+  checkEllipsoid(noise, "aligned", offset, aligned, readings, calibration);
+
+  // the same ellipsoid turned by 40, 25 and 30 deg around x, y and z: rotation * radius * rotation'
+  double rotation[3][3], rotated[3][3];
+  const double a = 40.0 * M_PI / 180.0, b = 25.0 * M_PI / 180.0, c = 30.0 * M_PI / 180.0;
+  const double rx[3][3] = {{1.0, 0.0, 0.0}, {0.0, cos(a), -sin(a)}, {0.0, sin(a), cos(a)}};
+  const double ry[3][3] = {{cos(b), 0.0, sin(b)}, {0.0, 1.0, 0.0}, {-sin(b), 0.0, cos(b)}};
+  const double rz[3][3] = {{cos(c), -sin(c), 0.0}, {sin(c), cos(c), 0.0}, {0.0, 0.0, 1.0}};
+  for(int i = 0; i < 3; i++)
+    for(int j = 0; j < 3; j++){
+      rotation[i][j] = 0.0;
+      for(int k = 0; k < 3; k++)
+        for(int l = 0; l < 3; l++) rotation[i][j] += rz[i][k] * ry[k][l] * rx[l][j];
+    }
+  for(int i = 0; i < 3; i++)
+    for(int j = 0; j < 3; j++){
+      rotated[i][j] = 0.0;
+      for(int k = 0; k < 3; k++) rotated[i][j] += rotation[i][k] * radius[k] * rotation[j][k];
+    }
+  double diagonalSpread = checkEllipsoid(noise, "turned", offset, rotated, readings, calibration);
+  check(diagonalSpread > 2.0 * MAX_RADIUS_ERROR, "fit: turned, not by the diagonal alone");
+
+  // only turned around the yaw: z does not change
+  resetCompassFit(fit);
+  for(int i = 0; i < FIT_READINGS; i++){
+    double yaw = 2.0 * M_PI * i / FIT_READINGS;
+    float reading[3] = {(float)(offset[0] + 0.5 * radius[0] * cos(yaw) + noise.gaussian(FIT_NOISE)),
+                        (float)(offset[1] + 0.5 * radius[1] * sin(yaw) + noise.gaussian(FIT_NOISE)),
+                        (float)(offset[2] + 0.87 * radius[2] + noise.gaussian(FIT_NOISE))};
+    addCompassFitSample(fit, reading);
+  }
+  compassCalibration untouched = calibration;
+  check(!solveCompassFit(fit, calibration) && memcmp(&untouched, &calibration, sizeof(calibration)) == 0,
+        "coverage: only the yaw, refused");
+
+  resetCompassFit(fit);
+  for(int i = 0; i < COMPASS_FIT_MIN_SAMPLES - 1; i++) addCompassFitSample(fit, &readings[3 * i]);
+  check(!solveCompassFit(fit, calibration), "coverage: too few readings, refused");
+
+  compassCalibration broken = {{0.0f, 0.0f, 0.0f}, {{1.0f, 0.0f, 0.0f}, {0.0f, NAN, 0.0f}, {0.0f, 0.0f, 1.0f}}};
+  check(!validCompassCalibration(broken), "coverage: NaN soft iron not valid");
+}
+
+/**
+ * @brief The tilt compensated heading of a drone turned in many ways.
+ */
+void checkHeading(){
+
+  Quadcopter quad;
+  SimulatedCompass compass;
+  double worst = 0.0;
+
+  for(int yaw = 0; yaw < 360; yaw += 15)
+    for(int roll = -30; roll <= 30; roll += 15)
+      for(int pitch = -30; pitch <= 30; pitch += 15){
+        // ZYX: yaw, then pitch, then roll
+        double y = yaw * M_PI / 360.0, p = pitch * M_PI / 360.0, r = roll * M_PI / 360.0;
+        quad.quaternion[0] = cos(r) * cos(p) * cos(y) + sin(r) * sin(p) * sin(y);
+        quad.quaternion[1] = sin(r) * cos(p) * cos(y) - cos(r) * sin(p) * sin(y);
+        quad.quaternion[2] = cos(r) * sin(p) * cos(y) + sin(r) * cos(p) * sin(y);
+        quad.quaternion[3] = cos(r) * cos(p) * sin(y) - sin(r) * sin(p) * cos(y);
+
+        double body[3];
+        quad.nedToBody(compass.field, body);
+        float field[3] = {(float)body[0], (float)body[1], (float)body[2]};
+        float heading = compassHeading(field, (float)roll, (float)pitch) + COMPASS_DECLINATION;
+        worst = fmax(worst, fabs(headingDifference(heading, (float)yaw)));
+      }
+
+  printf("     heading: largest error %.3f deg\n", worst);
+  check(worst < MAX_TILT_ERROR, "heading: tilt compensated");
+  check(fabs(headingDifference(350.0f, 10.0f) + 20.0f) < 1e-4f && fabs(headingDifference(10.0f, 350.0f) - 20.0f) < 1e-4f,
+        "heading: difference across the north");
+}
+
+/**
+ * @brief Flies the GPS hold with the nose to START_HEADING and a drifting gyroscope.
+ *
+ * @param tracePath csv, NULL for none
+ */
+void checkFlight(const char *tracePath){
+
+  simulationSettings settings = defaultSettings;
+  settings.scenario = GPS_HOLD;
+  settings.heading = START_HEADING;
+  settings.wind[1] = WIND_EAST;
+  startSimulation(settings);
+  world.mpu.gyroBias[2] += YAW_DRIFT;                       // after the calibration of the gyroscope
+
+  check(compassCalibrated, "flight: compass calibrated in setup()");
+
+  FILE *trace = tracePath ? fopen(tracePath, "w") : NULL;
+  if(trace) fprintf(trace, "time,yaw,angleYaw,compass,north,east,altitude,flightMode\n");
+
+  double armingError = -1.0, headingError = 0.0, drift = 0.0, turned = 0.0, engage[2] = {0.0, 0.0};
+  bool engaged = false;
+
+  while(halClock - world.flightStart < (uint64_t)(FLIGHT_TIME * 1e6)){
+    loop();
+    halRunTasks();
+
+    double t = (double)(halClock - world.flightStart) / 1e6, angles[3];
+    world.quad.eulerAngles(angles);
+    double error = fabs(headingDifference(angleYaw, (float)angles[2]));
+    const double *p = world.quad.position;
+
+    if(trace) fprintf(trace, "%.3f,%.2f,%.2f,%.2f,%.3f,%.3f,%.3f,%d\n", t, angles[2], angleYaw, actualCompassHeading,
+                      p[0], p[1], world.quad.altitude(), flightMode);
+
+    if(start == 2 && armingError < 0.0) armingError = error;
+    if(t >= TAKEOFF_TIME){
+      headingError = fmax(headingError, error);
+      turned = fmax(turned, fabs(headingDifference((float)angles[2], (float)START_HEADING)));
+    }
+    if(t >= ENGAGE_TIME && !engaged){
+      engaged = true;
+      engage[0] = p[0];
+      engage[1] = p[1];
+    }
+    if(engaged) drift = fmax(drift, sqrt(sq(p[0] - engage[0]) + sq(p[1] - engage[1])));
+  }
+  if(trace) fclose(trace);
+
+  printf("     flight: heading error %.1f deg at the start, %.1f deg at most, the drone turned by %.1f deg\n",
+         armingError, headingError, turned);
+  printf("     flight: drift %.1f m from the engage point, %s\n", drift, world.quad.crashed ? "crashed" : "not crashed");
+  check(armingError >= 0.0 && armingError < MAX_HEADING_ERROR, "flight: heading of the compass at the start");
+  check(headingError < MAX_HEADING_ERROR, "flight: heading follows the compass");
+  check(drift < MAX_DRIFT && !world.quad.crashed, "flight: GPS hold with the nose to START_HEADING");
+}
+
+int main(int argc, char *argv[]){
+
+  printf("    ----------------------------------------------------\n");
+  checkFit();
+  printf("    ----------------------------------------------------\n");
+  checkHeading();
+  printf("    ----------------------------------------------------\n");
+  checkFlight(argc > 1 ? argv[1] : NULL);
+  printf("    ----------------------------------------------------\n");
+
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,282 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *            Failsafe            *
+ *                       **********************************
+ *
+ *          Test the failsafe of the flight controller on your computer.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * The FLIGHT_CONTROLLER sketch flies in the simulator (see Simulation.h): the pilot takes off and hovers at 2 m,
+ * while the wind takes the drone away from the take off point. Then something is lost, and the failsafe (see
+ * Failsafe.h) must do the right thing:
+ *      rc          the receiver stops: hold, return to home, land on the home and stop the motors;
+ *      rc-back     the receiver stops for less than FAILSAFE_HOLD_TIME: hold, then the pilot flies again;
+ *      rc-no-gps   the GPS and then the receiver stop: land where it is;
+ *      gps         the GPS stops while the pilot holds the position: altitude hold, the pilot keeps the drone;
+ *      battery     the battery goes low: return to home and land;
+ *      empty       the battery is almost empty: land where it is.
+ * Each case flies in a process of its own, forked after the setup. The program prints the states of the failsafe
+ * and the landing of each case, and returns 1 if a check fails.
+ * Write a case as argument to fly only that one, and a file name after it to save one line per loop in a csv file.
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src simulator/failsafe.cpp -o failsafe
+ *      ./failsafe [case] [flight.csv]
+ *
+ *
+ * @file failsafe.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "Simulation.h"
+#include <sys/wait.h>
+#include <unistd.h>
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ */
+#define WIND_EAST                   1.5                       // (m/s) from ENGAGE_TIME, takes the drone away
+#define LOSS_TIME                   20.0                      // (s) after the setup, something is lost
+#define FLIGHT_TIME                 120.0                     // (s) after the setup, at most
+#define LOW_CHARGE                  12.0                      // (%) resting voltage below FAILSAFE_LOW_CELL_VOLTAGE
+#define EMPTY_CHARGE                2.5                       // (%) below FAILSAFE_CRITICAL_CELL_VOLTAGE, still flying
+/**
+ *      (LIMITS)
+ */
+#define MAX_HOME_ERROR              3.0                       // (m) from the take off point, after a return to home
+#define MAX_LANDING_SPEED           1.0                       // (m/s) descending, close to the ground
+#define MAX_TILT                    30.0                      // (deg) roll and pitch
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  DO NOT CHANGE THIS VALUES
+ */
+enum failsafeCase { CASE_RC, CASE_RC_BACK, CASE_RC_NO_GPS, CASE_GPS, CASE_BATTERY, CASE_EMPTY, CASES };
+const char *caseNames[CASES] = {"rc", "rc-back", "rc-no-gps", "gps", "battery", "empty"};
+const char *stateNames[] = {"none", "hold", "rth-climb", "rth-return", "land"};
+
+
+/**
+ * @brief What a case has done.
+ */
+struct caseResult {
+  int states[8];                                            // failsafeLevel, in the order they came
+  double stateTimes[8];                                     // (s) after the loss
+  int changes;
+  double lossPosition[2];                                   // (m) north and east, when lost
+  double landedPosition[2];                                 // (m) when the motors stopped
+  double motorsOff;                                         // (s) after the loss, negative if still on
+  double landingSpeed;                                      // (m/s) fastest descent in the last 2 m
+  double maxAltitude;                                       // (m)
+  double maxTilt;                                           // (deg)
+  int lastMode;                                             // flightMode at the end
+};
+
+/**
+ * @brief Checks the failsafe conditions alone: the timestamps and the delays.
+ */
+void checkConditions(){
+  failsafeCondition c;
+  memset(&c, 0, sizeof(c));
+
+  updateFailsafeCondition(c, true, 1000, 500, 200);
+  check(c.bad && !c.active && c.since == 1000, "condition: bad, waiting for the delay");
+  updateFailsafeCondition(c, true, 1499, 500, 200);
+  check(!c.active, "condition: not active before the delay");
+  updateFailsafeCondition(c, true, 1500, 500, 200);
+  check(c.active && c.time == 1500, "condition: active after the delay");
+  updateFailsafeCondition(c, false, 1600, 500, 200);
+  updateFailsafeCondition(c, true, 1700, 500, 200);
+  updateFailsafeCondition(c, false, 1750, 500, 200);
+  check(c.active && c.since == 1750, "condition: a short good time does not end it");
+  updateFailsafeCondition(c, false, 1950, 500, 200);
+  check(!c.active && c.time == 1950, "condition: ends after the good time");
+
+  updateFailsafeCondition(c, true, 2000, 0, UINT32_MAX);
+  updateFailsafeCondition(c, false, 100000, 0, UINT32_MAX);
+  check(c.active, "condition: a latched one never ends");
+}
+
+/**
+ * @brief Flies a case from the end of the setup.
+ *
+ * @param which
+ * @param tracePath csv, NULL for none
+ * @param r
+ */
+void flyCase(failsafeCase which, const char *tracePath, caseResult &r){
+
+  memset(&r, 0, sizeof(r));
+  r.motorsOff = -1.0;
+  r.states[r.changes] = FAILSAFE_NONE;
+  r.stateTimes[r.changes++] = 0.0;
+
+  FILE *trace = tracePath ? fopen(tracePath, "w") : NULL;
+  if(trace) fprintf(trace, "time,north,east,altitude,state,flightMode,throttle,climbRate,start\n");
+
+  bool lost = false;
+  while(halClock - world.flightStart < (uint64_t)(FLIGHT_TIME * 1e6)){
+    loop();
+    halRunTasks();
+
+    double t = (double)(halClock - world.flightStart) / 1e6, since = t - LOSS_TIME;
+    const double *p = world.quad.position;
+
+    // what is lost, and when
+    if(!lost && t >= LOSS_TIME){
+      lost = true;
+      r.lossPosition[0] = p[0];
+      r.lossPosition[1] = p[1];
+      if(which == CASE_RC || which == CASE_RC_BACK) world.receiver.lost = true;
+      if(which == CASE_GPS || which == CASE_RC_NO_GPS) world.gps.lost = true;
+      if(which == CASE_BATTERY) world.quad.charge = LOW_CHARGE;
+      if(which == CASE_EMPTY) world.quad.charge = EMPTY_CHARGE;
+    }
+    if(which == CASE_RC_NO_GPS && since >= 2.0) world.receiver.lost = true;
+    if(which == CASE_RC_BACK && since >= 1.0) world.receiver.lost = false;
+    if(which == CASE_GPS && t >= LOSS_TIME - 5.0) world.settings.scenario = GPS_HOLD;  // the pilot holds the position
+
+    if(failsafeState != r.states[r.changes - 1] && r.changes < 8){
+      r.states[r.changes] = failsafeState;
+      r.stateTimes[r.changes++] = since;
+    }
+
+    double angles[3];
+    world.quad.eulerAngles(angles);
+    if(t > TAKEOFF_TIME) r.maxTilt = fmax(r.maxTilt, fmax(fabs(angles[0]), fabs(angles[1])));
+    r.maxAltitude = fmax(r.maxAltitude, world.quad.altitude());
+    if(world.quad.altitude() < 2.0 && lost) r.landingSpeed = fmax(r.landingSpeed, world.quad.velocity[2]);
+
+    if(trace) fprintf(trace, "%.3f,%.2f,%.2f,%.2f,%d,%d,%d,%.2f,%d\n", t, p[0], p[1], world.quad.altitude(),
+                      failsafeState, flightMode, throttle, verticalSpeed, start);
+
+    if(which == CASE_GPS && since >= 5.0) break;              // the failsafe stays out, the rest is the altitude hold
+
+    if(lost && start == 0){
+      r.motorsOff = since;
+      r.landedPosition[0] = p[0];
+      r.landedPosition[1] = p[1];
+      break;
+    }
+  }
+  r.lastMode = flightMode;
+  if(trace) fclose(trace);
+}
+
+/**
+ * @brief Prints what a case has done and checks it.
+ *
+ * @param which
+ * @param r
+ */
+void checkCase(failsafeCase which, const caseResult &r){
+
+  printf("    ----------------------------------------------------\n");
+  printf("     %s: lost at %.1fm from home, states", caseNames[which], sqrt(sq(r.lossPosition[0]) + sq(r.lossPosition[1])));
+  for(int i = 1; i < r.changes; i++) printf(" %s (%.1fs)", stateNames[r.states[i]], r.stateTimes[i]);
+  printf("\n");
+  double home = sqrt(sq(r.landedPosition[0]) + sq(r.landedPosition[1]));
+  double spot = sqrt(sq(r.landedPosition[0] - r.lossPosition[0]) + sq(r.landedPosition[1] - r.lossPosition[1]));
+  if(r.motorsOff >= 0.0)
+    printf("     %s: motors off at %.1fs, %.1fm from home, %.1fm from the loss, landing %.2fm/s\n", caseNames[which],
+           r.motorsOff, home, spot, r.landingSpeed);
+  printf("     %s: max altitude %.1fm, max tilt %.1fdeg\n", caseNames[which], r.maxAltitude, r.maxTilt);
+
+  const int rth[] = {FAILSAFE_NONE, FAILSAFE_HOLD, FAILSAFE_RTH_CLIMB, FAILSAFE_RTH_RETURN, FAILSAFE_LAND};
+  const int battery[] = {FAILSAFE_NONE, FAILSAFE_RTH_CLIMB, FAILSAFE_RTH_RETURN, FAILSAFE_LAND};
+  char what[64];
+
+  switch(which){
+    case CASE_RC:
+      check(r.changes == 5 && memcmp(r.states, rth, sizeof(rth)) == 0, "rc: hold, return to home, land");
+      check(fabs(r.stateTimes[2] - FAILSAFE_HOLD_TIME / 1000.0) < 0.5, "rc: holds for FAILSAFE_HOLD_TIME");
+      check(r.maxAltitude > FAILSAFE_RTH_ALTITUDE - 1.0, "rc: climbs to FAILSAFE_RTH_ALTITUDE");
+      check(r.motorsOff > 0.0 && home < MAX_HOME_ERROR, "rc: landed at home, motors off");
+      break;
+
+    case CASE_RC_BACK:
+      check(r.changes == 3 && r.states[1] == FAILSAFE_HOLD && r.states[2] == FAILSAFE_NONE, "rc-back: hold, then the pilot");
+      check(r.motorsOff < 0.0 && start == 2, "rc-back: still flying");
+      break;
+
+    case CASE_RC_NO_GPS:
+      check(r.changes == 2 && r.states[1] == FAILSAFE_LAND, "rc-no-gps: land, at once");
+      check(r.motorsOff > 0.0, "rc-no-gps: landed, motors off");
+      break;
+
+    case CASE_GPS:
+      check(r.changes == 1 && r.lastMode == 2 && error == 4, "gps: altitude hold, no failsafe");
+      check(r.motorsOff < 0.0 && start == 2, "gps: still flying");
+      break;
+
+    case CASE_BATTERY:
+      check(r.changes == 4 && memcmp(r.states, battery, sizeof(battery)) == 0, "battery: return to home, land");
+      // the resting voltage is filtered, it takes a while to go below the threshold
+      check(r.stateTimes[1] > FAILSAFE_BATTERY_TIME / 1000.0 - 0.1 && r.stateTimes[1] < FAILSAFE_BATTERY_TIME / 1000.0 + 2.0,
+            "battery: after FAILSAFE_BATTERY_TIME");
+      check(r.motorsOff > 0.0 && home < MAX_HOME_ERROR, "battery: landed at home, motors off");
+      break;
+
+    default: {
+      // the low battery may come a moment before: no return anyway
+      bool returned = false;
+      for(int i = 0; i < r.changes; i++) returned |= r.states[i] == FAILSAFE_RTH_RETURN;
+      check(r.states[r.changes - 1] == FAILSAFE_LAND && r.stateTimes[r.changes - 1] - r.stateTimes[1] < 0.5 && !returned,
+            "empty: land");
+      check(r.motorsOff > 0.0 && spot < 2.0 * MAX_HOME_ERROR, "empty: landed where it was, motors off");
+    }
+  }
+
+  snprintf(what, sizeof(what), "%s: tilt", caseNames[which]);
+  check(r.maxTilt < MAX_TILT, what);
+  snprintf(what, sizeof(what), "%s: soft landing", caseNames[which]);
+  check(r.landingSpeed < MAX_LANDING_SPEED && !world.quad.crashed, what);
+}
+
+int main(int argc, char *argv[]){
+
+  int only = -1;
+  for(int i = 0; argc > 1 && i < CASES; i++) if(strcmp(argv[1], caseNames[i]) == 0) only = i;
+  if(argc > 1 && only < 0){
+    printf("unknown case %s\n", argv[1]);
+    return 1;
+  }
+
+  printf("    ----------------------------------------------------\n");
+  checkConditions();
+
+  simulationSettings settings = defaultSettings;
+  settings.wind[1] = WIND_EAST;
+  startSimulation(settings);
+  fflush(stdout);
+
+  // one process per case, from the same state
+  for(int i = 0; i < CASES; i++){
+    if(only >= 0 && i != only) continue;
+
+    pid_t pid = fork();
+    if(pid < 0){ perror("fork"); return 1; }
+    if(pid == 0){
+      caseResult r;
+      flyCase((failsafeCase)i, argc > 2 ? argv[2] : NULL, r);
+      checkCase((failsafeCase)i, r);
+      fflush(stdout);
+      _exit(failures > 0 ? 1 : 0);
+    }
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) failures++;
+  }
+  printf("    ----------------------------------------------------\n");
+
+  return failures > 0 ? 1 : 0;
+}
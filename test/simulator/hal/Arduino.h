@@ -0,0 +1,298 @@
+/**
+ * @file Arduino.h
+ * @author @sebastiano123-c
+ * @brief Simulated Arduino-ESP32 core for the host simulator.
+ *
+ * The sketch is compiled on the computer against these headers instead of the ESP32 core.
+ * Everything runs in a single thread on a simulated clock:
+ *  @li micros() advances the clock by HAL_MICROS_COST at every call, so the busy wait at the end of loop()
+ *      lasts exactly as on the board;
+ *  @li delay() and vTaskDelay() move the clock forward;
+ *  @li the FreeRTOS tasks (e.g. the battery task) are coroutines: they run until their next vTaskDelay(), and
+ *      the simulator resumes them with halRunTasks() between two loops, as if they were on the other core;
+ *  @li interrupts are called by the simulator with halSetPin(), with micros() returning the time of the edge.
+ *
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef HAL_ARDUINO_H
+#define HAL_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+#include <string>
+#include <deque>
+#include <ucontext.h>
+
+using std::abs;
+using std::isnan;
+using std::min;
+using std::max;
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define IRAM_ATTR
+#define HIGH                        1
+#define LOW                         0
+#define INPUT                       0x01
+#define OUTPUT                      0x02
+#define INPUT_PULLUP                0x05
+#define CHANGE                      0x03
+#define RISING                      0x01
+#define FALLING                     0x02
+#define SERIAL_8N1                  0x800001c
+#define PI                          3.1415926535897932384626433832795
+#define HALF_PI                     1.5707963267948966192313216916398
+#define TWO_PI                      6.283185307179586476925286766559
+#define DEG_TO_RAD                  0.017453292519943295769236907684886
+#define RAD_TO_DEG                  57.295779513082320876798154814105
+#define F(string)                   (string)
+#define digitalPinToInterrupt(pin)  (pin)
+#define constrain(amt, low, high)   ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+#define radians(deg)                ((deg) * DEG_TO_RAD)
+#define degrees(rad)                ((rad) * RAD_TO_DEG)
+#define sq(x)                       ((x) * (x))
+
+#define HAL_MICROS_COST             1                       // (us) time spent by a call to micros()
+#define HAL_PINS                    40
+#define HAL_LEDC_CHANNELS           16
+#define HAL_TASK_STACK              (256 * 1024)            // (bytes) host stack of each task
+#define HAL_STACK_PAINT             0xA5
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  CLOCK AND TASKS
+ */
+typedef void *TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef uint32_t UBaseType_t;
+typedef int BaseType_t;
+typedef void (*TaskFunction_t)(void *);
+typedef struct { int owner; } portMUX_TYPE;
+
+#define portTICK_PERIOD_MS          1
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux)     (void)(mux)
+#define portEXIT_CRITICAL(mux)      (void)(mux)
+#define portENTER_CRITICAL_ISR(mux) (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux)  (void)(mux)
+#define pdPASS                      1
+#define pdMS_TO_TICKS(ms)           (ms)
+
+struct halTask {
+  ucontext_t context;
+  TaskFunction_t function;
+  void *parameter;
+  const char *name;
+  uint64_t wake;                                            // (us) time to resume the task
+  uint32_t stackDepth;                                      // (bytes) stack requested by the sketch
+  std::vector<uint8_t> stack;
+  bool finished;
+};
+
+uint64_t halClock = 0;                                      // (us) simulated time
+int64_t halIsrTime = -1;                                    // (us) time seen by micros() inside an interrupt
+std::vector<halTask *> halTasks;
+halTask *halCurrentTask = NULL;
+ucontext_t halSchedulerContext;
+void (*halWorld)() = NULL;                                  // set by the simulator, brings the world up to halClock
+
+
+unsigned long micros(){
+  if(halIsrTime >= 0) return (unsigned long)halIsrTime;
+  halClock += HAL_MICROS_COST;
+  return (unsigned long)halClock;
+}
+
+unsigned long millis(){
+  return (unsigned long)(halClock / 1000);
+}
+
+void halTaskEntry(){
+  halCurrentTask->function(halCurrentTask->parameter);
+  halCurrentTask->finished = true;                          // FreeRTOS tasks should never return, just stop it
+  swapcontext(&halCurrentTask->context, &halSchedulerContext);
+}
+
+/**
+ * @brief Updates the world and resumes the tasks whose delay is over.
+ */
+void halRunTasks(){
+  if(halCurrentTask) return;
+  if(halWorld) halWorld();
+  for(size_t i = 0; i < halTasks.size(); i++){
+    halTask *task = halTasks[i];
+    if(task->finished || task->wake > halClock) continue;
+    halCurrentTask = task;
+    swapcontext(&halSchedulerContext, &task->context);
+    halCurrentTask = NULL;
+  }
+}
+
+/**
+ * @brief Waits: a task gives back the control to the simulator, the sketch moves the clock forward.
+ *
+ * @param us (us) time to wait
+ */
+void halSleep(uint64_t us){
+  if(halCurrentTask){
+    halTask *task = halCurrentTask;
+    task->wake = halClock + us;
+    swapcontext(&task->context, &halSchedulerContext);
+    return;
+  }
+
+  uint64_t end = halClock + us;
+  for(;;){
+    uint64_t next = end;
+    for(size_t i = 0; i < halTasks.size(); i++)
+      if(!halTasks[i]->finished && halTasks[i]->wake < next) next = halTasks[i]->wake;
+    if(next > halClock) halClock = next;
+    halRunTasks();
+    if(halClock >= end) break;
+  }
+}
+
+void delay(uint32_t ms){ halSleep((uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us){ halClock += us; }
+void vTaskDelay(TickType_t ticks){ halSleep((uint64_t)ticks * 1000 * portTICK_PERIOD_MS); }
+TickType_t xTaskGetTickCount(){ return (TickType_t)(halClock / 1000 / portTICK_PERIOD_MS); }
+
+void vTaskDelayUntil(TickType_t *previousWakeTime, TickType_t increment){
+  *previousWakeTime += increment;
+  uint64_t wake = (uint64_t)*previousWakeTime * 1000 * portTICK_PERIOD_MS;
+  halSleep(wake > halClock ? wake - halClock : 0);
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stackDepth, void *parameter,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core){
+  (void)priority;                                             // one core, the tasks run in turn
+  (void)core;
+  halTask *task = new halTask();
+  task->function = function;
+  task->parameter = parameter;
+  task->name = name;
+  task->wake = halClock;
+  task->stackDepth = stackDepth;
+  task->finished = false;
+  task->stack.assign(HAL_TASK_STACK, HAL_STACK_PAINT);       // painted, to measure the stack usage
+
+  getcontext(&task->context);
+  task->context.uc_stack.ss_sp = task->stack.data();
+  task->context.uc_stack.ss_size = task->stack.size();
+  task->context.uc_link = NULL;
+  makecontext(&task->context, halTaskEntry, 0);
+
+  halTasks.push_back(task);
+  if(handle) *handle = (TaskHandle_t)task;
+  return pdPASS;
+}
+
+/**
+ * @brief Stack never used by the task, out of the stack asked to xTaskCreatePinnedToCore() (in bytes, as in ESP-IDF).
+ * The host stack grows downwards and is larger: the paint left at its bottom tells how much the task used.
+ *
+ * @param handle task, NULL for the calling task
+ * @return UBaseType_t (bytes) 0 if the task used more than its stack
+ */
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t handle){
+  halTask *task = handle ? (halTask *)handle : halCurrentTask;
+  if(task == NULL) return 0;
+  size_t untouched = 0;
+  while(untouched < task->stack.size() && task->stack[untouched] == HAL_STACK_PAINT) untouched++;
+  size_t used = task->stack.size() - untouched;
+  return used < task->stackDepth ? (UBaseType_t)(task->stackDepth - used) : 0;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(){
+  return (TaskHandle_t)halCurrentTask;                      // NULL for the loop, which runs in the main thread
+}
+
+BaseType_t xPortGetCoreID(){
+  return halCurrentTask ? 0 : 1;                            // the loop runs on core 1
+}
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  GPIO AND INTERRUPTS
+ */
+int halPinLevel[HAL_PINS];
+void (*halPinInterrupt[HAL_PINS])() = {NULL};
+
+void pinMode(uint8_t pin, uint8_t mode){ (void)pin; (void)mode; }
+int digitalRead(uint8_t pin){ return pin < HAL_PINS ? halPinLevel[pin] : LOW; }
+void digitalWrite(uint8_t pin, uint8_t level){ if(pin < HAL_PINS) halPinLevel[pin] = level; }
+void attachInterrupt(uint8_t pin, void (*isr)(), int mode){ (void)mode; if(pin < HAL_PINS) halPinInterrupt[pin] = isr; }
+void detachInterrupt(uint8_t pin){ if(pin < HAL_PINS) halPinInterrupt[pin] = NULL; }
+
+/**
+ * @brief Changes the level of an input pin and calls its interrupt.
+ *
+ * @param pin
+ * @param level
+ * @param time (us) time of the edge, seen by micros() inside the interrupt
+ */
+void halSetPin(uint8_t pin, int level, uint64_t time){
+  if(pin >= HAL_PINS || halPinLevel[pin] == level) return;
+  halPinLevel[pin] = level;
+  if(halPinInterrupt[pin] == NULL) return;
+  halIsrTime = (int64_t)time;
+  halPinInterrupt[pin]();
+  halIsrTime = -1;
+}
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  LEDC
+ */
+uint32_t halLedcDuty[HAL_LEDC_CHANNELS];
+
+double ledcSetup(uint8_t channel, double frequency, uint8_t resolution){ (void)channel; (void)resolution; return frequency; }
+void ledcAttachPin(uint8_t pin, uint8_t channel){ (void)pin; (void)channel; }
+void ledcWrite(uint8_t channel, uint32_t duty){ if(channel < HAL_LEDC_CHANNELS) halLedcDuty[channel] = duty; }
+uint32_t ledcRead(uint8_t channel){ return channel < HAL_LEDC_CHANNELS ? halLedcDuty[channel] : 0; }
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  ANALOG AND RANDOM
+ */
+float (*halAnalogVoltage)(int pin) = NULL;                  // (V) set by the simulator
+
+uint16_t analogRead(uint8_t pin){
+  float voltage = halAnalogVoltage ? halAnalogVoltage(pin) : 0.0f;
+  return (uint16_t)constrain(voltage / 3.3f * 4095.0f, 0.0f, 4095.0f);
+}
+
+uint32_t halRandomState = 1;
+
+void randomSeed(unsigned long seed){ halRandomState = seed ? (uint32_t)seed : 1; }
+
+uint32_t halRandom(){
+  halRandomState ^= halRandomState << 13;                   // xorshift, the same numbers on every computer
+  halRandomState ^= halRandomState >> 17;
+  halRandomState ^= halRandomState << 5;
+  return halRandomState;
+}
+
+long random(long howBig){ return howBig > 0 ? (long)(halRandom() % (uint32_t)howBig) : 0; }
+long random(long howSmall, long howBig){ return howSmall >= howBig ? howSmall : howSmall + random(howBig - howSmall); }
+
+
+#include "WString.h"
+#include "HardwareSerial.h"
+
+#endif /* HAL_ARDUINO_H */
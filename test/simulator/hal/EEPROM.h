@@ -0,0 +1,30 @@
+/**
+ * @file EEPROM.h
+ * @author @sebastiano123-c
+ * @brief Simulated EEPROM, the simulator fills it as the SETUP sketch would do.
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef HAL_EEPROM_H
+#define HAL_EEPROM_H
+
+#include <Arduino.h>
+
+class EEPROMClass {
+  public:
+    uint8_t data[512];
+
+    EEPROMClass(){ memset(data, 0xFF, sizeof(data)); }
+
+    bool begin(size_t size){ (void)size; return true; }
+    uint8_t read(int address){ return address >= 0 && address < 512 ? data[address] : 0; }
+    void write(int address, uint8_t value){ if(address >= 0 && address < 512) data[address] = value; }
+    bool commit(){ return true; }
+};
+
+EEPROMClass EEPROM;
+
+#endif /* HAL_EEPROM_H */
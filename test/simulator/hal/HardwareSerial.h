@@ -0,0 +1,102 @@
+/**
+ * @file HardwareSerial.h
+ * @author @sebastiano123-c
+ * @brief Simulated UARTs.
+ *
+ * The simulator pushes the received bytes (e.g. the GPS sentences) with halReceive(), and what the sketch
+ * writes is printed on the console only if echo is true. The received bytes wait in a ring buffer, like in the
+ * UART driver of the ESP32: reading them never allocates, and the ones that do not fit are lost.
+ *
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef HAL_HARDWARE_SERIAL_H
+#define HAL_HARDWARE_SERIAL_H
+
+#define HAL_SERIAL_RX_BUFFER        4096                      // (bytes) received and not yet read
+
+class HardwareSerial {
+  public:
+    uint8_t received[HAL_SERIAL_RX_BUFFER];                 // bytes not yet read by the sketch, from receivedHead
+    size_t receivedHead, receivedCount;
+    std::vector<uint8_t> sent;                              // bytes written by the sketch, if record is true
+    bool echo;
+    bool record;
+
+    HardwareSerial(int uart) : receivedHead(0), receivedCount(0), echo(uart == 0), record(false){}
+
+    void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rxPin = -1, int8_t txPin = -1){
+      (void)baud; (void)config; (void)rxPin; (void)txPin;
+    }
+    void end(){}
+    operator bool() const { return true; }
+
+    void halReceive(const uint8_t *data, size_t size){
+      for(size_t i = 0; i < size && receivedCount < HAL_SERIAL_RX_BUFFER; i++)
+        received[(receivedHead + receivedCount++) % HAL_SERIAL_RX_BUFFER] = data[i];
+    }
+    void halReceive(const char *text){ halReceive((const uint8_t *)text, strlen(text)); }
+
+    int available(){ return (int)receivedCount; }
+    int availableForWrite(){ return 128; }                  // the FIFO of the ESP32, always empty
+    int peek(){ return receivedCount == 0 ? -1 : received[receivedHead]; }
+    int read(){
+      if(receivedCount == 0) return -1;
+      uint8_t data = received[receivedHead];
+      receivedHead = (receivedHead + 1) % HAL_SERIAL_RX_BUFFER;
+      receivedCount--;
+      return data;
+    }
+    size_t readBytes(uint8_t *buffer, size_t length){
+      size_t i = 0;
+      for(; i < length && receivedCount > 0; i++) buffer[i] = (uint8_t)read();
+      return i;
+    }
+    String readStringUntil(char terminator){
+      String line;
+      int data;
+      while((data = read()) >= 0 && data != terminator) line += (char)data;
+      return line;
+    }
+    void flush(){ if(echo) fflush(stdout); }
+
+    size_t write(uint8_t data){ return write(&data, 1); }
+    size_t write(const uint8_t *data, size_t size){
+      if(echo) fwrite(data, 1, size, stdout);
+      if(record) sent.insert(sent.end(), data, data + size);
+      return size;
+    }
+    size_t write(const char *text){ return write((const uint8_t *)text, strlen(text)); }
+
+    int printf(const char *format, ...){
+      char text[512];
+      va_list arguments;
+      va_start(arguments, format);
+      int length = vsnprintf(text, sizeof(text), format, arguments);
+      va_end(arguments);
+      write(text);
+      return length;
+    }
+
+    size_t print(const char *text){ return write(text); }
+    size_t print(const String &text){ return write(text.c_str()); }
+    size_t print(char character){ return write((uint8_t)character); }
+    size_t print(int value){ return printf("%d", value); }
+    size_t print(unsigned int value){ return printf("%u", value); }
+    size_t print(long value){ return printf("%ld", value); }
+    size_t print(unsigned long value){ return printf("%lu", value); }
+    size_t print(double value, int decimals = 2){ return printf("%.*f", decimals, value); }
+
+    size_t println(){ return write("\r\n"); }
+    template <typename T> size_t println(T value){ size_t n = print(value); return n + println(); }
+    size_t println(double value, int decimals){ size_t n = print(value, decimals); return n + println(); }
+};
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+
+#endif /* HAL_HARDWARE_SERIAL_H */
@@ -0,0 +1,65 @@
+/**
+ * @file Preferences.h
+ * @author @sebastiano123-c
+ * @brief Simulated NVS preferences, kept in memory.
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef HAL_PREFERENCES_H
+#define HAL_PREFERENCES_H
+
+#include <Arduino.h>
+#include <map>
+
+std::map<std::string, std::vector<uint8_t> > halNVS;        // "namespace/key" -> value
+
+class Preferences {
+  public:
+    std::string space;
+    bool readOnly;
+
+    bool begin(const char *name, bool readOnlyMode = false){ space = name; readOnly = readOnlyMode; return true; }
+    void end(){ space.clear(); }
+
+    bool clear(){
+      std::string prefix = space + "/";
+      for(std::map<std::string, std::vector<uint8_t> >::iterator it = halNVS.begin(); it != halNVS.end();)
+        if(it->first.compare(0, prefix.size(), prefix) == 0) halNVS.erase(it++);
+        else ++it;
+      return true;
+    }
+    bool remove(const char *key){ return halNVS.erase(space + "/" + key) > 0; }
+    bool isKey(const char *key){ return halNVS.count(space + "/" + key) > 0; }
+
+    size_t putBytes(const char *key, const void *value, size_t length){
+      if(readOnly) return 0;
+      halNVS[space + "/" + key].assign((const uint8_t *)value, (const uint8_t *)value + length);
+      return length;
+    }
+    size_t getBytesLength(const char *key){
+      std::map<std::string, std::vector<uint8_t> >::iterator it = halNVS.find(space + "/" + key);
+      return it == halNVS.end() ? 0 : it->second.size();
+    }
+    size_t getBytes(const char *key, void *buffer, size_t maxLength){
+      std::map<std::string, std::vector<uint8_t> >::iterator it = halNVS.find(space + "/" + key);
+      if(it == halNVS.end() || it->second.size() > maxLength) return 0;
+      memcpy(buffer, it->second.data(), it->second.size());
+      return it->second.size();
+    }
+
+    size_t putFloat(const char *key, float value){ return putBytes(key, &value, sizeof(value)); }
+    float getFloat(const char *key, float defaultValue = NAN){
+      float value;
+      return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+    }
+    size_t putUInt(const char *key, uint32_t value){ return putBytes(key, &value, sizeof(value)); }
+    uint32_t getUInt(const char *key, uint32_t defaultValue = 0){
+      uint32_t value;
+      return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+    }
+};
+
+#endif /* HAL_PREFERENCES_H */
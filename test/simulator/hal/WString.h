@@ -0,0 +1,49 @@
+/**
+ * @file WString.h
+ * @author @sebastiano123-c
+ * @brief Simulated Arduino String, the few methods used by the sketch.
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef HAL_WSTRING_H
+#define HAL_WSTRING_H
+
+class String {
+  public:
+    std::string buffer;
+
+    String(){}
+    String(const char *text) : buffer(text ? text : ""){}
+    String(const std::string &text) : buffer(text){}
+    String(char character) : buffer(1, character){}
+    String(int value){ char text[16]; snprintf(text, sizeof(text), "%d", value); buffer = text; }
+    String(unsigned int value){ char text[16]; snprintf(text, sizeof(text), "%u", value); buffer = text; }
+    String(long value){ char text[24]; snprintf(text, sizeof(text), "%ld", value); buffer = text; }
+    String(unsigned long value){ char text[24]; snprintf(text, sizeof(text), "%lu", value); buffer = text; }
+    String(double value, unsigned int decimals = 2){ char text[32]; snprintf(text, sizeof(text), "%.*f", decimals, value); buffer = text; }
+
+    const char *c_str() const { return buffer.c_str(); }
+    unsigned int length() const { return (unsigned int)buffer.size(); }
+    char charAt(unsigned int index) const { return index < buffer.size() ? buffer[index] : 0; }
+    char operator[](unsigned int index) const { return charAt(index); }
+    int indexOf(char character, unsigned int from = 0) const { size_t i = buffer.find(character, from); return i == std::string::npos ? -1 : (int)i; }
+    String substring(unsigned int from) const { return from < buffer.size() ? String(buffer.substr(from)) : String(); }
+    String substring(unsigned int from, unsigned int to) const { return from < buffer.size() && to > from ? String(buffer.substr(from, to - from)) : String(); }
+    long toInt() const { return atol(buffer.c_str()); }
+    float toFloat() const { return (float)atof(buffer.c_str()); }
+    void trim(){ size_t a = buffer.find_first_not_of(" \t\r\n"); size_t b = buffer.find_last_not_of(" \t\r\n"); buffer = a == std::string::npos ? "" : buffer.substr(a, b - a + 1); }
+
+    bool operator==(const String &other) const { return buffer == other.buffer; }
+    bool operator==(const char *other) const { return buffer == other; }
+    bool operator!=(const String &other) const { return buffer != other.buffer; }
+    String &operator+=(const String &other){ buffer += other.buffer; return *this; }
+    String &operator+=(const char *other){ buffer += other; return *this; }
+    String &operator+=(char other){ buffer += other; return *this; }
+    String operator+(const String &other) const { return String(buffer + other.buffer); }
+    String operator+(const char *other) const { return String(buffer + other); }
+};
+
+#endif /* HAL_WSTRING_H */
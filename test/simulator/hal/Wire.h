@@ -0,0 +1,91 @@
+/**
+ * @file Wire.h
+ * @author @sebastiano123-c
+ * @brief Simulated I2C bus.
+ *
+ * The simulated sensors derive from halI2CDevice and are attached to the bus with Wire.halAttach().
+ * The sketch talks to them as to the real ones: the first byte written is the register address, the following
+ * ones are written into the registers, and requestFrom() reads the registers starting from that address.
+ * As the ESP32 Wire, the bus has fixed buffers of HAL_I2C_BUFFER bytes: it never takes memory from the heap.
+ *
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef HAL_WIRE_H
+#define HAL_WIRE_H
+
+#include <Arduino.h>
+
+#define HAL_I2C_BUFFER              128                     // (bytes) I2C_BUFFER_LENGTH of the ESP32 Wire
+
+class halI2CDevice {
+  public:
+    virtual ~halI2CDevice(){}
+    virtual void writeRegister(uint8_t reg, uint8_t value) = 0;
+    virtual uint8_t readRegister(uint8_t reg) = 0;
+};
+
+class TwoWire {
+  public:
+    halI2CDevice *devices[128];
+    uint8_t address;
+    uint8_t reg;
+    uint8_t transmission[HAL_I2C_BUFFER];
+    uint8_t reception[HAL_I2C_BUFFER];
+    size_t transmitted, received, readPosition;
+
+    TwoWire() : transmitted(0), received(0), readPosition(0){ memset(devices, 0, sizeof(devices)); }
+
+    void halAttach(uint8_t deviceAddress, halI2CDevice *device){ devices[deviceAddress & 0x7F] = device; }
+
+    bool begin(int sda = -1, int scl = -1, uint32_t frequency = 0){ (void)sda; (void)scl; (void)frequency; return true; }
+    void setClock(uint32_t frequency){ (void)frequency; }
+
+    void beginTransmission(int deviceAddress){
+      address = (uint8_t)(deviceAddress & 0x7F);
+      transmitted = 0;
+    }
+
+    size_t write(uint8_t data){
+      if(transmitted == HAL_I2C_BUFFER) return 0;
+      transmission[transmitted++] = data;
+      return 1;
+    }
+    size_t write(const uint8_t *data, size_t size){
+      size_t i = 0;
+      while(i < size && write(data[i])) i++;
+      return i;
+    }
+
+    uint8_t endTransmission(bool sendStop = true){
+      (void)sendStop;
+      halI2CDevice *device = devices[address];
+      if(device == NULL) return 2;                          // address not acknowledged
+      if(transmitted == 0) return 0;
+      reg = transmission[0];
+      for(size_t i = 1; i < transmitted; i++) device->writeRegister((uint8_t)(reg + i - 1), transmission[i]);
+      return 0;
+    }
+
+    uint8_t requestFrom(int deviceAddress, int quantity){
+      received = readPosition = 0;
+      halI2CDevice *device = devices[deviceAddress & 0x7F];
+      if(device == NULL) return 0;
+      if(quantity > HAL_I2C_BUFFER) quantity = HAL_I2C_BUFFER;
+      for(int i = 0; i < quantity; i++) reception[received++] = device->readRegister((uint8_t)(reg + i));
+      return (uint8_t)quantity;
+    }
+
+    int available(){ return (int)(received - readPosition); }
+    int read(){
+      if(readPosition == received) return -1;
+      return reception[readPosition++];
+    }
+};
+
+TwoWire Wire;
+
+#endif /* HAL_WIRE_H */
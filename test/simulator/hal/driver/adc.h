@@ -0,0 +1,41 @@
+/**
+ * @file adc.h
+ * @author @sebastiano123-c
+ * @brief Simulated ESP-IDF ADC driver: the readings come from halAnalogVoltage() (see Arduino.h).
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef HAL_DRIVER_ADC_H
+#define HAL_DRIVER_ADC_H
+
+#include <Arduino.h>
+
+typedef int esp_err_t;
+#define ESP_OK                      0
+
+typedef enum { ADC_UNIT_1 = 1, ADC_UNIT_2 = 2 } adc_unit_t;
+typedef enum { ADC_WIDTH_BIT_9, ADC_WIDTH_BIT_10, ADC_WIDTH_BIT_11, ADC_WIDTH_BIT_12 } adc_bits_width_t;
+typedef enum { ADC_ATTEN_DB_0, ADC_ATTEN_DB_2_5, ADC_ATTEN_DB_6, ADC_ATTEN_DB_11 } adc_atten_t;
+typedef enum { ADC1_CHANNEL_0, ADC1_CHANNEL_1, ADC1_CHANNEL_2, ADC1_CHANNEL_3,
+               ADC1_CHANNEL_4, ADC1_CHANNEL_5, ADC1_CHANNEL_6, ADC1_CHANNEL_7 } adc1_channel_t;
+typedef enum { ADC2_CHANNEL_0, ADC2_CHANNEL_1, ADC2_CHANNEL_2, ADC2_CHANNEL_3, ADC2_CHANNEL_4,
+               ADC2_CHANNEL_5, ADC2_CHANNEL_6, ADC2_CHANNEL_7, ADC2_CHANNEL_8, ADC2_CHANNEL_9 } adc2_channel_t;
+
+const uint8_t halAdc1Pin[8] = {36, 37, 38, 39, 32, 33, 34, 35};
+const uint8_t halAdc2Pin[10] = {4, 0, 2, 15, 13, 12, 14, 27, 25, 26};
+
+esp_err_t adc1_config_width(adc_bits_width_t width){ (void)width; return ESP_OK; }
+esp_err_t adc1_config_channel_atten(adc1_channel_t channel, adc_atten_t atten){ (void)channel; (void)atten; return ESP_OK; }
+esp_err_t adc2_config_channel_atten(adc2_channel_t channel, adc_atten_t atten){ (void)channel; (void)atten; return ESP_OK; }
+
+int adc1_get_raw(adc1_channel_t channel){ return analogRead(halAdc1Pin[channel]); }
+esp_err_t adc2_get_raw(adc2_channel_t channel, adc_bits_width_t width, int *raw){
+  (void)width;
+  *raw = analogRead(halAdc2Pin[channel]);
+  return ESP_OK;
+}
+
+#endif /* HAL_DRIVER_ADC_H */
@@ -0,0 +1,33 @@
+/**
+ * @file esp_adc_cal.h
+ * @author @sebastiano123-c
+ * @brief Simulated ADC calibration: the simulated ADC is ideal, 0-3.3V in 0-4095.
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef HAL_ESP_ADC_CAL_H
+#define HAL_ESP_ADC_CAL_H
+
+#include "driver/adc.h"
+
+typedef enum { ESP_ADC_CAL_VAL_EFUSE_VREF, ESP_ADC_CAL_VAL_EFUSE_TP, ESP_ADC_CAL_VAL_DEFAULT_VREF } esp_adc_cal_value_t;
+typedef struct { adc_unit_t adc_num; adc_atten_t atten; adc_bits_width_t bit_width; uint32_t vref; } esp_adc_cal_characteristics_t;
+
+esp_adc_cal_value_t esp_adc_cal_characterize(adc_unit_t unit, adc_atten_t atten, adc_bits_width_t width,
+                                             uint32_t vref, esp_adc_cal_characteristics_t *characteristics){
+  characteristics->adc_num = unit;
+  characteristics->atten = atten;
+  characteristics->bit_width = width;
+  characteristics->vref = vref;
+  return ESP_ADC_CAL_VAL_DEFAULT_VREF;
+}
+
+uint32_t esp_adc_cal_raw_to_voltage(uint32_t raw, const esp_adc_cal_characteristics_t *characteristics){
+  (void)characteristics;
+  return raw * 3300 / 4095;                                 // (mV)
+}
+
+#endif /* HAL_ESP_ADC_CAL_H */
@@ -0,0 +1,40 @@
+/**
+ * @file esp_heap_caps.h
+ * @author @sebastiano123-c
+ * @brief Simulated heap information: the computer has no heap limit, so the heap is always as free as at the start.
+ *
+ * On the board the linker wraps malloc(), calloc() and realloc() for Diagnostics.h. Here the program replaces them
+ * instead (the C library calls them through the ones of the program too), and the real ones are those of glibc.
+ * @version 0.1
+ * @date 2022-06-20
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#ifndef HAL_ESP_HEAP_CAPS_H
+#define HAL_ESP_HEAP_CAPS_H
+
+#include <stddef.h>
+
+#define MALLOC_CAP_8BIT             (1 << 2)
+#define HAL_HEAP_SIZE               (280 * 1024)            // (bytes) about the free heap of an ESP32 sketch
+
+size_t heap_caps_get_free_size(uint32_t caps){ (void)caps; return HAL_HEAP_SIZE; }
+size_t heap_caps_get_minimum_free_size(uint32_t caps){ (void)caps; return HAL_HEAP_SIZE; }
+size_t heap_caps_get_largest_free_block(uint32_t caps){ (void)caps; return HAL_HEAP_SIZE; }
+
+extern "C" {
+  void *__libc_malloc(size_t size);
+  void *__libc_calloc(size_t count, size_t size);
+  void *__libc_realloc(void *p, size_t size);
+
+  void *__real_malloc(size_t size){ return __libc_malloc(size); }
+  void *__real_calloc(size_t count, size_t size){ return __libc_calloc(count, size); }
+  void *__real_realloc(void *p, size_t size){ return __libc_realloc(p, size); }
+
+  void *malloc(size_t size) noexcept { return __wrap_malloc(size); }
+  void *calloc(size_t count, size_t size) noexcept { return __wrap_calloc(count, size); }
+  void *realloc(void *p, size_t size) noexcept { return __wrap_realloc(p, size); }
+}
+
+#endif /* HAL_ESP_HEAP_CAPS_H */
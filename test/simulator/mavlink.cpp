@@ -0,0 +1,388 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *            MAVLink             *
+ *                       **********************************
+ *
+ *          Test the MAVLink v2 telemetry on your computer.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ *      1) the messages of MAVLink.h are written and read back, and compared byte by byte with the frames of
+ *         referenceFrames: these were made from the definitions of common.xml (fields, sizes, CRC_EXTRA) by another
+ *         implementation of the protocol, not by MAVLink.h;
+ *      2) the frames are read again from a stream with garbage, a broken frame, a signed frame and a message
+ *         DroneIno does not know;
+ *      3) the FLIGHT_CONTROLLER sketch flies the hover of the simulator (see Simulation.h) with the MAVLINK
+ *         telemetry, and a ground station on the other side of its UART asks the parameters and sets some of them.
+ * At the end the program prints the rate of every message and the bytes per second on the UART, and returns 1 if
+ * a check fails.
+ * With -DSIMULATOR_AUTOTUNE the gains of roll, pitch and yaw belong to the autotune task: the PARAM_SET of rollP must
+ * be refused, with the tuned value back, while the one of thrustCurveExpo is still applied.
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src simulator/mavlink.cpp -o mavlink
+ *      ./mavlink [seconds]
+ *
+ *
+ * @file mavlink.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-25
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define SIMULATOR_MAVLINK
+#include "Simulation.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ */
+#define FLIGHT_TIME                 10.0                      // (s) after the setup
+#define GCS_SYSTEM_ID               255
+#define GCS_COMPONENT_ID            190                       // MAV_COMP_ID_MISSIONPLANNER
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  DO NOT CHANGE THIS VALUES
+ */
+struct referenceFrame {
+  size_t size;
+  uint8_t bytes[64];
+};
+
+const referenceFrame referenceFrames[] = {
+  // HEARTBEAT quadrotor, generic, custom mode | stabilize | armed, custom mode 1, active, version 3 (sequence 7)
+  {21, {0xfd, 0x09, 0x00, 0x00, 0x07, 0x01, 0x01, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x02, 0x00, 0x91, 0x04,
+        0x03, 0x96, 0xa6}},
+  // SYS_STATUS sensors 0x1002b, load 412, 11870mV, current -1, errors comm 3, remaining -1 (sequence 8)
+  {43, {0xfd, 0x1f, 0x00, 0x00, 0x08, 0x01, 0x01, 0x01, 0x00, 0x00, 0x2b, 0x00, 0x01, 0x00, 0x2b, 0x00, 0x01, 0x00,
+        0x2b, 0x00, 0x01, 0x00, 0x9c, 0x01, 0x5e, 0x2e, 0xff, 0xff, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x00, 0x00, 0x00, 0xff, 0xba, 0x42}},
+  // ATTITUDE 123456ms, 0.1 -0.25 1.5rad, 0.01 -0.02 0.5rad/s (sequence 9)
+  {40, {0xfd, 0x1c, 0x00, 0x00, 0x09, 0x01, 0x01, 0x1e, 0x00, 0x00, 0x40, 0xe2, 0x01, 0x00, 0xcd, 0xcc, 0xcc, 0x3d,
+        0x00, 0x00, 0x80, 0xbe, 0x00, 0x00, 0xc0, 0x3f, 0x0a, 0xd7, 0x23, 0x3c, 0x0a, 0xd7, 0xa3, 0xbc, 0x00, 0x00,
+        0x00, 0x3f, 0x82, 0x8e}},
+  // GLOBAL_POSITION_INT 123456ms, 45.5 9.2deg, 120500 2500mm, -12 34 0cm/s, heading unknown (sequence 10)
+  {40, {0xfd, 0x1c, 0x00, 0x00, 0x0a, 0x01, 0x01, 0x21, 0x00, 0x00, 0x40, 0xe2, 0x01, 0x00, 0xc0, 0xbf, 0x1e, 0x1b,
+        0x00, 0xcf, 0x7b, 0x05, 0xb4, 0xd6, 0x01, 0x00, 0xc4, 0x09, 0x00, 0x00, 0xf4, 0xff, 0x22, 0x00, 0x00, 0x00,
+        0xff, 0xff, 0x5f, 0xe6}},
+  // RC_CHANNELS 5000ms, 1500 1500 1000 1500 2000us, 13 unused, rssi unknown (sequence 11)
+  {54, {0xfd, 0x2a, 0x00, 0x00, 0x0b, 0x01, 0x01, 0x41, 0x00, 0x00, 0x88, 0x13, 0x00, 0x00, 0xdc, 0x05, 0xdc, 0x05,
+        0xe8, 0x03, 0xdc, 0x05, 0xd0, 0x07, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0x05, 0xff, 0xcd, 0xa9}},
+  // PARAM_VALUE rollP 1.3, REAL32, 19 parameters, index 0 (sequence 12)
+  {37, {0xfd, 0x19, 0x00, 0x00, 0x0c, 0x01, 0x01, 0x16, 0x00, 0x00, 0x66, 0x66, 0xa6, 0x3f, 0x13, 0x00, 0x00, 0x00,
+        0x72, 0x6f, 0x6c, 0x6c, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09, 0x10,
+        0x9d}},
+  // PARAM_VALUE thrustCurveExpo 0, REAL32, 19 parameters, index 16 (sequence 13)
+  {37, {0xfd, 0x19, 0x00, 0x00, 0x0d, 0x01, 0x01, 0x16, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x13, 0x00, 0x10, 0x00,
+        0x74, 0x68, 0x72, 0x75, 0x73, 0x74, 0x43, 0x75, 0x72, 0x76, 0x65, 0x45, 0x78, 0x70, 0x6f, 0x00, 0x09, 0x01,
+        0xc1}},
+  // PARAM_REQUEST_LIST to 1/1, from 255/190 (sequence 0)
+  {14, {0xfd, 0x02, 0x00, 0x00, 0x00, 0xff, 0xbe, 0x15, 0x00, 0x00, 0x01, 0x01, 0x88, 0xc0}},
+  // PARAM_REQUEST_READ to 1/1, yawP, index -1 (sequence 1)
+  {20, {0xfd, 0x08, 0x00, 0x00, 0x01, 0xff, 0xbe, 0x14, 0x00, 0x00, 0xff, 0xff, 0x01, 0x01, 0x79, 0x61, 0x77, 0x50,
+        0xbf, 0x3a}},
+  // PARAM_SET to 1/1, rollP 1.25, REAL32 (sequence 2)
+  {35, {0xfd, 0x17, 0x00, 0x00, 0x02, 0xff, 0xbe, 0x17, 0x00, 0x00, 0x00, 0x00, 0xa0, 0x3f, 0x01, 0x01, 0x72, 0x6f,
+        0x6c, 0x6c, 0x50, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x09, 0x88, 0x0f}},
+  // PARAM_SET to 1/0, correctionPitch -2.5, REAL32 (sequence 3)
+  {35, {0xfd, 0x17, 0x00, 0x00, 0x03, 0xff, 0xbe, 0x17, 0x00, 0x00, 0x00, 0x00, 0x20, 0xc0, 0x01, 0x00, 0x63, 0x6f,
+        0x72, 0x72, 0x65, 0x63, 0x74, 0x69, 0x6f, 0x6e, 0x50, 0x69, 0x74, 0x63, 0x68, 0x00, 0x09, 0x2f, 0xaf}}
+};
+#define REFERENCE_FRAMES            (sizeof(referenceFrames) / sizeof(referenceFrames[0]))
+
+/**
+ * @brief The messages of referenceFrames, with the same values.
+ *
+ * @param i index in referenceFrames
+ * @param id of the message
+ * @param payload the struct of the message, at least 64 bytes
+ */
+void referenceMessage(size_t i, uint32_t &id, uint8_t *payload){
+  memset(payload, 0, 64);
+  switch(i){
+    case 0: {
+      mavlinkHeartbeat &m = *(mavlinkHeartbeat *)payload;
+      id = MAVLINK_MSG_HEARTBEAT;
+      m.customMode = 1; m.type = MAV_TYPE_QUADROTOR; m.autopilot = MAV_AUTOPILOT_GENERIC;
+      m.baseMode = MAV_MODE_FLAG_CUSTOM_MODE_ENABLED | MAV_MODE_FLAG_STABILIZE_ENABLED | MAV_MODE_FLAG_SAFETY_ARMED;
+      m.systemStatus = MAV_STATE_ACTIVE; m.mavlinkVersion = 3;
+      break;
+    }
+    case 1: {
+      mavlinkSysStatus &m = *(mavlinkSysStatus *)payload;
+      id = MAVLINK_MSG_SYS_STATUS;
+      m.sensorsPresent = m.sensorsEnabled = m.sensorsHealth = 0x1002b;
+      m.load = 412; m.voltageBattery = 11870; m.currentBattery = -1; m.errorsComm = 3; m.batteryRemaining = -1;
+      break;
+    }
+    case 2: {
+      mavlinkAttitude &m = *(mavlinkAttitude *)payload;
+      id = MAVLINK_MSG_ATTITUDE;
+      m.timeBootMs = 123456; m.roll = 0.1f; m.pitch = -0.25f; m.yaw = 1.5f;
+      m.rollSpeed = 0.01f; m.pitchSpeed = -0.02f; m.yawSpeed = 0.5f;
+      break;
+    }
+    case 3: {
+      mavlinkGlobalPositionInt &m = *(mavlinkGlobalPositionInt *)payload;
+      id = MAVLINK_MSG_GLOBAL_POSITION_INT;
+      m.timeBootMs = 123456; m.lat = 455000000; m.lon = 92000000; m.alt = 120500; m.relativeAlt = 2500;
+      m.vx = -12; m.vy = 34; m.vz = 0; m.hdg = UINT16_MAX;
+      break;
+    }
+    case 4: {
+      mavlinkRCChannels &m = *(mavlinkRCChannels *)payload;
+      id = MAVLINK_MSG_RC_CHANNELS;
+      const uint16_t chan[5] = {1500, 1500, 1000, 1500, 2000};
+      for(int c = 0; c < 18; c++) m.chan[c] = c < 5 ? chan[c] : UINT16_MAX;
+      m.timeBootMs = 5000; m.chanCount = 5; m.rssi = 255;
+      break;
+    }
+    case 5: case 6: {
+      mavlinkParamValue &m = *(mavlinkParamValue *)payload;
+      id = MAVLINK_MSG_PARAM_VALUE;
+      mavlinkSetParamId(m.paramId, i == 5 ? "rollP" : "thrustCurveExpo");
+      m.paramValue = i == 5 ? 1.3f : 0.0f; m.paramType = MAV_PARAM_TYPE_REAL32;
+      m.paramCount = 19; m.paramIndex = i == 5 ? 0 : 16;
+      break;
+    }
+    case 7: {
+      mavlinkParamRequestList &m = *(mavlinkParamRequestList *)payload;
+      id = MAVLINK_MSG_PARAM_REQUEST_LIST;
+      m.targetSystem = 1; m.targetComponent = 1;
+      break;
+    }
+    case 8: {
+      mavlinkParamRequestRead &m = *(mavlinkParamRequestRead *)payload;
+      id = MAVLINK_MSG_PARAM_REQUEST_READ;
+      m.targetSystem = 1; m.targetComponent = 1; m.paramIndex = -1;
+      mavlinkSetParamId(m.paramId, "yawP");
+      break;
+    }
+    default: {
+      mavlinkParamSet &m = *(mavlinkParamSet *)payload;
+      id = MAVLINK_MSG_PARAM_SET;
+      m.targetSystem = 1; m.targetComponent = i == 9 ? 1 : 0; m.paramType = MAV_PARAM_TYPE_REAL32;
+      m.paramValue = i == 9 ? 1.25f : -2.5f;
+      mavlinkSetParamId(m.paramId, i == 9 ? "rollP" : "correctionPitch");
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Writes the reference messages and reads them back.
+ */
+void checkReferenceFrames(){
+
+  const uint8_t check123456789[] = {'1', '2', '3', '4', '5', '6', '7', '8', '9'};
+  check(mavlinkCRC(0xFFFF, check123456789, 9) == 0x6F91, "CRC-16/MCRF4XX of \"123456789\"");
+
+  int written = 0, read = 0;
+  for(size_t i = 0; i < REFERENCE_FRAMES; i++){
+    const referenceFrame &reference = referenceFrames[i];
+    uint8_t payload[64], decoded[64], frame[MAVLINK_MAX_FRAME];
+    uint32_t id, errors = 0;
+    referenceMessage(i, id, payload);
+
+    size_t size = mavlinkEncode(frame, reference.bytes[4], reference.bytes[5], reference.bytes[6], id, payload);
+    if(size == reference.size && memcmp(frame, reference.bytes, size) == 0) written++;
+    else printf("     frame %i: written differently\n", (int)i);
+
+    mavlinkFrame found;
+    size_t used = mavlinkScan(reference.bytes, reference.size, found, errors);
+    if(found.payload == NULL || used != reference.size || found.id != id || errors != 0) continue;
+    mavlinkDecode(found, decoded, sizeof(decoded));
+    if(memcmp(decoded, payload, mavlinkFindMessage(id)->length) == 0 && found.sequence == reference.bytes[4]) read++;
+    else printf("     frame %i: read differently\n", (int)i);
+  }
+  check(written == (int)REFERENCE_FRAMES, "reference frames written");
+  check(read == (int)REFERENCE_FRAMES, "reference frames read back");
+
+  // the frames one after the other, with the things a real UART brings
+  std::vector<uint8_t> stream;
+  const uint8_t garbage[] = {0x00, 0xfd, 0x55, 0xfe, 0x09};
+  stream.insert(stream.end(), garbage, garbage + sizeof(garbage));
+  for(size_t i = 0; i < REFERENCE_FRAMES; i++){
+    const referenceFrame &reference = referenceFrames[i];
+    stream.insert(stream.end(), reference.bytes, reference.bytes + reference.size);
+    if(i == 2){                                               // a broken copy of the heartbeat
+      stream.insert(stream.end(), referenceFrames[0].bytes, referenceFrames[0].bytes + referenceFrames[0].size);
+      stream[stream.size() - 5] ^= 0x10;
+    }
+    if(i == 4){                                               // an unknown message (SYSTEM_TIME) and a signed heartbeat
+      uint8_t unknown[MAVLINK_HEADER_SIZE + 11 + 2] = {0xfd, 11, 0, 0, 0, 1, 1, 2, 0, 0};
+      stream.insert(stream.end(), unknown, unknown + sizeof(unknown));
+      size_t start = stream.size();
+      stream.insert(stream.end(), referenceFrames[0].bytes, referenceFrames[0].bytes + referenceFrames[0].size);
+      stream[start + 2] = MAVLINK_IFLAG_SIGNED;
+      uint16_t crc = mavlinkCRC(0xFFFF, &stream[start + 1], MAVLINK_HEADER_SIZE - 1 + 9);
+      const uint8_t extra = 50;
+      crc = mavlinkCRC(crc, &extra, 1);
+      stream[start + MAVLINK_HEADER_SIZE + 9] = crc & 0xFF;
+      stream[start + MAVLINK_HEADER_SIZE + 10] = crc >> 8;
+      uint8_t signature[MAVLINK_SIGNATURE_SIZE] = {0};
+      stream.insert(stream.end(), signature, signature + sizeof(signature));
+    }
+  }
+
+  uint32_t errors = 0;
+  int found = 0;
+  size_t used = 0;
+  mavlinkFrame frame;
+  for(;;){
+    used += mavlinkScan(stream.data() + used, stream.size() - used, frame, errors);
+    if(frame.payload == NULL) break;
+    found++;
+  }
+  check(found == (int)REFERENCE_FRAMES + 1 && errors == 1 && used == stream.size(),
+        "stream read: broken dropped, signed kept, unknown skipped");
+}
+
+/**
+ * @brief The ground station: it reads the UART of the sketch and writes in it.
+ */
+struct groundStation {
+  std::vector<uint8_t> received;
+  uint32_t errors;
+  uint8_t sequence;
+  long messages[256], bytes;
+  float parameters[LINK_MAX_PARAMETERS];
+  bool known[LINK_MAX_PARAMETERS];
+  uint16_t parameterCount;
+  uint8_t baseMode;
+
+  void read(){
+    received.insert(received.end(), SUART.sent.begin(), SUART.sent.end());
+    bytes += SUART.sent.size();
+    SUART.sent.clear();
+
+    size_t used = 0;
+    mavlinkFrame frame;
+    for(;;){
+      used += mavlinkScan(received.data() + used, received.size() - used, frame, errors);
+      if(frame.payload == NULL) break;
+      if(frame.id < 256) messages[frame.id]++;
+      if(frame.id == MAVLINK_MSG_HEARTBEAT){
+        mavlinkHeartbeat m;
+        mavlinkDecode(frame, &m, sizeof(m));
+        baseMode = m.baseMode;
+      }
+      if(frame.id == MAVLINK_MSG_PARAM_VALUE){
+        mavlinkParamValue m;
+        mavlinkDecode(frame, &m, sizeof(m));
+        if(m.paramIndex < LINK_MAX_PARAMETERS){
+          parameters[m.paramIndex] = m.paramValue;
+          known[m.paramIndex] = true;
+          parameterCount = m.paramCount;
+        }
+      }
+    }
+    received.erase(received.begin(), received.begin() + used);
+  }
+
+  void write(uint32_t id, const void *payload){
+    uint8_t frame[MAVLINK_MAX_FRAME];
+    size_t size = mavlinkEncode(frame, sequence++, GCS_SYSTEM_ID, GCS_COMPONENT_ID, id, payload);
+    SUART.halReceive(frame, size);
+  }
+
+  void set(const char *name, float value){
+    mavlinkParamSet m;
+    memset(&m, 0, sizeof(m));
+    m.targetSystem = MAVLINK_SYSTEM_ID;
+    m.targetComponent = MAVLINK_COMPONENT_ID;
+    mavlinkSetParamId(m.paramId, name);
+    m.paramValue = value;
+    m.paramType = MAV_PARAM_TYPE_REAL32;
+    write(MAVLINK_MSG_PARAM_SET, &m);
+  }
+} ground;
+
+int main(int argc, char *argv[]){
+
+  double duration = argc > 1 ? atof(argv[1]) : FLIGHT_TIME;
+
+  printf("    ----------------------------------------------------\n");
+  checkReferenceFrames();
+
+  SUART.record = true;
+  startSimulation(defaultSettings);
+  ground.read();
+  memset(ground.messages, 0, sizeof(ground.messages));
+  ground.bytes = 0;
+
+  bool listSent = false, setSent = false, refusedSent = false, armedSeen = false;
+  float yawBefore = 0.0f;
+  long loops = 0;
+  while(halClock - world.flightStart < (uint64_t)(duration * 1e6)){
+    loop();
+    halRunTasks();
+    loops++;
+    ground.read();
+    armedSeen |= (ground.baseMode & MAV_MODE_FLAG_SAFETY_ARMED) != 0;
+
+    double t = (double)(halClock - world.flightStart) / 1e6;
+    if(!listSent && t > 1.0){
+      mavlinkParamRequestList m = {MAVLINK_SYSTEM_ID, MAVLINK_COMPONENT_ID};
+      ground.write(MAVLINK_MSG_PARAM_REQUEST_LIST, &m);
+      listSent = true;
+    }
+    if(!setSent && t > 3.0){
+      ground.set("rollP", 1.25f);
+      ground.set("thrustCurveExpo", 0.35f);
+      setSent = true;
+    }
+    if(!refusedSent && t > 5.0){
+      yawBefore = PGainYaw;
+      ground.set("yawP", 99.0f);                              // out of its limits
+      refusedSent = true;
+    }
+  }
+
+  double seconds = (double)(halClock - world.flightStart) / 1e6;
+  const uint32_t streams[] = {MAVLINK_MSG_HEARTBEAT, MAVLINK_MSG_SYS_STATUS, MAVLINK_MSG_ATTITUDE,
+                              MAVLINK_MSG_GLOBAL_POSITION_INT, MAVLINK_MSG_RC_CHANNELS};
+  const int rates[] = {MAVLINK_RATE_HEARTBEAT, MAVLINK_RATE_SYS_STATUS, MAVLINK_RATE_ATTITUDE,
+                       MAVLINK_RATE_GLOBAL_POSITION_INT, MAVLINK_RATE_RC_CHANNELS};
+  const char *names[] = {"HEARTBEAT", "SYS_STATUS", "ATTITUDE", "GLOBAL_POSITION_INT", "RC_CHANNELS"};
+
+  printf("    ----------------------------------------------------\n");
+  printf("     %ld loops in %.1fs, %.0f bytes/s on the UART (%.0f%% of %d baud)\n", loops, seconds,
+         ground.bytes / seconds, ground.bytes / seconds * 10.0 / WIFI_BAUD_RATE * 100.0, WIFI_BAUD_RATE);
+  bool ratesGood = true;
+  for(int i = 0; i < 5; i++){
+    double rate = ground.messages[streams[i]] / seconds;
+    printf("     %-20s %5.1f Hz (%i)\n", names[i], rate, rates[i]);
+    ratesGood &= rate > rates[i] * 0.9 && rate < rates[i] * 1.1 + 0.2;
+  }
+  printf("     PARAM_VALUE          %5ld, %u skipped, %u broken frames\n", ground.messages[MAVLINK_MSG_PARAM_VALUE],
+         mavlinkSkipped, ground.errors);
+  printf("    ----------------------------------------------------\n");
+
+  int known = 0;
+  for(int i = 0; i < PARAMETERS; i++) known += ground.known[i];
+  check(ratesGood, "rates of the messages");
+  check(ground.errors == 0 && mavlinkSkipped == 0, "no broken frames, no skipped messages");
+  check(armedSeen, "heartbeat armed");
+  check(known == PARAMETERS && ground.parameterCount == PARAMETERS, "all the parameters listed");
+#ifdef SIMULATOR_AUTOTUNE
+  check(PGainRoll != 1.25f && thrustCurveExpo == 0.35f, "PARAM_SET of a tuned gain refused");
+  check(ground.parameters[PARAM_ROLL_P] != 1.25f && ground.parameters[PARAM_THRUST_CURVE_EXPO] == 0.35f,
+        "PARAM_VALUE with the tuned gain back");
+  check(PGainYaw != 99.0f && ground.parameters[PARAM_YAW_P] != 99.0f, "PARAM_SET out of range refused");
+#else
+  check(PGainRoll == 1.25f && thrustCurveExpo == 0.35f, "PARAM_SET applied");
+  check(ground.parameters[PARAM_ROLL_P] == 1.25f && ground.parameters[PARAM_THRUST_CURVE_EXPO] == 0.35f,
+        "PARAM_VALUE with the new values");
+  check(PGainYaw == yawBefore && ground.parameters[PARAM_YAW_P] == yawBefore, "PARAM_SET out of range refused, old value back");
+#endif
+  printf("    ----------------------------------------------------\n");
+
+  return failures > 0 ? 1 : 0;
+}
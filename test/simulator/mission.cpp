@@ -0,0 +1,264 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *            Mission             *
+ *                       **********************************
+ *
+ *          Test the waypoint missions on your computer.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ *      1) the reference of MissionPath.h flies a square, with a drone that follows it exactly: the legs must come in
+ *         order, without going beyond the cruise speed and MISSION_ACCELERATION; then with a drone that does not
+ *         move, the reference must wait for it;
+ *      2) the missions are saved on the simulated flash and read back; the wrong ones and a broken blob are refused;
+ *      3) the FLIGHT_CONTROLLER sketch flies the same square in the simulator (see Simulation.h), with some wind:
+ *         the pilot takes off, puts the SWC down at 3 m and the drone must fly all the legs and stop on the last
+ *         waypoint.
+ * The program prints how far from the legs the drone has flown, and returns 1 if a check fails.
+ * Write a file name as second argument to save one line per GPS sample in a csv file, to plot the flight.
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src simulator/mission.cpp -o mission
+ *      ./mission [seed] [track.csv]
+ *
+ *
+ * @file mission.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-24
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "Simulation.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ */
+#define SQUARE_SIDE                 25.0                      // (m) of the mission
+#define FLIGHT_TIME                 90.0                      // (s) after the setup, at most
+#define WIND_NORTH                  0.0                       // (m/s)
+#define WIND_EAST                   1.0                       // (m/s)
+/**
+ *      (LIMITS)
+ */
+#define MAX_CROSS_TRACK             5.0                       // (m) from the legs
+#define MAX_FINAL_ERROR             MISSION_ACCEPTANCE_RADIUS // (m) from the last waypoint, holding it
+#define MAX_TILT                    30.0                      // (deg) roll and pitch
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  DO NOT CHANGE THIS VALUES
+ */
+const double square[][2] = {{SQUARE_SIDE, 0.0}, {SQUARE_SIDE, SQUARE_SIDE}, {0.0, SQUARE_SIDE}, {0.0, 0.0}};
+#define SQUARE_WAYPOINTS            4
+
+/**
+ * @brief The waypoints of the square, north and east of the home of the simulated GPS.
+ */
+void squareMission(missionWaypoint *waypoints){
+  SimulatedGPS gps;
+  for(int i = 0; i < SQUARE_WAYPOINTS; i++){
+    waypoints[i].latitude = (int32_t)lround((gps.homeLatitude + square[i][0] / 6371000.0 * 180.0 / M_PI) * 1e6);
+    waypoints[i].longitude = (int32_t)lround((gps.homeLongitude + square[i][1] /
+                                              (6371000.0 * cos(gps.homeLatitude * M_PI / 180.0)) * 180.0 / M_PI) * 1e6);
+    waypoints[i].radius = 0.0f;
+    waypoints[i].speed = 0.0f;
+  }
+}
+
+/**
+ * @brief (m) distance of a point from a segment.
+ */
+double segmentDistance(const double p[2], const double a[2], const double b[2]){
+  double ab[2] = {b[0] - a[0], b[1] - a[1]}, ap[2] = {p[0] - a[0], p[1] - a[1]};
+  double length = ab[0] * ab[0] + ab[1] * ab[1];
+  double t = length > 0.0 ? (ap[0] * ab[0] + ap[1] * ab[1]) / length : 0.0;
+  t = t < 0.0 ? 0.0 : (t > 1.0 ? 1.0 : t);
+  return sqrt(sq(p[0] - a[0] - t * ab[0]) + sq(p[1] - a[1] - t * ab[1]));
+}
+
+/**
+ * @brief 1) the reference alone.
+ */
+void checkPath(const missionWaypoint *waypoints){
+
+  const float dt = 0.2f;
+  SimulatedGPS gps;
+  int32_t home[2] = {(int32_t)lround(gps.homeLatitude * 1e6), (int32_t)lround(gps.homeLongitude * 1e6)};
+
+  // a drone on the reference
+  missionPath path;
+  startMissionPath(path, waypoints, SQUARE_WAYPOINTS, home[0], home[1], MISSION_CRUISE_SPEED, MISSION_ACCEPTANCE_RADIUS,
+                   MISSION_ACCELERATION, MISSION_LEASH);
+
+  bool inOrder = true;
+  float maxSpeed = 0.0f, maxAcceleration = 0.0f, time = 0.0f;
+  float last[2] = {0.0f, 0.0f};
+  int leg = 0;
+  while(path.state == MISSION_FLYING && time < 200.0f){
+    float drone[2] = {path.reference[0], path.reference[1]};
+    stepMissionPath(path, drone, dt);
+    time += dt;
+
+    if(path.leg != leg && path.leg != leg + 1) inOrder = false;
+    leg = path.leg;
+    float speed = sqrtf(sq(path.velocity[0]) + sq(path.velocity[1]));
+    float acceleration = sqrtf(sq(path.velocity[0] - last[0]) + sq(path.velocity[1] - last[1])) / dt;
+    if(speed > maxSpeed) maxSpeed = speed;
+    if(acceleration > maxAcceleration) maxAcceleration = acceleration;
+    last[0] = path.velocity[0];
+    last[1] = path.velocity[1];
+  }
+  float expected = 4.0f * SQUARE_SIDE / MISSION_CRUISE_SPEED;
+
+  printf("     reference: square flown in %.1fs (%.1fs at cruise speed), max %.2fm/s, %.2fm/s^2\n", time, expected,
+         maxSpeed, maxAcceleration);
+  check(inOrder && path.state == MISSION_DONE && path.leg == SQUARE_WAYPOINTS - 1, "reference: legs in order, done");
+  check(fabsf(path.reference[0]) < 0.05f && fabsf(path.reference[1]) < 0.05f, "reference: on the last waypoint");
+  check(maxSpeed <= MISSION_CRUISE_SPEED + 1e-3f, "reference: cruise speed");
+  check(maxAcceleration <= MISSION_ACCELERATION + 1e-3f, "reference: acceleration");
+  check(time < expected * 1.5f, "reference: not too slow");
+
+  // a drone that does not move: the reference waits
+  startMissionPath(path, waypoints, SQUARE_WAYPOINTS, home[0], home[1], MISSION_CRUISE_SPEED, MISSION_ACCEPTANCE_RADIUS,
+                   MISSION_ACCELERATION, MISSION_LEASH);
+  float still[2] = {0.0f, 0.0f};
+  for(int i = 0; i < 300; i++) stepMissionPath(path, still, dt);
+  float lead = sqrtf(sq(path.reference[0]) + sq(path.reference[1]));
+  printf("     reference: %.2fm ahead of a still drone\n", lead);
+  check(lead <= 2.1f * MISSION_LEASH && path.leg == 0, "reference: waits for the drone");
+}
+
+/**
+ * @brief 2) the flash.
+ */
+void checkFlash(const missionWaypoint *waypoints){
+
+  start = 0;
+  check(setMission(waypoints, SQUARE_WAYPOINTS), "flash: mission saved");
+  missionCount = 0;
+  loadMission();
+  check(missionCount == SQUARE_WAYPOINTS && memcmp(missionWaypoints, waypoints, sizeof(missionWaypoint) * SQUARE_WAYPOINTS) == 0,
+        "flash: mission read back");
+
+  missionWaypoint wrong[SQUARE_WAYPOINTS];
+  memcpy(wrong, waypoints, sizeof(wrong));
+  wrong[2].speed = 50.0f;
+  check(!setMission(wrong, SQUARE_WAYPOINTS) && missionCount == SQUARE_WAYPOINTS, "flash: too fast, refused");
+
+  start = 2;
+  check(!setMission(waypoints, 1), "flash: refused with the motors on");
+  start = 0;
+
+  std::vector<uint8_t> saved = halNVS["mission/blob"];
+  halNVS["mission/blob"][16] ^= 1;                          // a bit of the first waypoint
+  loadMission();
+  check(missionCount == 0, "flash: broken blob refused");
+  halNVS["mission/blob"] = saved;
+}
+
+int main(int argc, char *argv[]){
+
+  simulationSettings settings = defaultSettings;
+  settings.scenario = GPS_HOLD;
+  settings.duration = FLIGHT_TIME;
+  settings.seed = argc > 1 ? atoi(argv[1]) : 1;
+  settings.wind[0] = WIND_NORTH;
+  settings.wind[1] = WIND_EAST;
+  FILE *track = argc > 2 ? fopen(argv[2], "w") : NULL;
+  if(track) fprintf(track, "time,north,east,altitude,referenceNorth,referenceEast,leg,state\n");
+
+  missionWaypoint waypoints[SQUARE_WAYPOINTS];
+  squareMission(waypoints);
+
+  printf("    ----------------------------------------------------\n");
+  checkPath(waypoints);
+  checkFlash(waypoints);
+
+  // 3) the flight: setup() reads the mission saved by checkFlash()
+  startSimulation(settings);
+  check(missionCount == SQUARE_WAYPOINTS, "flight: mission loaded by setup()");
+
+  double crossTrack = 0.0, maxSpeed = 0.0, finalError = 0.0, doneTime = -1.0;
+  int legs = 0;
+  bool inOrder = true;
+  double maxTilt = 0.0, altitudes[2] = {1e9, -1e9};
+  uint32_t lastSample = missionSamples;
+  double lastPosition[2] = {0.0, 0.0}, startPosition[2] = {0.0, 0.0};
+
+  while(halClock - world.flightStart < (uint64_t)(settings.duration * 1e6)){
+    loop();
+    halRunTasks();
+    double t = (double)(halClock - world.flightStart) / 1e6;
+    double angles[3];
+    world.quad.eulerAngles(angles);
+    maxTilt = fmax(maxTilt, fmax(fabs(angles[0]), fabs(angles[1])));
+    const double *p = world.quad.position;
+    if(missionSamples == lastSample) continue;              // at every GPS sample
+    lastSample = missionSamples;
+
+    if(flightMode != 4 || missionTarget.engagement != missionEngagement || missionTarget.state == MISSION_IDLE){
+      startPosition[0] = p[0];
+      startPosition[1] = p[1];
+      lastPosition[0] = p[0];
+      lastPosition[1] = p[1];
+      continue;
+    }
+
+    altitudes[0] = fmin(altitudes[0], world.quad.altitude());
+    altitudes[1] = fmax(altitudes[1], world.quad.altitude());
+
+    if(track){
+      float reference[2];
+      missionLocalPosition(missionTarget.latitude, missionTarget.longitude, missionRoute.origin, missionRoute.cosLatitude,
+                           reference);
+      fprintf(track, "%.2f,%.2f,%.2f,%.2f,%.2f,%.2f,%d,%d\n", t, p[0], p[1], world.quad.altitude(),
+              reference[0] + (missionRoute.origin[0] - waypoints[SQUARE_WAYPOINTS - 1].latitude) * MICRODEGREE_TO_METERS,
+              reference[1] + (missionRoute.origin[1] - waypoints[SQUARE_WAYPOINTS - 1].longitude) * MICRODEGREE_TO_METERS *
+                             missionRoute.cosLatitude,
+              missionTarget.leg, missionTarget.state);
+    }
+
+    if(missionTarget.leg != legs && missionTarget.leg != legs + 1) inOrder = false;
+    legs = missionTarget.leg;
+
+    // the distance from the leg flown (the first one starts where the mission started)
+    const double *from = legs == 0 ? startPosition : square[legs - 1];
+    double distance = segmentDistance(p, from, square[legs]);
+    if(legs > 0) distance = fmin(distance, segmentDistance(p, legs == 1 ? startPosition : square[legs - 2], from));
+    if(distance > crossTrack) crossTrack = distance;
+
+    double speed = sqrt(sq(p[0] - lastPosition[0]) + sq(p[1] - lastPosition[1])) / MISSION_SAMPLE_PERIOD;
+    if(speed > maxSpeed) maxSpeed = speed;
+    lastPosition[0] = p[0];
+    lastPosition[1] = p[1];
+
+    if(missionTarget.state == MISSION_DONE){
+      if(doneTime < 0.0) doneTime = t;
+      double error = sqrt(sq(p[0] - square[SQUARE_WAYPOINTS - 1][0]) + sq(p[1] - square[SQUARE_WAYPOINTS - 1][1]));
+      if(t > doneTime + 5.0 && error > finalError) finalError = error;
+    }
+  }
+  if(track) fclose(track);
+
+  printf("    ----------------------------------------------------\n");
+  printf("     flight: wind %.1fm/s north %.1fm/s east, seed %llu\n", settings.wind[0], settings.wind[1],
+         (unsigned long long)settings.seed);
+  printf("     flight: last leg %d, done at %.1fs, max %.1fm from the legs, max %.1fm/s\n", legs, doneTime, crossTrack, maxSpeed);
+  printf("     flight: %.1fm from the last waypoint, holding it\n", finalError);
+  printf("     flight: max tilt %.1fdeg, altitude %.1f-%.1fm (the altitude hold is not tested here)\n", maxTilt,
+         altitudes[0], altitudes[1]);
+  printf("    ----------------------------------------------------\n");
+  check(maxTilt < MAX_TILT, "flight: tilt");
+  check(inOrder && legs == SQUARE_WAYPOINTS - 1 && doneTime > 0.0, "flight: all the legs, in order");
+  check(crossTrack < MAX_CROSS_TRACK, "flight: close to the legs");
+  check(maxSpeed < 2.0 * MISSION_CRUISE_SPEED, "flight: speed");
+  check(finalError < MAX_FINAL_ERROR, "flight: holds the last waypoint");
+  printf("    ----------------------------------------------------\n");
+
+  return failures > 0 ? 1 : 0;
+}
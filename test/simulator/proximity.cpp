@@ -0,0 +1,202 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *           Proximity            *
+ *                       **********************************
+ *
+ *          Test the HC-SR04 rangefinder and the low altitude blending on your computer.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * The routines of Proximity.h, with the echo pin driven by timed edges through the interrupt, as the sensor does:
+ *      echo        the width of an echo is measured by proximityISR() and converted by echoToDistance(), also the
+ *                  ones too short, too long or without an obstacle;
+ *      reading     readProximitySensor() takes the echo, corrects it by the tilt and filters it; an echo out of range
+ *                  or stuck high longer than PROXIMITY_TIMEOUT_US makes the reading not valid;
+ *      blend       blendLowAltitude() gives the barometer when the rangefinder is not valid or far from the ground,
+ *                  follows the rangefinder close to the ground with a noisy barometer, and is continuous across the
+ *                  blending band.
+ * The program prints the results and returns 1 if a check fails.
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src simulator/proximity.cpp -o proximity
+ *      ./proximity
+ *
+ *
+ * @file proximity.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-28
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define SIMULATOR_PROXIMITY
+#include "Simulation.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ */
+#define GROUND_PRESSURE             1000.0                    // (hPa) on the ground below the drone
+#define BARO_NOISE                  0.03                      // (hPa) standard deviation, about 25 cm
+#define BARO_OFFSET                 0.05                      // (hPa) slow error of the barometer
+#define TILT                        30.0                      // (deg) of the roll
+/**
+ *      (LIMITS)
+ */
+#define MAX_DISTANCE_ERROR          0.005                     // (m) of a single echo
+#define MAX_BLEND_STEP              0.002                     // (hPa) between two close heights
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  DO NOT CHANGE THIS VALUES
+ */
+/**
+ * @brief An echo of the sensor, rising and falling on the echo pin.
+ *
+ * @param width (us)
+ */
+void echo(unsigned long width){
+  uint64_t start = halClock + 500;
+  halSetPin(PIN_PROXIMITY_SENSOR_ECHO, HIGH, start);
+  halSetPin(PIN_PROXIMITY_SENSOR_ECHO, LOW, start + width);
+  halClock = start + width + 100;
+}
+
+/**
+ * @brief Reads the sensor after the next ping time.
+ */
+void nextCycle(){
+  halClock += PROXIMITY_CYCLE_MS * 1000;
+  readProximitySensor();
+}
+
+/**
+ * @brief The width of an echo, through the interrupt, and its distance.
+ */
+void checkEcho(){
+
+  setupProximitySensor();
+
+  echo(5831);
+  printf("     echo: %lu us, %.4f m\n", proximityEchoWidth, echoToDistance(proximityEchoWidth));
+  check(proximityNewEcho && proximityEchoWidth == 5831, "echo: width measured by the interrupt");
+  check(fabs(echoToDistance(5831) - 1.0) < MAX_DISTANCE_ERROR, "echo: 1 m");
+  check(echoToDistance(100) < 0, "echo: closer than PROXIMITY_MIN_RANGE");
+  check(echoToDistance(25000) < 0, "echo: farther than PROXIMITY_MAX_RANGE");
+  check(echoToDistance(PROXIMITY_TIMEOUT_US + 1) < 0, "echo: no obstacle");
+}
+
+/**
+ * @brief The readings of readProximitySensor(), with the tilt, the filter and the timeouts.
+ */
+void checkReading(){
+
+  angleRoll = 0.0f;
+  anglePitch = 0.0f;
+  nextCycle();                                                    // the echo of checkEcho()
+  check(proximityValid && fabs(proximityDistance - 1.0) < MAX_DISTANCE_ERROR, "reading: 1 m");
+  check(!proximityNewEcho && proximityTriggerTimer == millis(), "reading: echo taken, new ping");
+
+  echo(2 * 5831);
+  nextCycle();
+  check(fabs(proximityDistance - (0.7 * 1.0 + 0.3 * 2.0)) < MAX_DISTANCE_ERROR, "reading: low pass filter");
+
+  echo(PROXIMITY_TIMEOUT_US + 2000);
+  nextCycle();
+  check(!proximityValid, "reading: no obstacle, not valid");
+
+  angleRoll = TILT;
+  echo(2 * 5831);
+  nextCycle();
+  printf("     reading: %.4f m at %.0f deg of roll\n", proximityDistance, TILT);
+  check(proximityValid && fabs(proximityDistance - 2.0 * cos(TILT * M_PI / 180.0)) < MAX_DISTANCE_ERROR,
+        "reading: tilt correction, first after a loss");
+  angleRoll = 0.0f;
+
+  // an echo that started 1 ms before the ping: still in time
+  halSetPin(PIN_PROXIMITY_SENSOR_ECHO, HIGH, halClock + PROXIMITY_CYCLE_MS * 1000 - 1000);
+  nextCycle();
+  check(proximityValid, "reading: echo high, in time");
+
+  // the same echo, one ping later: stuck
+  nextCycle();
+  check(!proximityValid, "reading: echo stuck high, not valid");
+  halSetPin(PIN_PROXIMITY_SENSOR_ECHO, LOW, halClock);
+  proximityNewEcho = false;
+}
+
+/**
+ * @brief blendLowAltitude() close to the ground, in the blending band and above it.
+ */
+void checkBlend(){
+
+  Noise noise(5);
+  groundPressure = 0.0f;
+
+  // not valid: the barometer, as it is
+  proximityValid = false;
+  proximityDistance = 1.0f;
+  check(blendLowAltitude(GROUND_PRESSURE - 0.5f) == (float)(GROUND_PRESSURE - 0.5f), "blend: not valid, barometer");
+
+  // close to the ground: the rangefinder, the ground pressure averages the noise of the barometer
+  proximityValid = true;
+  double inputSum = 0.0, outputSum = 0.0, outputMean = 0.0;
+  const int n = 2000;
+  for(int i = 0; i < n; i++){
+    double truth = GROUND_PRESSURE - proximityDistance * hPaPerMeter;
+    double error = BARO_OFFSET + noise.gaussian(BARO_NOISE);
+    float output = blendLowAltitude((float)(truth + error));
+    if(i < n / 2) continue;                                       // the ground pressure is settled
+    inputSum += sq(error - BARO_OFFSET);
+    outputSum += sq(output - (truth + BARO_OFFSET));
+    outputMean += output - truth;
+  }
+  double inputNoise = sqrt(inputSum / (n / 2)), outputNoise = sqrt(outputSum / (n / 2));
+  outputMean /= n / 2;
+  printf("     blend: noise %.4f hPa in, %.4f hPa out, offset %.4f hPa\n", inputNoise, outputNoise, outputMean);
+  check(outputNoise < 0.3 * inputNoise, "blend: rangefinder filters the barometer");
+  check(fabs(outputMean - BARO_OFFSET) < 0.3 * BARO_NOISE, "blend: same units as the barometer");
+  check(fabs(groundAltitude - proximityDistance) < 1e-4, "blend: ground altitude from the rangefinder");
+
+  // through the band, with a barometer without noise: continuous and equal to the barometer
+  double worstStep = 0.0, worstDistance = 0.0, last = 0.0;
+  for(int i = 0; i <= 400; i++){
+    proximityDistance = 1.5f + i * 0.005f;
+    float barometer = (float)(GROUND_PRESSURE + BARO_OFFSET - proximityDistance * hPaPerMeter);
+    for(int k = 0; k < 300; k++) blendLowAltitude(barometer);    // the ground pressure follows the slow offset
+    double output = blendLowAltitude(barometer);
+    if(i > 0) worstStep = fmax(worstStep, fabs(output - last));
+    worstDistance = fmax(worstDistance, fabs(output - barometer));
+    last = output;
+  }
+  printf("     blend: largest step %.5f hPa, largest distance from the barometer %.5f hPa\n", worstStep, worstDistance);
+  check(worstStep < MAX_BLEND_STEP, "blend: continuous through the band");
+  check(worstDistance < MAX_BLEND_STEP, "blend: consistent barometer, same output");
+
+  // half way in the band: half rangefinder, half barometer
+  proximityDistance = PROXIMITY_BLEND_ALTITUDE - 0.5f * proximityBlendBand;
+  float rangefinder = groundPressure - proximityDistance * hPaPerMeter;
+  float output = blendLowAltitude(rangefinder + 0.1f);
+  float expected = 0.5f * (groundPressure - proximityDistance * hPaPerMeter) + 0.5f * (rangefinder + 0.1f);
+  check(fabs(output - expected) < 1e-3, "blend: half way in the band");
+
+  // above the band: the barometer
+  proximityDistance = PROXIMITY_BLEND_ALTITUDE + 0.1f;
+  check(blendLowAltitude(GROUND_PRESSURE - 0.4f) == (float)(GROUND_PRESSURE - 0.4f), "blend: above the band, barometer");
+}
+
+int main(){
+
+  printf("    ----------------------------------------------------\n");
+  checkEcho();
+  printf("    ----------------------------------------------------\n");
+  checkReading();
+  printf("    ----------------------------------------------------\n");
+  checkBlend();
+  printf("    ----------------------------------------------------\n");
+
+  return failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,363 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *            Replay              *
+ *                       **********************************
+ *
+ *          Fly again, on your computer, a flight saved by the flight recorder.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * With FLIGHT_RECORDER true in Config.h, the flight controller writes on the serial the raw inputs of every loop:
+ * gyroscope, barometer and compass registers, GPS bytes, receiver channels, battery snapshot and the changes of the PID
+ * gains (see FlightRecorder.h and FlightTrace.h). Save them with a serial logger started before the drone.
+ * The simulator saves the same trace if compiled with -DSIMULATOR_RECORDER (see simulator.cpp).
+ *
+ * This program compiles src/main.cpp with the simulated core, as the simulator does, but the sensors are not
+ * simulated: setup() and loop() read the recorded bytes, in the same order as on the drone. Then:
+ *      ./replay flight.trace                       prints how long each stage of the loop takes, on the drone and here;
+ *      ./replay flight.trace --save golden.csv     also saves the outputs of every loop (ESC pulses, PID outputs, ...);
+ *      ./replay flight.trace --check golden.csv    compares the outputs with the saved ones, bit by bit.
+ * Save the golden file before changing e.g. calculateAnglePRY() or calculatePID(), check it after: the program
+ * returns 1 if an output changed, or if the sketch did not read the inputs as in the trace.
+ * Your Config.h must be the one of the recorded flight (except for FLIGHT_RECORDER and DEBUG), as in the simulator
+ * only the MPU-6050, the BMP280, the BN-880 and the HMC5883L are supported, without the proximity sensor.
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src simulator/replay.cpp -o replay
+ *      ./replay flight.trace [--save|--check golden.csv]
+ *
+ *
+ * @file replay.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-18
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define FLIGHT_REPLAY
+#include "Simulation.h"
+#include <fstream>
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ *
+ *
+ *      (REPORT)
+ */
+#define MAX_REPORTED                10                        // differences printed when checking
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                              DO NOT CHANGE THIS VALUES
+ */
+#define OUTPUTS_HEADER  "tick,flightMode,start,esc1,esc2,esc3,esc4,pidOutputRoll,pidOutputPitch,pidOutputYaw,"  \
+                        "pidRollSetpoint,pidPitchSetpoint,pidYawSetpoint,angleRoll,anglePitch,gyroRollInput,"   \
+                        "gyroPitchInput,gyroYawInput,pidOutputAltitude,GPSRollAdjust,GPSPitchAdjust,batteryVoltage"
+
+typedef std::chrono::steady_clock replayClock;
+
+struct replayState {
+  std::vector<uint8_t> trace;
+  size_t cursor;                                              // next record
+  size_t gpsLeft;                                             // bytes of the current GPS record not yet read
+  long tick;
+  long drifts;                                                // inputs read differently from the trace
+  uint32_t boardMicros;                                       // (us) micros() of the drone at the last tick
+  uint64_t clockOffset;                                       // halClock - board time
+  replayClock::time_point mark;
+  double hostTime[TRACE_STAGES];                              // (ns) summed on all the ticks
+  double boardTime[TRACE_STAGES];                             // (us) summed on boardTicks
+  long boardTicks;
+} replay;
+
+
+/**
+ * @brief Size of the record at the given position.
+ *
+ * @return long bytes, type included, -1 if the record is unknown or cut by the end of the trace
+ */
+long recordSize(size_t at){
+  if(at >= replay.trace.size()) return -1;
+  uint8_t record = replay.trace[at];
+  long size = record == TRACE_GPS ? (at + 1 < replay.trace.size() ? 2 + replay.trace[at + 1] : -1) : tracePayloadSize(record);
+  if(size < 0) return -1;
+  if(record != TRACE_GPS) size++;
+  return at + size <= replay.trace.size() ? size : -1;
+}
+
+void reportDrift(const char *what){
+  if(replay.drifts++ < MAX_REPORTED)
+    printf("  drift at tick %ld: %s (trace has record %d)\n", replay.tick, what,
+           replay.cursor < replay.trace.size() ? replay.trace[replay.cursor] : -1);
+}
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  THE FLIGHT RECORDER, REPLAYING (see FlightRecorder.h)
+ */
+void startFlightRecorder(){}
+
+/**
+ * @brief Gives back the recorded input: the sketch reads the trace instead of the sensors.
+ */
+void traceInput(uint8_t record, void *data, uint8_t size){
+
+  // the GPS bytes are already in SerialGPS (see traceLoopStart()): only check them
+  if(record == TRACE_GPS){
+    if(replay.gpsLeft == 0){
+      if(recordSize(replay.cursor) < 0 || replay.trace[replay.cursor] != TRACE_GPS){ reportDrift("GPS byte not in the trace"); return; }
+      replay.gpsLeft = replay.trace[replay.cursor + 1];
+      replay.cursor += 2;
+    }
+    if(memcmp(data, &replay.trace[replay.cursor], size) != 0) reportDrift("different GPS byte");
+    replay.cursor += size;
+    replay.gpsLeft -= size;
+    return;
+  }
+
+  if(replay.gpsLeft > 0 || recordSize(replay.cursor) != 1 + size || replay.trace[replay.cursor] != record){
+    reportDrift("input not in the trace");
+    return;
+  }
+  memcpy(data, &replay.trace[replay.cursor + 1], size);
+  replay.cursor += 1 + size;
+}
+
+/**
+ * @brief Times the stage just ended.
+ */
+void traceStage(uint8_t stage){
+  replayClock::time_point now = replayClock::now();
+  replay.hostTime[stage] += std::chrono::duration<double, std::nano>(now - replay.mark).count();
+  replay.mark = now;
+}
+
+/**
+ * @brief Skips what the previous loop did not read and loads the receiver, the GPS bytes and the parameters.
+ */
+void traceLoopStart(){
+
+  // inputs of the previous loop not read by the sketch
+  if(replay.gpsLeft > 0){
+    reportDrift("GPS bytes not read");
+    replay.cursor += replay.gpsLeft;
+    replay.gpsLeft = 0;
+  }
+  while(recordSize(replay.cursor) > 0 && replay.trace[replay.cursor] != TRACE_TICK){
+    if(replay.trace[replay.cursor] == TRACE_TIMING){
+      uint16_t timing[TRACE_STAGES];
+      memcpy(timing, &replay.trace[replay.cursor + 1], sizeof(timing));
+      for(int i = 0; i < TRACE_STAGES; i++) replay.boardTime[i] += (uint16_t)(timing[i] - (i > 0 ? timing[i - 1] : 0));
+      replay.boardTicks++;
+    }
+    else reportDrift("input not read");
+    replay.cursor += recordSize(replay.cursor);
+  }
+  if(recordSize(replay.cursor) < 0) return;                   // end of the trace
+
+  // receiver and clock
+  const uint8_t *tick = &replay.trace[replay.cursor + 1];
+  uint32_t boardTime;
+  memcpy(&boardTime, tick, 4);
+  for(int ch = 0; ch < TRACE_RECEIVER_CHANNELS; ch++) memcpy(&trimCh[ch].actual, tick + 4 + 2 * ch, 2);
+
+  if(replay.tick == 0) replay.clockOffset = halClock - boardTime;
+  else{
+    uint64_t clock = replay.clockOffset + boardTime;
+    if(boardTime < replay.boardMicros) replay.clockOffset += 0x100000000ULL, clock += 0x100000000ULL;   // micros() overflow
+    if(clock > halClock) halClock = clock;                    // the drone was late: so is the replay
+  }
+  replay.boardMicros = boardTime;
+  replay.cursor += recordSize(replay.cursor);
+
+  // parameters changed by the telemetry
+  if(recordSize(replay.cursor) > 0 && replay.trace[replay.cursor] == TRACE_PARAMETERS){
+    traceParameters parameters;
+    memcpy(&parameters, &replay.trace[replay.cursor + 1], sizeof(parameters));
+    setTraceParameters(parameters);
+    replay.cursor += recordSize(replay.cursor);
+  }
+
+  // the GPS bytes read in this loop
+  for(size_t at = replay.cursor; recordSize(at) > 0 && replay.trace[at] != TRACE_TICK; at += recordSize(at))
+    if(replay.trace[at] == TRACE_GPS) SerialGPS.halReceive(&replay.trace[at + 2], replay.trace[at + 1]);
+
+  replay.tick++;
+  replay.mark = replayClock::now();
+}
+
+/**
+ * @brief true if there is one more complete loop in the trace.
+ */
+bool nextTick(){
+  size_t at = replay.cursor + replay.gpsLeft;
+  while(recordSize(at) > 0 && replay.trace[at] != TRACE_TICK) at += recordSize(at);
+  if(recordSize(at) < 0) return false;
+  for(at += recordSize(at); recordSize(at) > 0; at += recordSize(at))
+    if(replay.trace[at] == TRACE_TICK || replay.trace[at] == TRACE_TIMING) return true;
+  return false;                                               // the logger stopped during this loop
+}
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *  OUTPUTS
+ */
+
+/**
+ * @brief One line of outputs, floats with 9 digits so that they are written and read back bit by bit.
+ */
+std::string outputsLine(){
+  char line[512];
+  snprintf(line, sizeof(line), "%ld,%d,%d,%d,%d,%d,%d,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g,%.9g",
+           replay.tick, flightMode, start, esc1, esc2, esc3, esc4, pidOutputRoll, pidOutputPitch, pidOutputYaw,
+           pidRollSetpoint, pidPitchSetpoint, pidYawSetpoint, angleRoll, anglePitch, gyroRollInput, gyroPitchInput,
+           gyroYawInput, pidOutputAltitude, GPSRollAdjust, GPSPitchAdjust, batteryVoltage);
+  return line;
+}
+
+std::vector<std::string> splitColumns(const std::string &line){
+  std::vector<std::string> columns(1);
+  for(size_t i = 0; i < line.size(); i++){
+    if(line[i] == ',') columns.push_back("");
+    else columns.back() += line[i];
+  }
+  return columns;
+}
+
+/**
+ * @brief Prints the columns of two lines that differ.
+ */
+void reportDifference(const std::string &expected, const std::string &actual){
+  std::vector<std::string> names = splitColumns(OUTPUTS_HEADER), e = splitColumns(expected), a = splitColumns(actual);
+  printf("  tick %s:", a[0].c_str());
+  for(size_t i = 0; i < names.size(); i++){
+    std::string ei = i < e.size() ? e[i] : "-", ai = i < a.size() ? a[i] : "-";
+    if(ei != ai) printf(" %s %s -> %s", names[i].c_str(), ei.c_str(), ai.c_str());
+  }
+  printf("\n");
+}
+
+
+int main(int argc, char **argv){
+
+  if(argc != 2 && !(argc == 4 && (strcmp(argv[2], "--save") == 0 || strcmp(argv[2], "--check") == 0))){
+    printf("usage: %s flight.trace [--save|--check golden.csv]\n", argv[0]);
+    return 1;
+  }
+  bool save = argc == 4 && strcmp(argv[2], "--save") == 0, check = argc == 4 && !save;
+
+  // the trace
+  FILE *file = fopen(argv[1], "rb");
+  if(!file){ printf("Cannot open %s\n", argv[1]); return 1; }
+  uint8_t buffer[65536];
+  size_t n;
+  while((n = fread(buffer, 1, sizeof(buffer), file)) > 0) replay.trace.insert(replay.trace.end(), buffer, buffer + n);
+  fclose(file);
+
+  traceHeader header;
+  if(replay.trace.size() < sizeof(header)){ printf("%s is not a flight trace\n", argv[1]); return 1; }
+  memcpy(&header, replay.trace.data(), sizeof(header));
+  if(header.magic != TRACE_MAGIC || header.version != TRACE_VERSION || header.stages != TRACE_STAGES){
+    printf("%s is not a flight trace of this version\n", argv[1]);
+    return 1;
+  }
+  const uint8_t options[7] = {GYROSCOPE, ALTITUDE_SENSOR, GPS, PROXIMITY_SENSOR, AUTOTUNE_PID_GYROSCOPE, FRAME_TYPE, COMPASS};
+  const char *optionNames[7] = {"GYROSCOPE", "ALTITUDE_SENSOR", "GPS", "PROXIMITY_SENSOR", "AUTOTUNE_PID_GYROSCOPE", "FRAME_TYPE",
+                                "COMPASS"};
+  for(int i = 0; i < 7; i++)
+    if(header.options[i] != options[i])
+      printf("  WARNING: %s was %d in the recorded flight, %d here: the replay will drift\n", optionNames[i],
+             header.options[i], options[i]);
+  replay.cursor = sizeof(header);
+
+  // the golden file
+  std::vector<std::string> golden;
+  FILE *outputs = NULL;
+  if(check){
+    std::ifstream in(argv[3]);
+    std::string line;
+    if(!in || !std::getline(in, line) || line != OUTPUTS_HEADER){ printf("%s is not a golden file of this version\n", argv[3]); return 1; }
+    while(std::getline(in, line)) golden.push_back(line);
+  }
+  if(save){
+    outputs = fopen(argv[3], "w");
+    if(!outputs){ printf("Cannot write %s\n", argv[3]); return 1; }
+    fprintf(outputs, "%s\n", OUTPUTS_HEADER);
+  }
+
+  // setup(), on the EEPROM and with the receiver of the drone
+  for(int i = 0; i < TRACE_EEPROM_SIZE; i++) EEPROM.write(i, header.eeprom[i]);
+  size_t at = replay.cursor;
+  while(recordSize(at) > 0 && replay.trace[at] != TRACE_TICK) at += recordSize(at);
+  if(recordSize(at) > 0)
+    for(int ch = 0; ch < TRACE_RECEIVER_CHANNELS; ch++) memcpy(&trimCh[ch].actual, &replay.trace[at + 5 + 2 * ch], 2);
+
+  SimulatedMPU6050 mpu;                                       // only to answer on the bus: the data come from the trace
+  SimulatedBMP280 bmp;
+  Wire.halAttach(GYRO_ADDRESS, &mpu);
+  Wire.halAttach(ALTITUDE_SENSOR_ADDRESS, &bmp);
+  #if COMPASS != OFF
+    SimulatedCompass compass;
+    Wire.halAttach(COMPASS_ADDRESS, &compass);
+  #endif
+
+  setup();
+  long setupDrifts = replay.drifts;
+
+  // the loops
+  long differences = 0;
+  replayClock::time_point wallStart = replayClock::now();
+  while(nextTick()){
+    loop();
+
+    std::string line = outputsLine();
+    if(outputs) fprintf(outputs, "%s\n", line.c_str());
+    if(check){
+      size_t i = (size_t)(replay.tick - 1);
+      if(i >= golden.size() || golden[i] != line){
+        if(differences++ < MAX_REPORTED){
+          if(i < golden.size()) reportDifference(golden[i], line);
+          else printf("  tick %ld: not in the golden file\n", replay.tick);
+        }
+      }
+    }
+  }
+  double wallTime = std::chrono::duration<double>(replayClock::now() - wallStart).count();
+  if(outputs) fclose(outputs);
+  if(check && golden.size() != (size_t)replay.tick){
+    printf("  the golden file has %zu ticks, the trace %ld\n", golden.size(), replay.tick);
+    differences++;
+  }
+
+  // report
+  double hostTotal = 0.0, boardTotal = 0.0;
+  for(int i = 0; i < TRACE_STAGES; i++){ hostTotal += replay.hostTime[i]; boardTotal += replay.boardTime[i]; }
+  long ticks = replay.tick > 0 ? replay.tick : 1, boardTicks = replay.boardTicks > 0 ? replay.boardTicks : 1;
+
+  printf("\n\n");
+  printf("    -------------------------------------------------------\n");
+  printf("     trace              %s, %zu bytes\n", argv[1], replay.trace.size());
+  printf("     loops              %ld, %.1fs of flight\n", replay.tick, replay.tick * 0.004);
+  printf("     drifts             %ld in setup(), %ld in loop()\n", setupDrifts, replay.drifts - setupDrifts);
+  if(check)
+    printf("     golden file        %s: %ld loops differ\n", argv[3], differences);
+  printf("    -------------------------------------------------------\n");
+  printf("     stage              drone (us)         here (ns)\n");
+  for(int i = 0; i < TRACE_STAGES; i++)
+    printf("     %-12s   %9.1f %5.1f%%   %9.0f %5.1f%%\n", traceStageNames[i], replay.boardTime[i] / boardTicks,
+           boardTotal > 0 ? 100.0 * replay.boardTime[i] / boardTotal : 0.0, replay.hostTime[i] / ticks,
+           hostTotal > 0 ? 100.0 * replay.hostTime[i] / hostTotal : 0.0);
+  printf("     %-12s   %9.1f          %9.0f\n", "loop", boardTotal / boardTicks, hostTotal / ticks);
+  printf("    -------------------------------------------------------\n");
+  printf("     replayed in %.2fs\n\n", wallTime);
+
+  return replay.drifts > 0 || differences > 0 ? 1 : 0;
+}
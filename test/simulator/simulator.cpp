@@ -0,0 +1,123 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *           Simulator            *
+ *                       **********************************
+ *
+ *          Fly the flight controller sketch on your computer, before flying it for real.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * src/main.cpp is compiled for the computer with the simulated ESP32 core of the hal/ dir (see Simulation.h):
+ * the sketch reads a simulated MPU-6050, BMP280, GPS and receiver, and its esc1..esc4 pulses drive a 6-DOF
+ * model of the quadcopter (see Quadcopter.h). Your Config.h is used, except for the few values changed in
+ * Config.sim.h. The time is simulated, so a flight runs many times faster than real time.
+ *
+ * A simulated pilot arms the motors, takes off and flies one of the scenarios:
+ *      hover       manual hover at 2 m;
+ *      steps       roll, pitch and yaw stick steps while hovering;
+ *      althold     altitude hold engaged at 3 m;
+ *      gpshold     GPS hold engaged at 3 m, with 2 m/s of wind from the west.
+ * Then the program prints how well the drone has followed the sticks and held its position.
+ * Write a file name as fourth argument to save one line per loop in a csv file, to plot the flight.
+ * Compiled with -DSIMULATOR_RECORDER, the flight recorder of the sketch is on (see FlightRecorder.h): the trace is
+ * saved in the file of the fifth argument (flight.trace by default), to be replayed with replay.cpp.
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src simulator/simulator.cpp -o sim
+ *      ./sim [scenario] [seconds] [seed] [trace.csv] [flight.trace]
+ *
+ *
+ * @file simulator.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-16
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "Simulation.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ *
+ *
+ *      (DRONE, see Quadcopter.h for the default one)
+ */
+#define DRONE_MASS                  1.20                      // (kg) take off weight
+#define MOTOR_MAX_THRUST            7.5                       // (N) thrust of one motor at full throttle
+#define BATTERY_CHARGE              100.0                     // (%) at take off
+/**
+ *      (WIND in GPS hold)
+ */
+#define WIND_NORTH                  0.0                       // (m/s)
+#define WIND_EAST                   2.0                       // (m/s)
+
+
+
+int main(int argc, char **argv){
+
+  simulationSettings settings = defaultSettings;
+  settings.quadcopter.mass = DRONE_MASS;
+  settings.quadcopter.maxThrust = MOTOR_MAX_THRUST;
+  settings.batteryCharge = BATTERY_CHARGE;
+
+  if(argc > 1){
+    int i = 0;
+    while(i < 4 && strcmp(argv[1], scenarioNames[i]) != 0) i++;
+    if(i == 4){
+      printf("Unknown scenario %s: use hover, steps, althold or gpshold\n", argv[1]);
+      return 1;
+    }
+    settings.scenario = (scenarioType)i;
+  }
+  if(argc > 2) settings.duration = atof(argv[2]);
+  if(argc > 3) settings.seed = strtoull(argv[3], NULL, 10);
+  if(argc > 4 && strcmp(argv[4], "-") != 0) settings.tracePath = argv[4];
+  if(settings.scenario == GPS_HOLD){
+    settings.wind[0] = -WIND_NORTH;                           // NED air velocity: the wind blows from the given side
+    settings.wind[1] = WIND_EAST;
+  }
+
+  simulationResult result;
+  runSimulation(settings, result);
+
+  #if FLIGHT_RECORDER == true
+    const char *recordPath = argc > 5 ? argv[5] : "flight.trace";
+    FILE *record = fopen(recordPath, "wb");
+    if(record){
+      fwrite(Serial.sent.data(), 1, Serial.sent.size(), record);
+      fclose(record);
+      printf("\nFlight recorder trace saved in %s (%zu bytes)\n", recordPath, Serial.sent.size());
+    }
+  #endif
+
+  printf("\n\n");
+  printf("    ----------------------------------------------------\n");
+  printf("     scenario           %s, %.0fs, seed %llu\n", scenarioNames[settings.scenario], settings.duration,
+         (unsigned long long)settings.seed);
+  printf("     setup              %.1fs\n", result.setupTime);
+  printf("     flight             %.1fs, %ld loops\n", result.simulatedTime, result.loops);
+  if(result.crashed)
+    printf("     CRASHED            at %.1fs\n", result.crashTime);
+  printf("    ----------------------------------------------------\n");
+  printf("     rate error (RMS)   roll %.2f  pitch %.2f  yaw %.2f deg/s\n", result.rateError[0], result.rateError[1],
+         result.rateError[2]);
+  printf("     angle (RMS)        roll %.2f  pitch %.2f deg, max %.1f deg\n", result.angleError[0], result.angleError[1],
+         result.maxAngle);
+  printf("     altitude error     %.2f m (RMS)\n", result.altitudeError);
+  printf("     horizontal drift   %.2f m (max)\n", result.drift);
+  printf("     rate overshoot     %.1f%%\n", result.overshoot);
+  printf("     ESC noise          %.1fus (RMS change between two loops)\n", result.escNoise);
+  printf("     motor saturation   %.1f%% of the loops\n", result.saturation);
+  printf("     battery            %.2fV min, %.0fmAh used\n", result.minVoltage, result.consumed);
+  printf("    ----------------------------------------------------\n");
+  printf("     %.1fs simulated in %.2fs, %.0fx real time\n", result.setupTime + result.simulatedTime, result.wallTime,
+         (result.setupTime + result.simulatedTime) / result.wallTime);
+  printf("\n");
+
+  return result.crashed ? 2 : 0;
+}
@@ -0,0 +1,312 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *           PID Tuner            *
+ *                       **********************************
+ *
+ *          Find the roll, pitch and yaw PID gains on your computer, with the simulator.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * Every set of gains flies the "steps" scenario of the simulator (see simulator.cpp): hover, then roll, pitch
+ * and yaw stick steps. Each flight gets a score, the lower the better:
+ *
+ *      score = rate error + OVERSHOOT_WEIGHT * overshoot + NOISE_WEIGHT * ESC noise + SATURATION_WEIGHT * saturation
+ *
+ * being the rate error the RMS difference between the rates of the drone and the PID set points (deg/s), the
+ * overshoot the largest rate beyond the one asked by a stick step (%), the ESC noise the RMS change of the pulses
+ * between two loops (us), which heats up the motors, and the saturation the loops with a motor at its limits (%).
+ * A flight that crashes, or tilts more than MAX_ANGLE, is discarded.
+ *
+ * The tuner runs:
+ *      1) a grid of roll and pitch P, I and D gains (roll and pitch share the gains, as in Config.h);
+ *      2) a grid of yaw P and I gains, with the best roll and pitch gains;
+ *      3) a local search around the best gains, halving the steps when no neighbour is better.
+ * Then it prints the best gains of the grid and the Config.h lines of the final gains.
+ *
+ * The setup of the sketch (11 s of gyroscope calibration) is simulated only once: then the program forks one
+ * process per flight, JOBS at a time, so the number of simulations per second grows with the cores of your computer.
+ *
+ * Compile and run it on your computer, from the /test dir:
+ *      g++ -O2 -std=gnu++11 -Isimulator -Isimulator/hal -I../include -I../src simulator/tuner.cpp -o tuner
+ *      ./tuner [jobs]
+ *
+ *
+ * @file tuner.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-17
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include "Simulation.h"
+#include <unistd.h>
+#include <sys/wait.h>
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ *
+ *
+ *      (ROLL AND PITCH GRID)
+ */
+#define P_MIN                       0.2
+#define P_MAX                       2.0
+#define P_STEPS                     16
+#define I_MIN                       0.0
+#define I_MAX                       0.06
+#define I_STEPS                     8
+#define D_MIN                       0.0
+#define D_MAX                       6.0
+#define D_STEPS                     16
+/**
+ *      (YAW GRID, no D as in Config.h)
+ */
+#define YAW_P_MIN                   1.0
+#define YAW_P_MAX                   10.0
+#define YAW_P_STEPS                 10
+#define YAW_I_MIN                   0.0
+#define YAW_I_MAX                   0.06
+#define YAW_I_STEPS                 7
+/**
+ *      (SCORE)
+ */
+#define OVERSHOOT_WEIGHT            0.05                      // (deg/s per %)
+#define NOISE_WEIGHT                0.2                       // (deg/s per us)
+#define SATURATION_WEIGHT           0.2                       // (deg/s per %)
+#define MAX_ANGLE                   45.0                      // (deg)
+/**
+ *      (FLIGHTS)
+ */
+#define FLIGHT_DURATION             20.0                      // (s) the steps last 12s after 8s of take off
+#define SEEDS                       2                         // flights with different sensor noise for each set of gains
+#define REFINE_ITERATIONS           12
+#define TABLE_ROWS                  15
+
+
+
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                              DO NOT CHANGE THIS VALUES
+ */
+#define GAINS                       5                         // roll P, I, D, yaw P, I
+#define DISCARDED                   1e9
+
+struct candidate {
+  double gains[GAINS];
+  simulationResult result;                                    // averaged on the seeds
+  double score;
+};
+
+double score(const simulationResult &r){
+  if(r.crashed || r.maxAngle > MAX_ANGLE) return DISCARDED;
+  return (r.rateError[0] + r.rateError[1] + r.rateError[2]) / 3.0 + OVERSHOOT_WEIGHT * r.overshoot +
+         NOISE_WEIGHT * r.escNoise + SATURATION_WEIGHT * r.saturation;
+}
+
+/**
+ * @brief Flies a set of gains in a child process, which writes the result in the pipe.
+ */
+void flyChild(const candidate &c, int seed, int pipeOut){
+  PGainRoll = PGainPitch = (float)c.gains[0];
+  IGainRoll = IGainPitch = (float)c.gains[1];
+  DGainRoll = DGainPitch = (float)c.gains[2];
+  PGainYaw = (float)c.gains[3];
+  IGainYaw = (float)c.gains[4];
+  world.noise = Noise(world.settings.seed + 7919 * seed);
+
+  simulationResult result;
+  flySimulation(result);
+  if(write(pipeOut, &result, sizeof(result)) != (ssize_t)sizeof(result)) _exit(1);
+  _exit(0);
+}
+
+/**
+ * @brief Flies all the candidates, jobs processes at a time, and scores them.
+ *
+ * @return double (s) wall time
+ */
+double evaluate(std::vector<candidate> &candidates, int jobs){
+
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  struct flight { pid_t pid; int pipeIn; size_t index; };
+  std::vector<flight> running;
+  size_t tasks = candidates.size() * SEEDS, next = 0;
+
+  for(size_t i = 0; i < candidates.size(); i++){
+    memset(&candidates[i].result, 0, sizeof(simulationResult));
+    candidates[i].score = 0.0;
+  }
+
+  fflush(stdout);
+  while(next < tasks || !running.empty()){
+
+    // start a new flight as soon as a job is free
+    while(next < tasks && (int)running.size() < jobs){
+      int fd[2];
+      if(pipe(fd) != 0){ perror("pipe"); exit(1); }
+      pid_t pid = fork();
+      if(pid < 0){ perror("fork"); exit(1); }
+      if(pid == 0){
+        close(fd[0]);
+        flyChild(candidates[next / SEEDS], (int)(next % SEEDS), fd[1]);
+      }
+      close(fd[1]);
+      flight f = {pid, fd[0], next};
+      running.push_back(f);
+      next++;
+    }
+
+    // collect a finished one
+    int status;
+    pid_t pid = wait(&status);
+    for(size_t i = 0; i < running.size(); i++){
+      if(running[i].pid != pid) continue;
+
+      simulationResult r;
+      memset(&r, 0, sizeof(r));
+      if(read(running[i].pipeIn, &r, sizeof(r)) != (ssize_t)sizeof(r)) r.crashed = true;
+      close(running[i].pipeIn);
+
+      candidate &c = candidates[running[i].index / SEEDS];
+      double s = score(r);
+      c.score += (s >= DISCARDED ? DISCARDED : s / SEEDS);
+      c.result.crashed |= r.crashed;
+      for(int k = 0; k < 3; k++) c.result.rateError[k] += r.rateError[k] / SEEDS;
+      c.result.overshoot += r.overshoot / SEEDS;
+      c.result.escNoise += r.escNoise / SEEDS;
+      c.result.saturation += r.saturation / SEEDS;
+      c.result.maxAngle = std::max(c.result.maxAngle, r.maxAngle);
+
+      running.erase(running.begin() + i);
+      break;
+    }
+  }
+
+  for(size_t i = 0; i < candidates.size(); i++)
+    if(candidates[i].score > DISCARDED) candidates[i].score = DISCARDED;
+
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool better(const candidate &a, const candidate &b){ return a.score < b.score; }
+
+double gridValue(double low, double high, int steps, int i){
+  return steps > 1 ? low + (high - low) * i / (steps - 1) : low;
+}
+
+void printThroughput(const char *stage, size_t flights, double seconds, int jobs){
+  printf("  %-22s %5zu flights in %6.1fs: %6.1f simulations/s, %5.1f per job (%d jobs)\n", stage, flights, seconds,
+         flights / seconds, flights / seconds / jobs, jobs);
+}
+
+void printTable(const std::vector<candidate> &candidates, int rows){
+  printf("\n  rank     P       I       D     yaw P   yaw I  |  rate err  overshoot  ESC noise  saturation  |  score\n");
+  for(int i = 0; i < rows && i < (int)candidates.size(); i++){
+    const candidate &c = candidates[i];
+    if(c.score >= DISCARDED) break;
+    printf("  %3d   %6.3f  %6.4f  %6.3f  %6.2f  %6.4f  |  %7.2f  %8.1f%%  %7.1fus  %9.1f%%  |  %6.2f\n", i + 1,
+           c.gains[0], c.gains[1], c.gains[2], c.gains[3], c.gains[4],
+           (c.result.rateError[0] + c.result.rateError[1] + c.result.rateError[2]) / 3.0, c.result.overshoot,
+           c.result.escNoise, c.result.saturation, c.score);
+  }
+}
+
+
+
+int main(int argc, char **argv){
+
+  int jobs = argc > 1 ? atoi(argv[1]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if(jobs < 1) jobs = 1;
+
+  simulationSettings settings = defaultSettings;
+  settings.scenario = STEPS;
+  settings.duration = FLIGHT_DURATION;
+
+  printf("\n  Simulating the setup... ");
+  startSimulation(settings);
+  printf("done, the drone is on the ground.\n\n");
+
+  // 1) roll and pitch
+  std::vector<candidate> grid;
+  for(int p = 0; p < P_STEPS; p++)
+    for(int i = 0; i < I_STEPS; i++)
+      for(int d = 0; d < D_STEPS; d++){
+        candidate c;
+        c.gains[0] = gridValue(P_MIN, P_MAX, P_STEPS, p);
+        c.gains[1] = gridValue(I_MIN, I_MAX, I_STEPS, i);
+        c.gains[2] = gridValue(D_MIN, D_MAX, D_STEPS, d);
+        c.gains[3] = PID_P_GAIN_YAW;
+        c.gains[4] = PID_I_GAIN_YAW;
+        grid.push_back(c);
+      }
+  double seconds = evaluate(grid, jobs);
+  printThroughput("roll and pitch grid", grid.size() * SEEDS, seconds, jobs);
+  std::stable_sort(grid.begin(), grid.end(), better);
+  if(grid[0].score >= DISCARDED){
+    printf("\n  Every set of gains crashed: check the grid limits.\n");
+    return 1;
+  }
+
+  // 2) yaw
+  std::vector<candidate> yawGrid;
+  for(int p = 0; p < YAW_P_STEPS; p++)
+    for(int i = 0; i < YAW_I_STEPS; i++){
+      candidate c = grid[0];
+      c.gains[3] = gridValue(YAW_P_MIN, YAW_P_MAX, YAW_P_STEPS, p);
+      c.gains[4] = gridValue(YAW_I_MIN, YAW_I_MAX, YAW_I_STEPS, i);
+      yawGrid.push_back(c);
+    }
+  seconds = evaluate(yawGrid, jobs);
+  printThroughput("yaw grid", yawGrid.size() * SEEDS, seconds, jobs);
+  std::stable_sort(yawGrid.begin(), yawGrid.end(), better);
+
+  // 3) local search: the neighbours of the best gains fly in parallel
+  candidate best = yawGrid[0].score < grid[0].score ? yawGrid[0] : grid[0];
+  double steps[GAINS] = {(P_MAX - P_MIN) / (P_STEPS - 1) / 2.0, (I_MAX - I_MIN) / (I_STEPS - 1) / 2.0,
+                         (D_MAX - D_MIN) / (D_STEPS - 1) / 2.0, (YAW_P_MAX - YAW_P_MIN) / (YAW_P_STEPS - 1) / 2.0,
+                         (YAW_I_MAX - YAW_I_MIN) / (YAW_I_STEPS - 1) / 2.0};
+  size_t refineFlights = 0;
+  seconds = 0.0;
+  for(int iteration = 0; iteration < REFINE_ITERATIONS; iteration++){
+    std::vector<candidate> neighbours;
+    for(int k = 0; k < GAINS; k++)
+      for(int sign = -1; sign <= 1; sign += 2){
+        candidate c = best;
+        c.gains[k] += sign * steps[k];
+        if(c.gains[k] < 0.0) continue;
+        neighbours.push_back(c);
+      }
+    seconds += evaluate(neighbours, jobs);
+    refineFlights += neighbours.size() * SEEDS;
+    std::stable_sort(neighbours.begin(), neighbours.end(), better);
+
+    if(!neighbours.empty() && neighbours[0].score < best.score) best = neighbours[0];
+    else for(int k = 0; k < GAINS; k++) steps[k] /= 2.0;
+  }
+  printThroughput("local search", refineFlights, seconds, jobs);
+
+  // results
+  printf("\n\n  BEST ROLL AND PITCH GAINS OF THE GRID (yaw as in Config.h)\n");
+  printTable(grid, TABLE_ROWS);
+  printf("\n\n  BEST YAW GAINS OF THE GRID\n");
+  printTable(yawGrid, 5);
+  std::vector<candidate> final(1, best);
+  printf("\n\n  AFTER THE LOCAL SEARCH\n");
+  printTable(final, 1);
+
+  printf("\n\n  Put these lines in your Config.h:\n\n");
+  printf("#define PID_P_GAIN_ROLL             %.3ff                    //Gain setting for the roll P-controller\n", best.gains[0]);
+  printf("#define PID_I_GAIN_ROLL             %.4ff                   //Gain setting for the roll I-controller\n", best.gains[1]);
+  printf("#define PID_D_GAIN_ROLL             %.3ff                    //Gain setting for the roll D-controller\n", best.gains[2]);
+  printf("#define PID_P_GAIN_YAW              %.3ff                    //Gain setting for the pitch P-controller.\n", best.gains[3]);
+  printf("#define PID_I_GAIN_YAW              %.4ff                   //Gain setting for the pitch I-controller.\n", best.gains[4]);
+  printf("\n  They come from a model of the drone: try them with care, and without propellers first.\n\n");
+
+  return 0;
+}
@@ -0,0 +1,238 @@
+/**
+*
+ *
+ *                       **********************************
+ *                       *      Thrust Compensation       *
+ *                       **********************************
+ *
+ *          Simulate a full battery discharge while DroneIno is hovering.
+ *
+ *
+ *                                  HOW IT WORKS:
+ *
+ * The drone hovers at a fixed altitude held by a PI controller, which plays the role of the altitude PID.
+ * The battery drains and its voltage sags. The program runs the discharge twice: the first time without
+ * BATTERY_COMPENSATION, the second time passing the mixer output through compensatePulse() (see ThrustCurve.h).
+ * For each step of the state of charge it prints the mixer output needed to hover: with the compensation
+ * it should stay constant, so the altitude PID does not have to recover the sag.
+ * The motors are not the model of ThrustCurve.h (otherwise the compensation would be exact by construction):
+ * the voltage on the windings is the battery one by the duty cycle, less the drop on MOTOR_RESISTANCE, and the
+ * thrust grows as that voltage to REAL_THRUST_EXPONENT. So the program checks that the fitted curve removes most of
+ * the drift and of the non linearity of the thrust, and returns 1 if it does not.
+ *
+ * Compile and run it on your computer:
+ *      g++ -O2 -I../include thrustCompensation.cpp -o thrustCompensation && ./thrustCompensation
+ *
+ *
+ * @file thrustCompensation.cpp
+ * @author @sebastiano123-c
+ * @brief
+ * @version 0.1
+ * @date 2022-06-10
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <stdio.h>
+#include <stdlib.h>
+#include "ThrustCurve.h"
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                                  PUT YOUR VALUES HERE
+ *
+ *
+ *      (DRONE)
+ */
+#define DRONE_MASS                  1.20                      // (kg) take off weight
+#define MAX_THRUST                  30.0                      // (N) total thrust of the four motors at full throttle
+/**
+ *      (BATTERY, as in Config.h)
+ */
+#define BATTERY_NUMBER_OF_CELLS     3
+#define BATTERY_CAPACITY            2200                      // (mAh)
+#define BATTERY_CELL_RESISTANCE     0.015                     // (Ohm)
+#define BATTERY_MAX_CURRENT         60.0                      // (A)
+#define BATTERY_REFERENCE_VOLTAGE   11.4                      // (V)
+#define THRUST_CURVE_EXPO           0.3
+/**
+ *      (REAL THRUST CURVE)
+ *      The thrust of the motors grows as x^REAL_THRUST_EXPONENT, x = command * voltage / BATTERY_REFERENCE_VOLTAGE:
+ *      2 is an ideal propeller with the speed proportional to the voltage, real ones are a bit below.
+ */
+#define REAL_THRUST_EXPONENT        1.6
+#define MOTOR_RESISTANCE            0.08                      // (Ohm) of the windings and the ESC of one motor
+/**
+ *      (LIMITS)
+ */
+#define MAX_COMPENSATED_DRIFT       15.0                      // (us) of the hover mixer output, with the compensation
+#define MAX_DRIFT_RATIO             0.25                      // of the drift with and without the compensation
+#define MAX_LINEARITY_ERROR         0.10                      // of the full thrust, with the compensation
+
+
+
+
+
+/**
+ * ---------------------------------------------------------------------------------------------------------------------------
+ *                                              DO NOT CHANGE THIS VALUES
+ *
+ *      (SIMULATION)
+ */
+#define LOOP_TIME                   0.004                     // (s) 250Hz as the flight controller
+#define GRAVITY                     9.81                      // (m/s^2)
+#define END_CELL_VOLTAGE            3.3                       // (V) stop the simulation under load
+/**
+ *      (CELL DISCHARGE CURVE, as in Globals.h)
+ */
+std::vector<float> cellDischargeCurve {3.27, 3.61, 3.69, 3.71, 3.73, 3.75, 3.77, 3.79, 3.80, 3.82, 3.84,
+                                       3.85, 3.87, 3.91, 3.95, 3.98, 4.02, 4.08, 4.11, 4.15, 4.20};
+
+
+/**
+ * @brief Open circuit voltage of a cell
+ *
+ * @param soc (%) state of charge
+ * @return float
+ */
+float cellVoltage(float soc){
+    float position = soc / 100. * (cellDischargeCurve.size() - 1);
+    int ii = (int)position;
+    if(ii >= (int)cellDischargeCurve.size() - 1) return cellDischargeCurve.back();
+    if(ii < 0) return cellDischargeCurve.front();
+    return cellDischargeCurve[ii] + (position - ii) * (cellDischargeCurve[ii + 1] - cellDischargeCurve[ii]);
+}
+
+
+/**
+ * @brief Thrust of the four motors, the plant of the simulation.
+ *
+ * @param pulse (us) ESC pulse
+ * @param batteryVoltage (V) under load
+ * @param current (A) drawn by the four motors, written
+ * @return float (N)
+ */
+float motorThrust(float pulse, float batteryVoltage, float &current){
+    float command = (pulse - 1000.) / 1000. * batteryVoltage / BATTERY_REFERENCE_VOLTAGE;
+    if(command <= 0.) { current = 0.; return 0.; }
+    current = BATTERY_MAX_CURRENT * command * sqrt(command);
+
+    float x = command - current / 4. * MOTOR_RESISTANCE / BATTERY_REFERENCE_VOLTAGE;     // on the windings
+    return x > 0. ? MAX_THRUST * pow(x, REAL_THRUST_EXPONENT) : 0.;
+}
+
+
+/**
+ * @brief Largest distance of the thrust from a straight line, from 1100us to 1900us of mixer output.
+ *
+ * @param compensation true to use compensatePulse()
+ * @return float fraction of the full thrust
+ */
+float linearityError(bool compensation){
+    float current, full = motorThrust(2000, BATTERY_REFERENCE_VOLTAGE, current), worst = 0.;
+    for(int mixer = 1100; mixer <= 1900; mixer += 10){
+        int16_t pulse = mixer;
+        if(compensation) pulse = compensatePulse(mixer, 1., THRUST_CURVE_EXPO);
+        worst = std::max(worst, (float)fabs(motorThrust(pulse, BATTERY_REFERENCE_VOLTAGE, current) / full - (mixer - 1000.) / 1000.));
+    }
+    return worst;
+}
+
+
+/**
+ * @brief Simulates the hover until the battery is empty.
+ *
+ * @param compensation true to use compensatePulse()
+ * @param mixerOutput mean mixer output for every 5% of state of charge
+ * @param escPulse mean ESC pulse for every 5% of state of charge
+ * @param voltage mean battery voltage for every 5% of state of charge
+ */
+void simulateDischarge(bool compensation, std::vector<float> &mixerOutput, std::vector<float> &escPulse, std::vector<float> &voltage){
+
+    float soc = 100., altitude = 0., speed = 0., integral = 0., current = 0.;
+    float sumMixer = 0., sumEsc = 0., sumVoltage = 0.;
+    int samples = 0, step = 19;
+
+    while(step >= 0){
+
+        // battery
+        float batteryVoltage = BATTERY_NUMBER_OF_CELLS * (cellVoltage(soc) - current * BATTERY_CELL_RESISTANCE);
+        if(batteryVoltage / BATTERY_NUMBER_OF_CELLS < END_CELL_VOLTAGE) break;
+
+        // altitude controller, the same output is sent to the four motors
+        integral += -altitude * 40. * LOOP_TIME;
+        int16_t mixer = (int16_t)(1350. + integral - altitude * 200. - speed * 150.);
+        if(mixer > 2000) mixer = 2000;
+        if(mixer < 1100) mixer = 1100;
+
+        int16_t pulse = mixer;
+        if(compensation) pulse = compensatePulse(mixer, voltageScale(batteryVoltage, BATTERY_REFERENCE_VOLTAGE, 9.), THRUST_CURVE_EXPO);
+
+        // motors
+        float thrust = motorThrust(pulse, batteryVoltage, current);
+
+        // vertical dynamics
+        speed += (thrust / DRONE_MASS - GRAVITY) * LOOP_TIME;
+        altitude += speed * LOOP_TIME;
+
+        // discharge
+        soc -= current * LOOP_TIME / 3.6 / BATTERY_CAPACITY * 100.;
+
+        sumMixer += mixer;
+        sumEsc += pulse;
+        sumVoltage += batteryVoltage;
+        samples++;
+
+        if(soc < step * 5.){
+            mixerOutput[step] = sumMixer / samples;
+            escPulse[step] = sumEsc / samples;
+            voltage[step] = sumVoltage / samples;
+            sumMixer = 0., sumEsc = 0., sumVoltage = 0.;
+            samples = 0;
+            step--;
+        }
+    }
+}
+
+
+int main(){
+
+    std::vector<float> rawMixer(20, 0.), rawEsc(20, 0.), rawVoltage(20, 0.);
+    std::vector<float> compMixer(20, 0.), compEsc(20, 0.), compVoltage(20, 0.);
+
+    simulateDischarge(false, rawMixer, rawEsc, rawVoltage);
+    simulateDischarge(true, compMixer, compEsc, compVoltage);
+
+    printf("\n          WITHOUT COMPENSATION          |            WITH COMPENSATION");
+    printf("\n  SoC    voltage    mixer output        |   voltage    mixer output    ESC pulse\n");
+
+    for(int step = 19; step >= 0; step--){
+        if(rawVoltage[step] == 0. && compVoltage[step] == 0.) continue;
+        printf("\n %3i%%    %6.2fV     %7.1fus           |   %6.2fV     %7.1fus      %7.1fus",
+               (step + 1) * 5, rawVoltage[step], rawMixer[step], compVoltage[step], compMixer[step], compEsc[step]);
+    }
+
+    // spread of the hover mixer output
+    float rawMin = 2000., rawMax = 0., compMin = 2000., compMax = 0.;
+    for(int step = 0; step < 20; step++){
+        if(rawMixer[step] > 0.){ rawMin = std::min(rawMin, rawMixer[step]); rawMax = std::max(rawMax, rawMixer[step]); }
+        if(compMixer[step] > 0.){ compMin = std::min(compMin, compMixer[step]); compMax = std::max(compMax, compMixer[step]); }
+    }
+
+    float rawDrift = rawMax - rawMin, compDrift = compMax - compMin;
+    bool ok = compDrift < MAX_COMPENSATED_DRIFT && compDrift < MAX_DRIFT_RATIO * rawDrift;
+
+    printf("\n\n Hover mixer output drift: %.1fus without compensation, %.1fus with compensation: %s \n",
+           rawDrift, compDrift, ok ? "ok" : "FAILED");
+
+    float rawLinearity = linearityError(false), compLinearity = linearityError(true);
+    bool linear = compLinearity < MAX_LINEARITY_ERROR && compLinearity < rawLinearity;
+
+    printf(" Thrust non linearity: %.1f%% without compensation, %.1f%% with compensation: %s \n",
+           rawLinearity * 100., compLinearity * 100., linear ? "ok" : "FAILED");
+
+    return ok && linear ? 0 : 1;
+}
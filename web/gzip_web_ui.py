@@ -0,0 +1,62 @@
+"""
+Gzips web/index.html into include/wifi/web_ui.h, the page served from the flash by the NATIVE telemetry
+(see include/WiFiTelemetry.h) and by the ESP32-CAM (see esp32cam/include/CamServer.h).
+
+PlatformIO runs it before every build (extra_scripts in platformio.ini and in esp32cam/platformio.ini). With the Arduino IDE run it by hand,
+from the root of the repository, after changing the page:
+    python web/gzip_web_ui.py
+The header is written only when the page changes, and the gzip has no time stamp, so the same page always gives
+the same header.
+"""
+import gzip
+import io
+import os
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__))) if "__file__" in globals() else os.getcwd()
+SOURCE = os.path.join(ROOT, "web", "index.html")
+HEADER = os.path.join(ROOT, "include", "wifi", "web_ui.h")
+
+
+def gzip_web_ui():
+    with open(SOURCE, "rb") as f:
+        page = f.read()
+
+    buffer = io.BytesIO()
+    with gzip.GzipFile(filename="", mode="wb", compresslevel=9, fileobj=buffer, mtime=0) as g:
+        g.write(page)
+    data = buffer.getvalue()
+
+    lines = []
+    for i in range(0, len(data), 20):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 20]) + ",")
+
+    text = ("/**\n"
+            " * @file web_ui.h\n"
+            " * @brief web/index.html gzip'd (%d bytes, %d before), written by web/gzip_web_ui.py: do not change it.\n"
+            " */\n"
+            "\n"
+            "const size_t WEB_UI_LENGTH = %d;\n"
+            "const uint8_t WEB_UI[] PROGMEM = {\n"
+            "%s\n"
+            "};\n") % (len(data), len(page), len(data), "\n".join(lines))
+
+    if os.path.exists(HEADER):
+        with open(HEADER) as f:
+            if f.read() == text:
+                return
+    with open(HEADER, "w") as f:
+        f.write(text)
+    print("gzip_web_ui: %s, %d bytes" % (HEADER, len(data)))
+
+
+try:
+    Import("env")  # noqa: F821 (PlatformIO)
+    ROOT = env.subst("$PROJECT_DIR")  # noqa: F821
+    if not os.path.exists(os.path.join(ROOT, "web", "index.html")):
+        ROOT = os.path.dirname(ROOT)  # the esp32cam project, inside the repository
+    SOURCE = os.path.join(ROOT, "web", "index.html")
+    HEADER = os.path.join(ROOT, "include", "wifi", "web_ui.h")
+except NameError:
+    pass
+
+gzip_web_ui()